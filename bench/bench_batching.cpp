@@ -0,0 +1,180 @@
+// Bursts of tiny messages with and without the batching subprotocol: the
+// client writes a burst of messages at once and waits for all the echoes.
+// Without batching every message is its own masked frame, parsed, echoed
+// and framed again by the server. With it the burst is one frame of
+// length prefixed messages, unpacked in place and echoed as one batch.
+// Every case runs with and without a batch handler; the handler copies
+// each message into the reply batch, which is what a real one would have
+// to do at least. Every mode gets TCP_NODELAY and write coalescing, the
+// best the server does for separate frames. cpu is the server's, per
+// message.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/batch.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include "ws/handshake.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19800;
+static constexpr std::chrono::seconds CaseDuration{2};
+static constexpr std::size_t Burst = 64; ///< messages per client write
+
+enum class Mode
+{
+    Frames,  ///< one frame per message
+    Batch,   ///< one batch per burst, echoed as is
+    Handler, ///< one batch per burst, answered by a batch handler
+};
+
+char const*
+to_string(Mode mode)
+{
+    switch (mode) {
+        case Mode::Batch:
+            return "batch";
+        case Mode::Handler:
+            return "batch+handler";
+        case Mode::Frames:
+        default:
+            return "frames";
+    }
+}
+
+/// connect_tcp() and an upgrade offering the batching subprotocol
+/// \return socket, or -1 on error (or if the server didn't agree)
+int
+connect_batching(int port)
+{
+    int const fd = connect_tcp(port);
+    if (fd == -1) {
+        return -1;
+    }
+    std::string const key = frame_generator::generate_websocket_key();
+    std::string const request = make_upgrade_request("127.0.0.1", "/", key, BatchProtocol);
+    std::string response;
+    if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) != -1) {
+        char buf[1024];
+        while (!response.contains("\r\n\r\n")) {
+            ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+            if (nbytes <= 0) {
+                break;
+            }
+            response.append(buf, static_cast<std::size_t>(nbytes));
+        }
+    }
+    if (!validate_upgrade_response(response, websocket_accept_key(key), BatchProtocol)) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool
+run_case(std::size_t size, Mode mode, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.max_frames_per_iteration = 0;
+    config.sockets.nodelay = true;
+    config.coalesce_writes = true;
+    config.batching = mode != Mode::Frames;
+    if (mode == Mode::Handler) {
+        config.on_batch = [](std::span<std::span<std::uint8_t const> const> messages,
+                                  batch_writer& replies) {
+            for (auto const message : messages) {
+                replies.add(message);
+            }
+        };
+    }
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    // one write carries the whole burst, as frames or as a batch
+    std::vector<std::uint8_t> const payload(size, 'b');
+    frame_generator generator;
+    std::vector<std::uint8_t> request;
+    std::size_t response_size = 0;
+    if (mode == Mode::Frames) {
+        for (std::size_t i = 0; i < Burst; ++i) {
+            auto const frame = generator.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+            request.insert(request.end(), frame.begin(), frame.end());
+        }
+        response_size = Burst * (frame_header_size(size) + size);
+    } else {
+        batch_writer batch;
+        for (std::size_t i = 0; i < Burst; ++i) {
+            batch.add(payload);
+        }
+        auto const frame = generator.binary(batch.data(), /*fin=*/true, /*mask=*/true).take_data();
+        request.assign(frame.begin(), frame.end());
+        response_size = frame_header_size(batch.data().size()) + batch.data().size();
+    }
+
+    auto const start = clock::now();
+    int const fd = mode == Mode::Frames ? connect_websocket(port) : connect_batching(port);
+    bool ok = fd != -1;
+    std::size_t rounds = 0;
+    while (ok && clock::now() - start < CaseDuration) {
+        ok = round_trip(fd, request, response_size);
+        ++rounds;
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const messages = static_cast<double>(rounds * Burst);
+    std::print("{:>6} {:<14} {:>12.0f} {:>12.1f} {:>12.0f}\n", size, to_string(mode),
+            messages / elapsed.count(), static_cast<double>(request.size()) / Burst,
+            server_cpu * 1e9 / messages);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("bursts of {} messages, {}s per case\n{:>6} {:<14} {:>12} {:>12} {:>12}\n", Burst,
+            CaseDuration.count(), "bytes", "mode", "msgs/s", "wire B/msg", "srv ns/msg");
+
+    int port = BasePort;
+    for (std::size_t const size : {16UL, 32UL, 64UL, 128UL, 256UL}) {
+        for (Mode const mode : {Mode::Frames, Mode::Batch, Mode::Handler}) {
+            if (!run_case(size, mode, port++)) {
+                std::print(stderr, "{} byte {} failed\n", size, to_string(mode));
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
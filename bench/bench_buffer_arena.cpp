@@ -0,0 +1,165 @@
+// Per-message buffer work at high connection counts: every message lands
+// in a random connection's read buffer, is parsed and queued on its send
+// queue, as the echo path does, with the buffers from the heap vs the
+// huge page arena (util/buffer_arena.hpp). Reports ns/msg, msgs/s and
+// dTLB load misses per message (n/a where perf counters aren't available).
+
+#include "bench_utils.hpp"
+#include "util/buffer_arena.hpp"
+#include "util/byte_buffer.hpp"
+#include "util/random.hpp"
+#include <linux/perf_event.h>
+#include <sys/syscall.h> // SYS_perf_event_open
+#include <unistd.h>      // ::close, ::read, ::syscall
+#include <cstring>       // std::memcpy, std::memset
+#include <format>
+#include <fstream>
+#include <string>
+#include <utility> // std::move
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr std::uint64_t Messages = 2'000'000;
+static constexpr std::size_t ReadBufferSize = 16384; ///< 1 MiB buffers would fault in 2 MiB each
+static constexpr std::size_t SendQueueSize = 4096;
+static constexpr std::size_t MessageSize = 64;
+
+/// dTLB load misses of the calling thread, if the kernel lets us count them
+class dtlb_counter
+{
+public:
+    dtlb_counter() noexcept
+    {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~dtlb_counter() noexcept
+    {
+        if (fd_ != -1) {
+            ::close(fd_);
+        }
+    }
+
+    dtlb_counter(dtlb_counter const&) = delete;
+    dtlb_counter& operator=(dtlb_counter const&) = delete;
+
+    bool
+    available() const noexcept
+    {
+        return fd_ != -1;
+    }
+
+    std::uint64_t
+    read() const noexcept
+    {
+        std::uint64_t count = 0;
+        if (fd_ == -1 || ::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+            return 0;
+        }
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/// Transparent huge pages backing this process, in MiB
+std::size_t
+anon_huge_pages_mib()
+{
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.starts_with("AnonHugePages:")) {
+            return std::stoul(line.substr(sizeof("AnonHugePages:"))) / 1024;
+        }
+    }
+    return 0;
+}
+
+struct connection
+{
+    byte_buffer<ReadBufferSize> in;
+    arena_bytes out;
+};
+
+/// Connections of finished cases. Kept so their blocks aren't recycled
+/// by a later case with another backing.
+std::vector<std::vector<connection>> retired;
+
+void
+run_case(char const* name, ArenaBacking backing, std::size_t connection_count)
+{
+    buffer_arena::instance().set_backing(backing);
+
+    std::vector<connection> connections(connection_count);
+    for (connection& c : connections) {
+        c.out.reserve(SendQueueSize);
+    }
+    std::uint8_t message[MessageSize];
+    std::memset(message, 'm', sizeof(message));
+
+    // one message: "recv" into the read buffer, parse it, queue the echo
+    std::uint64_t checksum = 0;
+    auto const handle_message = [&] {
+        connection& c = connections[fast_random_u32() % connection_count];
+        std::memcpy(c.in.write_ptr(), message, sizeof(message));
+        c.in.bytes_written(sizeof(message));
+        checksum += c.in.read_ptr()[0] + c.in.read_ptr()[MessageSize - 1];
+        c.out.insert(c.out.end(), c.in.read_ptr(), c.in.read_ptr() + MessageSize);
+        c.in.bytes_read(MessageSize);
+        c.in.shift();
+        if (c.out.size() + MessageSize > SendQueueSize) {
+            c.out.clear(); // "flushed"
+        }
+    };
+
+    dtlb_counter const dtlb;
+    std::uint64_t const misses_before = dtlb.read();
+    result const r = measure(Messages, handle_message);
+    std::uint64_t const misses = dtlb.read() - misses_before;
+    do_not_optimize(checksum);
+    retired.push_back(std::move(connections));
+
+    // measure() runs a tenth of the iterations again as warm-up
+    std::string const misses_per_msg = dtlb.available()
+            ? std::format("{:.3f}",
+                      static_cast<double>(misses) / static_cast<double>(Messages + Messages / 10))
+            : "n/a";
+    arena_stats const stats = buffer_arena::instance().stats();
+    std::print("{:<10} {:>6} {:>10.1f} {:>12.0f} {:>13} {:>8} {:>8} {:>8}\n", name,
+            connection_count, r.ns_per_op, r.ops_per_sec, misses_per_msg, stats.regions,
+            stats.hugetlb_regions, anon_huge_pages_mib());
+}
+
+} // namespace
+
+
+int
+main()
+{
+    std::print("per-message buffer work, {} byte messages to random connections\n"
+               "(regions/hugetlb: arena regions mapped so far, thp: AnonHugePages MiB)\n",
+            MessageSize);
+    std::print("{:<10} {:>6} {:>10} {:>12} {:>13} {:>8} {:>8} {:>8}\n", "backing", "conns",
+            "ns/msg", "msgs/s", "dTLB miss/msg", "regions", "hugetlb", "thp");
+
+    for (std::size_t const connections : {1'000UL, 8'000UL, 32'000UL}) {
+        run_case("heap", ArenaBacking::Heap, connections);
+        run_case("thp", ArenaBacking::HugePages, connections);
+        run_case("hugetlb", ArenaBacking::HugeTlb, connections);
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Loopback echo round-trip latency for each event loop poll mode. The
+// server runs on the first allowed cpu and the client on the second (the
+// same one if there is only one, where spinning mostly hurts). Each mode
+// runs back to back and with a think time between messages, which is
+// where a blocking loop pays for going to sleep.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "echo_server/reactor_pool.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <chrono>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 18400;
+static constexpr std::size_t RoundTrips = 20'000;
+static constexpr std::size_t PayloadSize = 64;
+
+struct scenario
+{
+    char const* name;
+    PollMode mode;
+    unsigned busy_poll_usecs;
+};
+
+bool
+run_scenario(scenario const& s, int port, std::chrono::microseconds think_time,
+        std::vector<int> const& cpus)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.poll_mode = s.mode;
+    config.busy_poll_usecs = s.busy_poll_usecs;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        pin_to_cpu(cpus.front());
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    pin_to_cpu(cpus.size() > 1 ? cpus[1] : cpus.front());
+
+    std::vector<std::uint8_t> const payload(PayloadSize, 'x');
+    auto const request
+            = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+
+    std::vector<double> rtts;
+    rtts.reserve(RoundTrips);
+    auto const start = clock::now();
+    int const fd = connect_websocket(port);
+    bool ok = fd != -1;
+    for (std::size_t i = 0; ok && i < RoundTrips; ++i) {
+        if (think_time.count() != 0) {
+            std::this_thread::sleep_for(think_time);
+        }
+        auto const sent = clock::now();
+        ok = round_trip(fd, request, MinFrameHeaderSize + PayloadSize);
+        std::chrono::duration<double, std::micro> const rtt = clock::now() - sent;
+        rtts.push_back(rtt.count());
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    server.request_shutdown();
+    server_thread.join();
+
+    latency_summary const latency = summarize(rtts);
+    std::print("{:<26} {:>10.1f} {:>10.1f} {:>10.1f} {:>9.0f}%\n", s.name, latency.p50,
+            latency.p99, latency.p999, 100.0 * server_cpu / elapsed.count());
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<int> const cpus = reactor_pool::allowed_cpus();
+    std::print("server on cpu {}, client on cpu {}, {} round trips of {} bytes\n", cpus.front(),
+            cpus.size() > 1 ? cpus[1] : cpus.front(), RoundTrips, PayloadSize);
+
+    scenario const scenarios[] = {
+            {"block (10ms epoll_wait)", PollMode::Block, 0},
+            {"spin", PollMode::Spin, 0},
+            {"hybrid (100us window)", PollMode::Hybrid, 0},
+            {"block + busy poll 50us", PollMode::Block, 50},
+            {"spin + busy poll 50us", PollMode::Spin, 50},
+    };
+
+    int port = BasePort;
+    for (auto const think_time : {std::chrono::microseconds(0), std::chrono::microseconds(50)}) {
+        std::print("\nthink time {}us\n{:<26} {:>10} {:>10} {:>10} {:>10}\n", think_time.count(),
+                "mode", "p50 us", "p99 us", "p99.9 us", "srv cpu");
+        for (auto const& s : scenarios) {
+            if (!run_scenario(s, port++, think_time, cpus)) {
+                std::print(stderr, "scenario '{}' failed\n", s.name);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
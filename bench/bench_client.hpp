@@ -0,0 +1,226 @@
+#pragma once
+
+// Minimal blocking websocket client for end-to-end benchmarks against an
+// in-process server on loopback. Errors are reported as -1 / false;
+// benchmarks just give up on the scenario.
+
+#include "util/socket_address.hpp"
+#include "ws/frame_generator.hpp"
+#include <arpa/inet.h>   // ::inet_pton
+#include <netinet/in.h>  // sockaddr_in
+#include <netinet/tcp.h> // TCP_NODELAY, TCP_FASTOPEN_CONNECT
+#include <pthread.h>     // ::pthread_setaffinity_np
+#include <sched.h>       // CPU_SET
+#include <sys/socket.h>
+#include <unistd.h>    // ::close
+#include <algorithm>   // std::min, std::sort
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memmove
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace ws::bench {
+
+/// Connect to 127.0.0.1:port with TCP_NODELAY set. With \c fastopen the
+/// connect returns at once and the first send goes out in the SYN.
+/// \return socket, or -1 on error
+inline int
+connect_tcp(int port, bool fastopen = false) noexcept
+{
+    int const fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    int const yes = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    if (fastopen) {
+        ::setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &yes, sizeof(yes));
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    if (::connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == -1) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// Send the http upgrade request on \c fd and wait for the 101 response
+/// \return \c false on error
+inline bool
+upgrade(int fd)
+{
+    std::string const request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\n"
+                                "Connection: Upgrade\r\nSec-WebSocket-Key: "
+            + frame_generator::generate_websocket_key()
+            + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) == -1) {
+        return false;
+    }
+
+    std::string response;
+    char buf[1024];
+    while (!response.contains("\r\n\r\n")) {
+        ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+        if (nbytes <= 0) {
+            return false;
+        }
+        response.append(buf, static_cast<std::size_t>(nbytes));
+    }
+    return response.starts_with("HTTP/1.1 101");
+}
+
+/// connect_tcp() followed by upgrade()
+/// \return socket, or -1 on error
+inline int
+connect_websocket(int port, bool fastopen = false)
+{
+    int const fd = connect_tcp(port, fastopen);
+    if (fd != -1 && !upgrade(fd)) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// connect_socket() to any address (a unix domain socket, say) followed
+/// by upgrade()
+/// \return socket, or -1 on error
+inline int
+connect_websocket(socket_address const& address)
+{
+    int const fd = connect_socket(address);
+    if (fd != -1 && !upgrade(fd)) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// Send one (masked) frame and read back \c response_size bytes
+/// \return \c false on error
+inline bool
+round_trip(int fd, std::span<std::uint8_t const> request, std::size_t response_size) noexcept
+{
+    if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL)
+            != static_cast<ssize_t>(request.size())) {
+        return false;
+    }
+
+    std::uint8_t buf[4096];
+    std::size_t received = 0;
+    while (received < response_size) {
+        ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+        if (nbytes <= 0) {
+            return false;
+        }
+        received += static_cast<std::size_t>(nbytes);
+    }
+    return true;
+}
+
+/// Read unmasked server frames from \c fd until \c payload_size bytes of
+/// payload have arrived, however the server chose to split them up
+/// \return \c false on error
+inline bool
+receive_payload(int fd, std::size_t payload_size) noexcept
+{
+    std::uint8_t buf[65536];
+    std::size_t begin = 0;        ///< first byte not looked at yet
+    std::size_t end = 0;          ///< one past the last byte received
+    std::uint64_t frame_left = 0; ///< payload bytes of the current frame still to come
+    std::size_t received = 0;     ///< payload bytes seen so far
+
+    auto const fill = [&]() {
+        std::memmove(buf, buf + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        ssize_t const nbytes = ::recv(fd, buf + end, sizeof(buf) - end, 0);
+        if (nbytes <= 0) {
+            return false;
+        }
+        end += static_cast<std::size_t>(nbytes);
+        return true;
+    };
+
+    while (received < payload_size) {
+        // payload bytes are only counted
+        if (frame_left > 0) {
+            if (begin == end && !fill()) {
+                return false;
+            }
+            std::size_t const take = std::min<std::uint64_t>(frame_left, end - begin);
+            begin += take;
+            frame_left -= take;
+            received += take;
+            continue;
+        }
+
+        std::size_t const available = end - begin;
+        std::size_t header_size = MinFrameHeaderSize;
+        if (available >= MinFrameHeaderSize) {
+            std::uint8_t const len7 = buf[begin + 1] & 0x7f;
+            header_size += len7 == 126 ? 2 : len7 == 127 ? 8 : 0;
+        }
+        if (available < header_size) {
+            if (!fill()) {
+                return false;
+            }
+            continue;
+        }
+
+        frame_left = buf[begin + 1] & 0x7f;
+        if (header_size > MinFrameHeaderSize) {
+            frame_left = 0;
+            for (std::size_t i = MinFrameHeaderSize; i < header_size; ++i) {
+                frame_left = (frame_left << 8) | buf[begin + i];
+            }
+        }
+        begin += header_size;
+    }
+    return true;
+}
+
+/// Pin the calling thread to \c cpu; a no-op for cpu -1
+inline void
+pin_to_cpu(int cpu) noexcept
+{
+    if (cpu == -1) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<std::size_t>(cpu), &set);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+}
+
+/// Round-trip latency percentiles, in microseconds
+struct latency_summary
+{
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+};
+
+/// Sorts \c samples
+inline latency_summary
+summarize(std::vector<double>& samples)
+{
+    if (samples.empty()) {
+        return {};
+    }
+    std::sort(samples.begin(), samples.end());
+    auto const at = [&](double p) {
+        return samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))];
+    };
+    return {at(0.50), at(0.99), at(0.999)};
+}
+
+} // namespace ws::bench
@@ -0,0 +1,129 @@
+// ws::client driving an in-process echo server: CONNS connections on one
+// client thread, each keeping Pipeline messages in flight (every echo that
+// comes back sends the next message). msgs/core-s divides the messages
+// echoed by the cpu time of the client thread alone, i.e. what one core
+// running the client engine sustains; wr/msg is send(2) calls per message.
+
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/client.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19300;
+static constexpr std::chrono::seconds CaseDuration{2};
+static constexpr std::chrono::seconds ConnectTimeout{30};
+static constexpr std::chrono::milliseconds PollTimeout{10};
+static constexpr std::size_t Pipeline = 8;
+static constexpr std::size_t ConnectBatch = 8; ///< the server's listen backlog is small
+
+bool
+run_case(std::size_t connections, std::size_t payload_size, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+
+    echo_server server(config);
+    std::thread server_thread([&] { server.run(); });
+
+    std::vector<std::uint8_t> const payload(payload_size, 'c');
+    std::size_t opened = 0;
+    std::uint64_t echoed = 0;
+    bool failed = false;
+
+    client_config options;
+    options.reconnect = false;
+    client* engine = nullptr;
+    options.on_open = [&](std::uint64_t id) {
+        ++opened;
+        for (std::size_t i = 0; i < Pipeline; ++i) {
+            engine->send(id, payload);
+        }
+    };
+    options.on_message = [&](std::uint64_t id, OpCode, std::span<std::uint8_t const>) {
+        ++echoed;
+        engine->send(id, payload);
+    };
+    options.on_close = [&](std::uint64_t, std::uint16_t) { failed = true; };
+
+    client c(options);
+    engine = &c;
+    std::string const address = "127.0.0.1:" + std::to_string(port);
+
+    // open the connections a few at a time
+    auto const connect_deadline = clock::now() + ConnectTimeout;
+    for (std::size_t connected = 0; connected < connections && !failed;) {
+        std::size_t const batch = std::min(ConnectBatch, connections - connected);
+        for (std::size_t i = 0; i < batch; ++i) {
+            c.connect(address);
+        }
+        connected += batch;
+        while (opened < connected && clock::now() < connect_deadline && c.poll(PollTimeout)) {
+        }
+        failed = failed || opened < connected;
+    }
+
+    // warm up, then measure
+    auto const warm_up_end = clock::now() + std::chrono::milliseconds(200);
+    while (!failed && clock::now() < warm_up_end && c.poll(PollTimeout)) {
+    }
+    std::uint64_t const echoed_before = echoed;
+    std::uint64_t const writes_before = c.stats().write_syscalls;
+    double const cpu_before = thread_cpu_seconds();
+    auto const start = clock::now();
+    while (!failed && clock::now() - start < CaseDuration && c.poll(PollTimeout)) {
+    }
+    double const cpu = thread_cpu_seconds() - cpu_before;
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+    auto const msgs = static_cast<double>(std::max<std::uint64_t>(echoed - echoed_before, 1));
+    auto const writes = static_cast<double>(c.stats().write_syscalls - writes_before);
+
+    // answer the server's close frames so its drain doesn't wait them out
+    bool const ok = !failed;
+    server.request_shutdown();
+    while (c.size() != 0 && c.poll(PollTimeout)) {
+    }
+    server_thread.join();
+
+    std::print("{:>6} {:>8} {:>12.0f} {:>12.0f} {:>10.2f}\n", connections, payload_size,
+            msgs / elapsed.count(), msgs / cpu, writes / msgs);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{} messages in flight per connection, {}s per case\n"
+               "{:>6} {:>8} {:>12} {:>12} {:>10}\n",
+            Pipeline, CaseDuration.count(), "conns", "bytes", "msgs/s", "msgs/core-s", "wr/msg");
+
+    int port = BasePort;
+    for (std::size_t const connections : {1UL, 64UL, 1024UL}) {
+        for (std::size_t const payload_size : {32UL, 1024UL}) {
+            if (!run_case(connections, payload_size, port++)) {
+                std::print(stderr, "{} connections, {} bytes failed\n", connections, payload_size);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
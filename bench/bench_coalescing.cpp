@@ -0,0 +1,104 @@
+// Pipelined small echoes with and without write coalescing: the client
+// sends a burst of messages in one write and waits for all the echoes.
+// Without coalescing every echo is its own send; with it a connection's
+// echoes from one event loop pass leave in a single syscall. Without
+// coalescing (and without TCP_NODELAY) bursts also run into nagle holding
+// back every echo after the first until the client's delayed ack.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 18800;
+static constexpr std::chrono::seconds CaseDuration{2};
+static constexpr std::size_t PayloadSize = 64;
+
+bool
+run_case(std::size_t burst, bool coalesce, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.coalesce_writes = coalesce;
+    config.max_frames_per_iteration = 0;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    // one write carries the whole burst
+    std::vector<std::uint8_t> const payload(PayloadSize, 'c');
+    frame_generator generator;
+    std::vector<std::uint8_t> request;
+    for (std::size_t i = 0; i < burst; ++i) {
+        auto const frame = generator.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+        request.insert(request.end(), frame.begin(), frame.end());
+    }
+    std::size_t const response_size = burst * (MinFrameHeaderSize + PayloadSize);
+
+    auto const start = clock::now();
+    int const fd = connect_websocket(port);
+    bool ok = fd != -1;
+    std::size_t rounds = 0;
+    while (ok && clock::now() - start < CaseDuration) {
+        ok = round_trip(fd, request, response_size);
+        ++rounds;
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const messages = static_cast<double>(rounds * burst);
+    server_stats const& stats = server.stats();
+    std::print("{:>6} {:<10} {:>12.0f} {:>14.3f} {:>14.2f}\n", burst,
+            coalesce ? "coalesce" : "send", messages / elapsed.count(),
+            static_cast<double>(stats.write_syscalls) / messages, server_cpu * 1e9 / messages);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{} byte messages, {}s per case\n{:>6} {:<10} {:>12} {:>14} {:>14}\n", PayloadSize,
+            CaseDuration.count(), "burst", "writes", "msgs/s", "syscalls/msg", "srv ns/msg");
+
+    int port = BasePort;
+    for (std::size_t const burst : {1UL, 8UL, 32UL, 128UL}) {
+        for (bool const coalesce : {false, true}) {
+            if (!run_case(burst, coalesce, port++)) {
+                std::print(stderr, "burst of {} ({}) failed\n", burst,
+                        coalesce ? "coalesce" : "send");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+// Compares building server frames through frame_generator (heap vector
+// per frame) with the precomputed/encoded headers from frame_header.hpp,
+// both in isolation and in a ping/pong-heavy loop over a socketpair.
+
+#define WS_BENCH_COUNT_ALLOCATIONS
+#include "bench_utils.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <format>
+#include <print>
+#include <span>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr std::uint64_t Iterations = 2'000'000;
+static constexpr std::uint64_t RoundTrips = 100'000;
+
+void
+bench_frame_building()
+{
+    print_header("frame building");
+
+    std::array<std::uint8_t, 16> const ping_payload{};
+
+    print_result("pong, empty (frame_generator)", measure(Iterations, [] {
+        auto gen = frame_generator{}.pong();
+        do_not_optimize(gen.data().data());
+    }));
+    print_result("pong, empty (control_frame_buffer)", measure(Iterations, [] {
+        control_frame_buffer const frame(OpCode::Pong);
+        do_not_optimize(frame);
+    }));
+    print_result("pong, 16 bytes (frame_generator)", measure(Iterations, [&] {
+        auto gen = frame_generator{}.pong(ping_payload);
+        do_not_optimize(gen.data().data());
+    }));
+    print_result("pong, 16 bytes (control_frame_buffer)", measure(Iterations, [&] {
+        control_frame_buffer const frame(OpCode::Pong, ping_payload);
+        do_not_optimize(frame);
+    }));
+    print_result("close 1001 (frame_generator)", measure(Iterations, [] {
+        auto gen = frame_generator{}.close(1001);
+        do_not_optimize(gen.data().data());
+    }));
+    print_result("close 1001 (CloseGoingAwayFrame)", measure(Iterations, [] {
+        std::span<std::uint8_t const> frame = CloseGoingAwayFrame;
+        do_not_optimize(frame);
+    }));
+
+    for (std::size_t const len : {64UL, 1024UL, 65536UL}) {
+        std::vector<std::uint8_t> const payload(len, 'x');
+        std::uint64_t const iterations = len > 1024 ? Iterations / 20 : Iterations;
+
+        print_result(std::format("echo header, {} bytes (frame_generator)", len),
+                measure(iterations, [&] {
+                    auto gen = frame_generator{}.binary(payload);
+                    do_not_optimize(gen.data().data());
+                }));
+        print_result(std::format("echo header, {} bytes (encode_frame_header)", len),
+                measure(iterations, [&] {
+                    std::uint8_t header[MaxFrameHeaderSize];
+                    std::size_t const size
+                            = encode_frame_header(header, OpCode::Binary, payload.size());
+                    do_not_optimize(header);
+                    do_not_optimize(size);
+                }));
+    }
+}
+
+/// One side plays the client (masked pings), the other the server
+/// (parse, reply with a pong); \c reply builds and sends the pong.
+template <typename Reply>
+bool
+ping_pong_loop(char const* name, int client, int server, Reply&& reply)
+{
+    std::array<std::uint8_t, 8> const payload = {'p', 'i', 'n', 'g', 'p', 'i', 'n', 'g'};
+    auto const ping = frame_generator{}.ping(payload, /*mask=*/true);
+
+    std::uint8_t buf[256];
+    bool ok = true;
+    print_result(name, measure(RoundTrips, [&] {
+        ok = ok
+                && ::send(client, ping.data().data(), ping.size(), 0)
+                        == static_cast<ssize_t>(ping.size());
+
+        ssize_t const nbytes = ::recv(server, buf, sizeof(buf), 0);
+        frame f;
+        ok = ok && nbytes > 0
+                && f.parse_from_buffer(buf, static_cast<std::size_t>(nbytes))
+                        == ParseResult::Success;
+        ok = ok && reply(server, f.get_payload_data());
+
+        ok = ok && ::recv(client, buf, sizeof(buf), 0) > 0;
+    }));
+    return ok;
+}
+
+bool
+bench_ping_pong()
+{
+    print_header("ping/pong round trips over a socketpair");
+
+    int sv[2] = {-1, -1};
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        std::print(stderr, "socketpair failed\n");
+        return false;
+    }
+
+    bool ok = ping_pong_loop("frame_generator", sv[0], sv[1],
+            [](int sock, std::span<std::uint8_t const> payload) {
+                auto gen = frame_generator{}.pong(payload);
+                return ::send(sock, gen.data().data(), gen.size(), 0)
+                        == static_cast<ssize_t>(gen.size());
+            });
+    ok = ok
+            && ping_pong_loop("control_frame_buffer", sv[0], sv[1],
+                    [](int sock, std::span<std::uint8_t const> payload) {
+                        control_frame_buffer const frame(OpCode::Pong, payload);
+                        return ::send(sock, frame.data().data(), frame.size(), 0)
+                                == static_cast<ssize_t>(frame.size());
+                    });
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    bench_frame_building();
+    if (!bench_ping_pong()) {
+        std::print(stderr, "ping/pong loop failed\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+// The built-in echo callbacks against the same echo written as a
+// coroutine handler (echo_handler in coro_connection.hpp):
+//  - round trip: one message at a time, latency bound
+//  - burst: 32 messages pipelined in one write
+//  - churn: connect, upgrade, one message, close; every connection
+//    starts a handler, whose frame comes from the reactor's pool
+// allocs/op counts heap allocations in the whole process (client
+// included) per message or per connection.
+
+#define WS_BENCH_COUNT_ALLOCATIONS
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/coro_connection.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <utility> // std::pair
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19000;
+static constexpr std::chrono::seconds CaseDuration{1};
+static constexpr std::size_t PayloadSize = 64;
+static constexpr std::size_t Burst = 32;
+
+/// Messages (or connections) per second, server cpu and allocations per op
+struct case_result
+{
+    double ops_per_sec = 0.0;
+    double server_ns_per_op = 0.0;
+    double allocs_per_op = 0.0;
+    latency_summary latency;
+};
+
+/// Run \c client against a fresh server for CaseDuration
+/// \param persistent hand \c client one websocket for the whole case
+///        (otherwise it gets the port and connects itself)
+/// \param client does one op, returns the number of messages or
+///        connections it completed, 0 on error
+template <typename Fn>
+bool
+run_case(connection_handler handler, int port, bool persistent, Fn&& client, case_result& out)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.max_frames_per_iteration = 0;
+    config.sockets.nodelay = true;
+    config.handler = handler;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    int const fd = persistent ? connect_websocket(port) : port;
+    std::vector<double> samples;
+    samples.reserve(1'000'000);
+    std::size_t ops = 0;
+    bool ok = fd != -1;
+    std::uint64_t const allocs_before = allocations.load(std::memory_order_relaxed);
+    auto const start = clock::now();
+    while (ok && clock::now() - start < CaseDuration) {
+        auto const op_start = clock::now();
+        std::size_t const done = client(fd);
+        std::chrono::duration<double, std::micro> const elapsed = clock::now() - op_start;
+        samples.push_back(elapsed.count());
+        ops += done;
+        ok = done != 0;
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+    std::uint64_t const allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+    if (persistent && fd != -1) {
+        ::close(fd);
+    }
+
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const n = static_cast<double>(ops);
+    out.ops_per_sec = n / elapsed.count();
+    out.server_ns_per_op = server_cpu * 1e9 / n;
+    out.allocs_per_op = static_cast<double>(allocs) / n;
+    out.latency = summarize(samples);
+    return ok;
+}
+
+/// Echo \c messages pipelined in \c request over the websocket \c fd
+/// \return messages echoed
+std::size_t
+echo_messages(int fd, std::span<std::uint8_t const> request, std::size_t messages)
+{
+    return round_trip(fd, request, messages * (MinFrameHeaderSize + PayloadSize)) ? messages : 0;
+}
+
+/// Connect to \c port, echo \c messages, disconnect
+/// \return connections made
+std::size_t
+churn_connection(int port, std::span<std::uint8_t const> request, std::size_t messages)
+{
+    int const fd = connect_websocket(port);
+    if (fd == -1) {
+        return 0;
+    }
+    bool const echoed = echo_messages(fd, request, messages) != 0;
+    ::close(fd);
+    return echoed ? 1 : 0;
+}
+
+struct workload
+{
+    char const* name;
+    bool persistent; ///< one websocket for the whole case
+    std::size_t (*client)(int fd_or_port, std::span<std::uint8_t const>, std::size_t);
+    std::size_t messages; ///< pipelined per op
+};
+
+void
+print_row(std::string_view workload, std::string_view mode, case_result const& r)
+{
+    std::print("{:<12} {:<10} {:>12.0f} {:>10.1f} {:>10.1f} {:>12.0f} {:>10.2f}\n", workload,
+            mode, r.ops_per_sec, r.latency.p50, r.latency.p99, r.server_ns_per_op,
+            r.allocs_per_op);
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{} byte messages, {}s per case\n{:<12} {:<10} {:>12} {:>10} {:>10} {:>12} {:>10}\n",
+            PayloadSize, CaseDuration.count(), "workload", "handler", "ops/s", "p50 us",
+            "p99 us", "srv ns/op", "allocs/op");
+
+    std::vector<std::uint8_t> const payload(PayloadSize, 'k');
+    auto const single = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+    std::vector<std::uint8_t> request;
+    for (std::size_t i = 0; i < Burst; ++i) {
+        request.insert(request.end(), single.begin(), single.end());
+    }
+
+    workload const workloads[] = {
+            {"round trip", true, echo_messages, 1},
+            {"burst", true, echo_messages, Burst},
+            {"churn", false, churn_connection, 1},
+    };
+    std::pair<char const*, connection_handler> const handlers[] = {
+            {"callbacks", nullptr},
+            {"coroutine", echo_handler},
+    };
+
+    int port = BasePort;
+    for (auto const& w : workloads) {
+        std::span<std::uint8_t const> const messages(request.data(), w.messages * single.size());
+        for (auto const& [name, handler] : handlers) {
+            case_result r;
+            bool const ok = run_case(handler, port++, w.persistent,
+                    [&](int fd_or_port) { return w.client(fd_or_port, messages, w.messages); }, r);
+            if (!ok) {
+                std::print(stderr, "{} ({}) failed\n", w.name, name);
+                return EXIT_FAILURE;
+            }
+            print_row(w.name, name, r);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+// Heap allocations per echoed message once the server is warmed up, by
+// opcode, payload size and batching: the per-pass arena (loop_arena.hpp)
+// holds the parsed frames, text views and log previews of a pass, so the
+// steady state should not touch the heap at all. allocs/msg counts the
+// whole process; the client side doesn't allocate.
+
+#define WS_BENCH_COUNT_ALLOCATIONS
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19400;
+static constexpr std::size_t WarmupMessages = 2'000;
+static constexpr std::size_t Messages = 50'000;
+
+/// Echo \c batch copies of a \c size byte frame per write through a fresh
+/// server, first WarmupMessages unmeasured
+/// \return \c false on error
+bool
+run_case(bool text, std::size_t size, std::size_t batch, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    std::vector<std::uint8_t> request;
+    {
+        frame_generator gen;
+        if (text) {
+            gen.text(std::string(size, 't'), /*fin=*/true, /*mask=*/true);
+        } else {
+            gen.binary(std::vector<std::uint8_t>(size, 'b'), /*fin=*/true, /*mask=*/true);
+        }
+        auto const single = gen.take_data();
+        for (std::size_t i = 0; i < batch; ++i) {
+            request.insert(request.end(), single.begin(), single.end());
+        }
+    }
+    std::size_t const response_size = batch * (frame_header_size(size) + size);
+
+    int const fd = connect_websocket(port);
+    bool ok = fd != -1;
+    for (std::size_t i = 0; ok && i < WarmupMessages; i += batch) {
+        ok = round_trip(fd, request, response_size);
+    }
+
+    std::uint64_t const allocs_before = allocations.load(std::memory_order_relaxed);
+    auto const start = clock::now();
+    std::size_t echoed = 0;
+    for (; ok && echoed < Messages; echoed += batch) {
+        ok = round_trip(fd, request, response_size);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+    std::uint64_t const allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+    if (fd != -1) {
+        ::close(fd);
+    }
+
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const n = static_cast<double>(echoed);
+    std::print("{:<8} {:>6} {:>6} {:>12.0f} {:>12.0f} {:>10.3f}\n", text ? "text" : "binary", size,
+            batch, n / elapsed.count(), server_cpu * 1e9 / (n + WarmupMessages),
+            static_cast<double>(allocs) / n);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{} echoes per case after {} warm-up\n{:<8} {:>6} {:>6} {:>12} {:>12} {:>10}\n",
+            Messages, WarmupMessages, "opcode", "bytes", "batch", "msgs/s", "srv ns/msg",
+            "allocs/msg");
+
+    int port = BasePort;
+    for (bool const text : {true, false}) {
+        for (std::size_t const size : {16UL, 125UL, 1000UL}) {
+            for (std::size_t const batch : {1UL, 32UL}) {
+                if (!run_case(text, size, batch, port++)) {
+                    std::print(stderr, "{} byte {} echo failed\n", size, text ? "text" : "binary");
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+// Masked (client-to-server) frame throughput: the old per-byte
+// mt19937/uniform_int_distribution masking against the thread-local
+// wyrand mask and word-at-a-time xor now used by frame_generator.
+
+#define WS_BENCH_COUNT_ALLOCATIONS
+#include "bench_utils.hpp"
+#include "util/random.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <array>
+#include <cstring> // std::memcpy
+#include <format>
+#include <span>
+#include <random> // std::mt19937, std::random_device, std::uniform_int_distribution
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr std::uint64_t Iterations = 2'000'000;
+
+/// frame_generator::generate_mask before the switch to wyrand
+std::array<std::uint8_t, 4>
+legacy_generate_mask() noexcept
+{
+    static thread_local std::random_device rd;
+    static thread_local std::mt19937 gen(rd());
+    static thread_local std::uniform_int_distribution<unsigned> dis(0, 255);
+
+    return {static_cast<std::uint8_t>(dis(gen)), static_cast<std::uint8_t>(dis(gen)),
+            static_cast<std::uint8_t>(dis(gen)), static_cast<std::uint8_t>(dis(gen))};
+}
+
+/// frame_generator::apply_mask before the switch to word-at-a-time xor
+void
+legacy_apply_mask(
+        std::uint8_t* payload, std::size_t length, std::array<std::uint8_t, 4> const& mask) noexcept
+{
+    for (std::size_t i = 0; i < length; ++i) {
+        payload[i] ^= mask[i % 4];
+    }
+}
+
+/// Build a masked binary frame into \c out with the given mask source
+/// and masking routine; \c out is reused so no allocation is measured.
+template <typename MaskFn, typename ApplyFn>
+void
+build_masked_frame(std::vector<std::uint8_t>& out, std::vector<std::uint8_t> const& payload,
+        MaskFn&& make_mask, ApplyFn&& apply)
+{
+    std::array<std::uint8_t, 4> const mask = make_mask();
+    std::size_t const header_size = encode_frame_header(
+            out.data(), OpCode::Binary, payload.size(), /*fin=*/true, mask.data());
+    std::memcpy(out.data() + header_size, payload.data(), payload.size());
+    apply(out.data() + header_size, payload.size(), mask);
+}
+
+void
+bench_mask_generation()
+{
+    print_header("mask / key generation");
+
+    print_result("mask: mt19937 + 4 distribution calls", measure(Iterations, [] {
+        do_not_optimize(legacy_generate_mask());
+    }));
+    print_result("mask: thread-local wyrand (fast_random_u32)", measure(Iterations, [] {
+        do_not_optimize(fast_random_u32());
+    }));
+    print_result("mask: getrandom(2)", measure(Iterations / 10, [] {
+        std::array<std::uint8_t, 4> mask{};
+        do_not_optimize(secure_random_bytes(mask));
+        do_not_optimize(mask);
+    }));
+    print_result("handshake key (generate_websocket_key)", measure(Iterations / 10, [] {
+        auto const key = frame_generator::generate_websocket_key();
+        do_not_optimize(key.data());
+    }));
+}
+
+void
+bench_masked_frames()
+{
+    print_header("masked client frames (ops/s = frames/s)");
+
+    auto const fast_mask = [] {
+        std::uint32_t const bits = fast_random_u32();
+        std::array<std::uint8_t, 4> mask{};
+        std::memcpy(mask.data(), &bits, sizeof(bits));
+        return mask;
+    };
+    auto const fast_apply = [](std::uint8_t* payload, std::size_t length,
+                                    std::array<std::uint8_t, 4> const& mask) {
+        apply_mask(std::span(payload, length), mask);
+    };
+
+    for (std::size_t const len : {16UL, 125UL, 1024UL, 16384UL}) {
+        std::vector<std::uint8_t> const payload(len, 'x');
+        std::vector<std::uint8_t> out(MaxFrameHeaderSize + len);
+        std::uint64_t const iterations = len > 1024 ? Iterations / 10 : Iterations;
+
+        print_result(std::format("{} bytes: legacy mask + byte xor", len),
+                measure(iterations, [&] {
+                    build_masked_frame(out, payload, legacy_generate_mask, legacy_apply_mask);
+                    do_not_optimize(out.data());
+                }));
+        print_result(std::format("{} bytes: wyrand mask + word xor", len),
+                measure(iterations, [&] {
+                    build_masked_frame(out, payload, fast_mask, fast_apply);
+                    do_not_optimize(out.data());
+                }));
+        print_result(std::format("{} bytes: frame_generator", len), measure(iterations, [&] {
+            auto gen = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true);
+            do_not_optimize(gen.data().data());
+        }));
+    }
+}
+
+} // namespace
+
+
+int
+main()
+{
+    bench_mask_generation();
+    bench_masked_frames();
+    return 0;
+}
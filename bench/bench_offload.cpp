@@ -0,0 +1,209 @@
+// CPU-bound message processing on the reactor vs on the worker pool. Busy
+// clients send messages whose reply takes COST us of cpu to compute (a
+// hash over the payload, repeated), each keeping Pipeline messages in
+// flight, while a probe client pings the same reactor and measures how
+// long its pongs take. On the reactor every message holds up every other
+// client; with the workers the reactor only moves bytes, so the pongs
+// stay fast and throughput scales with the worker threads.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/coro_connection.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <algorithm>
+#include <atomic>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19200;
+static constexpr std::chrono::seconds CaseDuration{2};
+static constexpr std::size_t PayloadSize = 64;
+static constexpr std::size_t BusyClients = 4;
+static constexpr std::size_t Pipeline = 4;
+static constexpr std::chrono::microseconds ProbeInterval{500};
+
+/// FNV-1a over \c data, \c rounds times over
+std::uint64_t
+spin_hash(std::span<std::uint8_t const> data, std::uint64_t rounds) noexcept
+{
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (std::uint64_t r = 0; r < rounds; ++r) {
+        for (std::uint8_t const byte : data) {
+            hash = (hash ^ byte) * 0x100000001b3;
+        }
+    }
+    return hash;
+}
+
+/// spin_hash() rounds over a PayloadSize payload that take about 1us
+std::uint64_t
+rounds_per_usec()
+{
+    std::vector<std::uint8_t> const data(PayloadSize, 'h');
+    static constexpr std::uint64_t Rounds = 200'000;
+    auto const start = clock::now();
+    do_not_optimize(spin_hash(data, Rounds));
+    std::chrono::duration<double, std::micro> const elapsed = clock::now() - start;
+    return std::max<std::uint64_t>(1, static_cast<std::uint64_t>(Rounds / elapsed.count()));
+}
+
+/// Keep Pipeline messages in flight on a new connection until \c stop
+/// \return messages completed, 0 on error
+std::size_t
+busy_client(int port, std::atomic<bool> const& stop)
+{
+    int const fd = connect_websocket(port);
+    if (fd == -1) {
+        return 0;
+    }
+
+    std::vector<std::uint8_t> const payload(PayloadSize, 'b');
+    frame_generator generator;
+    std::vector<std::uint8_t> request;
+    for (std::size_t i = 0; i < Pipeline; ++i) {
+        auto const frame = generator.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+        request.insert(request.end(), frame.begin(), frame.end());
+    }
+
+    std::size_t messages = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (!round_trip(fd, request, Pipeline * (MinFrameHeaderSize + PayloadSize))) {
+            messages = 0;
+            break;
+        }
+        messages += Pipeline;
+    }
+    ::close(fd);
+    return messages;
+}
+
+/// Ping every ProbeInterval on a new connection until \c stop
+/// \return pong round trips in microseconds, empty on error
+std::vector<double>
+probe_client(int port, std::atomic<bool> const& stop)
+{
+    std::vector<double> samples;
+    int const fd = connect_websocket(port);
+    if (fd == -1) {
+        return samples;
+    }
+
+    std::vector<std::uint8_t> const payload(8, 'p');
+    frame_generator generator;
+    auto const ping = generator.ping(payload, /*mask=*/true).take_data();
+    while (!stop.load(std::memory_order_relaxed)) {
+        auto const start = clock::now();
+        if (!round_trip(fd, ping, MinFrameHeaderSize + payload.size())) {
+            samples.clear();
+            break;
+        }
+        std::chrono::duration<double, std::micro> const elapsed = clock::now() - start;
+        samples.push_back(elapsed.count());
+        std::this_thread::sleep_for(ProbeInterval);
+    }
+    ::close(fd);
+    return samples;
+}
+
+bool
+run_case(std::chrono::microseconds cost, std::uint64_t rounds_per_us, std::size_t workers,
+        int port)
+{
+    std::uint64_t const rounds = static_cast<std::uint64_t>(cost.count()) * rounds_per_us;
+
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+    config.worker_threads = workers;
+    config.processor = [rounds](message& msg) {
+        // the reply is the message with its hash in front
+        std::uint64_t const hash = spin_hash(msg.payload, rounds);
+        std::copy_n(reinterpret_cast<std::uint8_t const*>(&hash), sizeof(hash),
+                msg.payload.begin());
+    };
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    std::atomic<bool> stop{false};
+    std::vector<std::size_t> messages(BusyClients, 0);
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < BusyClients; ++i) {
+        clients.emplace_back([&, i] { messages[i] = busy_client(port, stop); });
+    }
+    std::vector<double> pongs;
+    std::thread probe([&] { pongs = probe_client(port, stop); });
+
+    std::this_thread::sleep_for(CaseDuration);
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+    probe.join();
+
+    server.request_shutdown();
+    server_thread.join();
+
+    bool const ok = std::ranges::none_of(messages, [](std::size_t n) { return n == 0; })
+            && !pongs.empty();
+    std::size_t total = 0;
+    for (std::size_t const n : messages) {
+        total += n;
+    }
+
+    latency_summary const pong = summarize(pongs);
+    auto const msgs = static_cast<double>(std::max<std::size_t>(total, 1));
+    std::print("{:>8} {:<10} {:>12.0f} {:>12.1f} {:>12.1f} {:>14.0f}\n", cost.count(),
+            workers == 0 ? "reactor" : std::format("{} workers", workers),
+            msgs / std::chrono::duration<double>(CaseDuration).count(), pong.p50, pong.p99,
+            server_cpu * 1e9 / msgs);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::size_t const workers = std::max(2U, std::thread::hardware_concurrency());
+    std::uint64_t const rounds_per_us = rounds_per_usec();
+
+    std::print("{} busy clients x {} in flight, {} byte messages, {}s per case\n"
+               "{:>8} {:<10} {:>12} {:>12} {:>12} {:>14}\n",
+            BusyClients, Pipeline, PayloadSize, CaseDuration.count(), "cost us", "where",
+            "msgs/s", "pong p50 us", "pong p99 us", "reactor ns/msg");
+
+    int port = BasePort;
+    for (long const cost : {0L, 10L, 50L, 200L}) {
+        for (std::size_t const threads : {std::size_t{0}, workers}) {
+            if (!run_case(std::chrono::microseconds(cost), rounds_per_us, threads, port++)) {
+                std::print(stderr, "cost {}us ({} workers) failed\n", cost, threads);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+// Producer threads posting sends into one reactor through its command
+// queue (echo_server::post_send), the way a pricing engine would push
+// updates to its subscribers. Every producer spreads its messages over all
+// connected clients; a reader thread counts what arrives. With coalescing
+// a connection's posted messages from one batch leave in a single write.
+// full/msg counts posts refused because the queue was full (the producer
+// yields and retries).
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame.hpp"
+#include <spdlog/spdlog.h>
+#include <poll.h>   // ::poll
+#include <unistd.h> // ::close
+#include <atomic>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <mutex>
+#include <print>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19100;
+static constexpr std::size_t Clients = 4;
+static constexpr std::size_t MessagesPerProducer = 200'000;
+static constexpr std::size_t PayloadSize = 64;
+static constexpr std::size_t QueueSize = 4096;
+static constexpr std::chrono::seconds Timeout{30};
+
+/// Read from every client until \c expected bytes have arrived in total
+/// \return \c false on error or timeout
+bool
+read_all(std::vector<int> const& fds, std::size_t expected) noexcept
+{
+    std::vector<pollfd> pfds;
+    for (int const fd : fds) {
+        pfds.push_back({fd, POLLIN, 0});
+    }
+
+    auto const deadline = clock::now() + Timeout;
+    std::vector<std::uint8_t> buf(65536);
+    std::size_t received = 0;
+    while (received < expected) {
+        if (clock::now() > deadline || ::poll(pfds.data(), pfds.size(), 1000) == -1) {
+            return false;
+        }
+        for (pollfd const& pfd : pfds) {
+            if ((pfd.revents & POLLIN) == 0) {
+                continue;
+            }
+            ssize_t const nbytes = ::recv(pfd.fd, buf.data(), buf.size(), MSG_DONTWAIT);
+            if (nbytes <= 0) {
+                return false;
+            }
+            received += static_cast<std::size_t>(nbytes);
+        }
+    }
+    return true;
+}
+
+bool
+run_case(std::size_t producers, bool coalesce, int port)
+{
+    std::mutex ids_mutex;
+    std::vector<std::uint64_t> ids;
+
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+    config.coalesce_writes = coalesce;
+    config.command_queue_size = QueueSize;
+    config.on_open = [&](std::uint64_t id) {
+        std::lock_guard const lock(ids_mutex);
+        ids.push_back(id);
+    };
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    std::vector<int> fds;
+    for (std::size_t i = 0; i < Clients; ++i) {
+        int const fd = connect_websocket(port);
+        if (fd == -1) {
+            break;
+        }
+        fds.push_back(fd);
+    }
+
+    // the ids show up once the reactor has processed the upgrades
+    bool ok = fds.size() == Clients;
+    auto const deadline = clock::now() + Timeout;
+    while (ok) {
+        std::lock_guard const lock(ids_mutex);
+        if (ids.size() == Clients) {
+            break;
+        }
+        ok = clock::now() < deadline;
+    }
+
+    std::atomic<std::uint64_t> full{0};
+    std::size_t const messages = producers * MessagesPerProducer;
+    auto const start = clock::now();
+    if (ok) {
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                std::uint64_t refused = 0;
+                for (std::size_t i = 0; i < MessagesPerProducer; ++i) {
+                    std::vector<std::uint8_t> payload(PayloadSize, static_cast<std::uint8_t>(p));
+                    std::uint64_t const id = ids[(p + i) % Clients];
+                    while (!server.post_send(id, payload)) {
+                        ++refused;
+                        std::this_thread::yield();
+                    }
+                }
+                full += refused;
+            });
+        }
+        ok = read_all(fds, messages * (MinFrameHeaderSize + PayloadSize));
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    for (int const fd : fds) {
+        ::close(fd);
+    }
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const total = static_cast<double>(messages);
+    server_stats const& stats = server.stats();
+    std::print("{:>9} {:<10} {:>12.0f} {:>10.3f} {:>12.3f} {:>12.1f}\n", producers,
+            coalesce ? "coalesce" : "send", total / elapsed.count(),
+            static_cast<double>(full.load()) / total,
+            static_cast<double>(stats.write_syscalls) / total, server_cpu * 1e9 / total);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{} byte messages to {} clients, {} per producer, queue of {}\n"
+               "{:>9} {:<10} {:>12} {:>10} {:>12} {:>12}\n",
+            PayloadSize, Clients, MessagesPerProducer, QueueSize, "producers", "writes",
+            "msgs/s", "full/msg", "syscalls/msg", "srv ns/msg");
+
+    int port = BasePort;
+    for (std::size_t const producers : {1UL, 2UL, 4UL, 8UL}) {
+        for (bool const coalesce : {false, true}) {
+            if (!run_case(producers, coalesce, port++)) {
+                std::print(stderr, "{} producers ({}) failed\n", producers,
+                        coalesce ? "coalesce" : "send");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+// Round trips through the reverse proxy (client -> echo_server -> backend
+// stub -> echo_server -> client) against the plain echo server, per
+// payload size and backend transport. The proxy's own cpu cost per round
+// trip is the interesting column: client payloads are copied out to the
+// backend, backend bytes are spliced back without a copy.
+
+#include "backend_stub/backend_stub.hpp"
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close, ::getpid
+#include <algorithm> // std::clamp
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 18600;
+static constexpr int BaseBackendPort = 18700;
+static constexpr std::size_t BytesPerCase = 64 * 1024 * 1024;
+
+enum class Backend
+{
+    None, ///< plain echo server
+    Tcp,  ///< proxy to a backend on loopback tcp
+    Unix, ///< proxy to a backend on a unix socket
+};
+
+char const*
+to_string(Backend backend)
+{
+    switch (backend) {
+        case Backend::Tcp:
+            return "proxy (tcp)";
+        case Backend::Unix:
+            return "proxy (unix)";
+        case Backend::None:
+        default:
+            return "echo";
+    }
+}
+
+bool
+run_case(std::size_t size, Backend backend, int port, int backend_port)
+{
+    std::string address;
+    switch (backend) {
+        case Backend::Tcp:
+            address = "127.0.0.1:" + std::to_string(backend_port);
+            break;
+        case Backend::Unix:
+            address = "unix:/tmp/ws_bench_proxy." + std::to_string(::getpid());
+            break;
+        case Backend::None:
+        default:
+            break;
+    }
+
+    std::optional<backend_stub> stub;
+    std::thread stub_thread;
+    if (!address.empty()) {
+        stub.emplace(address);
+        stub_thread = std::thread([&] { stub->run(); });
+    }
+
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.backend = address;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    std::vector<std::uint8_t> const payload(size, 'p');
+    auto const request
+            = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+    std::size_t const round_trips = std::clamp<std::size_t>(BytesPerCase / size, 200, 20'000);
+
+    std::vector<double> rtts;
+    rtts.reserve(round_trips);
+    auto const start = clock::now();
+    int const fd = connect_websocket(port);
+    bool ok = fd != -1;
+    for (std::size_t i = 0; ok && i < round_trips; ++i) {
+        auto const sent = clock::now();
+        ok = ::send(fd, request.data(), request.size(), MSG_NOSIGNAL)
+                        == static_cast<ssize_t>(request.size())
+                && receive_payload(fd, size);
+        std::chrono::duration<double, std::micro> const rtt = clock::now() - sent;
+        rtts.push_back(rtt.count());
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    server.request_shutdown();
+    server_thread.join();
+    if (stub) {
+        stub->request_shutdown();
+        stub_thread.join();
+    }
+
+    latency_summary const latency = summarize(rtts);
+    std::print("{:>8} {:<14} {:>10.0f} {:>10.1f} {:>10.1f} {:>14.2f}\n", size, to_string(backend),
+            static_cast<double>(round_trips * size) / elapsed.count() / 1e6, latency.p50,
+            latency.p99, server_cpu * 1e6 / static_cast<double>(round_trips));
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{:>8} {:<14} {:>10} {:>10} {:>10} {:>14}\n", "bytes", "server", "MB/s", "p50 us",
+            "p99 us", "srv us/trip");
+
+    int port = BasePort;
+    int backend_port = BaseBackendPort;
+    for (std::size_t const size : {64UL, 16384UL, 262144UL}) {
+        for (Backend const backend : {Backend::None, Backend::Tcp, Backend::Unix}) {
+            if (!run_case(size, backend, port++, backend_port++)) {
+                std::print(stderr, "{} byte round trip ({}) failed\n", size, to_string(backend));
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+// The same workloads against the server with each socket profile: the
+// kernel defaults, socket_options::latency() and ::throughput().
+//  - reconnect: connect + upgrade time, and how many connections got their
+//    upgrade request into the SYN (fast open needs net.ipv4.tcp_fastopen=3)
+//  - pipelined: bursts of 8 small echoes, where nagle stalls the defaults
+//  - bulk: 256 KiB echoes
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <netinet/tcp.h> // tcp_info, TCPI_OPT_SYN_DATA
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 18900;
+static constexpr std::size_t Reconnects = 300;
+static constexpr std::size_t Burst = 8;
+static constexpr std::size_t SmallPayload = 64;
+static constexpr std::size_t BulkPayload = 256 * 1024;
+static constexpr std::chrono::seconds CaseDuration{1};
+
+struct profile
+{
+    char const* name;
+    socket_options options;
+};
+
+/// \return \c true if the peer accepted the data we sent in the SYN
+bool
+syn_data_accepted(int fd) noexcept
+{
+    tcp_info info{};
+    socklen_t len = sizeof(info);
+    return ::getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0
+            && (info.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+}
+
+/// Send \c request back to back until CaseDuration has passed
+/// \return bytes of payload echoed per second, 0 on error
+double
+echo_rate(int port, std::span<std::uint8_t const> request, std::size_t payload_bytes,
+        std::size_t response_size, std::vector<double>& rtts)
+{
+    int const fd = connect_websocket(port);
+    if (fd == -1) {
+        return 0.0;
+    }
+
+    bool ok = true;
+    std::size_t rounds = 0;
+    auto const start = clock::now();
+    while (ok && clock::now() - start < CaseDuration) {
+        auto const sent = clock::now();
+        ok = round_trip(fd, request, response_size);
+        std::chrono::duration<double, std::micro> const rtt = clock::now() - sent;
+        rtts.push_back(rtt.count());
+        ++rounds;
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+    ::close(fd);
+    return ok ? static_cast<double>(rounds * payload_bytes) / elapsed.count() : 0.0;
+}
+
+bool
+run_profile(profile const& p, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets = p.options;
+
+    echo_server server(config);
+    std::thread server_thread([&] { server.run(); });
+
+    // reconnect
+    bool const fastopen = p.options.fastopen_queue != 0;
+    std::vector<double> connect_times;
+    std::size_t syn_data = 0;
+    bool ok = true;
+    for (std::size_t i = 0; ok && i < Reconnects; ++i) {
+        auto const start = clock::now();
+        int const fd = connect_websocket(port, fastopen);
+        std::chrono::duration<double, std::micro> const elapsed = clock::now() - start;
+        ok = fd != -1;
+        if (ok) {
+            connect_times.push_back(elapsed.count());
+            syn_data += syn_data_accepted(fd) ? 1 : 0;
+            ::close(fd);
+        }
+    }
+
+    // pipelined small echoes
+    frame_generator generator;
+    std::vector<std::uint8_t> const small(SmallPayload, 's');
+    std::vector<std::uint8_t> burst;
+    for (std::size_t i = 0; i < Burst; ++i) {
+        auto const frame = generator.binary(small, /*fin=*/true, /*mask=*/true).take_data();
+        burst.insert(burst.end(), frame.begin(), frame.end());
+    }
+    std::vector<double> burst_rtts;
+    double const small_rate = echo_rate(port, burst, Burst * SmallPayload,
+            Burst * (MinFrameHeaderSize + SmallPayload), burst_rtts);
+
+    // bulk
+    std::vector<std::uint8_t> const bulk(BulkPayload, 'b');
+    auto const bulk_request = generator.binary(bulk, /*fin=*/true, /*mask=*/true).take_data();
+    std::vector<double> bulk_rtts;
+    double const bulk_rate = echo_rate(port, bulk_request, BulkPayload,
+            frame_header_size(BulkPayload) + BulkPayload, bulk_rtts);
+
+    server.request_shutdown();
+    server_thread.join();
+
+    latency_summary const connect = summarize(connect_times);
+    latency_summary const pipelined = summarize(burst_rtts);
+    std::print("{:<12} {:>10.1f} {:>8}/{} {:>12.0f} {:>10.1f} {:>10.0f}\n", p.name, connect.p50,
+            syn_data, Reconnects, small_rate / static_cast<double>(SmallPayload),
+            pipelined.p99, bulk_rate / 1e6);
+    return ok && small_rate > 0.0 && bulk_rate > 0.0;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{:<12} {:>10} {:>12} {:>12} {:>10} {:>10}\n", "profile", "connect us",
+            "syn data", "burst msg/s", "burst p99", "bulk MB/s");
+
+    profile const profiles[] = {
+            {"default", socket_options{}},
+            {"latency", socket_options::latency()},
+            {"throughput", socket_options::throughput()},
+    };
+
+    int port = BasePort;
+    for (auto const& p : profiles) {
+        if (!run_profile(p, port++)) {
+            std::print(stderr, "profile '{}' failed\n", p.name);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
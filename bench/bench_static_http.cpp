@@ -0,0 +1,168 @@
+// Plain http on the websocket port: health checks and static files
+// (util/static_content.hpp) over one keep-alive connection, one request
+// at a time. The 100 KB file goes out with sendfile(), the 1 KB one from
+// memory; "304" sends the file's ETag back in If-None-Match. allocs/req
+// counts the whole process; the client side doesn't allocate.
+
+#define WS_BENCH_COUNT_ALLOCATIONS
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "util/static_content.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close, ::getpid
+#include <charconv> // std::from_chars
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19500;
+static constexpr std::chrono::seconds CaseDuration{1};
+
+/// Send \c request on \c fd and read the whole response
+/// \return status code, 0 on error
+int
+http_round_trip(int fd, std::string_view request) noexcept
+{
+    if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL)
+            != static_cast<ssize_t>(request.size())) {
+        return 0;
+    }
+
+    char buf[65536];
+    std::size_t received = 0;
+    std::size_t header_end = std::string_view::npos;
+    while (header_end == std::string_view::npos) {
+        ssize_t const nbytes = ::recv(fd, buf + received, sizeof(buf) - received, 0);
+        if (nbytes <= 0) {
+            return 0;
+        }
+        received += static_cast<std::size_t>(nbytes);
+        header_end = std::string_view(buf, received).find("\r\n\r\n");
+    }
+
+    std::string_view const headers(buf, header_end);
+    int status = 0;
+    std::from_chars(headers.data() + 9, headers.data() + 12, status);
+    std::size_t length = 0;
+    if (std::size_t const pos = headers.find("Content-Length: "); pos != std::string_view::npos) {
+        std::from_chars(headers.data() + pos + 16, headers.data() + headers.size(), length);
+    }
+
+    // the rest of the body
+    std::size_t body = received - header_end - 4;
+    while (body < length) {
+        ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+        if (nbytes <= 0) {
+            return 0;
+        }
+        body += static_cast<std::size_t>(nbytes);
+    }
+    return status;
+}
+
+/// Repeat \c request against a fresh server for CaseDuration
+/// \return \c false on error or an unexpected status
+bool
+run_case(char const* name, std::string const& root, std::string_view request, int expected,
+        int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+    config.static_root = root;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    int const fd = connect_tcp(port);
+    bool ok = fd != -1 && http_round_trip(fd, request) == expected; // warm-up
+    std::size_t requests = 0;
+    std::uint64_t const allocs_before = allocations.load(std::memory_order_relaxed);
+    auto const start = clock::now();
+    while (ok && clock::now() - start < CaseDuration) {
+        ok = http_round_trip(fd, request) == expected;
+        ++requests;
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+    std::uint64_t const allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+    if (fd != -1) {
+        ::close(fd);
+    }
+
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const n = static_cast<double>(requests);
+    std::print("{:<14} {:>12.0f} {:>12.0f} {:>10.2f}\n", name, n / elapsed.count(),
+            server_cpu * 1e9 / n, static_cast<double>(allocs) / n);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    namespace fs = std::filesystem;
+    fs::path const root
+            = fs::temp_directory_path() / ("bench_static_http." + std::to_string(::getpid()));
+    fs::create_directories(root);
+    std::ofstream(root / "small.js") << std::string(1024, 's');
+    std::ofstream(root / "large.js") << std::string(100 * 1024, 'l');
+    std::string const etag = static_content(root.string()).find("/large.js")->etag;
+
+    std::string const health = "GET /health HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    std::string const small = "GET /small.js HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    std::string const large = "GET /large.js HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    std::string const cached
+            = "GET /large.js HTTP/1.1\r\nHost: 127.0.0.1\r\nIf-None-Match: " + etag + "\r\n\r\n";
+
+    struct
+    {
+        char const* name;
+        std::string const& request;
+        int status;
+    } const cases[] = {
+            {"GET /health", health, 200},
+            {"1 KB file", small, 200},
+            {"100 KB file", large, 200},
+            {"100 KB, 304", cached, 304},
+    };
+
+    std::print("keep-alive, one request at a time, {}s per case\n{:<14} {:>12} {:>12} {:>10}\n",
+            CaseDuration.count(), "request", "req/s", "srv ns/req", "allocs/req");
+
+    int port = BasePort;
+    bool ok = true;
+    for (auto const& c : cases) {
+        ok = run_case(c.name, root.string(), c.request, c.status, port++);
+        if (!ok) {
+            std::print(stderr, "{} failed\n", c.name);
+            break;
+        }
+    }
+
+    fs::remove_all(root);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,156 @@
+// Steered vs unsteered connection placement across reactors. Client
+// threads are pinned one per cpu; on loopback a connection's packets are
+// processed on the sending client's cpu, so with steering its reactor is
+// the one pinned to that same cpu.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/reactor_pool.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h>  // ::close
+#include <algorithm> // std::min
+#include <atomic>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 18300;
+static constexpr std::size_t MaxReactors = 8;
+static constexpr std::size_t ConnectionsPerClient = 200;
+static constexpr std::size_t RoundTripsPerConnection = 20;
+static constexpr std::size_t PayloadSize = 64;
+
+struct scenario
+{
+    char const* name;
+    bool pin;
+    Steering steering;
+};
+
+/// Connect, upgrade and run \c RoundTripsPerConnection echoes.
+/// \return \c false on any failure
+bool
+echo_session(int port, std::vector<std::uint8_t> const& request, std::vector<double>& rtts_us)
+{
+    int const fd = connect_websocket(port);
+    if (fd == -1) {
+        return false;
+    }
+
+    bool ok = true;
+    for (std::size_t i = 0; ok && i < RoundTripsPerConnection; ++i) {
+        auto const start = clock::now();
+        ok = round_trip(fd, request, MinFrameHeaderSize + PayloadSize);
+        std::chrono::duration<double, std::micro> const rtt = clock::now() - start;
+        rtts_us.push_back(rtt.count());
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+bool
+run_scenario(scenario const& s, int port, std::vector<int> const& cpus)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.reactors = cpus.size();
+    config.pin_reactors = s.pin;
+    config.steering = s.steering;
+    config.drain_window = std::chrono::milliseconds(0);
+
+    reactor_pool pool(config);
+    std::thread server([&] { pool.run(); });
+
+    std::vector<std::uint8_t> const payload(PayloadSize, 'x');
+    auto const request
+            = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+
+    std::atomic<bool> ok{true};
+    std::vector<std::vector<double>> rtts(cpus.size());
+    auto const start = clock::now();
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        clients.emplace_back([&, i] {
+            pin_to_cpu(cpus[i]);
+            for (std::size_t c = 0; c < ConnectionsPerClient; ++c) {
+                if (!echo_session(port, request, rtts[i])) {
+                    ok = false;
+                    return;
+                }
+            }
+        });
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    pool.request_shutdown();
+    server.join();
+
+    std::vector<double> all;
+    for (auto const& r : rtts) {
+        all.insert(all.end(), r.begin(), r.end());
+    }
+    latency_summary const latency = summarize(all);
+
+    std::uint64_t accepted = 0;
+    std::uint64_t local = 0;
+    for (auto const& st : pool.stats()) {
+        accepted += st.accepted_connections;
+        local += st.local_connections;
+    }
+
+    double const local_pct = accepted == 0
+            ? 0.0
+            : 100.0 * static_cast<double>(local) / static_cast<double>(accepted);
+    std::print("{:<28} {:>12.0f} {:>10.1f} {:>10.1f} {:>9.1f}%\n", s.name,
+            static_cast<double>(all.size()) / elapsed.count(), latency.p50, latency.p99,
+            local_pct);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<int> cpus = reactor_pool::allowed_cpus();
+    cpus.resize(std::min(cpus.size(), MaxReactors));
+
+    std::print("{} reactors, {} client threads x {} connections x {} round trips\n", cpus.size(),
+            cpus.size(), ConnectionsPerClient, RoundTripsPerConnection);
+    std::print("{:<28} {:>12} {:>10} {:>10} {:>10}\n", "placement", "rtt/s", "p50 us", "p99 us",
+            "local");
+
+    scenario const scenarios[] = {
+            {"unpinned, kernel hash", false, Steering::None},
+            {"pinned, kernel hash", true, Steering::None},
+            {"pinned, SO_INCOMING_CPU", true, Steering::IncomingCpu},
+            {"pinned, reuseport cbpf", true, Steering::Cbpf},
+    };
+
+    int port = BasePort;
+    for (auto const& s : scenarios) {
+        if (!run_scenario(s, port++, cpus)) {
+            std::print(stderr, "scenario '{}' failed\n", s.name);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
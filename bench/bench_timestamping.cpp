@@ -0,0 +1,110 @@
+// Where a message's time goes, from the kernel's receive timestamp to the
+// client's ack of the echo: request/response echoes with kernel
+// timestamps (SO_TIMESTAMPING) on, next to the same load with them off to
+// show what the extra recvmsg control data and error queue reads cost.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <cstdlib>  // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19900;
+static constexpr std::chrono::seconds CaseDuration{2};
+static constexpr std::size_t PayloadSize = 64;
+
+bool
+run_case(std::size_t burst, bool timestamping, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.coalesce_writes = true;
+    config.max_frames_per_iteration = 0;
+    config.timestamping = timestamping;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    // one write carries the whole burst
+    std::vector<std::uint8_t> const payload(PayloadSize, 't');
+    frame_generator generator;
+    std::vector<std::uint8_t> request;
+    for (std::size_t i = 0; i < burst; ++i) {
+        auto const frame = generator.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+        request.insert(request.end(), frame.begin(), frame.end());
+    }
+    std::size_t const response_size = burst * (MinFrameHeaderSize + PayloadSize);
+
+    auto const start = clock::now();
+    int const fd = connect_websocket(port);
+    bool ok = fd != -1;
+    std::size_t rounds = 0;
+    while (ok && clock::now() - start < CaseDuration) {
+        ok = round_trip(fd, request, response_size);
+        ++rounds;
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    server.request_shutdown();
+    server_thread.join();
+
+    auto const messages = static_cast<double>(rounds * burst);
+    std::print("{:>6} {:<6} {:>12.0f} {:>14.2f}\n", burst, timestamping ? "on" : "off",
+            messages / elapsed.count(), server_cpu * 1e9 / messages);
+    if (timestamping) {
+        message_latency const& l = server.latency();
+        std::print("         kernel_rx..read:  {}\n"
+                   "         read..parse:      {}\n"
+                   "         parse..reply:     {}\n"
+                   "         reply..kernel_tx: {}\n"
+                   "         kernel_tx..ack:   {}\n",
+                l.rx_to_read, l.read_to_parse, l.parse_to_reply, l.reply_to_tx, l.tx_to_ack);
+    }
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{} byte messages, coalesced echoes, {}s per case\n{:>6} {:<6} {:>12} {:>14}\n",
+            PayloadSize, CaseDuration.count(), "burst", "stamps", "msgs/s", "srv ns/msg");
+
+    int port = BasePort;
+    for (std::size_t const burst : {1UL, 32UL}) {
+        for (bool const timestamping : {false, true}) {
+            if (!run_case(burst, timestamping, port++)) {
+                std::print(stderr, "burst of {} (timestamps {}) failed\n", burst,
+                        timestamping ? "on" : "off");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
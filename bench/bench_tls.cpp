@@ -0,0 +1,280 @@
+// wss:// against ws:// on loopback: the same echo stream in plaintext,
+// with TLS in user space (OpenSSL encrypting into its own buffers, then
+// send/recv) and with kTLS (OpenSSL only does the handshake, then hands
+// the keys to the kernel, which encrypts in sendmsg and decrypts in recv
+// without the extra copy). Both ends use the mode of their row, with a
+// self-signed certificate written for the run. Messages go out a burst
+// at a time, bounded so neither side's socket buffers fill up, and the
+// echoes are read back before the next burst. cpu is client and server
+// together, per message. kTLS needs the tls module (modprobe tls) and a
+// cipher the kernel knows; where it's missing that row reports it and
+// runs in user space.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "util/tls.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <spdlog/spdlog.h>
+#include <fcntl.h>    // ::fcntl, O_NONBLOCK
+#include <poll.h>     // ::poll
+#include <unistd.h>   // ::close, ::getpid
+#include <algorithm>  // std::clamp
+#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <filesystem>
+#include <memory>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19700;
+static constexpr std::size_t BytesPerCase = 64 * 1024 * 1024;
+static constexpr std::size_t BurstBytes = 256 * 1024; ///< request bytes in flight at most
+
+enum class Mode
+{
+    Plain,   ///< ws://
+    UserTls, ///< wss://, OpenSSL encrypts and decrypts
+    Ktls,    ///< wss://, the kernel encrypts and decrypts
+};
+
+/// A client connection, non-blocking, through tls in user space if the
+/// kernel doesn't do it
+struct stream
+{
+    int fd = -1;
+    std::unique_ptr<tls_session> tls;
+
+    ~stream()
+    {
+        tls.reset();
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    bool
+    wait(short events) const noexcept
+    {
+        pollfd pfd{fd, events, 0};
+        return ::poll(&pfd, 1, 5000) == 1;
+    }
+
+    bool
+    send_all(std::span<std::uint8_t const> data) noexcept
+    {
+        while (!data.empty()) {
+            ssize_t const nbytes = tls != nullptr && !tls->kernel_send()
+                    ? tls->send(data.data(), data.size())
+                    : ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (nbytes > 0) {
+                data = data.subspan(static_cast<std::size_t>(nbytes));
+            } else if (nbytes == 0 || errno != EAGAIN || !wait(POLLOUT)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Read exactly \c len bytes
+    bool
+    recv_exactly(std::uint8_t* buf, std::size_t len) noexcept
+    {
+        std::size_t received = 0;
+        while (received < len) {
+            ssize_t const nbytes = tls != nullptr && !tls->kernel_recv()
+                    ? tls->recv(buf + received, len - received)
+                    : ::recv(fd, buf + received, len - received, 0);
+            if (nbytes > 0) {
+                received += static_cast<std::size_t>(nbytes);
+            } else if (nbytes == 0 || errno != EAGAIN || !wait(POLLIN)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/// Connect, do the tls handshake (with \c context) and the upgrade
+/// \return \c false on error
+bool
+open_stream(stream& s, int port, tls_context const* context)
+{
+    s.fd = connect_tcp(port);
+    if (s.fd == -1) {
+        return false;
+    }
+    ::fcntl(s.fd, F_SETFL, ::fcntl(s.fd, F_GETFL) | O_NONBLOCK);
+
+    if (context != nullptr) {
+        s.tls = std::make_unique<tls_session>(*context, s.fd, "localhost");
+        for (TlsProgress p = s.tls->handshake(); p != TlsProgress::Done; p = s.tls->handshake()) {
+            short const events = p == TlsProgress::WantRead ? POLLIN : POLLOUT;
+            if (p == TlsProgress::Failed || !s.wait(events)) {
+                std::print(stderr, "tls handshake failed: {}\n", s.tls->error());
+                return false;
+            }
+        }
+    }
+
+    std::string const request = "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+                                "Connection: Upgrade\r\nSec-WebSocket-Key: "
+            + frame_generator::generate_websocket_key()
+            + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (!s.send_all(std::span(reinterpret_cast<std::uint8_t const*>(request.data()),
+                request.size()))) {
+        return false;
+    }
+
+    // the 101 response, a byte at a time: nothing follows it
+    std::string response;
+    while (!response.ends_with("\r\n\r\n")) {
+        std::uint8_t byte = 0;
+        if (!s.recv_exactly(&byte, 1)) {
+            return false;
+        }
+        response.push_back(static_cast<char>(byte));
+    }
+    return response.starts_with("HTTP/1.1 101");
+}
+
+char const*
+to_string(Mode mode, server_stats const& stats)
+{
+    switch (mode) {
+        case Mode::UserTls:
+            return "tls (user)";
+        case Mode::Ktls:
+            if (stats.ktls_send != 0 && stats.ktls_recv != 0) {
+                return "kTLS";
+            }
+            return stats.ktls_send != 0 ? "kTLS (tx only)" : "kTLS (n/a)";
+        case Mode::Plain:
+        default:
+            return "plaintext";
+    }
+}
+
+/// \return \c false on error; \c ktls_missing set if the kernel didn't take over
+bool
+run_case(std::size_t size, Mode mode, int port, std::string const& cert, std::string const& key,
+        bool& ktls_missing)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+    if (mode != Mode::Plain) {
+        config.tls_certificate = cert;
+        config.tls_private_key = key;
+        config.ktls = mode == Mode::Ktls;
+    }
+
+    std::unique_ptr<tls_context const> client_context;
+    if (mode != Mode::Plain) {
+        tls_options options;
+        options.ca_file = cert;
+        options.ktls = mode == Mode::Ktls;
+        client_context = std::make_unique<tls_context const>(TlsRole::Client, options);
+    }
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    std::vector<std::uint8_t> const payload(size, 'p');
+    auto const single = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+    std::size_t const burst_messages = std::max<std::size_t>(1, BurstBytes / single.size());
+    std::vector<std::uint8_t> burst;
+    for (std::size_t i = 0; i < burst_messages; ++i) {
+        burst.insert(burst.end(), single.begin(), single.end());
+    }
+    std::size_t const echo_size = frame_header_size(size, /*masked=*/false) + size;
+    std::vector<std::uint8_t> echoes(burst_messages * echo_size);
+    std::size_t const bursts
+            = std::clamp<std::size_t>(BytesPerCase / size, 2'000, 100'000) / burst_messages;
+
+    double const cpu_before = thread_cpu_seconds();
+    bool ok = false;
+    std::chrono::duration<double> elapsed{};
+    {
+        stream s;
+        ok = open_stream(s, port, client_context.get());
+        auto const start = clock::now();
+        for (std::size_t i = 0; ok && i < bursts; ++i) {
+            ok = s.send_all(burst) && s.recv_exactly(echoes.data(), echoes.size());
+        }
+        elapsed = clock::now() - start;
+    }
+    double const client_cpu = thread_cpu_seconds() - cpu_before;
+
+    server.request_shutdown();
+    server_thread.join();
+
+    server_stats const& stats = server.stats();
+    if (mode == Mode::Ktls && (stats.ktls_send == 0 || stats.ktls_recv == 0)) {
+        ktls_missing = true;
+    }
+
+    auto const n = static_cast<double>(bursts * burst_messages);
+    std::print("{:>8} {:<16} {:>12.0f} {:>10.0f} {:>12.0f}\n", size, to_string(mode, stats),
+            n / elapsed.count(), n * static_cast<double>(size) / elapsed.count() / 1e6,
+            (server_cpu + client_cpu) * 1e9 / n);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    namespace fs = std::filesystem;
+    std::string const base
+            = (fs::temp_directory_path() / ("bench_tls." + std::to_string(::getpid()))).string();
+    std::string const cert = base + ".crt";
+    std::string const key = base + ".key";
+    write_self_signed_certificate(cert, key);
+
+    std::print("{:>8} {:<16} {:>12} {:>10} {:>12}\n", "bytes", "mode", "msgs/s", "MB/s",
+            "cpu ns/msg");
+
+    int port = BasePort;
+    bool ok = true;
+    bool ktls_missing = false;
+    for (std::size_t const size : {64UL, 4096UL, 65536UL}) {
+        for (Mode const mode : {Mode::Plain, Mode::UserTls, Mode::Ktls}) {
+            ok = run_case(size, mode, port++, cert, key, ktls_missing);
+            if (!ok) {
+                std::print(stderr, "{} byte echo failed\n", size);
+                break;
+            }
+        }
+        if (!ok) {
+            break;
+        }
+    }
+    if (ktls_missing) {
+        std::print("kTLS wasn't (fully) available, those rows ran (partly) in user space; "
+                   "see /proc/sys/net/ipv4/tcp_available_ulp\n");
+    }
+
+    fs::remove(cert);
+    fs::remove(key);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,172 @@
+// The same echo server reached over loopback tcp and over its unix domain
+// socket listeners (server_config::unix_listeners), in the filesystem and
+// in the abstract namespace, per payload size. Latency is one message at
+// a time; throughput streams them, Burst per write, from a second thread
+// while the first reads the echoes. cpu is client and server together,
+// per message of both runs. A unix socket
+// skips the whole tcp/ip stack (segmentation, checksums, acks, loopback
+// softirq), so the gap is widest for small messages.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "util/socket_address.hpp"
+#include "ws/frame_generator.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h>  // ::close, ::getpid
+#include <algorithm> // std::clamp
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 19600;
+static constexpr std::size_t BytesPerCase = 64 * 1024 * 1024;
+static constexpr std::size_t Burst = 32; ///< messages per write in the throughput run
+
+enum class Transport
+{
+    Tcp,          ///< 127.0.0.1:port
+    UnixPath,     ///< unix:PATH
+    UnixAbstract, ///< unix:@NAME
+};
+
+char const*
+to_string(Transport transport)
+{
+    switch (transport) {
+        case Transport::UnixPath:
+            return "unix";
+        case Transport::UnixAbstract:
+            return "unix (abstract)";
+        case Transport::Tcp:
+        default:
+            return "tcp";
+    }
+}
+
+bool
+run_case(std::size_t size, Transport transport, int port)
+{
+    std::string const path = "unix:/tmp/ws_bench_unix_socket." + std::to_string(::getpid());
+    std::string const name = "unix:@ws_bench_unix_socket." + std::to_string(::getpid());
+
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.sockets.nodelay = true;
+    config.unix_listeners = {path, name};
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    int fd = -1;
+    switch (transport) {
+        case Transport::UnixPath:
+            fd = connect_websocket(resolve_socket_address(path));
+            break;
+        case Transport::UnixAbstract:
+            fd = connect_websocket(resolve_socket_address(name));
+            break;
+        case Transport::Tcp:
+        default:
+            fd = connect_websocket(port);
+            break;
+    }
+
+    std::vector<std::uint8_t> const payload(size, 'p');
+    auto const single = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+    std::vector<std::uint8_t> burst;
+    for (std::size_t i = 0; i < Burst; ++i) {
+        burst.insert(burst.end(), single.begin(), single.end());
+    }
+    std::size_t const messages
+            = std::clamp<std::size_t>(BytesPerCase / size, 2'000, 100'000) / Burst * Burst;
+
+    // latency: one message at a time
+    double const cpu_before = thread_cpu_seconds();
+    std::vector<double> rtts;
+    rtts.reserve(messages / 4);
+    bool ok = fd != -1;
+    for (std::size_t i = 0; ok && i < messages / 4; ++i) {
+        auto const sent = clock::now();
+        ok = ::send(fd, single.data(), single.size(), MSG_NOSIGNAL)
+                        == static_cast<ssize_t>(single.size())
+                && receive_payload(fd, size);
+        std::chrono::duration<double, std::micro> const rtt = clock::now() - sent;
+        rtts.push_back(rtt.count());
+    }
+
+    // throughput: the server's sends block, so someone has to keep
+    // reading while the requests go out
+    auto const start = clock::now();
+    double sender_cpu = 0.0;
+    std::thread sender;
+    if (ok) {
+        sender = std::thread([&] {
+            double const sender_start = thread_cpu_seconds();
+            for (std::size_t sent = 0; sent < messages; sent += Burst) {
+                if (::send(fd, burst.data(), burst.size(), MSG_NOSIGNAL)
+                        != static_cast<ssize_t>(burst.size())) {
+                    break;
+                }
+            }
+            sender_cpu = thread_cpu_seconds() - sender_start;
+        });
+        ok = receive_payload(fd, messages * size);
+        sender.join();
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+    double const client_cpu = thread_cpu_seconds() - cpu_before + sender_cpu;
+    if (fd != -1) {
+        ::close(fd);
+    }
+
+    server.request_shutdown();
+    server_thread.join();
+
+    latency_summary const latency = summarize(rtts);
+    auto const n = static_cast<double>(messages);
+    std::print("{:>8} {:<16} {:>9.1f} {:>9.1f} {:>12.0f} {:>10.0f} {:>12.0f}\n", size,
+            to_string(transport), latency.p50, latency.p99, n / elapsed.count(),
+            n * static_cast<double>(size) / elapsed.count() / 1e6,
+            (server_cpu + client_cpu) * 1e9 / (n + static_cast<double>(rtts.size())));
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{:>8} {:<16} {:>9} {:>9} {:>12} {:>10} {:>12}\n", "bytes", "transport", "p50 us",
+            "p99 us", "msgs/s", "MB/s", "cpu ns/msg");
+
+    int port = BasePort;
+    for (std::size_t const size : {64UL, 4096UL, 65536UL}) {
+        for (Transport const transport :
+                {Transport::Tcp, Transport::UnixPath, Transport::UnixAbstract}) {
+            if (!run_case(size, transport, port++)) {
+                std::print(stderr, "{} byte echo ({}) failed\n", size, to_string(transport));
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
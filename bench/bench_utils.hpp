@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib> // std::free, std::malloc
+#include <ctime>   // ::clock_gettime, CLOCK_THREAD_CPUTIME_ID
+#include <new>
+#include <print>
+#include <string_view>
+
+
+namespace ws::bench {
+
+using clock = std::chrono::steady_clock;
+
+/// Heap allocations made so far. Only counted by benchmarks that define
+/// WS_BENCH_COUNT_ALLOCATIONS before including this header (once per
+/// executable, since that replaces the global operator new).
+inline std::atomic<std::uint64_t> allocations{0};
+
+/// Keep the compiler from optimizing away a value that is otherwise unused
+template <typename T>
+inline void
+do_not_optimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// cpu time consumed by the calling thread so far, in seconds
+inline double
+thread_cpu_seconds() noexcept
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+/// Outcome of a single benchmark case
+struct result
+{
+    std::uint64_t iterations = 0;
+    double ns_per_op = 0.0;
+    double ops_per_sec = 0.0;
+    double allocs_per_op = 0.0;
+};
+
+/// Run \c fn \c iterations times (after a short warm-up) and time it
+template <typename Fn>
+result
+measure(std::uint64_t iterations, Fn&& fn)
+{
+    for (std::uint64_t i = 0; i < iterations / 10; ++i) {
+        fn();
+    }
+
+    std::uint64_t const allocs_before = allocations.load(std::memory_order_relaxed);
+    auto const start = clock::now();
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    std::chrono::duration<double, std::nano> const elapsed = clock::now() - start;
+    std::uint64_t const allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+
+    result r;
+    r.iterations = iterations;
+    r.ns_per_op = elapsed.count() / static_cast<double>(iterations);
+    r.ops_per_sec = 1e9 / r.ns_per_op;
+    r.allocs_per_op = static_cast<double>(allocs) / static_cast<double>(iterations);
+    return r;
+}
+
+/// Print a table header matching print_result()
+inline void
+print_header(std::string_view title)
+{
+    std::print("\n{}\n{:<44} {:>12} {:>14} {:>10}\n", title, "case", "ns/op", "ops/s",
+            "allocs/op");
+}
+
+inline void
+print_result(std::string_view name, result const& r)
+{
+    std::print("{:<44} {:>12.1f} {:>14.0f} {:>10.2f}\n", name, r.ns_per_op, r.ops_per_sec,
+            r.allocs_per_op);
+}
+
+} // namespace ws::bench
+
+
+#ifdef WS_BENCH_COUNT_ALLOCATIONS
+
+void*
+operator new(std::size_t size)
+{
+    ws::bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif // WS_BENCH_COUNT_ALLOCATIONS
@@ -0,0 +1,98 @@
+// Large binary echoes with and without MSG_ZEROCOPY, per payload size:
+// throughput and server cpu time per echo. On loopback the kernel copies
+// zerocopy payloads anyway when it hands them to the receiving socket (the
+// "copied" column), so the win only shows with a real NIC; what loopback
+// does show is the fixed cost of tracking completions for small sends.
+
+#include "bench_client.hpp"
+#include "bench_utils.hpp"
+#include "echo_server/echo_server.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <spdlog/spdlog.h>
+#include <unistd.h> // ::close
+#include <algorithm> // std::clamp
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using namespace ws::bench;
+
+static constexpr int BasePort = 18500;
+static constexpr std::size_t BytesPerCase = 256 * 1024 * 1024;
+
+/// Echo \c size byte binary frames through a fresh server
+/// \return \c false on error
+bool
+run_case(std::size_t size, bool zerocopy, int port)
+{
+    server_config config;
+    config.port = port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+    config.zerocopy_threshold = zerocopy ? 1 : 0;
+
+    echo_server server(config);
+    double server_cpu = 0.0;
+    std::thread server_thread([&] {
+        double const start = thread_cpu_seconds();
+        server.run();
+        server_cpu = thread_cpu_seconds() - start;
+    });
+
+    std::vector<std::uint8_t> const payload(size, 'z');
+    auto const request
+            = frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true).take_data();
+    std::size_t const response_size = frame_header_size(size) + size;
+    std::size_t const echoes = std::clamp<std::size_t>(BytesPerCase / size, 100, 20'000);
+
+    auto const start = clock::now();
+    int const fd = connect_websocket(port);
+    bool ok = fd != -1;
+    for (std::size_t i = 0; ok && i < echoes; ++i) {
+        ok = round_trip(fd, request, response_size);
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    std::chrono::duration<double> const elapsed = clock::now() - start;
+
+    server.request_shutdown();
+    server_thread.join();
+
+    server_stats const stats = server.stats();
+    std::print("{:>8} {:<10} {:>12.0f} {:>14.2f} {:>9}/{}\n", size, zerocopy ? "zerocopy" : "copy",
+            static_cast<double>(echoes * size) / elapsed.count() / 1e6,
+            server_cpu * 1e6 / static_cast<double>(echoes), stats.zerocopy_copied,
+            stats.zerocopy_sends);
+    return ok;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::print("{:>8} {:<10} {:>12} {:>14} {:>12}\n", "bytes", "send", "MB/s", "srv us/echo",
+            "copied");
+
+    int port = BasePort;
+    for (std::size_t const size : {4096UL, 16384UL, 65536UL, 262144UL, 524288UL}) {
+        for (bool const zerocopy : {false, true}) {
+            if (!run_case(size, zerocopy, port++)) {
+                std::print(stderr, "{} byte echo ({}) failed\n", size,
+                        zerocopy ? "zerocopy" : "copy");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Two-stage profile-guided build:
+#   ./pgo_build.sh build_pgo gcc_release.ini
+#   ./pgo_build.sh build_pgo_clang clang_release.ini
+# builds everything instrumented (-Dpgo=generate), runs the pgo_train
+# loopback workload to collect a profile, then rebuilds the same build
+# directory with the profile (-Dpgo=use). Run it again after changing the
+# code: stale profiles are ignored, not fatal.
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <build_dir> [native_file]" >&2
+    exit 1
+fi
+build_dir=$1
+native_file=${2:-gcc_release.ini}
+
+if [ -d "$build_dir" ]; then
+    meson configure "$build_dir" -Dpgo=generate
+else
+    meson setup "$build_dir" --native-file="$native_file" -Dpgo=generate
+fi
+
+# stage 1: instrumented build, training run
+rm -rf "$build_dir/pgo"
+meson compile -C "$build_dir" pgo_train
+"$build_dir/pgo_train"
+
+# clang writes raw profiles that have to be merged first
+if ls "$build_dir"/pgo/*.profraw >/dev/null 2>&1; then
+    llvm-profdata merge -output="$build_dir/pgo/ws.profdata" "$build_dir"/pgo/*.profraw
+fi
+
+# stage 2: optimized build
+meson configure "$build_dir" -Dpgo=use
+meson compile -C "$build_dir"
@@ -0,0 +1,179 @@
+#include "backend_stub.hpp"
+#include <spdlog/spdlog.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h> // ::eventfd
+#include <sys/socket.h>
+#include <unistd.h> // ::close, ::unlink
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <stdexcept>
+
+
+namespace ws {
+namespace {
+    static constexpr int ListenBacklog = 128;           ///< max num of pending connections
+    static constexpr int EpollMaxEvents = 64;           ///< max num of pending epoll events
+    static constexpr std::size_t RecvSize = 256 * 1024; ///< max bytes read per recv
+} // namespace
+
+backend_stub::backend_stub(std::string const& address)
+        : address_(resolve_socket_address(address))
+        , buf_(RecvSize)
+{
+    listen_fd_ = ::socket(address_.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    if (address_.family() == AF_UNIX) {
+        ::unlink(unix_socket_path(address_).c_str());
+    } else {
+        int const yes = 1;
+        if (int rv = ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+                rv == -1) {
+            throw std::runtime_error(
+                    std::string("setsockopt (SO_REUSEADDR): ") + std::strerror(errno));
+        }
+    }
+
+    if (int rv = ::bind(listen_fd_, address_.get(), address_.size); rv == -1) {
+        throw std::runtime_error(std::string("bind (") + address + "): " + std::strerror(errno));
+    }
+    if (int rv = ::listen(listen_fd_, ListenBacklog); rv == -1) {
+        throw std::runtime_error(std::string("listen: ") + std::strerror(errno));
+    }
+
+    epollfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd_ == -1) {
+        throw std::runtime_error(std::string("epoll_create1: ") + std::strerror(errno));
+    }
+
+    wakeup_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ == -1) {
+        throw std::runtime_error(std::string("eventfd: ") + std::strerror(errno));
+    }
+}
+
+backend_stub::~backend_stub() noexcept
+{
+    for (int const fd : clients_) {
+        ::close(fd);
+    }
+    ::close(listen_fd_);
+    ::close(epollfd_);
+    ::close(wakeup_fd_);
+
+    if (std::string const path = unix_socket_path(address_); !path.empty()) {
+        ::unlink(path.c_str());
+    }
+}
+
+bool
+backend_stub::run()
+{
+    // level-triggered: one recv per readable event is enough
+    for (int const fd : {listen_fd_, wakeup_fd_}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &event); rv == -1) {
+            SPDLOG_CRITICAL("error: epoll_ctl: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+    }
+
+    epoll_event events[EpollMaxEvents];
+    for (;;) {
+        int const num_events = ::epoll_wait(
+                epollfd_, static_cast<epoll_event*>(events), EpollMaxEvents, /*timeout=*/-1);
+        if (num_events == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            SPDLOG_CRITICAL("error: epoll_wait: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+
+        for (int i = 0; i < num_events; ++i) {
+            int const fd = events[i].data.fd;
+            if (fd == wakeup_fd_) {
+                return true;
+            }
+            if (fd == listen_fd_) {
+                if (!on_incoming_connection()) {
+                    return false;
+                }
+            } else {
+                on_incoming_data(fd);
+            }
+        }
+    }
+}
+
+void
+backend_stub::request_shutdown() noexcept
+{
+    std::uint64_t const one = 1;
+    [[maybe_unused]] ssize_t const rv = ::write(wakeup_fd_, &one, sizeof(one));
+}
+
+std::uint64_t
+backend_stub::bytes_echoed() const noexcept
+{
+    return bytes_echoed_.load(std::memory_order_relaxed);
+}
+
+bool
+backend_stub::on_incoming_connection() noexcept
+{
+    int const sock = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (sock == -1) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+            return true;
+        }
+        SPDLOG_CRITICAL("error: accept: {} {}", std::strerror(errno), errno);
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = sock;
+    if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, sock, &event); rv == -1) {
+        SPDLOG_CRITICAL("error: epoll_ctl (EPOLL_CTL_ADD): {} {}", std::strerror(errno), errno);
+        ::close(sock);
+        return false;
+    }
+
+    clients_.insert(sock);
+    SPDLOG_DEBUG("backend client connected on fd {}", sock);
+    return true;
+}
+
+void
+backend_stub::on_incoming_data(int fd) noexcept
+{
+    ssize_t const nbytes = ::recv(fd, buf_.data(), buf_.size(), 0);
+    if (nbytes == -1 && errno == EINTR) {
+        return;
+    }
+
+    // the echo is a blocking send: the proxy on the other end keeps reading
+    bool ok = nbytes > 0;
+    std::size_t sent = 0;
+    while (ok && sent < static_cast<std::size_t>(nbytes)) {
+        ssize_t const n = ::send(
+                fd, buf_.data() + sent, static_cast<std::size_t>(nbytes) - sent, MSG_NOSIGNAL);
+        ok = n > 0 || (n == -1 && errno == EINTR);
+        sent += n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+    bytes_echoed_.fetch_add(sent, std::memory_order_relaxed);
+
+    if (!ok) {
+        SPDLOG_DEBUG("backend client on fd {} disconnected", fd);
+        ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        clients_.erase(fd);
+    }
+}
+
+} // namespace ws
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "util/socket_address.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ws {
+
+/*! \class  backend_stub
+ *  \brief  Stand-in backend for the echo_server reverse proxy. Listens on
+ *          a tcp or unix socket and echoes every byte it receives back on
+ *          the same connection.
+ */
+class backend_stub
+{
+public:
+    /// \param address "host:port" or "unix:PATH" to listen on
+    /// \throw std::runtime_error if the listening socket can't be set up
+    explicit backend_stub(std::string const& address);
+    ~backend_stub() noexcept;
+
+    // no copies/moves
+    backend_stub(backend_stub const&) = delete;
+    backend_stub(backend_stub&&) = delete;
+    backend_stub& operator=(backend_stub const&) = delete;
+    backend_stub&& operator=(backend_stub&&) = delete;
+
+    /// Serve connections until request_shutdown()
+    /// \return \c false on error
+    bool run();
+
+    /// Make run() return. Safe to call from any thread.
+    void request_shutdown() noexcept;
+
+    /// Bytes echoed so far
+    std::uint64_t bytes_echoed() const noexcept;
+
+private:
+    bool on_incoming_connection() noexcept;
+    void on_incoming_data(int fd) noexcept;
+
+private:
+    socket_address address_;                     ///< where we listen
+    int listen_fd_ = -1;                         ///< listening socket
+    int epollfd_ = -1;                           ///< epoll file descriptor
+    int wakeup_fd_ = -1;                         ///< eventfd poked by request_shutdown()
+    std::unordered_set<int> clients_;            ///< connected sockets
+    std::vector<std::uint8_t> buf_;              ///< receive buffer shared by all clients
+    std::atomic<std::uint64_t> bytes_echoed_{0}; ///< bytes sent back so far
+};
+
+} // namespace ws
@@ -0,0 +1,86 @@
+#include "backend_stub/backend_stub.hpp"
+#include <getopt.h>
+#include <spdlog/spdlog.h>
+#include <csignal> // ::pthread_sigmask, ::sigwait, SIGINT, SIGTERM
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <string>
+#include <thread>
+
+namespace {
+
+void
+print_usage(char const* prog)
+{
+    std::print(stderr,
+            "usage: {} [options]\n"
+            "echoes every byte back; a backend for echo_server --backend\n"
+            "  -l, --listen=ADDR        host:port or unix:PATH (default 127.0.0.1:9000)\n"
+            "  -h, --help               show this message\n",
+            prog);
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    spdlog::set_level(spdlog::level::info);
+
+    // [2025-07-17 11:10:13.674784] [info] [main.cpp:14] message
+    spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%^%l%$] [%s:%#] %v");
+
+    std::string address = "127.0.0.1:9000";
+
+    static option const long_options[] = {
+            {"listen", required_argument, nullptr, 'l'},
+            {"help", no_argument, nullptr, 'h'},
+            {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = ::getopt_long(argc, argv, "l:h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'l':
+                address = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    // SIGINT/SIGTERM are picked up by sigwait below, so the destructor
+    // gets to remove a unix socket path
+    sigset_t mask;
+    ::sigemptyset(&mask);
+    ::sigaddset(&mask, SIGINT);
+    ::sigaddset(&mask, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    try {
+        ws::backend_stub stub(address);
+        SPDLOG_INFO("backend stub listening on {}", address);
+
+        bool ok = true;
+        std::thread server_thread([&] { ok = stub.run(); });
+
+        int signo = 0;
+        ::sigwait(&mask, &signo);
+        stub.request_shutdown();
+        server_thread.join();
+
+        SPDLOG_INFO("echoed {} bytes", stub.bytes_echoed());
+        if (!ok) {
+            return EXIT_FAILURE;
+        }
+    } catch (std::exception const& e) {
+        SPDLOG_CRITICAL("error: exception: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
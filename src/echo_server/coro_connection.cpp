@@ -0,0 +1,264 @@
+#include "coro_connection.hpp"
+#include "echo_server.hpp"
+#include "ws/connection.hpp"
+#include <utility> // std::exchange
+
+
+namespace ws {
+
+handler_task::handler_task(std::coroutine_handle<promise_type> handle) noexcept
+        : handle_(handle)
+{
+    // empty
+}
+
+handler_task::~handler_task() noexcept
+{
+    if (handle_) {
+        handle_.destroy();
+    }
+}
+
+handler_task::handler_task(handler_task&& other) noexcept
+        : handle_(std::exchange(other.handle_, {}))
+{
+    // empty
+}
+
+handler_task&
+handler_task::operator=(handler_task&& other) noexcept
+{
+    if (this != &other) {
+        if (handle_) {
+            handle_.destroy();
+        }
+        handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+}
+
+bool
+handler_task::done() const noexcept
+{
+    return !handle_ || handle_.done();
+}
+
+void
+handler_task::resume() const
+{
+    handle_.resume();
+}
+
+std::exception_ptr
+handler_task::exception() const noexcept
+{
+    return handle_ ? handle_.promise().exception : nullptr;
+}
+
+
+coro_connection::recv_awaiter::recv_awaiter(coro_connection& conn) noexcept
+        : conn_(conn)
+{
+    // empty
+}
+
+bool
+coro_connection::recv_awaiter::await_ready() const noexcept
+{
+    return conn_.inbox_.has_value();
+}
+
+void
+coro_connection::recv_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    conn_.suspend(HandlerWait::Message, handle);
+}
+
+message
+coro_connection::recv_awaiter::await_resume() noexcept
+{
+    message msg = std::move(*conn_.inbox_);
+    conn_.inbox_.reset();
+    return msg;
+}
+
+
+coro_connection::send_awaiter::send_awaiter(
+        coro_connection& conn, std::span<std::uint8_t const> payload, OpCode op_code) noexcept
+        : conn_(conn)
+        , payload_(payload)
+        , op_code_(op_code)
+{
+    // empty
+}
+
+bool
+coro_connection::send_awaiter::await_ready() noexcept
+{
+    // whatever the socket doesn't take is queued on the connection; only
+    // wait if something was
+    ok_ = conn_.server_.send_from_handler(conn_.conn_, payload_, op_code_);
+    return !ok_ || !conn_.conn_.write_blocked;
+}
+
+void
+coro_connection::send_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    conn_.suspend(HandlerWait::Writable, handle);
+}
+
+bool
+coro_connection::send_awaiter::await_resume() const noexcept
+{
+    return ok_;
+}
+
+
+coro_connection::sleep_awaiter::sleep_awaiter(
+        coro_connection& conn, std::chrono::steady_clock::duration duration) noexcept
+        : conn_(conn)
+        , duration_(duration)
+{
+    // empty
+}
+
+bool
+coro_connection::sleep_awaiter::await_ready() const noexcept
+{
+    return duration_ <= std::chrono::steady_clock::duration::zero();
+}
+
+void
+coro_connection::sleep_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    conn_.timer_id_ = conn_.server_.add_handler_timer(conn_.conn_.sockfd, duration_);
+    conn_.suspend(HandlerWait::Timer, handle);
+}
+
+void
+coro_connection::sleep_awaiter::await_resume() const noexcept
+{
+    // empty
+}
+
+
+coro_connection::coro_connection(echo_server& server, connection& conn, frame_pool& frames) noexcept
+        : server_(server)
+        , conn_(conn)
+        , frames_(frames)
+{
+    // empty
+}
+
+coro_connection::recv_awaiter
+coro_connection::recv_message() noexcept
+{
+    return recv_awaiter(*this);
+}
+
+coro_connection::send_awaiter
+coro_connection::send(std::span<std::uint8_t const> payload, OpCode op_code) noexcept
+{
+    return send_awaiter(*this, payload, op_code);
+}
+
+coro_connection::sleep_awaiter
+coro_connection::sleep_for(std::chrono::steady_clock::duration duration) noexcept
+{
+    return sleep_awaiter(*this, duration);
+}
+
+int
+coro_connection::sockfd() const noexcept
+{
+    return conn_.sockfd;
+}
+
+frame_pool&
+coro_connection::frames() const noexcept
+{
+    return frames_;
+}
+
+void
+coro_connection::start(handler_task task) noexcept
+{
+    task_ = std::move(task);
+}
+
+void
+coro_connection::resume()
+{
+    wait_ = HandlerWait::None;
+    if (waiter_) {
+        std::exchange(waiter_, {}).resume();
+    } else {
+        task_.resume(); // first run
+    }
+}
+
+bool
+coro_connection::accepts_message() const noexcept
+{
+    return !inbox_.has_value() || task_.done();
+}
+
+void
+coro_connection::deliver(message&& msg) noexcept
+{
+    inbox_ = std::move(msg);
+}
+
+bool
+coro_connection::waiting_for(HandlerWait what) const noexcept
+{
+    return wait_ == what;
+}
+
+bool
+coro_connection::waiting_for_timer(std::uint64_t id) const noexcept
+{
+    return wait_ == HandlerWait::Timer && timer_id_ == id;
+}
+
+bool
+coro_connection::done() const noexcept
+{
+    return task_.done();
+}
+
+std::exception_ptr
+coro_connection::exception() const noexcept
+{
+    return task_.exception();
+}
+
+void
+coro_connection::suspend(HandlerWait what, std::coroutine_handle<> handle) noexcept
+{
+    wait_ = what;
+    waiter_ = handle;
+}
+
+
+// gcc warns about the state machine it generates for a coroutine body
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wswitch-default"
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+
+handler_task
+echo_handler(coro_connection& conn)
+{
+    for (;;) {
+        message const msg = co_await conn.recv_message();
+
+        // like the callbacks, don't bother echoing empty messages
+        if (!msg.payload.empty() && !co_await conn.send(msg.payload, msg.op_code)) {
+            co_return;
+        }
+    }
+}
+
+#pragma GCC diagnostic pop
+
+} // namespace ws
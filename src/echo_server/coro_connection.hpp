@@ -0,0 +1,254 @@
+#pragma once
+
+#include "util/frame_pool.hpp"
+#include "ws/frame.hpp"
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ws {
+
+class coro_connection;
+class echo_server;
+struct connection;
+
+/*! \class  handler_task
+ *  \brief  Coroutine type of a connection handler. Starts suspended and
+ *          is resumed by the event loop. Its frame is allocated from the
+ *          reactor's frame_pool, which is why a handler must take its
+ *          coro_connection as the first parameter.
+ */
+class handler_task
+{
+public:
+    struct promise_type
+    {
+        std::exception_ptr exception; ///< escaped the handler, rethrown by the event loop
+
+        handler_task
+        get_return_object() noexcept
+        {
+            return handler_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always
+        initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always
+        final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void
+        return_void() noexcept
+        {
+            // empty
+        }
+
+        void
+        unhandled_exception() noexcept
+        {
+            exception = std::current_exception();
+        }
+
+        template <typename... Args>
+        static void* operator new(std::size_t size, coro_connection& conn, Args&... args);
+
+        static void
+        operator delete(void* ptr) noexcept
+        {
+            frame_pool::deallocate(ptr);
+        }
+    };
+
+    handler_task() noexcept = default;
+    ~handler_task() noexcept;
+
+    handler_task(handler_task const&) = delete;
+    handler_task& operator=(handler_task const&) = delete;
+    handler_task(handler_task&& other) noexcept;
+    handler_task& operator=(handler_task&& other) noexcept;
+
+    /// \return \c true once the handler has returned (or thrown)
+    bool done() const noexcept;
+
+    /// Run the handler up to its next suspension point
+    void resume() const;
+
+    /// What the handler threw, if anything
+    std::exception_ptr exception() const noexcept;
+
+private:
+    explicit handler_task(std::coroutine_handle<promise_type> handle) noexcept;
+
+private:
+    std::coroutine_handle<promise_type> handle_; ///< owned coroutine frame
+};
+
+/// A complete text or binary message received from the client
+struct message
+{
+    OpCode op_code = OpCode::Binary;   ///< text or binary
+    std::vector<std::uint8_t> payload; ///< unmasked (and reassembled) payload
+};
+
+/// What a suspended handler is waiting for
+enum class HandlerWait : std::uint8_t
+{
+    None,     ///< running, finished, or not started
+    Message,  ///< recv_message()
+    Writable, ///< send() that the socket couldn't take at once
+    Timer,    ///< sleep_for()
+};
+
+/*! \class  coro_connection
+ *  \brief  A websocket connection as seen by a coroutine handler. The
+ *          awaitables suspend the handler until the event loop has what
+ *          it asked for; none of them allocate.
+ *
+ *  The event loop hands over one message at a time and parses no further
+ *  frames until the handler has taken it, so a slow handler pushes back
+ *  on the client through tcp. When the connection goes away the handler
+ *  is destroyed at whatever co_await it is suspended in; when the handler
+ *  returns, the connection is closed.
+ */
+class coro_connection
+{
+public:
+    class recv_awaiter
+    {
+    public:
+        explicit recv_awaiter(coro_connection& conn) noexcept;
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle) noexcept;
+        message await_resume() noexcept;
+
+    private:
+        coro_connection& conn_;
+    };
+
+    class send_awaiter
+    {
+    public:
+        send_awaiter(coro_connection& conn, std::span<std::uint8_t const> payload,
+                OpCode op_code) noexcept;
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> handle) noexcept;
+        bool await_resume() const noexcept;
+
+    private:
+        coro_connection& conn_;
+        std::span<std::uint8_t const> payload_;
+        OpCode op_code_;
+        bool ok_ = false;
+    };
+
+    class sleep_awaiter
+    {
+    public:
+        sleep_awaiter(coro_connection& conn, std::chrono::steady_clock::duration duration) noexcept;
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept;
+
+    private:
+        coro_connection& conn_;
+        std::chrono::steady_clock::duration duration_;
+    };
+
+public:
+    coro_connection(echo_server& server, connection& conn, frame_pool& frames) noexcept;
+
+    // awaitables suspended in a handler point back at us: no copies/moves
+    coro_connection(coro_connection const&) = delete;
+    coro_connection(coro_connection&&) = delete;
+    coro_connection& operator=(coro_connection const&) = delete;
+    coro_connection&& operator=(coro_connection&&) = delete;
+
+    /// co_await: the next text or binary message from the client
+    recv_awaiter recv_message() noexcept;
+
+    /// co_await: send \c payload as one message. Completes right away
+    /// unless the socket is full; then the handler resumes once the
+    /// kernel has taken all of it. The payload is copied if need be, so
+    /// it only has to live until the co_await.
+    /// \return \c false if the send failed
+    send_awaiter send(
+            std::span<std::uint8_t const> payload, OpCode op_code = OpCode::Binary) noexcept;
+
+    /// co_await: resume after at least \c duration
+    sleep_awaiter sleep_for(std::chrono::steady_clock::duration duration) noexcept;
+
+    /// Client socket
+    int sockfd() const noexcept;
+
+    /// Pool the handler's frame comes from
+    frame_pool& frames() const noexcept;
+
+    // event loop side
+
+    /// Take ownership of the handler. The first resume() runs it up to its
+    /// first co_await.
+    void start(handler_task task) noexcept;
+
+    /// Resume the handler where it's suspended
+    void resume();
+
+    /// \return \c true if the handler has taken the last message delivered
+    ///         (or will never take another)
+    bool accepts_message() const noexcept;
+
+    /// Queue \c msg for recv_message()
+    void deliver(message&& msg) noexcept;
+
+    /// \return \c true if the handler is suspended waiting for \c what
+    bool waiting_for(HandlerWait what) const noexcept;
+
+    /// \return \c true if the handler is suspended in the sleep_for() that
+    ///         registered timer \c id
+    bool waiting_for_timer(std::uint64_t id) const noexcept;
+
+    /// \return \c true once the handler has returned (or thrown)
+    bool done() const noexcept;
+
+    /// What the handler threw, if anything
+    std::exception_ptr exception() const noexcept;
+
+private:
+    void suspend(HandlerWait what, std::coroutine_handle<> handle) noexcept;
+
+private:
+    echo_server& server_;                  ///< event loop we belong to
+    connection& conn_;                     ///< connection state in the event loop
+    frame_pool& frames_;                   ///< reactor's coroutine frame pool
+    handler_task task_;                    ///< the handler
+    std::coroutine_handle<> waiter_;       ///< where the handler is suspended
+    HandlerWait wait_ = HandlerWait::None; ///< what it's waiting for
+    std::uint64_t timer_id_ = 0;           ///< timer of the pending sleep_for()
+    std::optional<message> inbox_;         ///< delivered, not yet received
+};
+
+/// Echoes every message back; the coroutine counterpart of echo_server's
+/// built-in callbacks
+handler_task echo_handler(coro_connection& conn);
+
+
+/**********************************************************************/
+
+template <typename... Args>
+void*
+handler_task::promise_type::operator new(
+        std::size_t size, coro_connection& conn, [[maybe_unused]] Args&... args)
+{
+    return conn.frames().allocate(size);
+}
+
+} // namespace ws
@@ -1,27 +1,51 @@
 #include "echo_server.hpp"
-#include "util/base64_codec.hpp"
-#include "util/sha1.hpp"
+#include "util/fd_passing.hpp"
+#include "util/probes.hpp"
+#include "util/socket_address.hpp"
+#include "util/static_content.hpp"
 #include "util/str_utils.hpp"
+#include "util/timestamping.hpp"
+#include "util/tls.hpp"
+#include "util/worker_pool.hpp"
+#include "util/zerocopy.hpp"
+#include "ws/batch.hpp"
 #include "ws/connection.hpp"
 #include "ws/connection_fmt.hpp"
 #include "ws/frame.hpp"
 #include "ws/frame_fmt.hpp"
-#include "ws/frame_generator.hpp"
-#include <arpa/inet.h> // ::inet_ntop
-#include <fcntl.h>     // ::fcntl
+#include "ws/frame_header.hpp"
+#include "ws/handshake.hpp"
+#include <arpa/inet.h>    // ::inet_ntop
+#include <fcntl.h>        // ::fcntl, ::open
+#include <linux/filter.h> // sock_filter, sock_fprog, SKF_AD_CPU
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_NODELAY, TCP_NOTSENT_LOWAT, TCP_FASTOPEN, TCP_DEFER_ACCEPT
 #include <spdlog/spdlog.h>
 #include <sys/epoll.h>
-#include <sys/socket.h> // ::setsockopt
+#include <sys/eventfd.h>  // ::eventfd
+#include <sys/sendfile.h> // ::sendfile
+#include <sys/ioctl.h>    // ::ioctl, _IOW
+#include <sys/poll.h>     // ::poll
+#include <sys/signalfd.h> // ::signalfd
+#include <sys/socket.h>   // ::setsockopt
+#include <sys/stat.h>     // ::stat, S_ISSOCK
 #include <sys/types.h>
-#include <unistd.h>  // ::close
-#include <algorithm> // std::find_if
+#include <sys/un.h>    // sockaddr_un
+#include <unistd.h>    // ::close
+#include <algorithm>   // std::clamp, std::find_if, std::push_heap, std::sort
+#include <array>
 #include <cassert>
+#include <cctype>  // std::isspace, std::tolower
+#include <csignal> // sigset_t, SIGINT, SIGTERM
 #include <cstdlib> // std::abort
 #include <cstring> // std::memset, std::strerror
+#include <exception>
+#include <functional> // std::greater
+#include <iterator>   // std::back_inserter
 #include <print>
 #include <span>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -31,7 +55,405 @@ namespace {
     static constexpr int ListenBacklog = 10;     ///< max num of pending connections
     static constexpr int EpollMaxEvents = 20;    ///< max num of pending epoll events
     static constexpr int EpollTimeoutMsecs = 10; ///< num of milliseconds to block on epoll_wait
-    static constexpr std::string_view MagicGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    static constexpr std::uint16_t CloseNormal = 1000;        ///< rfc 6455 7.4.1 normal closure
+    static constexpr std::uint16_t CloseGoingAway = 1001;     ///< rfc 6455 7.4.1 going away
+    static constexpr std::uint16_t CloseInvalidData = 1007;   ///< rfc 6455 7.4.1 malformed data
+    static constexpr std::uint16_t CloseTooBig = 1009;        ///< rfc 6455 7.4.1 message too big
+    static constexpr std::uint16_t CloseInternalError = 1011; ///< rfc 6455 7.4.1 server failure
+    static constexpr std::uint16_t CloseBadGateway = 1014;    ///< iana registry: bad gateway
+    static constexpr std::uint64_t BackendTag = 1ULL << 32;  ///< marks backend fds in epoll data
+    static constexpr std::size_t SplicePipeSize = 1'048'576; ///< max bytes per backend splice
+    static constexpr std::size_t MaxRequestHeaderSize = 16384; ///< larger http requests get 431
+    static constexpr std::size_t MaxTimedReplies = 1024; ///< replies awaiting tx stamps, per conn
+
+    // plain http responses, complete and allocation free
+    static constexpr std::string_view ConnectionClose = "Connection: close\r\n";
+    static constexpr std::string_view HealthResponse = "HTTP/1.1 200 OK\r\n"
+                                                       "Content-Type: text/plain\r\n"
+                                                       "Content-Length: 3\r\n"
+                                                       "Cache-Control: no-store\r\n"
+                                                       "\r\n"
+                                                       "ok\n";
+    static constexpr std::string_view ReadyResponse = "HTTP/1.1 200 OK\r\n"
+                                                      "Content-Type: text/plain\r\n"
+                                                      "Content-Length: 6\r\n"
+                                                      "Cache-Control: no-store\r\n"
+                                                      "\r\n"
+                                                      "ready\n";
+    static constexpr std::string_view DrainingResponse = "HTTP/1.1 503 Service Unavailable\r\n"
+                                                         "Content-Type: text/plain\r\n"
+                                                         "Content-Length: 9\r\n"
+                                                         "Cache-Control: no-store\r\n"
+                                                         "\r\n"
+                                                         "draining\n";
+    static constexpr std::string_view NotFoundResponse = "HTTP/1.1 404 Not Found\r\n"
+                                                         "Content-Type: text/plain\r\n"
+                                                         "Content-Length: 10\r\n"
+                                                         "\r\n"
+                                                         "not found\n";
+    static constexpr std::string_view MethodNotAllowedResponse
+            = "HTTP/1.1 405 Method Not Allowed\r\n"
+              "Allow: GET, HEAD\r\n"
+              "Content-Length: 0\r\n"
+              "Connection: close\r\n"
+              "\r\n";
+    static constexpr std::string_view BadRequestResponse = "HTTP/1.1 400 Bad Request\r\n"
+                                                           "Content-Length: 0\r\n"
+                                                           "Connection: close\r\n"
+                                                           "\r\n";
+    static constexpr std::string_view HeadersTooLargeResponse
+            = "HTTP/1.1 431 Request Header Fields Too Large\r\n"
+              "Content-Length: 0\r\n"
+              "Connection: close\r\n"
+              "\r\n";
+
+#ifdef EPIOCSPARAMS
+    using epoll_busy_poll_params = ::epoll_params;
+    static constexpr unsigned long EpollSetParams = EPIOCSPARAMS;
+#else
+    /// struct epoll_params from linux 6.9 <linux/eventpoll.h>, for older headers
+    struct epoll_busy_poll_params
+    {
+        std::uint32_t busy_poll_usecs;
+        std::uint16_t busy_poll_budget;
+        std::uint8_t prefer_busy_poll;
+        std::uint8_t pad;
+    };
+    static constexpr unsigned long EpollSetParams = _IOW(0x8A, 0x01, epoll_busy_poll_params);
+#endif
+
+    /// Attach a classic BPF program to the SO_REUSEPORT group of \c sockfd
+    /// that picks the group member whose reactor runs on the cpu handling
+    /// the incoming packet. \c cpus holds each member's cpu in group order.
+    void
+    attach_steering_program(int sockfd, std::vector<int> const& cpus)
+    {
+        std::vector<sock_filter> code;
+        // A = cpu that is processing the packet
+        code.push_back(BPF_STMT(
+                BPF_LD | BPF_W | BPF_ABS, static_cast<std::uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+        for (std::size_t i = 0; i < cpus.size(); ++i) {
+            auto const cpu = static_cast<std::uint32_t>(cpus[i]);
+            code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, cpu, 0, 1));
+            code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<std::uint32_t>(i)));
+        }
+        // no reactor on this cpu: an out of range index falls back to the hash
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffffffff));
+
+        sock_fprog const prog{static_cast<unsigned short>(code.size()), code.data()};
+        if (int rv = ::setsockopt(
+                    sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+                rv == -1) {
+            throw std::runtime_error(
+                    std::string("setsockopt (SO_ATTACH_REUSEPORT_CBPF): ") + std::strerror(errno));
+        }
+    }
+
+    /// Create, configure, bind and listen on the tcp listening socket. A
+    /// tcp socket joins its SO_REUSEPORT group on listen(), so reactors
+    /// constructed in order end up in the group in the same order.
+    int
+    bind_listener(server_config const& config)
+    {
+        int const port = config.port;
+
+        addrinfo hints{};
+
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;     // ipv4 or ipv6
+        hints.ai_socktype = SOCK_STREAM; // tcp
+        hints.ai_flags = AI_PASSIVE;     // wildcard ip
+
+        // get local address
+        addrinfo* result = nullptr;
+        if (int rv = ::getaddrinfo(nullptr, std::to_string(port).c_str(), &hints, &result);
+                rv != 0) {
+            throw std::runtime_error(std::string("getaddrinfo: ") + std::strerror(errno));
+        }
+
+        // get socket
+        int const sockfd = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        if (sockfd == -1) {
+            throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+        }
+
+        // allow for socket reuse
+        int const yes = 1;
+        if (int rv = ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)); rv == -1) {
+            throw std::runtime_error(
+                    std::string("setsockopt (SO_REUSEADDR): ") + std::strerror(errno));
+        }
+        if (int rv = ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)); rv == -1) {
+            throw std::runtime_error(
+                    std::string("setsockopt (SO_REUSEPORT): ") + std::strerror(errno));
+        }
+
+        // steer to the reactor on the cpu that received the connection
+        if (config.cpu != -1 && config.steering == Steering::IncomingCpu) {
+            if (int rv = ::setsockopt(
+                        sockfd, SOL_SOCKET, SO_INCOMING_CPU, &config.cpu, sizeof(config.cpu));
+                    rv == -1) {
+                throw std::runtime_error(
+                        std::string("setsockopt (SO_INCOMING_CPU): ") + std::strerror(errno));
+            }
+        }
+
+        // bind
+        if (int rv = ::bind(sockfd, result->ai_addr, result->ai_addrlen); rv == -1) {
+            throw std::runtime_error(std::string("bind: ") + std::strerror(errno));
+        }
+
+        ::freeaddrinfo(result);
+
+        // start listening
+        if (int rv = ::listen(sockfd, ListenBacklog); rv == -1) {
+            throw std::runtime_error(std::string("listen: ") + std::strerror(errno));
+        }
+
+        if (config.steering == Steering::Cbpf && !config.reactor_cpus.empty()) {
+            attach_steering_program(sockfd, config.reactor_cpus);
+        }
+
+        // set socket as non-blocking
+        if (int rv = ::fcntl(sockfd, F_SETFL, O_NONBLOCK); rv == -1) {
+            throw std::runtime_error(std::string("fcntl (O_NONBLOCK): ") + std::strerror(errno));
+        }
+        return sockfd;
+    }
+
+    /// Fill in a unix domain socket address for \c path
+    sockaddr_un
+    make_unix_address(std::string const& path)
+    {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("handoff path too long: " + path);
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return addr;
+    }
+
+    /// Ask the instance listening on \c path for its listening socket.
+    /// \return the received socket, or -1 if no instance is running there
+    int
+    receive_listener(std::string const& path)
+    {
+        sockaddr_un const addr = make_unix_address(path);
+
+        int const sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock == -1) {
+            throw std::runtime_error(std::string("socket (AF_UNIX): ") + std::strerror(errno));
+        }
+
+        if (::connect(sock, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == -1) {
+            int const err = errno;
+            ::close(sock);
+            if (err == ENOENT || err == ECONNREFUSED) {
+                return -1; // nobody to take over from
+            }
+            throw std::runtime_error(std::string("connect (handoff): ") + std::strerror(err));
+        }
+
+        int fds[1] = {-1};
+        int const count = recv_fds(sock, fds);
+        int const err = errno;
+        ::close(sock);
+        if (count != 1) {
+            throw std::runtime_error(std::string("recv_fds (handoff): ") + std::strerror(err));
+        }
+
+        if (int rv = ::fcntl(fds[0], F_SETFL, O_NONBLOCK); rv == -1) {
+            throw std::runtime_error(std::string("fcntl (O_NONBLOCK): ") + std::strerror(errno));
+        }
+        return fds[0];
+    }
+
+    /// Listen on \c path for the next instance asking for our listening socket
+    int
+    bind_handoff_listener(std::string const& path)
+    {
+        sockaddr_un const addr = make_unix_address(path);
+
+        int const sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sock == -1) {
+            throw std::runtime_error(std::string("socket (AF_UNIX): ") + std::strerror(errno));
+        }
+
+        // the path belongs to whichever instance started last
+        ::unlink(path.c_str());
+        if (int rv = ::bind(sock, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr));
+                rv == -1) {
+            throw std::runtime_error(std::string("bind (handoff): ") + std::strerror(errno));
+        }
+        if (int rv = ::listen(sock, 1); rv == -1) {
+            throw std::runtime_error(std::string("listen (handoff): ") + std::strerror(errno));
+        }
+        return sock;
+    }
+
+    /// Create, bind and listen on a unix domain socket listener. A socket
+    /// file left at its path by an earlier run is replaced; anything else
+    /// there is left alone and the bind fails.
+    int
+    bind_unix_listener(socket_address const& address, std::string const& name)
+    {
+        int const sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sock == -1) {
+            throw std::runtime_error(std::string("socket (AF_UNIX): ") + std::strerror(errno));
+        }
+
+        if (std::string const path = unix_socket_path(address); !path.empty()) {
+            struct stat st{};
+            if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+                ::unlink(path.c_str());
+            }
+        }
+        if (int rv = ::bind(sock, address.get(), address.size); rv == -1) {
+            throw std::runtime_error("bind (" + name + "): " + std::strerror(errno));
+        }
+        if (int rv = ::listen(sock, ListenBacklog); rv == -1) {
+            throw std::runtime_error("listen (" + name + "): " + std::strerror(errno));
+        }
+        return sock;
+    }
+
+    /// Apply the busy-poll settings to \c sockfd. Accepted sockets inherit
+    /// them from the listener. Failures are logged, not fatal: busy polling
+    /// only changes latency, and raising it past the sysctl defaults needs
+    /// CAP_NET_ADMIN.
+    void
+    configure_busy_poll(int sockfd, server_config const& config) noexcept
+    {
+        auto const set = [sockfd](int option, char const* name, int value) {
+            if (::setsockopt(sockfd, SOL_SOCKET, option, &value, sizeof(value)) == -1) {
+                SPDLOG_WARN("setsockopt ({}): {} {}", name, std::strerror(errno), errno);
+            }
+        };
+
+        if (config.busy_poll_usecs != 0) {
+            set(SO_BUSY_POLL, "SO_BUSY_POLL", static_cast<int>(config.busy_poll_usecs));
+        }
+        if (config.busy_poll_budget != 0) {
+            set(SO_BUSY_POLL_BUDGET, "SO_BUSY_POLL_BUDGET",
+                    static_cast<int>(config.busy_poll_budget));
+        }
+        if (config.prefer_busy_poll) {
+            set(SO_PREFER_BUSY_POLL, "SO_PREFER_BUSY_POLL", 1);
+        }
+    }
+
+    /// setsockopt() for an int option; failures are logged, not fatal
+    void
+    set_socket_option(int sockfd, int level, int option, char const* name, int value) noexcept
+    {
+        if (::setsockopt(sockfd, level, option, &value, sizeof(value)) == -1) {
+            SPDLOG_WARN("setsockopt ({}): {} {}", name, std::strerror(errno), errno);
+        }
+    }
+
+    /// Apply the listener half of the socket profile. Accepted sockets
+    /// inherit the buffer sizes; the rest only matters on the listener.
+    void
+    configure_listener(int sockfd, socket_options const& options) noexcept
+    {
+        if (options.recv_buffer != 0) {
+            set_socket_option(sockfd, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", options.recv_buffer);
+        }
+        if (options.send_buffer != 0) {
+            set_socket_option(sockfd, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", options.send_buffer);
+        }
+
+        // a returning client's upgrade request rides in the SYN; needs
+        // net.ipv4.tcp_fastopen & 2 for the server side
+        if (options.fastopen_queue != 0) {
+            set_socket_option(
+                    sockfd, IPPROTO_TCP, TCP_FASTOPEN, "TCP_FASTOPEN", options.fastopen_queue);
+        }
+
+        // don't wake us up for a connection until its request has arrived
+        if (options.defer_accept_secs != 0) {
+            set_socket_option(sockfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, "TCP_DEFER_ACCEPT",
+                    options.defer_accept_secs);
+        }
+    }
+
+    /// Make epoll_wait on \c epollfd busy-poll the NIC queues of its
+    /// sockets before sleeping. Needs linux 6.9; logged, not fatal.
+    void
+    configure_epoll_busy_poll(int epollfd, server_config const& config) noexcept
+    {
+        if (config.busy_poll_usecs == 0) {
+            return;
+        }
+
+        epoll_busy_poll_params params{};
+        params.busy_poll_usecs = config.busy_poll_usecs;
+        params.busy_poll_budget = static_cast<std::uint16_t>(config.busy_poll_budget);
+        params.prefer_busy_poll = config.prefer_busy_poll ? 1 : 0;
+        if (::ioctl(epollfd, EpollSetParams, &params) == -1) {
+            SPDLOG_WARN("ioctl (EPIOCSPARAMS): {} {}", std::strerror(errno), errno);
+        }
+    }
+
+    /// The request line of an http request: method, target and version
+    struct request_line
+    {
+        std::string_view method;
+        std::string_view target;
+        std::string_view version;
+    };
+
+    /// Split "METHOD TARGET VERSION" at its single spaces
+    /// \return \c std::nullopt if there aren't exactly three parts
+    std::optional<request_line>
+    parse_request_line(std::string_view line) noexcept
+    {
+        std::size_t const first = line.find(' ');
+        std::size_t const second = line.find(' ', first + 1);
+        if (first == std::string_view::npos || second == std::string_view::npos
+                || line.find(' ', second + 1) != std::string_view::npos) {
+            return std::nullopt;
+        }
+        return request_line{line.substr(0, first), line.substr(first + 1, second - first - 1),
+                line.substr(second + 1)};
+    }
+
+    /// \c s without leading and trailing whitespace
+    std::string_view
+    trimmed(std::string_view s) noexcept
+    {
+        auto const is_space = [](unsigned char c) { return std::isspace(c) != 0; };
+        while (!s.empty() && is_space(s.front())) {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && is_space(s.back())) {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    /// \return \c true if the comma separated \c list (a Sec-WebSocket-Protocol
+    ///         value) names \c protocol; the names are case-sensitive
+    bool
+    offers_protocol(std::string_view list, std::string_view protocol) noexcept
+    {
+        while (!list.empty()) {
+            std::size_t const comma = list.find(',');
+            if (trimmed(list.substr(0, comma)) == protocol) {
+                return true;
+            }
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        }
+        return false;
+    }
+
+    /// Nanoseconds from \c from to \c to; 0 if the clock stepped back
+    std::uint64_t
+    elapsed_ns(std::int64_t from, std::int64_t to) noexcept
+    {
+        return static_cast<std::uint64_t>(std::max<std::int64_t>(to - from, 0));
+    }
 } // namespace
 
 
@@ -66,50 +488,58 @@ print_hexdump(void const* data, std::size_t size)
     }
 }
 
-echo_server::echo_server(int port)
-        : port_(port)
+echo_server::echo_server(server_config const& config)
+        : config_(config)
+        , stats_()
         , sockfd_(-1)
         , epollfd_(-1)
+        , spare_fd_(-1)
+        , signal_fd_(-1)
+        , wakeup_fd_(-1)
+        , handoff_fd_(-1)
         , clients_()
+        , commands_(config.command_queue_size)
 {
-    addrinfo hints{};
-
-    std::memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;     // ipv4 or ipv6
-    hints.ai_socktype = SOCK_STREAM; // tcp
-    hints.ai_flags = AI_PASSIVE;     // wildcard ip
-
-    // get local address
-    addrinfo* result = nullptr;
-    if (int rv = ::getaddrinfo(nullptr, std::to_string(port_).c_str(), &hints, &result); rv != 0) {
-        throw std::runtime_error(std::string("getaddrinfo: ") + std::strerror(errno));
+    // the limiters of every connection are built from these
+    if ((config_.max_messages_per_sec > 0.0 || config_.max_bytes_per_sec > 0.0)
+            && !(config_.rate_burst_secs > 0.0)) {
+        throw std::runtime_error("rate_burst_secs must be positive");
     }
 
-    // get socket
-    sockfd_ = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
-    if (sockfd_ == -1) {
-        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    // take over the listening socket of a running instance, if there is one
+    if (!config_.handoff_path.empty()) {
+        sockfd_ = receive_listener(config_.handoff_path);
+        if (sockfd_ != -1) {
+            SPDLOG_INFO("took over listening socket from {}", config_.handoff_path);
+        }
     }
 
-    // allow for socket reuse
-    int const yes = 1;
-    if (int rv = ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)); rv == -1) {
-        throw std::runtime_error(std::string("setsockopt (SO_REUSEADDR): ") + std::strerror(errno));
-    }
-    if (int rv = ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)); rv == -1) {
-        throw std::runtime_error(std::string("setsockopt (SO_REUSEPORT): ") + std::strerror(errno));
+    if (sockfd_ == -1) {
+        sockfd_ = bind_listener(config_);
     }
 
-    // bind
-    if (int rv = ::bind(sockfd_, result->ai_addr, result->ai_addrlen); rv == -1) {
-        throw std::runtime_error(std::string("bind: ") + std::strerror(errno));
+    // the next instance asks us for the listening socket through here
+    if (!config_.handoff_path.empty()) {
+        handoff_fd_ = bind_handoff_listener(config_.handoff_path);
     }
 
-    ::freeaddrinfo(result);
+    // clients on the same host can skip the tcp stack
+    for (std::string const& name : config_.unix_listeners) {
+        unix_listener listener;
+        listener.address = resolve_socket_address(name);
+        if (listener.address.family() != AF_UNIX) {
+            throw std::runtime_error("not a unix socket address: " + name);
+        }
+        listener.fd = bind_unix_listener(listener.address, name);
 
-    // set socket as non-blocking
-    if (int rv = ::fcntl(sockfd_, F_SETFL, O_NONBLOCK); rv == -1) {
-        throw std::runtime_error(std::string("fcntl (O_NONBLOCK): ") + std::strerror(errno));
+        // remembered so we never remove a successor's socket file
+        if (std::string const path = unix_socket_path(listener.address); !path.empty()) {
+            struct stat st{};
+            if (::stat(path.c_str(), &st) == 0) {
+                listener.inode = st.st_ino;
+            }
+        }
+        unix_listeners_.push_back(listener);
     }
 
     // get epoll fd
@@ -117,47 +547,253 @@ echo_server::echo_server(int port)
     if (epollfd_ == -1) {
         throw std::runtime_error(std::string("epoll_create1: ") + std::strerror(errno));
     }
+
+    // also applied to a listener taken over from another instance, which
+    // may have been started with different settings
+    configure_busy_poll(sockfd_, config_);
+    configure_epoll_busy_poll(epollfd_, config_);
+    configure_listener(sockfd_, config_.sockets);
+
+    // keep one fd in reserve so we can still accept-and-close when the
+    // process runs out of descriptors
+    spare_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (spare_fd_ == -1) {
+        throw std::runtime_error(std::string("open (/dev/null): ") + std::strerror(errno));
+    }
+
+    // other threads (and signal handlers) poke the event loop through this
+    wakeup_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ == -1) {
+        throw std::runtime_error(std::string("eventfd: ") + std::strerror(errno));
+    }
+
+    // SIGINT/SIGTERM start a graceful drain. the signals must already be
+    // blocked in every thread for the signalfd to receive them
+    if (config_.handle_signals) {
+        sigset_t mask;
+        ::sigemptyset(&mask);
+        ::sigaddset(&mask, SIGINT);
+        ::sigaddset(&mask, SIGTERM);
+        signal_fd_ = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (signal_fd_ == -1) {
+            throw std::runtime_error(std::string("signalfd: ") + std::strerror(errno));
+        }
+    }
+
+    // reverse proxy: resolve the backend once. every client gets its own
+    // connection to it; they all share one pipe for splicing
+    if (!config_.backend.empty()) {
+        if (config_.handler != nullptr) {
+            throw std::runtime_error("a backend and a coroutine handler are mutually exclusive");
+        }
+        backend_ = resolve_socket_address(config_.backend);
+        splice_pipe_.emplace(SplicePipeSize);
+    }
+
+    // worker offload: a server on its own brings its own pool
+    config_.max_offloaded_per_connection
+            = std::max<std::size_t>(config_.max_offloaded_per_connection, 1);
+    if (config_.processor) {
+        if (config_.handler != nullptr || backend_) {
+            throw std::runtime_error(
+                    "a processor excludes both a coroutine handler and a backend");
+        }
+        if (config_.worker_threads != 0 && !config_.workers) {
+            config_.workers = std::make_shared<worker_pool>(config_.worker_threads);
+        }
+    }
+
+    // message batching: the batch handler is the only way to answer a batch
+    if (config_.batching && (config_.handler != nullptr || config_.processor || backend_)) {
+        throw std::runtime_error(
+                "batching excludes a coroutine handler, a processor and a backend");
+    }
+
+    // kernel timestamps key sends by stream offset, which splicing bypasses
+    if (config_.timestamping && backend_) {
+        throw std::runtime_error("timestamping and a backend are mutually exclusive");
+    }
+
+    // static files: a server on its own loads its own
+    if (!config_.static_root.empty() && !config_.static_files) {
+        config_.static_files = std::make_shared<static_content const>(config_.static_root);
+    }
+    if (config_.static_files) {
+        SPDLOG_INFO("serving {} static files from {}", config_.static_files->size(),
+                config_.static_root);
+    }
+
+    // wss: a server on its own builds its own tls context
+    if (!config_.tls_certificate.empty() && !config_.tls) {
+        tls_options options;
+        options.certificate = config_.tls_certificate;
+        options.private_key = config_.tls_private_key;
+        options.ktls = config_.ktls;
+        config_.tls = std::make_shared<tls_context const>(TlsRole::Server, options);
+    }
+    if (config_.tls) {
+        SPDLOG_INFO("tls on port {}{}", config_.port, config_.tls->ktls() ? ", kTLS" : "");
+    }
+
+    if (!config_.capture_path.empty()) {
+        capture_ = std::make_unique<capture_writer>(
+                config_.capture_path, config_.capture_max_bytes);
+        SPDLOG_INFO("capturing client messages to {}", config_.capture_path);
+    }
 }
 
 echo_server::~echo_server() noexcept
 {
+    // the workers may still be running jobs that post back to us. their
+    // replies are thrown away, but need room in the queue to be posted
+    for (auto& [id, executor] : executors_) {
+        retired_executors_.push_back(std::move(executor));
+    }
+    posted_command discarded;
+    while (!std::ranges::all_of(
+            retired_executors_, [](auto const& executor) { return executor->idle(); })) {
+        while (commands_.try_pop(discarded)) {
+            // empty
+        }
+        std::this_thread::yield();
+    }
+
     ::close(sockfd_);
+    close_unix_listeners();
     ::close(epollfd_);
+    ::close(spare_fd_);
+    ::close(wakeup_fd_);
+    if (signal_fd_ != -1) {
+        ::close(signal_fd_);
+    }
+    if (handoff_fd_ != -1) {
+        ::close(handoff_fd_);
+    }
 
     for (auto& [sock, conn] : clients_) {
         ::close(sock);
+        if (conn.backend_fd != -1) {
+            ::close(conn.backend_fd);
+        }
     }
 }
 
 bool
 echo_server::run()
 {
-    // start listening
-    if (int rv = ::listen(sockfd_, ListenBacklog); rv == -1) {
-        SPDLOG_CRITICAL("error: listen {}: {}", std::strerror(errno), errno);
-        return false;
+    if (config_.cpu == -1) {
+        SPDLOG_INFO("listening on port {}", config_.port);
+    } else {
+        SPDLOG_INFO("listening on port {} (cpu {})", config_.port, config_.cpu);
+    }
+    for (std::string const& name : config_.unix_listeners) {
+        SPDLOG_INFO("listening on {}", name);
     }
-    SPDLOG_INFO("listening on port {}", port_);
 
-    // Add our listening socket to epoll.
-    epoll_event event{};
-    event.data.fd = sockfd_;
-    event.events = (EPOLLIN | EPOLLET);
-    if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, sockfd_, &event); rv == -1) {
-        SPDLOG_CRITICAL("error: epoll_ctl: {} {}", std::strerror(errno), errno);
-        return false;
+    // Add our listening socket and control fds to epoll.
+    for (int const fd : {sockfd_, wakeup_fd_, signal_fd_, handoff_fd_}) {
+        if (fd == -1) {
+            continue;
+        }
+        epoll_event event{};
+        event.data.fd = fd;
+        event.events = (EPOLLIN | EPOLLET);
+        if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &event); rv == -1) {
+            SPDLOG_CRITICAL("error: epoll_ctl: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+    }
+    for (unix_listener const& listener : unix_listeners_) {
+        epoll_event event{};
+        event.data.fd = listener.fd;
+        event.events = (EPOLLIN | EPOLLET);
+        if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, listener.fd, &event); rv == -1) {
+            SPDLOG_CRITICAL("error: epoll_ctl: {} {}", std::strerror(errno), errno);
+            return false;
+        }
     }
 
     epoll_event events[EpollMaxEvents];
+    clock::time_point last_event = now_;
     for (;;) {
+        int timeout = EpollTimeoutMsecs;
+        switch (config_.poll_mode) {
+            case PollMode::Spin:
+                timeout = 0;
+                break;
+            case PollMode::Hybrid:
+                timeout = now_ - last_event < config_.spin_window ? 0 : EpollTimeoutMsecs;
+                break;
+            case PollMode::Block:
+            default:
+                break;
+        }
+
+        // deferred connections already have frames waiting for this pass
+        if (!deferred_.empty()) {
+            timeout = 0;
+        }
+
+        // wake up when the first throttled connection may go on
+        if (!throttled_.empty() && timeout != 0) {
+            auto const until = std::chrono::ceil<std::chrono::milliseconds>(
+                    throttle_wakeup_ - clock::now());
+            timeout = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(
+                    until.count(), 0, timeout));
+        }
+
+        // wake up in time for the first sleeping coroutine handler
+        if (!handler_timers_.empty() && timeout != 0) {
+            auto const until = std::chrono::ceil<std::chrono::milliseconds>(
+                    handler_timers_.front().deadline - clock::now());
+            timeout = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(
+                    until.count(), 0, timeout));
+        }
+
         int const num_events = ::epoll_wait(
-                epollfd_, static_cast<epoll_event*>(events), EpollMaxEvents, EpollTimeoutMsecs);
+                epollfd_, static_cast<epoll_event*>(events), EpollMaxEvents, timeout);
         if (num_events == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
             SPDLOG_CRITICAL("error: epoll_wait: {} {}", std::strerror(errno), errno);
             return false;
         }
+        now_ = clock::now();
+        if (num_events > 0) {
+            last_event = now_;
+        } else if (timeout == 0) {
+            ++stats_.empty_polls;
+        }
 
         for (int i = 0; i < num_events; ++i) {
+            // backend sockets are registered with the fd of their client
+            if ((events[i].data.u64 & BackendTag) != 0) {
+                int const client_fd = static_cast<int>(events[i].data.u64 & ~BackendTag);
+                on_backend_event(client_fd, events[i].events);
+                continue;
+            }
+
+            // MSG_ZEROCOPY completions and transmit timestamps are
+            // reported as socket errors
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) == EPOLLERR) {
+                auto itr = clients_.find(events[i].data.fd);
+                if (itr != clients_.end() && (itr->second.zerocopy || itr->second.timestamping)
+                        && on_socket_error(itr->second)) {
+                    events[i].events &= ~static_cast<std::uint32_t>(EPOLLERR);
+                    if ((events[i].events & EPOLLIN) == 0) {
+                        continue;
+                    }
+                }
+            }
+
+            // a unix domain socket peer that closes (both directions at
+            // once) reports EPOLLHUP along with EPOLLIN. what it sent
+            // before closing is still to be read, and the read sees the eof
+            if ((events[i].events & (EPOLLERR | EPOLLHUP | EPOLLIN)) == (EPOLLHUP | EPOLLIN)) {
+                events[i].events &= ~static_cast<std::uint32_t>(EPOLLHUP);
+            }
+
             // Check for flag that we aren't listening for. Not sure if this is necessary.
             if ((events[i].events & EPOLLERR) || (events[i].events & EPOLLHUP)) {
                 SPDLOG_ERROR("error: unexpected event on fd {}\n", i);
@@ -169,16 +805,21 @@ echo_server::run()
                     std::abort();
                 }
 
-                clients_.erase(itr);
-                ::close(events[i].data.fd);
+                disconnect_and_cleanup_client(itr->second);
                 continue;
             }
 
-            if (events[i].data.fd == sockfd_) {
-                bool const status = on_incoming_connection();
+            if (events[i].data.fd == sockfd_ || is_unix_listener(events[i].data.fd)) {
+                bool const status = on_incoming_connection(events[i].data.fd);
                 if (!status) {
                     return false;
                 }
+            } else if (events[i].data.fd == signal_fd_) {
+                on_signal();
+            } else if (events[i].data.fd == wakeup_fd_) {
+                on_wakeup();
+            } else if (events[i].data.fd == handoff_fd_) {
+                on_handoff_request();
             } else {
                 int fd = events[i].data.fd;
                 auto itr = clients_.find(fd);
@@ -187,128 +828,970 @@ echo_server::run()
                     std::abort();
                 }
 
-                bool const status = on_incoming_data(itr->second);
+                // wss: the tls handshake comes before anything else
+                if (itr->second.conn_state == ConnectionState::TlsHandshake) {
+                    if (!on_tls_handshake(itr->second)) {
+                        return false;
+                    }
+                    continue;
+                }
+
+                // a coroutine handler's send was waiting for room in the socket
+                int recv_flags = 0;
+                if ((events[i].events & EPOLLOUT) != 0) {
+                    on_client_writable(itr->second);
+                    itr = clients_.find(fd);
+                    if ((events[i].events & EPOLLIN) == 0 || itr == clients_.end()) {
+                        continue;
+                    }
+                    recv_flags = MSG_DONTWAIT;
+                }
+
+                bool const status = on_incoming_data(itr->second, recv_flags);
                 if (!status) {
                     return false;
                 }
             }
         } // for each event
+
+        on_throttled_connections();
+        on_deferred_connections();
+        on_handler_timers();
+        on_posted_commands();
+        flush_pending_writes();
+        loop_arena_.reset();
+
+        if (draining_ && on_drain_tick()) {
+            break;
+        }
     } // main event loop
 
+    SPDLOG_INFO("shutdown complete");
     return true;
 }
 
-bool
-echo_server::on_incoming_connection() noexcept
+void
+echo_server::request_shutdown() noexcept
+{
+    shutdown_requests_.fetch_add(1, std::memory_order_release);
+    std::uint64_t const one = 1;
+    [[maybe_unused]] ssize_t const rv = ::write(wakeup_fd_, &one, sizeof(one));
+}
+
+void
+echo_server::on_signal() noexcept
 {
-    // accept the connection
-    sockaddr_storage their_addr{};
-    socklen_t addr_size = sizeof(their_addr);
-    int const accepted_sock
-            = ::accept(sockfd_, reinterpret_cast<sockaddr*>(&their_addr), &addr_size);
-    if (accepted_sock == -1) {
-        if (errno == EAGAIN) {
-            return true; // not an error
+    signalfd_siginfo info{};
+    while (::read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+        SPDLOG_INFO("received signal {}", info.ssi_signo);
+        if (draining_) {
+            // a second signal means the operator is out of patience
+            SPDLOG_WARN("already draining, skipping to the deadline");
+            drain_deadline_ = now_;
         }
-        SPDLOG_CRITICAL("error: accept: {} {}", std::strerror(errno), errno);
-        return false;
+        begin_drain();
     }
+}
 
-    connection conn{};
-    conn.conn_state = ConnectionState::TcpConnected;
-    conn.sockfd = accepted_sock;
+void
+echo_server::on_wakeup() noexcept
+{
+    std::uint64_t count = 0;
+    [[maybe_unused]] ssize_t const rv = ::read(wakeup_fd_, &count, sizeof(count));
 
-    auto const* sin = reinterpret_cast<sockaddr_in const*>(&their_addr);
-    char const* ip = nullptr;
-    if (ip = ::inet_ntop(AF_INET, &(sin->sin_addr), conn.ip, sizeof(conn.ip)); ip == nullptr) {
-        SPDLOG_CRITICAL("inet_ntop: {}: {}", std::strerror(errno), errno);
-        std::abort();
+    int const requests = shutdown_requests_.load(std::memory_order_acquire);
+    if (requests > 0) {
+        if (requests > 1 && draining_) {
+            drain_deadline_ = now_; // asked again: out of patience
+        }
+        begin_drain();
     }
-    conn.port = sin->sin_port;
+}
 
-    // add the new fd to epoll
-    epoll_event event{};
-    event.events = (EPOLLIN | EPOLLET);
-    event.data.fd = accepted_sock;
-    if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, accepted_sock, &event); rv == -1) {
-        SPDLOG_CRITICAL("error: epoll_ctl (EPOLL_CTL_ADD): {} {}", std::strerror(errno), errno);
-        return false;
-    }
+bool
+echo_server::post_send(std::uint64_t id, std::vector<std::uint8_t> payload, OpCode op_code) noexcept
+{
+    return post({id, op_code, 0, std::move(payload)});
+}
 
-    // successfully connected. add client entry
-    clients_.emplace(accepted_sock, std::move(conn));
-    SPDLOG_INFO("client connected: {}", conn);
+bool
+echo_server::post_close(std::uint64_t id, std::uint16_t code) noexcept
+{
+    return post({id, OpCode::Close, code, {}});
+}
 
-    return true;
+std::size_t
+echo_server::reactor_of(std::uint64_t id) noexcept
+{
+    return id >> 56;
 }
 
 bool
-echo_server::on_incoming_data(connection& conn) noexcept
+echo_server::post(posted_command&& command) noexcept
 {
-    // shift once we're past the 75% mark of capacity
-    if (conn.buf.bytes_left() / conn.buf.capacity() < 0.25) {
-        conn.buf.shift();
-    }
-
-    ssize_t const nbytes
-            = ::recv(conn.sockfd, conn.buf.write_ptr(), conn.buf.bytes_left(), /*flags=*/0);
-    if (nbytes == -1) {
-        SPDLOG_CRITICAL("error: recv: {} {}", std::strerror(errno), errno);
+    if (!commands_.try_push(std::move(command))) {
         return false;
     }
-    conn.buf.bytes_written(nbytes);
-
-    // client disconnected
-    if (nbytes == 0) {
-        SPDLOG_INFO("client on fd {} disconnected", conn.sockfd);
-        disconnect_and_cleanup_client(conn);
-        return true;
-    }
 
-    if (conn.conn_state == ConnectionState::WebSocket) {
-        if (!on_websocket_frame(conn)) {
-            SPDLOG_ERROR("on_websocket_frame returned false");
-        }
-    } else {
-        if (!on_http_request(conn)) {
-            SPDLOG_ERROR("on_http_request returned false");
-        }
+    // one poke per batch: the event loop clears the flag before draining
+    // the queue, so whatever is pushed after that pokes it again
+    if (!commands_pending_.exchange(true, std::memory_order_acq_rel)) {
+        std::uint64_t const one = 1;
+        [[maybe_unused]] ssize_t const rv = ::write(wakeup_fd_, &one, sizeof(one));
     }
     return true;
 }
 
-bool
-echo_server::on_http_request(connection& conn) const noexcept
+void
+echo_server::on_posted_commands() noexcept
 {
-    conn.conn_state = ConnectionState::Http;
-    std::string_view req(
-            reinterpret_cast<char const*>(conn.buf.read_ptr()), conn.buf.bytes_unread());
-    SPDLOG_DEBUG("received http request:\n{}", req);
-    conn.buf.bytes_read(conn.buf.bytes_unread());
+    // executors of closed connections go once the workers are done with them
+    if (!retired_executors_.empty()) {
+        std::erase_if(retired_executors_, [](auto const& executor) { return executor->idle(); });
+    }
+
+    if (!commands_pending_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    std::size_t const limit = config_.max_commands_per_iteration;
+    std::size_t count = 0;
+    posted_command command;
+    while ((limit == 0 || count < limit) && commands_.try_pop(command)) {
+        ++count;
+        ++stats_.posted_commands;
+        run_posted_command(command);
+    }
+
+    // over budget: the rest wait for the next pass, which mustn't sleep
+    if (!commands_.empty() && !commands_pending_.exchange(true, std::memory_order_acq_rel)) {
+        std::uint64_t const one = 1;
+        [[maybe_unused]] ssize_t const rv = ::write(wakeup_fd_, &one, sizeof(one));
+    }
+}
+
+void
+echo_server::run_posted_command(posted_command& command)
+{
+    // the connection may be gone, its fd even reused by another one
+    auto itr = clients_.find(static_cast<int>(command.id & 0xffffffff));
+    if (itr == clients_.end() || itr->second.id != command.id) {
+        ++stats_.posted_dropped;
+        return;
+    }
+
+    connection& conn = itr->second;
+    bool const was_at_limit
+            = command.reply && conn.offloaded-- == config_.max_offloaded_per_connection;
+
+    // rfc 6455 5.5.1: nothing more once we've sent a close frame
+    if (conn.conn_state != ConnectionState::WebSocket) {
+        ++stats_.posted_dropped;
+        return;
+    }
+
+    bool ok = true;
+    if (command.op_code == OpCode::Close) {
+        ok = send_websocket_close(conn, command.close_code);
+    } else if (conn.handler == nullptr) {
+        ok = send_echo(conn, command.payload, command.op_code);
+    } else if (!command.payload.empty()) {
+        // behind whatever the handler has queued. if that lets the socket
+        // drain, a handler blocked in send() has nothing left to wait for
+        ok = send_from_handler(conn, command.payload, command.op_code);
+        if (ok && !conn.write_blocked && conn.handler->waiting_for(HandlerWait::Writable)) {
+            ok = resume_handler(conn);
+            if (ok && conn.handler->accepts_message()) {
+                process_buffered_data(conn);
+                return;
+            }
+        }
+    }
+
+    if (!ok) {
+        disconnect_and_cleanup_client(conn);
+        return;
+    }
+
+    // a reply made room at the workers, or was the last one a close frame
+    // waited for: carry on with the frames held back
+    if (was_at_limit || (command.reply && conn.offloaded == 0 && conn.buf.bytes_unread() != 0)) {
+        process_buffered_data(conn);
+    }
+}
+
+bool
+echo_server::process_message(
+        connection& conn, std::vector<std::uint8_t>&& payload, OpCode op_code)
+{
+    // rfc 6455 5.5.1: no data frames after we've sent a close frame
+    if (conn.conn_state != ConnectionState::WebSocket) {
+        return true;
+    }
+
+    // on the reactor: the reply goes out like an echo
+    if (!config_.workers) {
+        message msg{op_code, std::move(payload)};
+        try {
+            config_.processor(msg);
+        } catch (std::exception const& e) {
+            SPDLOG_ERROR("error: processor on fd {} threw: {}", conn.sockfd, e.what());
+            return send_websocket_close(conn, CloseInternalError);
+        } catch (...) {
+            SPDLOG_ERROR("error: processor on fd {} threw", conn.sockfd);
+            return send_websocket_close(conn, CloseInternalError);
+        }
+        return send_echo(conn, msg.payload, msg.op_code);
+    }
+
+    // at the workers: the connection's own executor keeps its messages in
+    // order. it holds max_offloaded_per_connection jobs, more than we submit
+    std::unique_ptr<offload_executor>& executor = executors_[conn.id];
+    if (!executor) {
+        executor = std::make_unique<offload_executor>(*config_.workers,
+                config_.max_offloaded_per_connection,
+                [this](offload_job& job) { run_offloaded(job); });
+    }
+    ++conn.offloaded;
+    ++stats_.offloaded_messages;
+    return executor->submit({conn.id, message{op_code, std::move(payload)}});
+}
+
+void
+echo_server::run_offloaded(offload_job& job) noexcept
+{
+    // on a worker thread: touch nothing but the job and the command queue
+    posted_command reply{job.id, OpCode::Close, CloseInternalError, {}, /*reply=*/true};
+    try {
+        config_.processor(job.msg);
+        reply.op_code = job.msg.op_code;
+        reply.close_code = 0;
+        reply.payload = std::move(job.msg.payload);
+    } catch (std::exception const& e) {
+        SPDLOG_ERROR("error: processor threw: {}", e.what());
+    } catch (...) {
+        SPDLOG_ERROR("error: processor threw");
+    }
+
+    // replies can't be dropped: wait for the reactor to make room. post()
+    // leaves the command alone while the queue is full
+    while (!post(std::move(reply))) {
+        std::this_thread::yield();
+    }
+}
+
+std::uint64_t
+echo_server::make_connection_id(int sockfd) noexcept
+{
+    // reactor index (8 bits) | serial (24 bits) | fd (32 bits). the fd
+    // finds the connection, the serial tells it from an earlier one on the
+    // same fd and the index tells reactor_pool where to post
+    ++next_connection_serial_;
+    return (std::uint64_t{config_.reactor_index} << 56)
+            | (static_cast<std::uint64_t>(next_connection_serial_ & 0xffffff) << 32)
+            | static_cast<std::uint32_t>(sockfd);
+}
+
+void
+echo_server::on_handoff_request() noexcept
+{
+    for (;;) {
+        int const sock = ::accept4(handoff_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (sock == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                SPDLOG_ERROR("error: accept (handoff): {} {}", std::strerror(errno), errno);
+            }
+            return;
+        }
+
+        // the successor owns the listening socket from here on; it keeps
+        // accepting out of the same queue so no connection is refused
+        bool const sent = sockfd_ != -1 && send_fds(sock, std::array{sockfd_});
+        if (!sent) {
+            SPDLOG_ERROR("error: send_fds (handoff): {} {}", std::strerror(errno), errno);
+        }
+        ::close(sock);
+
+        if (sent) {
+            SPDLOG_INFO("handed listening socket over to a new instance");
+            begin_drain();
+            return;
+        }
+    }
+}
+
+bool
+echo_server::on_socket_error(connection& conn) noexcept
+{
+    if (conn.timestamping) {
+        return on_tx_timestamps(conn);
+    }
+
+    zerocopy_completions completions;
+    bool const ok = read_zerocopy_completions(conn.sockfd, completions);
+    if (!ok) {
+        SPDLOG_ERROR("socket error on fd {}: {} {}", conn.sockfd, std::strerror(errno), errno);
+    }
+
+    conn.zerocopy_released += completions.released;
+    stats_.zerocopy_copied += completions.copied;
+
+    // frames whose sends have been released can go. tcp releases in
+    // order, so they are at the front (unsigned distance copes with the
+    // kernel's 32-bit counter wrapping)
+    while (!conn.zerocopy_frames.empty()
+            && conn.zerocopy_released - conn.zerocopy_frames.front().release_count < (1U << 31)) {
+        conn.zerocopy_frames.pop_front();
+    }
+    return ok;
+}
+
+bool
+echo_server::on_tx_timestamps(connection& conn) noexcept
+{
+    std::array<tx_timestamp, 16> stamps;
+    int n = 0;
+    do {
+        n = read_tx_timestamps(conn.sockfd, stamps);
+        if (n == -1) {
+            SPDLOG_ERROR("socket error on fd {}: {} {}", conn.sockfd, std::strerror(errno), errno);
+            return false;
+        }
+
+        // a stamp covers every reply up to the last byte of its send: one
+        // send can carry several coalesced replies. replies are in stream
+        // order; unsigned distance copes with the 32-bit key wrapping
+        for (tx_timestamp const& stamp : std::span(stamps).first(static_cast<std::size_t>(n))) {
+            auto const covered = [&stamp](timed_reply const& r) {
+                return stamp.key - r.key < (1U << 31);
+            };
+            if (stamp.kind == TxStamp::Sent) {
+                for (timed_reply& r : conn.timed_replies) {
+                    if (!covered(r)) {
+                        break;
+                    }
+                    if (r.sent_ns == 0) {
+                        r.sent_ns = stamp.ns;
+                        latency_.reply_to_tx.record(elapsed_ns(r.reply_ns, stamp.ns));
+                    }
+                }
+                continue;
+            }
+            auto const acked = std::ranges::find_if_not(conn.timed_replies, covered);
+            for (auto itr = conn.timed_replies.begin(); itr != acked; ++itr) {
+                if (itr->sent_ns != 0) {
+                    latency_.tx_to_ack.record(elapsed_ns(itr->sent_ns, stamp.ns));
+                }
+            }
+            conn.timed_replies.erase(conn.timed_replies.begin(), acked);
+        }
+    } while (static_cast<std::size_t>(n) == stamps.size());
+    return true;
+}
+
+void
+echo_server::begin_drain() noexcept
+{
+    if (draining_) {
+        return;
+    }
+    draining_ = true;
+    drain_deadline_ = now_ + config_.drain_timeout;
+
+    // stop accepting. anything still in the backlog is reset by the
+    // kernel, unless the socket was handed over to a successor
+    if (sockfd_ != -1) {
+        ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, sockfd_, nullptr);
+        ::close(sockfd_);
+        sockfd_ = -1;
+    }
+    close_unix_listeners();
+
+    // the handoff path now belongs to the successor (if any); leave it be
+    if (handoff_fd_ != -1) {
+        ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, handoff_fd_, nullptr);
+        ::close(handoff_fd_);
+        handoff_fd_ = -1;
+    }
+
+    // connections still mid-handshake are left to finish it (they are
+    // closed as soon as they upgrade) or are dropped at the deadline.
+    // plain http ones get no keep-alive past the response they are on;
+    // the idle ones are closed on the first tick, outside event dispatch
+    drain_queue_.clear();
+    drain_http_.clear();
+    for (auto& [fd, conn] : clients_) {
+        if (conn.conn_state == ConnectionState::WebSocket) {
+            drain_queue_.push_back(fd);
+        } else if (conn.conn_state == ConnectionState::Http) {
+            conn.close_after_response = true;
+            drain_http_.push_back(fd);
+        }
+    }
+
+    // idle connections go first; they are the cheapest to move elsewhere
+    std::sort(drain_queue_.begin(), drain_queue_.end(), [this](int lhs, int rhs) {
+        return clients_.at(lhs).last_activity < clients_.at(rhs).last_activity;
+    });
+    drain_next_ = 0;
+    drain_start_ = now_;
+
+    SPDLOG_INFO("draining {} websocket connections over {} ms (deadline {} ms)",
+            drain_queue_.size(), config_.drain_window.count(), config_.drain_timeout.count());
+}
+
+bool
+echo_server::on_drain_tick() noexcept
+{
+    // keep-alive http connections between requests (health checks, say)
+    // would otherwise hold the drain open until the deadline
+    for (int const fd : drain_http_) {
+        auto itr = clients_.find(fd);
+        if (itr != clients_.end() && itr->second.buf.bytes_unread() == 0) {
+            finish_http_response(itr->second);
+        }
+    }
+    drain_http_.clear();
+
+    // spread the close frames evenly over the drain window so clients
+    // don't all reconnect to the new instance at the same instant
+    std::size_t const total = drain_queue_.size();
+    while (drain_next_ < total) {
+        auto const due = drain_start_ + config_.drain_window * drain_next_ / total;
+        if (due > now_) {
+            break;
+        }
+
+        int const fd = drain_queue_[drain_next_++];
+        auto itr = clients_.find(fd);
+        if (itr == clients_.end() || itr->second.conn_state != ConnectionState::WebSocket) {
+            continue; // already gone or already closing
+        }
+        send_websocket_close(itr->second, CloseGoingAway);
+    }
+
+    if (clients_.empty() && drain_next_ == total) {
+        SPDLOG_INFO("drain complete");
+        return true;
+    }
+
+    if (now_ >= drain_deadline_) {
+        SPDLOG_WARN("drain deadline reached, closing {} remaining connections", clients_.size());
+        while (!clients_.empty()) {
+            disconnect_and_cleanup_client(clients_.begin()->second);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+server_stats const&
+echo_server::stats() const noexcept
+{
+    return stats_;
+}
+
+message_latency const&
+echo_server::latency() const noexcept
+{
+    return latency_;
+}
+
+bool
+echo_server::on_incoming_connection(int listen_fd) noexcept
+{
+    // the listening socket is edge-triggered, so drain the whole accept queue
+    for (;;) {
+        // accept the connection
+        sockaddr_storage their_addr{};
+        socklen_t addr_size = sizeof(their_addr);
+        int const accepted_sock
+                = ::accept(listen_fd, reinterpret_cast<sockaddr*>(&their_addr), &addr_size);
+        if (accepted_sock == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true; // not an error
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                if (!refuse_with_spare_fd(listen_fd)) {
+                    return false;
+                }
+                continue;
+            }
+            if (errno == ECONNABORTED || errno == EINTR) {
+                continue;
+            }
+            SPDLOG_CRITICAL("error: accept: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+
+        // admission control: refuse early, before any per-connection memory is committed
+        if (config_.max_connections != 0 && clients_.size() >= config_.max_connections) {
+            ::close(accepted_sock);
+            ++stats_.rejected_connections;
+            SPDLOG_DEBUG("refused connection: at max_connections={}", config_.max_connections);
+            continue;
+        }
 
-    if (req.starts_with("GET")) {
-        SPDLOG_DEBUG("on_http_request: GET");
+        if (!add_client(accepted_sock, their_addr)) {
+            return false;
+        }
+    }
+}
+
+bool
+echo_server::refuse_with_spare_fd(int listen_fd) noexcept
+{
+    // out of descriptors: the pending connection would sit in the accept
+    // queue forever (edge-triggered), so free our reserved fd, accept it,
+    // and close it straight away
+    ::close(spare_fd_);
+    int const sock = ::accept(listen_fd, nullptr, nullptr);
+    if (sock != -1) {
+        ::close(sock);
+        ++stats_.rejected_connections;
+    }
+    SPDLOG_ERROR("refused connection: out of file descriptors");
+
+    spare_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (spare_fd_ == -1) {
+        SPDLOG_CRITICAL("error: open (/dev/null): {} {}", std::strerror(errno), errno);
+        return false;
+    }
+    return sock != -1;
+}
+
+bool
+echo_server::add_client(int accepted_sock, sockaddr_storage const& their_addr) noexcept
+{
+    connection conn{};
+    conn.conn_state = ConnectionState::TcpConnected;
+    conn.sockfd = accepted_sock;
+    conn.last_activity = now_;
+    conn.msg_limiter = token_bucket(config_.max_messages_per_sec,
+            config_.max_messages_per_sec * config_.rate_burst_secs, now_);
+    conn.byte_limiter = token_bucket(
+            config_.max_bytes_per_sec, config_.max_bytes_per_sec * config_.rate_burst_secs, now_);
+
+    // unix domain socket peers are unnamed; none of the tcp options apply
+    bool const tcp = their_addr.ss_family != AF_UNIX;
+    if (tcp) {
+        auto const* sin = reinterpret_cast<sockaddr_in const*>(&their_addr);
+        char const* ip = nullptr;
+        if (ip = ::inet_ntop(AF_INET, &(sin->sin_addr), conn.ip, sizeof(conn.ip)); ip == nullptr) {
+            SPDLOG_CRITICAL("inet_ntop: {}: {}", std::strerror(errno), errno);
+            std::abort();
+        }
+        conn.port = sin->sin_port;
     } else {
-        // TODO
-        SPDLOG_CRITICAL("did not receive GET request");
-        std::abort();
+        std::memcpy(conn.ip, "unix", sizeof("unix"));
+        ++stats_.unix_connections;
+    }
+
+    // wss: the tls handshake comes first. it runs non-blocking, driven by
+    // the event loop like everything else
+    if (tcp && config_.tls) {
+        try {
+            conn.tls = std::make_unique<tls_session>(*config_.tls, accepted_sock);
+        } catch (std::exception const& e) {
+            SPDLOG_ERROR("tls: {}", e.what());
+            ::close(accepted_sock);
+            ++stats_.tls_failures;
+            return true;
+        }
+        ::fcntl(accepted_sock, F_SETFL, ::fcntl(accepted_sock, F_GETFL) | O_NONBLOCK);
+        conn.secure = true;
+        conn.conn_state = ConnectionState::TlsHandshake;
+    }
+
+    // add the new fd to epoll
+    epoll_event event{};
+    event.events = (EPOLLIN | EPOLLET);
+    event.data.fd = accepted_sock;
+    if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, accepted_sock, &event); rv == -1) {
+        SPDLOG_CRITICAL("error: epoll_ctl (EPOLL_CTL_ADD): {} {}", std::strerror(errno), errno);
+        return false;
+    }
+
+    // tls records don't line up with the bytes we hand over, so their
+    // stamps would match no reply
+    if (tcp && config_.timestamping && !conn.secure) {
+        conn.timestamping = enable_timestamping(accepted_sock);
+        if (conn.timestamping) {
+            ++stats_.stamped_connections;
+        } else {
+            SPDLOG_WARN("setsockopt (SO_TIMESTAMPING): {} {}", std::strerror(errno), errno);
+        }
+    }
+
+    // kTLS encrypts into its own buffers; MSG_ZEROCOPY doesn't apply.
+    // zerocopy completions share the error queue with timestamps
+    if (tcp && config_.zerocopy_threshold != 0 && !conn.secure && !conn.timestamping) {
+        conn.zerocopy = enable_zerocopy(accepted_sock);
+        if (!conn.zerocopy) {
+            SPDLOG_WARN("setsockopt (SO_ZEROCOPY): {} {}", std::strerror(errno), errno);
+        }
+    }
+
+    // zerocopy frames are split into segments along page boundaries,
+    // leaving a short tail that nagle would hold back until the previous
+    // segment is acked. coalesced writes are already batched by us. in
+    // both cases there is nothing left for nagle to do but add delay
+    if (tcp
+            && (config_.sockets.nodelay || config_.zerocopy_threshold != 0
+                    || config_.coalesce_writes)) {
+        set_socket_option(accepted_sock, IPPROTO_TCP, TCP_NODELAY, "TCP_NODELAY", 1);
+    }
+
+    // keep only this much unsent data in the kernel: sends block (and
+    // backpressure reaches us) instead of piling up in the socket
+    if (tcp && config_.sockets.notsent_lowat != 0) {
+        set_socket_option(accepted_sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT",
+                config_.sockets.notsent_lowat);
+    }
+
+    // did the connection's packets arrive on our own cpu?
+    if (tcp && config_.cpu != -1) {
+        int incoming_cpu = -1;
+        socklen_t len = sizeof(incoming_cpu);
+        if (::getsockopt(accepted_sock, SOL_SOCKET, SO_INCOMING_CPU, &incoming_cpu, &len) == 0
+                && incoming_cpu == config_.cpu) {
+            ++stats_.local_connections;
+        }
     }
 
-    std::string method;
-    std::unordered_map<std::string, std::string> header_fields;
+    // successfully connected. add client entry
+    WS_PROBE(accept, accepted_sock, conn.ip, ntohs(conn.port));
+    clients_.emplace(accepted_sock, std::move(conn));
+    ++stats_.accepted_connections;
+    SPDLOG_INFO("client connected: {}", conn);
+
+    return true;
+}
+
+bool
+echo_server::is_unix_listener(int fd) const noexcept
+{
+    return std::ranges::any_of(
+            unix_listeners_, [fd](unix_listener const& listener) { return listener.fd == fd; });
+}
+
+void
+echo_server::close_unix_listeners() noexcept
+{
+    for (unix_listener const& listener : unix_listeners_) {
+        ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, listener.fd, nullptr);
+        ::close(listener.fd);
+
+        // after a handoff the path may belong to the successor by now
+        std::string const path = unix_socket_path(listener.address);
+        struct stat st{};
+        if (!path.empty() && ::stat(path.c_str(), &st) == 0 && st.st_ino == listener.inode) {
+            ::unlink(path.c_str());
+        }
+    }
+    unix_listeners_.clear();
+}
+
+bool
+echo_server::on_tls_handshake(connection& conn) noexcept
+{
+    TlsProgress const progress = conn.tls->handshake();
+    if (progress == TlsProgress::Failed) {
+        SPDLOG_INFO("tls handshake with {} failed: {}", conn.ip, conn.tls->error());
+        ++stats_.tls_failures;
+        disconnect_and_cleanup_client(conn);
+        return true;
+    }
+
+    // wait for whichever way the handshake goes next
+    bool const want_write = progress == TlsProgress::WantWrite;
+    if (want_write != conn.write_blocked) {
+        epoll_event event{};
+        event.events = want_write ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLET);
+        event.data.fd = conn.sockfd;
+        if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_MOD, conn.sockfd, &event); rv == -1) {
+            SPDLOG_ERROR("error: epoll_ctl (EPOLL_CTL_MOD): {} {}", std::strerror(errno), errno);
+            disconnect_and_cleanup_client(conn);
+            return true;
+        }
+        conn.write_blocked = want_write;
+    }
+    if (progress != TlsProgress::Done) {
+        return true;
+    }
+
+    ++stats_.tls_handshakes;
+    bool const kernel_send = conn.tls->kernel_send();
+    bool const kernel_recv = conn.tls->kernel_recv();
+    stats_.ktls_send += kernel_send ? 1 : 0;
+    stats_.ktls_recv += kernel_recv ? 1 : 0;
+    SPDLOG_DEBUG("tls handshake with {} done: {} {}, kTLS send={} recv={}", conn.ip,
+            conn.tls->version(), conn.tls->cipher(), kernel_send, kernel_recv);
+
+    // the kernel does it all: from here on the socket is like any other
+    if (kernel_send && kernel_recv) {
+        conn.tls.reset();
+        ::fcntl(conn.sockfd, F_SETFL, ::fcntl(conn.sockfd, F_GETFL) & ~O_NONBLOCK);
+    }
+
+    // the request may have come in right behind the handshake
+    conn.conn_state = ConnectionState::TcpConnected;
+    return on_incoming_data(conn, MSG_DONTWAIT);
+}
+
+bool
+echo_server::on_incoming_data(connection& conn, int recv_flags) noexcept
+{
+    // shift once we're past the 75% mark of capacity
+    if (conn.buf.bytes_left() / conn.buf.capacity() < 0.25) {
+        conn.buf.shift();
+    }
+
+    // the buffer is full of frames we were not allowed to process yet.
+    // leave the rest in the socket (tcp backpressure) and come back later
+    std::size_t const space = conn.buf.bytes_left();
+    if (space == 0) {
+        conn.read_pending = true;
+        if (!conn.throttled) {
+            defer(conn);
+        }
+        return true;
+    }
+
+    ssize_t const nbytes = recv_from_client(conn, conn.buf.write_ptr(), space, recv_flags);
+    if (nbytes == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true; // nothing left in the socket
+        }
+
+        // a bad record or an alert (kTLS reports those as EIO) ends the
+        // connection, not the server
+        if (conn.secure) {
+            SPDLOG_INFO("tls connection on fd {} failed: {}", conn.sockfd, std::strerror(errno));
+            disconnect_and_cleanup_client(conn);
+            return true;
+        }
+        SPDLOG_CRITICAL("error: recv: {} {}", std::strerror(errno), errno);
+        return false;
+    }
+    conn.buf.bytes_written(nbytes);
+    conn.last_activity = now_;
+
+    // client disconnected
+    if (nbytes == 0) {
+        SPDLOG_INFO("client on fd {} disconnected", conn.sockfd);
+        disconnect_and_cleanup_client(conn);
+        return true;
+    }
+
+    // we may not have drained the socket, and being edge-triggered we
+    // won't hear about the remainder. revisit on the next pass
+    if (static_cast<std::size_t>(nbytes) == space) {
+        conn.read_pending = true;
+        defer(conn);
+    }
+
+    process_buffered_data(conn);
+    return true;
+}
+
+bool
+echo_server::process_buffered_data(connection& conn)
+{
+    if (conn.buf.bytes_unread() == 0) {
+        return true;
+    }
+
+    if (conn.conn_state == ConnectionState::WebSocket
+            || conn.conn_state == ConnectionState::WebSocketClosing) {
+        if (!on_websocket_frame(conn)) {
+            SPDLOG_ERROR("on_websocket_frame returned false");
+            return false;
+        }
+    } else {
+        std::size_t const unread = conn.buf.bytes_unread();
+        if (!on_http_request(conn)) {
+            SPDLOG_ERROR("on_http_request returned false");
+            return false;
+        }
+        if (finish_http_response(conn)) {
+            return true;
+        }
+        bool const more = conn.buf.bytes_unread() != 0 && conn.buf.bytes_unread() != unread;
+
+        // upgraded after the drain began; it missed the schedule
+        if (draining_ && conn.conn_state == ConnectionState::WebSocket) {
+            return send_websocket_close(conn, CloseGoingAway);
+        }
+
+        // other threads may address the connection from now on
+        if (conn.conn_state == ConnectionState::WebSocket && conn.id == 0) {
+            conn.id = make_connection_id(conn.sockfd);
+            WS_PROBE(handshake_end, conn.sockfd, conn.id);
+            if (config_.on_open) {
+                config_.on_open(conn.id);
+            }
+        }
+
+        // coroutine handler: runs as soon as the connection is a websocket
+        if (config_.handler != nullptr && conn.conn_state == ConnectionState::WebSocket
+                && conn.handler == nullptr && !start_handler(conn)) {
+            return false;
+        }
+
+        // reverse proxy: pair the new websocket with its own backend connection
+        if (backend_ && conn.conn_state == ConnectionState::WebSocket && conn.backend_fd == -1
+                && !connect_backend(conn)) {
+            return send_websocket_close(conn, CloseBadGateway);
+        }
+
+        // pipelined http requests, or frames sent right behind the upgrade
+        if (more) {
+            defer(conn);
+        }
+    }
+    return true;
+}
+
+void
+echo_server::on_deferred_connections() noexcept
+{
+    if (deferred_.empty()) {
+        return;
+    }
+
+    // connections deferred while we work through this batch wait for the next pass
+    deferred_scratch_.clear();
+    deferred_scratch_.swap(deferred_);
+
+    for (int const fd : deferred_scratch_) {
+        auto itr = clients_.find(fd);
+        if (itr == clients_.end()) {
+            continue; // disconnected in the meantime
+        }
+
+        connection& conn = itr->second;
+        conn.deferred = false;
+
+        process_buffered_data(conn);
+
+        // processing may have closed the connection
+        itr = clients_.find(fd);
+        if (itr == clients_.end() || itr->second.deferred || !itr->second.read_pending) {
+            continue;
+        }
+
+        itr->second.read_pending = false;
+        if (!on_incoming_data(itr->second, MSG_DONTWAIT)) {
+            SPDLOG_ERROR("failed to read deferred data on fd {}", fd);
+        }
+    }
+}
+
+void
+echo_server::defer(connection& conn)
+{
+    if (!conn.deferred) {
+        conn.deferred = true;
+        deferred_.push_back(conn.sockfd);
+    }
+}
+
+void
+echo_server::on_throttled_connections() noexcept
+{
+    if (throttled_.empty() || now_ < throttle_wakeup_) {
+        return;
+    }
+
+    std::size_t kept = 0;
+    throttle_wakeup_ = clock::time_point::max();
+    for (int const fd : throttled_) {
+        auto itr = clients_.find(fd);
+        if (itr == clients_.end() || !itr->second.throttled) {
+            continue; // disconnected in the meantime
+        }
+
+        connection& conn = itr->second;
+        if (conn.throttled_until <= now_) {
+            conn.throttled = false;
+            defer(conn);
+        } else {
+            throttle_wakeup_ = std::min(throttle_wakeup_, conn.throttled_until);
+            throttled_[kept++] = fd;
+        }
+    }
+    throttled_.resize(kept);
+}
+
+void
+echo_server::throttle(connection& conn, frame const& frame)
+{
+    // polling again before the limiters have refilled would only spin
+    auto const nbytes = static_cast<double>(frame.total_size());
+    conn.throttled_until = now_
+            + std::max(conn.msg_limiter.wait_time(1, now_),
+                    conn.byte_limiter.wait_time(nbytes, now_));
+    if (throttled_.empty() || conn.throttled_until < throttle_wakeup_) {
+        throttle_wakeup_ = conn.throttled_until;
+    }
+    if (!conn.throttled) {
+        conn.throttled = true;
+        throttled_.push_back(conn.sockfd);
+    }
+}
+
+bool
+echo_server::admit_frame(connection& conn, frame const& frame) noexcept
+{
+    auto const nbytes = static_cast<double>(frame.total_size());
+    if (!conn.msg_limiter.can_consume(1, now_) || !conn.byte_limiter.can_consume(nbytes, now_)) {
+        return false;
+    }
+
+    conn.msg_limiter.try_consume(1, now_);
+    conn.byte_limiter.try_consume(nbytes, now_);
+    return true;
+}
+
+bool
+echo_server::on_http_request(connection& conn) noexcept
+{
+    conn.conn_state = ConnectionState::Http;
+
+    // a response is still going out; requests behind it wait until it is
+    if (conn.write_blocked || conn.file_fd != -1) {
+        return true;
+    }
+
+    std::string_view const buffered(
+            reinterpret_cast<char const*>(conn.buf.read_ptr()), conn.buf.bytes_unread());
+    std::size_t const header_end = buffered.find("\r\n\r\n");
+    if (header_end == std::string_view::npos) {
+        if (buffered.size() > MaxRequestHeaderSize) {
+            SPDLOG_ERROR("http request from {} too large", conn.ip);
+            reject_http_request(conn, HeadersTooLargeResponse);
+        }
+        return true; // wait for the rest
+    }
+
+    std::string_view const req = buffered.substr(0, header_end + 4);
+    SPDLOG_DEBUG("received http request:\n{}", req);
+    conn.buf.bytes_read(req.size());
+
+    header_map header_fields(&loop_arena_);
 
     // extract command
     std::size_t pos = 0;
     std::size_t newline_pos = req.find("\r\n", pos);
-    method = req.substr(pos, newline_pos - pos);
+    std::string_view const method = req.substr(pos, newline_pos - pos);
     SPDLOG_DEBUG("method={}", method);
     pos = newline_pos + 2;
 
-    if (!validate_request_method_uri_and_version(method)) {
-        SPDLOG_ERROR("request method, uri, and version validation failed");
-        return false;
-    }
-
     while (pos < req.size()) {
         std::size_t colon_pos = req.find(':', pos);
         std::size_t newline_pos = req.find("\r\n", colon_pos);
@@ -316,42 +1799,185 @@ echo_server::on_http_request(connection& conn) const noexcept
             break;
         }
 
-        std::string header_key = std::string(req.substr(pos, colon_pos - pos));
-        std::string header_val
-                = std::string(req.substr(colon_pos + 1, newline_pos - colon_pos - 1));
+        std::pmr::string header_key(trimmed(req.substr(pos, colon_pos - pos)), &loop_arena_);
+        std::pmr::string header_val(
+                trimmed(req.substr(colon_pos + 1, newline_pos - colon_pos - 1)), &loop_arena_);
 
-        trim(header_key);
-        trim(header_val);
-        header_fields.emplace(to_lower(header_key), header_val);
+        std::transform(header_key.begin(), header_key.end(), header_key.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        header_fields.emplace(std::move(header_key), std::move(header_val));
 
         pos = newline_pos + 2;
     }
 
     if (header_fields.contains("upgrade")) {
+        WS_PROBE(handshake_start, conn.sockfd);
+        if (!validate_request_method_uri_and_version(std::string(method))) {
+            SPDLOG_ERROR("request method, uri, and version validation failed");
+            return false;
+        }
         if (!on_websocket_upgrade_request(conn, header_fields)) {
             SPDLOG_ERROR("invalid websocket upgrade request");
             return false;
         }
-    } else {
-        // TODO
+        return true;
     }
 
-    // echo
-    // ::ssize_t const bytes_sent = ::send(fd, &buf, static_cast<std::size_t>(bytes_recvd), 0);
-    // if (bytes_sent == -1) {
-    //     SPDLOG_CRITICAL("error: send: {} {}", std::strerror(errno), errno);
-    //     return false;
-    // }
+    std::optional<request_line> const line = parse_request_line(method);
+    if (!line || !line->version.starts_with("HTTP/1.")) {
+        SPDLOG_ERROR("bad http request line from {}: {}", conn.ip, method);
+        reject_http_request(conn, BadRequestResponse);
+        return true;
+    }
+    return on_plain_http_request(conn, line->method, line->target, header_fields);
+}
 
-    // buf[bytes_recvd - 1] = '\0'; // NOLINT
-    // SPDLOG_INFO("[on_incoming_data] fd={}, buf={}\n", fd, buf);
+bool
+echo_server::on_plain_http_request(connection& conn, std::string_view method,
+        std::string_view target, header_map const& header_fields) noexcept
+{
+    bool const head = method == "HEAD";
+    if (method != "GET" && !head) {
+        SPDLOG_ERROR("unsupported http method from {}: {}", conn.ip, method);
+        reject_http_request(conn, MethodNotAllowedResponse);
+        return true;
+    }
+    ++stats_.http_requests;
+    if (draining_) {
+        conn.close_after_response = true;
+    }
 
+    // load balancer probes: alive, and taking new connections
+    if (target == "/health") {
+        return send_http_response(conn, HealthResponse, head);
+    }
+    if (target == "/ready") {
+        return send_http_response(conn, draining_ ? DrainingResponse : ReadyResponse, head);
+    }
+
+    static_file const* const file
+            = config_.static_files ? config_.static_files->find(target) : nullptr;
+    if (file == nullptr) {
+        SPDLOG_DEBUG("no static file for {}", target);
+        return send_http_response(conn, NotFoundResponse, head);
+    }
+
+    if (auto const itr = header_fields.find("if-none-match");
+            itr != header_fields.end() && if_none_match(itr->second, file->etag)) {
+        ++stats_.not_modified;
+        return send_http_response(conn, file->not_modified);
+    }
+
+    if (file->in_memory() || head) {
+        return send_http_response(conn, file->response, head);
+    }
+
+    // the headers, then the file straight from the page cache. if the
+    // headers didn't all fit, the file follows once they're out
+    if (!send_http_response(conn, std::string_view(file->response).substr(0, file->header_size))) {
+        return false;
+    }
+    conn.file_fd = file->fd;
+    conn.file_offset = 0;
+    conn.file_end = file->size;
+    return conn.write_blocked || send_static_file(conn);
+}
+
+bool
+echo_server::send_http_response(
+        connection& conn, std::string_view response, bool head_only) noexcept
+{
+    if (head_only) {
+        response = response.substr(0, response.find("\r\n\r\n") + 4);
+    }
+    auto const bytes = [](std::string_view str) {
+        return std::span(reinterpret_cast<std::uint8_t const*>(str.data()), str.size());
+    };
+
+    // the responses are prebuilt; slip the header in behind the others
+    std::size_t const header_end = response.find("\r\n\r\n") + 2;
+    if (conn.close_after_response
+            && !response.substr(0, header_end).contains("\r\nConnection: close\r\n")) {
+        return send_frame_nonblocking(
+                       conn, bytes(response.substr(0, header_end)), bytes(ConnectionClose))
+                && send_frame_nonblocking(conn, bytes(response.substr(header_end)), {});
+    }
+    return send_frame_nonblocking(conn, bytes(response), {});
+}
+
+bool
+echo_server::finish_http_response(connection& conn) noexcept
+{
+    if (!conn.close_after_response || conn.conn_state != ConnectionState::Http
+            || conn.write_blocked || conn.file_fd != -1) {
+        return false;
+    }
+    SPDLOG_DEBUG("closing http connection {} ({}), draining", conn.sockfd, conn.ip);
+    disconnect_and_cleanup_client(conn);
     return true;
 }
 
+void
+echo_server::reject_http_request(connection& conn, std::string_view response) noexcept
+{
+    // whatever else the client sent goes unanswered. the client sees our
+    // fin once the response is out and closes, which ends the connection
+    conn.buf.bytes_read(conn.buf.bytes_unread());
+    if (send_http_response(conn, response)) {
+        ::shutdown(conn.sockfd, SHUT_WR);
+    }
+}
+
 bool
-echo_server::on_websocket_upgrade_request(
-        connection& conn, std::unordered_map<std::string, std::string> const& header_fields) const
+echo_server::send_static_file(connection& conn) noexcept
+{
+    // tls in user space: through a buffer of ours instead of sendfile()
+    bool const copy = conn.tls != nullptr && !conn.tls->kernel_send();
+    std::size_t const chunk_size = copy ? std::min<std::size_t>(conn.file_end, 65536) : 0;
+    auto* const chunk = static_cast<std::uint8_t*>(loop_arena_.allocate(chunk_size, 1));
+
+    while (conn.file_offset < conn.file_end) {
+        auto offset = static_cast<off_t>(conn.file_offset);
+        ssize_t nbytes = -1;
+        if (copy) {
+            nbytes = ::pread(conn.file_fd, chunk,
+                    std::min(chunk_size, conn.file_end - conn.file_offset), offset);
+            if (nbytes > 0) {
+                iovec iov{chunk, static_cast<std::size_t>(nbytes)};
+                msghdr msg{};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                nbytes = send_to_client(conn, msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            }
+        } else {
+            nbytes = ::sendfile(
+                    conn.sockfd, conn.file_fd, &offset, conn.file_end - conn.file_offset);
+            if (nbytes > 0) {
+                stats_.bytes_sendfile += static_cast<std::uint64_t>(nbytes);
+                conn.tx_bytes += conn.timestamping ? static_cast<std::uint32_t>(nbytes) : 0;
+            }
+        }
+        ++stats_.write_syscalls;
+        if (nbytes == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return watch_writable(conn, true);
+            }
+            SPDLOG_ERROR("error: sendfile: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+        if (nbytes == 0) {
+            SPDLOG_ERROR("static file shrank after it was loaded");
+            return false;
+        }
+        conn.file_offset += static_cast<std::size_t>(nbytes);
+    }
+
+    conn.file_fd = -1;
+    return watch_writable(conn, false);
+}
+
+bool
+echo_server::on_websocket_upgrade_request(connection& conn, header_map const& header_fields)
 {
     if (!validate_header_fields(header_fields)) {
         SPDLOG_ERROR("header fields validation failed");
@@ -361,7 +1987,19 @@ echo_server::on_websocket_upgrade_request(
     auto itr = header_fields.find("sec-websocket-key");
     assert(itr != header_fields.end());
 
-    if (!send_websocket_accept(conn, itr->second)) {
+    // the only subprotocol we speak; any other offer goes unanswered
+    // (rfc 6455 4.2.2)
+    std::string_view protocol;
+    if (config_.batching) {
+        auto const offer = header_fields.find("sec-websocket-protocol");
+        if (offer != header_fields.end() && offers_protocol(offer->second, BatchProtocol)) {
+            protocol = BatchProtocol;
+            conn.batched = true;
+            ++stats_.batched_connections;
+        }
+    }
+
+    if (!send_websocket_accept(conn, itr->second, protocol)) {
         SPDLOG_ERROR("failed to send websocket accept");
         return false;
     } else {
@@ -405,8 +2043,7 @@ echo_server::validate_request_method_uri_and_version(
 }
 
 bool
-echo_server::validate_header_fields(
-        std::unordered_map<std::string, std::string> const& header_fields) const noexcept
+echo_server::validate_header_fields(header_map const& header_fields) const noexcept
 {
     // According to RFC 7230, section 3.2:
     // Each header field consists of a case-insensitive field name
@@ -479,41 +2116,38 @@ echo_server::validate_header_fields(
     return true;
 }
 
-std::string
-echo_server::generate_accept_key(std::string const& key) const noexcept
+std::pmr::string
+echo_server::generate_accept_key(std::string_view key) const noexcept
 {
-    SPDLOG_DEBUG("key={}", key);
-    std::string const concat = key + std::string(MagicGuid);
-    SPDLOG_DEBUG("concat={}", concat);
-
-    // Get the raw SHA-1 hash bytes (not hex string!)
-    auto const sha1_digest = sha1::hash(concat);
-    SPDLOG_DEBUG("sha1_digest raw bytes computed");
-
-    // base64-encode the raw bytes directly
-    std::string_view raw_bytes(
-            reinterpret_cast<const char*>(sha1_digest.data()), sha1_digest.size());
-    std::string b64_hash = to_base64(raw_bytes);
-    SPDLOG_DEBUG("b64_hash={}", b64_hash);
+    std::pmr::string b64_hash = websocket_accept_key(key, &loop_arena_);
+    SPDLOG_DEBUG("key={}, b64_hash={}", key, b64_hash);
     return b64_hash;
 }
 
 bool
-echo_server::send_websocket_accept(
-        connection& conn, std::string const& sec_websocket_key) const noexcept
+echo_server::send_websocket_accept(connection& conn, std::string_view sec_websocket_key,
+        std::string_view protocol) const noexcept
 {
     conn.conn_state = ConnectionState::WebSocket;
-    std::string accept_key = generate_accept_key(sec_websocket_key);
-    std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
-                           "Upgrade: websocket\r\n"
-                           "Connection: Upgrade\r\n"
-                           "Sec-WebSocket-Accept: "
-            + accept_key + "\r\n\r\n";
+    std::pmr::string const accept_key = generate_accept_key(sec_websocket_key);
+    std::pmr::string response("HTTP/1.1 101 Switching Protocols\r\n"
+                              "Upgrade: websocket\r\n"
+                              "Connection: Upgrade\r\n"
+                              "Sec-WebSocket-Accept: ",
+            &loop_arena_);
+    response.append(accept_key).append("\r\n");
+    if (!protocol.empty()) {
+        response.append("Sec-WebSocket-Protocol: ").append(protocol).append("\r\n");
+    }
+    response.append("\r\n");
     SPDLOG_DEBUG("response=\n{}", response);
 
     SPDLOG_DEBUG("sending {} bytes", response.size());
-    ssize_t nbytes
-            = ::send(conn.sockfd, response.c_str(), static_cast<ssize_t>(response.size()), 0);
+    iovec iov{response.data(), response.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    ssize_t nbytes = send_to_client(conn, msg, MSG_NOSIGNAL);
     if (nbytes == -1) {
         SPDLOG_CRITICAL("send: {}: {}", std::strerror(errno), errno);
         return false;
@@ -528,13 +2162,50 @@ echo_server::on_websocket_frame(connection& conn)
 {
     SPDLOG_DEBUG("on_websocket_frame: bytes_unread={}", conn.buf.bytes_unread());
 
+    std::size_t frames_this_pass = 0;
+
     // process all complete frames in the buffer
     while (conn.buf.bytes_unread() > 0) {
-        frame frame;
+        // reverse proxy: the backend isn't keeping up. the rest waits in the
+        // buffer (and then the socket) until its backlog has drained
+        if (!conn.backend_backlog.empty()) {
+            return true;
+        }
+
+        // coroutine handler: one message at a time. the rest waits in the
+        // buffer (and then the socket) until the handler has taken it
+        if (conn.handler != nullptr && !conn.handler->accepts_message()) {
+            return true;
+        }
+
+        // worker offload: the rest waits until replies make room at the workers
+        if (conn.offloaded >= config_.max_offloaded_per_connection) {
+            return true;
+        }
+
+        // fairness: the rest of this client's frames wait for the next pass
+        if (config_.max_frames_per_iteration != 0
+                && frames_this_pass == config_.max_frames_per_iteration) {
+            ++stats_.budget_exhausted;
+            defer(conn);
+            return true;
+        }
+
+        frame frame(&loop_arena_);
         ParseResult result = frame.parse_from_buffer(conn.buf.read_ptr(), conn.buf.bytes_unread());
 
         switch (result) {
             case ParseResult::NeedMoreData:
+                // a frame larger than the buffer could never be completed
+                if (frame.parse_header(conn.buf.read_ptr(), conn.buf.bytes_unread())
+                                == ParseResult::Success
+                        && frame.total_size() > BufferSize) {
+                    SPDLOG_ERROR("frame of {} bytes from {} is over the {} byte buffer",
+                            frame.total_size(), conn.ip, BufferSize);
+                    send_websocket_close(conn, CloseTooBig);
+                    disconnect_and_cleanup_client(conn);
+                    return false;
+                }
                 SPDLOG_DEBUG("need more data for complete frame");
                 return true; // wait for more data
 
@@ -551,15 +2222,39 @@ echo_server::on_websocket_frame(connection& conn)
         SPDLOG_DEBUG("parsed frame: fin={}, op_code={}, masked={}, payload_len={}, header_size={}",
                 frame.fin(), frame.op_code(), frame.masked(), frame.payload_len(),
                 frame.header_size());
+        WS_PROBE(frame_parsed, conn.sockfd, static_cast<int>(frame.op_code()), frame.payload_len());
+
+        // worker offload: replies still at the workers go out before our close
+        if (frame.op_code() == OpCode::Close && conn.offloaded != 0) {
+            return true;
+        }
+
+        // rate limiting: the frame stays in the buffer until the client has tokens again
+        if (!admit_frame(conn, frame)) {
+            ++stats_.throttled_events;
+            SPDLOG_DEBUG("throttled client on fd {}", conn.sockfd);
+            throttle(conn, frame);
+            return true;
+        }
+
+        ++frames_this_pass;
+        ++stats_.frames_processed;
+
+        // whatever goes out from here on is this frame's reply
+        if (conn.timestamping) {
+            conn.parse_ns = realtime_ns();
+            conn.parse_position = conn.tx_bytes
+                    + static_cast<std::uint32_t>(conn.pending_writes.size());
+        }
 
         bool frame_handled = false;
 
         switch (frame.op_code()) {
             case OpCode::Close: {
+                // the connection is gone once this returns
                 on_websocket_close(conn);
-                conn.buf.bytes_read(frame.total_size());
-                frame_handled = true;
-            } break;
+                return true;
+            }
 
             case OpCode::Ping: {
                 on_websocket_ping(conn, frame.get_payload_data());
@@ -599,17 +2294,12 @@ echo_server::on_websocket_ping(connection& conn, std::span<std::uint8_t const> p
 {
     SPDLOG_INFO("received ping frame");
 
-    auto frame = frame_generator{}.pong(payload);
+    // built on the stack; replying to a ping never allocates. pongs
+    // measure round trips, so they don't wait for the end of the pass
+    control_frame_buffer const frame(OpCode::Pong, payload);
 
     SPDLOG_DEBUG("sending {} bytes", frame.size());
-    ssize_t nbytes = ::send(
-            conn.sockfd, frame.data().data(), static_cast<ssize_t>(frame.size()), /*flags=*/0);
-    if (nbytes == -1) {
-        SPDLOG_CRITICAL("send: {}: {}", std::strerror(errno), errno);
-        return false;
-    }
-
-    return true;
+    return send_frame(conn, frame.data(), {}, /*urgent=*/true);
 }
 
 bool
@@ -627,24 +2317,42 @@ bool
 echo_server::on_websocket_close(connection& conn)
 {
     SPDLOG_INFO("received close frame");
-    conn.conn_state = ConnectionState::WebSocketClosing;
-
-    auto frame = frame_generator{}.close();
 
-    SPDLOG_DEBUG("sending {} bytes", frame.size());
-    ssize_t nbytes = ::send(
-            conn.sockfd, frame.data().data(), static_cast<ssize_t>(frame.size()), /*flags=*/0);
-    if (nbytes == -1) {
-        SPDLOG_CRITICAL("send: {}: {}", std::strerror(errno), errno);
-        return false;
+    // we started the closing handshake; this is the client's acknowledgement
+    if (conn.conn_state == ConnectionState::WebSocketClosing) {
+        disconnect_and_cleanup_client(conn);
+        return true;
     }
 
+    bool const sent = send_websocket_close(conn, CloseNormal);
     disconnect_and_cleanup_client(conn);
-    return true;
+    return sent;
 }
 
 bool
-echo_server::on_websocket_data_frame(connection& conn, frame const& frame)
+echo_server::send_websocket_close(connection& conn, std::uint16_t code)
+{
+    conn.conn_state = ConnectionState::WebSocketClosing;
+
+    // the codes we send routinely are prebuilt; anything else is
+    // assembled on the stack
+    std::uint8_t const code_be[2] = {
+            static_cast<std::uint8_t>(code >> 8), static_cast<std::uint8_t>(code)};
+    control_frame_buffer const custom(OpCode::Close, code_be);
+
+    std::span<std::uint8_t const> frame = custom.data();
+    if (code == CloseNormal) {
+        frame = CloseNormalFrame;
+    } else if (code == CloseGoingAway) {
+        frame = CloseGoingAwayFrame;
+    }
+
+    SPDLOG_DEBUG("sending {} bytes (close code {})", frame.size(), code);
+    return send_frame(conn, frame, {}, /*urgent=*/true);
+}
+
+bool
+echo_server::on_websocket_data_frame(connection& conn, frame& frame)
 {
     OpCode opcode = frame.op_code();
 
@@ -729,30 +2437,37 @@ echo_server::process_complete_fragmented_message(connection& conn, frame const&
     SPDLOG_INFO("Completed fragmented message: {} total bytes in {} fragments",
             conn.fragmented_payload.size(), conn.fragments_received);
 
-    // Log the complete message content for debugging
-    if (conn.current_frame_type == OpCode::Text && !conn.fragmented_payload.empty()) {
-        std::string complete_text(reinterpret_cast<char const*>(conn.fragmented_payload.data()),
-                conn.fragmented_payload.size());
-        SPDLOG_DEBUG("Complete text message: '{}'", complete_text);
-    }
-
     // Process the complete message (call the appropriate handler)
     if (conn.current_frame_type == OpCode::Text) {
-        std::string complete_text(reinterpret_cast<char const*>(conn.fragmented_payload.data()),
+        std::string_view const complete_text(
+                reinterpret_cast<char const*>(conn.fragmented_payload.data()),
                 conn.fragmented_payload.size());
+        SPDLOG_DEBUG("Complete text message: '{}'", complete_text);
         on_websocket_text_frame(conn, complete_text);
     } else if (conn.current_frame_type == OpCode::Binary) {
         std::span<const std::uint8_t> complete_data(conn.fragmented_payload);
         on_websocket_binary_frame(conn, complete_data);
     }
+    capture_message(conn, conn.current_frame_type, conn.fragmented_payload);
 
     // Send echo response using the accumulated data
     std::span<const std::uint8_t> echo_data(conn.fragmented_payload);
     SPDLOG_DEBUG("Sending echo response for fragmented message: {} bytes", echo_data.size());
 
+    WS_PROBE(message_dispatched, conn.sockfd, static_cast<int>(conn.current_frame_type),
+            conn.fragmented_payload.size());
     bool echo_sent = false;
-    if (!echo_data.empty()) {
-        echo_sent = send_echo(conn, echo_data, conn.current_frame_type);
+    if (conn.batched && conn.current_frame_type == OpCode::Binary) {
+        echo_sent = on_websocket_batch(conn, conn.fragmented_payload);
+    } else if (conn.handler != nullptr) {
+        echo_sent = deliver_to_handler(
+                conn, std::move(conn.fragmented_payload), conn.current_frame_type);
+    } else if (config_.processor) {
+        echo_sent = process_message(
+                conn, std::move(conn.fragmented_payload), conn.current_frame_type);
+    } else if (!echo_data.empty()) {
+        echo_sent = backend_ ? forward_to_backend(conn, conn.fragmented_payload)
+                             : send_echo(conn, conn.fragmented_payload, conn.current_frame_type);
         if (echo_sent) {
             SPDLOG_DEBUG("Successfully sent fragmented message echo");
         } else {
@@ -763,6 +2478,10 @@ echo_server::process_complete_fragmented_message(connection& conn, frame const&
         echo_sent = true; // Consider empty message as successfully "sent"
     }
 
+    if (conn.timestamping && echo_sent) {
+        time_message(conn);
+    }
+
     // Consume the final frame from buffer
     conn.buf.bytes_read(final_frame.total_size());
 
@@ -774,11 +2493,11 @@ echo_server::process_complete_fragmented_message(connection& conn, frame const&
 }
 
 bool
-echo_server::process_single_frame_message(connection& conn, frame const& frame)
+echo_server::process_single_frame_message(connection& conn, frame& frame)
 {
     // process a complete single-frame message
     if (frame.op_code() == OpCode::Text) {
-        auto payload = frame.get_text_payload();
+        auto payload = frame.get_text_view();
         if (!payload) {
             SPDLOG_ERROR("received text frame with bad payload");
             disconnect_and_cleanup_client(conn);
@@ -788,11 +2507,117 @@ echo_server::process_single_frame_message(connection& conn, frame const& frame)
     } else if (frame.op_code() == OpCode::Binary) {
         on_websocket_binary_frame(conn, frame.get_payload_data());
     }
+    capture_message(conn, frame.op_code(), frame.get_payload_data());
+
+    // the payload is in the loop arena; what outlives this pass gets a copy
+    std::span<std::uint8_t const> const payload = frame.get_payload_data();
+    WS_PROBE(message_dispatched, conn.sockfd, static_cast<int>(frame.op_code()), payload.size());
+    bool echo_sent = false;
+    if (conn.batched && frame.op_code() == OpCode::Binary) {
+        echo_sent = on_websocket_batch(conn, payload);
+    } else if (conn.handler != nullptr) {
+        echo_sent = deliver_to_handler(
+                conn, std::vector<std::uint8_t>(payload.begin(), payload.end()), frame.op_code());
+    } else if (config_.processor) {
+        echo_sent = process_message(
+                conn, std::vector<std::uint8_t>(payload.begin(), payload.end()), frame.op_code());
+    } else {
+        echo_sent = backend_ ? forward_to_backend(conn, payload)
+                             : send_echo(conn, payload, frame.op_code());
+    }
+    if (conn.timestamping && echo_sent) {
+        time_message(conn);
+    }
+    conn.buf.bytes_read(frame.total_size());
+
+    return echo_sent;
+}
+
+bool
+echo_server::on_websocket_batch(connection& conn, std::span<std::uint8_t const> payload)
+{
+    // rfc 6455 5.5.1: no data frames after we've sent a close frame
+    if (conn.conn_state != ConnectionState::WebSocket) {
+        return true;
+    }
+
+    // the messages stay where they are, in the frame; only their spans are
+    // collected, and only if there is a handler to hand them to
+    std::pmr::vector<std::span<std::uint8_t const>> messages(&loop_arena_);
+    std::size_t count = 0;
+    batch_reader reader(payload);
+    for (std::span<std::uint8_t const> message; reader.next(message); ++count) {
+        if (config_.on_batch) {
+            messages.push_back(message);
+        }
+    }
+    if (reader.error()) {
+        SPDLOG_ERROR("malformed batch from {} after {} messages", conn.ip, count);
+        return send_websocket_close(conn, CloseInvalidData);
+    }
+    ++stats_.batches;
+    stats_.batched_messages += count;
+
+    // echo: the batch of echoes is the batch itself
+    if (!config_.on_batch) {
+        return send_echo(conn, payload, OpCode::Binary);
+    }
+
+    batch_writer replies(&loop_arena_);
+    try {
+        config_.on_batch(messages, replies);
+    } catch (std::exception const& e) {
+        SPDLOG_ERROR("error: batch handler on fd {} threw: {}", conn.sockfd, e.what());
+        return send_websocket_close(conn, CloseInternalError);
+    } catch (...) {
+        SPDLOG_ERROR("error: batch handler on fd {} threw", conn.sockfd);
+        return send_websocket_close(conn, CloseInternalError);
+    }
+    return send_echo(conn, replies.data(), OpCode::Binary);
+}
+
+void
+echo_server::time_message(connection& conn)
+{
+    std::int64_t const reply_ns = realtime_ns();
+    if (conn.rx_ns != 0) {
+        latency_.rx_to_read.record(elapsed_ns(conn.rx_ns, conn.read_ns));
+    }
+    latency_.read_to_parse.record(elapsed_ns(conn.read_ns, conn.parse_ns));
+
+    // nothing went out: no reply, a reply still to come (coroutine
+    // handler, worker pool) or our close frame
+    std::uint32_t const position
+            = conn.tx_bytes + static_cast<std::uint32_t>(conn.pending_writes.size());
+    if (position == conn.parse_position || conn.conn_state != ConnectionState::WebSocket) {
+        return;
+    }
+    latency_.parse_to_reply.record(elapsed_ns(conn.parse_ns, reply_ns));
+
+    // a client that never acks can't grow this without bound
+    if (conn.timed_replies.size() < MaxTimedReplies) {
+        conn.timed_replies.push_back({position - 1, reply_ns});
+    }
+}
+
+void
+echo_server::capture_message(
+        connection const& conn, OpCode op_code, std::span<std::uint8_t const> payload)
+{
+    if (!capture_) {
+        return;
+    }
+    auto const now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now().time_since_epoch());
+    if (capture_->append(now.count(), conn.id, static_cast<std::uint8_t>(op_code), payload)) {
+        ++stats_.captured_messages;
+        return;
+    }
 
-    bool echo_sent = send_echo(conn, frame.get_payload_data(), frame.op_code());
-    conn.buf.bytes_read(frame.total_size());
-
-    return echo_sent;
+    if (stats_.capture_dropped++ == 0) {
+        SPDLOG_WARN("capture log {} is full after {} messages, dropping what follows",
+                config_.capture_path, capture_->records());
+    }
 }
 
 bool
@@ -820,14 +2645,14 @@ echo_server::on_websocket_binary_frame(connection& conn, std::span<std::uint8_t
         SPDLOG_INFO("received binary frame from {}: {} bytes", conn.ip, payload.size());
 
         if (!payload.empty()) {
-            std::string hex_preview;
+            std::pmr::string hex_preview(&loop_arena_);
             std::size_t preview_len = std::min(payload.size(), static_cast<std::size_t>(16));
 
             for (std::size_t i = 0; i < preview_len; ++i) {
                 if (i > 0) {
                     hex_preview += " ";
                 }
-                hex_preview += std::format("{:02x}", payload[i]);
+                std::format_to(std::back_inserter(hex_preview), "{:02x}", payload[i]);
             }
 
             if (payload.size() > 16) {
@@ -843,6 +2668,8 @@ echo_server::on_websocket_binary_frame(connection& conn, std::span<std::uint8_t
 bool
 echo_server::disconnect_and_cleanup_client(connection& conn)
 {
+    WS_PROBE(disconnect, conn.sockfd);
+
     epoll_event event{};
     event.events = (EPOLLIN | EPOLLET);
     event.data.fd = conn.sockfd;
@@ -851,62 +2678,690 @@ echo_server::disconnect_and_cleanup_client(connection& conn)
         return false;
     }
 
+    // the kernel may still be reading zerocopy payloads we're about to
+    // free. an abortive close drops its references right away
+    if (conn.zerocopy_in_flight()) {
+        on_socket_error(conn);
+    }
+    if (conn.zerocopy_in_flight()) {
+        linger const abort_on_close{1, 0};
+        ::setsockopt(conn.sockfd, SOL_SOCKET, SO_LINGER, &abort_on_close, sizeof(abort_on_close));
+    }
+
+    if (conn.backend_fd != -1) {
+        close_backend(conn);
+    }
+
+    // the handler is destroyed wherever it's suspended
+    if (conn.handler != nullptr) {
+        handlers_.erase(conn.sockfd);
+    }
+
+    // jobs already at the workers still run; their executor goes once they have
+    if (auto const itr = executors_.find(conn.id); itr != executors_.end()) {
+        if (!itr->second->idle()) {
+            retired_executors_.push_back(std::move(itr->second));
+        }
+        executors_.erase(itr);
+    }
+
+    if (conn.id != 0 && config_.on_close) {
+        config_.on_close(conn.id);
+    }
+
     close(conn.sockfd);
-    clients_.erase(conn.sockfd);
     SPDLOG_INFO("client disconnected: {}", conn);
+    clients_.erase(conn.sockfd);
     return true;
 }
 
 bool
 echo_server::send_echo(
-        connection& conn, std::span<std::uint8_t const> payload, OpCode original_frame_type)
+        connection& conn, std::vector<std::uint8_t>& payload, OpCode original_frame_type)
+{
+    return send_echo(conn, std::span<std::uint8_t const>(payload), original_frame_type, &payload);
+}
+
+bool
+echo_server::send_echo(connection& conn, std::span<std::uint8_t const> payload,
+        OpCode original_frame_type, std::vector<std::uint8_t>* owner)
 {
     if (payload.empty()) {
         SPDLOG_DEBUG("payload is empty - returning true without sending");
         return true;
     }
 
-    frame_generator gen;
+    // rfc 6455 5.5.1: no data frames after we've sent a close frame
+    if (conn.conn_state == ConnectionState::WebSocketClosing) {
+        SPDLOG_DEBUG("connection is closing - dropping echo");
+        return true;
+    }
+
+    // echoes are never masked, so the header depends only on opcode and
+    // length. encode it on the stack and send it together with the payload
+    std::uint8_t header[MaxFrameHeaderSize];
+    OpCode const op_code = original_frame_type == OpCode::Text ? OpCode::Text : OpCode::Binary;
+    std::size_t const header_size = encode_frame_header(header, op_code, payload.size());
+
+    // large payloads go out zerocopy; the connection takes the payload
+    // over (or a copy of it) until the kernel is done with it
+    if (conn.zerocopy && payload.size() >= config_.zerocopy_threshold) {
+        std::vector<std::uint8_t> kept = owner != nullptr
+                ? std::move(*owner)
+                : std::vector<std::uint8_t>(payload.begin(), payload.end());
+        return send_zerocopy(conn, std::span(header, header_size), std::move(kept));
+    }
+
+    SPDLOG_DEBUG("generated frame size: {} bytes", header_size + payload.size());
+    return send_frame(conn, std::span(header, header_size), payload, /*urgent=*/false);
+}
+
+bool
+echo_server::send_frame(connection& conn, std::span<std::uint8_t const> header,
+        std::span<std::uint8_t const> payload, bool urgent)
+{
+    std::size_t const frame_size = header.size() + payload.size();
+
+    // small frames wait for the end of the pass and go out together
+    if (config_.coalesce_writes && !urgent
+            && conn.pending_writes.size() + frame_size <= config_.coalesce_limit) {
+        conn.pending_writes.insert(conn.pending_writes.end(), header.begin(), header.end());
+        conn.pending_writes.insert(conn.pending_writes.end(), payload.begin(), payload.end());
+        WS_PROBE(send_queued, conn.sockfd, frame_size, conn.pending_writes.size());
+        if (!conn.flush_queued) {
+            conn.flush_queued = true;
+            flush_queue_.push_back(conn.sockfd);
+        }
+        ++stats_.coalesced_frames;
+        return true;
+    }
+
+    // whatever is queued goes first, in the same syscall
+    iovec iov[3];
+    std::size_t count = 0;
+    std::size_t total = 0;
+    for (auto const part : {std::span<std::uint8_t const>(conn.pending_writes), header, payload}) {
+        if (!part.empty()) {
+            iov[count++] = {const_cast<std::uint8_t*>(part.data()), part.size()};
+            total += part.size();
+        }
+    }
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    ssize_t nbytes = send_to_client(conn, msg, /*flags=*/MSG_NOSIGNAL);
+    ++stats_.write_syscalls;
+
+    if (nbytes == -1) {
+        SPDLOG_CRITICAL("send() failed: {} (errno={})", std::strerror(errno), errno);
+        return false;
+    }
+
+    if (nbytes != static_cast<ssize_t>(total)) {
+        SPDLOG_ERROR("partial send: sent {} bytes, expected {} bytes", nbytes, total);
+        return false;
+    }
+
+    SPDLOG_DEBUG("successfully sent {} bytes to socket {}", nbytes, conn.sockfd);
+    conn.pending_writes.clear();
+    return true;
+}
+
+ssize_t
+echo_server::recv_from_client(connection& conn, void* buf, std::size_t len, int flags) noexcept
+{
+    if (conn.tls != nullptr && !conn.tls->kernel_recv()) {
+        return conn.tls->recv(buf, len);
+    }
+    if (conn.timestamping) {
+        ssize_t const nbytes = recv_timestamped(conn.sockfd, buf, len, flags, conn.rx_ns);
+        conn.read_ns = realtime_ns();
+        return nbytes;
+    }
+    return ::recv(conn.sockfd, buf, len, flags);
+}
+
+ssize_t
+echo_server::send_to_client(connection& conn, msghdr const& msg, int flags) const noexcept
+{
+    if (conn.tls == nullptr) {
+        ssize_t const nbytes = ::sendmsg(conn.sockfd, &msg, flags);
+        // the stream offset the kernel keys transmit timestamps by
+        if (conn.timestamping && nbytes > 0) {
+            conn.tx_bytes += static_cast<std::uint32_t>(nbytes);
+        }
+        WS_PROBE(send_flushed, conn.sockfd, nbytes);
+        return nbytes;
+    }
 
-    if (original_frame_type == OpCode::Text) {
-        std::string_view text_data(reinterpret_cast<const char*>(payload.data()), payload.size());
-        gen.text(text_data);
+    // tls records are cut from one buffer
+    std::span<std::uint8_t const> data;
+    if (msg.msg_iovlen == 1) {
+        data = {static_cast<std::uint8_t const*>(msg.msg_iov[0].iov_base), msg.msg_iov[0].iov_len};
     } else {
-        gen.binary(payload);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < msg.msg_iovlen; ++i) {
+            total += msg.msg_iov[i].iov_len;
+        }
+        auto* const gathered = static_cast<std::uint8_t*>(loop_arena_.allocate(total, 1));
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < msg.msg_iovlen; ++i) {
+            std::memcpy(gathered + offset, msg.msg_iov[i].iov_base, msg.msg_iov[i].iov_len);
+            offset += msg.msg_iov[i].iov_len;
+        }
+        data = {gathered, total};
+    }
+
+    // the socket is non-blocking for the user-space direction(s); a
+    // blocking send waits for room here instead
+    bool const kernel_send = conn.tls->kernel_send();
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t const nbytes = kernel_send
+                ? ::send(conn.sockfd, data.data() + sent, data.size() - sent, flags | MSG_DONTWAIT)
+                : conn.tls->send(data.data() + sent, data.size() - sent);
+        if (nbytes > 0) {
+            sent += static_cast<std::size_t>(nbytes);
+            continue;
+        }
+        if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)
+                && (flags & MSG_DONTWAIT) == 0) {
+            pollfd pfd{conn.sockfd, POLLOUT, 0};
+            if (::poll(&pfd, 1, -1) != -1 || errno == EINTR) {
+                continue;
+            }
+        }
+        break;
+    }
+    WS_PROBE(send_flushed, conn.sockfd, sent);
+    return sent != 0 || data.empty() ? static_cast<ssize_t>(sent) : -1;
+}
+
+bool
+echo_server::flush_writes(connection& conn)
+{
+    if (conn.pending_writes.empty()) {
+        return true;
     }
+    return send_frame(conn, {}, {}, /*urgent=*/true);
+}
 
-    SPDLOG_DEBUG("generated frame size: {} bytes", gen.size());
+void
+echo_server::flush_pending_writes() noexcept
+{
+    for (int const fd : flush_queue_) {
+        auto itr = clients_.find(fd);
+        if (itr == clients_.end()) {
+            continue; // disconnected in the meantime
+        }
 
-    // Validate the generated frame by parsing it back
-    auto frame_data = gen.data();
-    frame validation_frame;
-    ParseResult parse_result
-            = validation_frame.parse_from_buffer(frame_data.data(), frame_data.size());
+        // coroutine handlers never block the event loop, not even here
+        connection& conn = itr->second;
+        conn.flush_queued = false;
+        bool const flushed = conn.handler != nullptr ? send_frame_nonblocking(conn, {}, {})
+                                                     : flush_writes(conn);
+        if (!flushed) {
+            disconnect_and_cleanup_client(conn);
+        }
+    }
+    flush_queue_.clear();
+}
 
-    if (parse_result != ParseResult::Success) {
-        SPDLOG_ERROR("generated frame is invalid! ParseResult: {}", static_cast<int>(parse_result));
+bool
+echo_server::send_zerocopy(connection& conn, std::span<std::uint8_t const> header,
+        std::vector<std::uint8_t>&& payload)
+{
+    // frames queued earlier in this pass go first
+    if (!flush_writes(conn)) {
         return false;
     }
 
-    SPDLOG_DEBUG("frame validation: opcode={}, fin={}, payload_len={}",
-            static_cast<int>(validation_frame.op_code()), validation_frame.fin(),
-            validation_frame.payload_len());
+    // the kernel reads the frame in place until it reports the send
+    // released (see on_socket_error), so give it a stable home first
+    zerocopy_frame& zc = conn.zerocopy_frames.emplace_back();
+    std::memcpy(zc.header.data(), header.data(), header.size());
+    zc.header_size = header.size();
+    zc.payload = std::move(payload);
+
+    iovec iov[2] = {
+            {zc.header.data(), zc.header_size},
+            {zc.payload.data(), zc.payload.size()},
+    };
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    std::size_t const frame_size = zc.header_size + zc.payload.size();
+
+    ssize_t nbytes = ::sendmsg(conn.sockfd, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY);
+    ++stats_.write_syscalls;
+    bool const zerocopy = nbytes != -1;
+    if (nbytes == -1 && errno == ENOBUFS) {
+        // out of socket option memory for tracking the send; copy this one
+        nbytes = ::sendmsg(conn.sockfd, &msg, MSG_NOSIGNAL);
+        ++stats_.write_syscalls;
+    }
+    int const err = errno;
+    WS_PROBE(send_flushed, conn.sockfd, nbytes);
 
-    ssize_t nbytes
-            = ::send(conn.sockfd, gen.data().data(), static_cast<ssize_t>(gen.size()), /*flags=*/0);
+    if (zerocopy) {
+        zc.release_count = ++conn.zerocopy_sent;
+        ++stats_.zerocopy_sends;
+    } else {
+        conn.zerocopy_frames.pop_back(); // copied, or not sent at all; moves no other frame
+    }
 
     if (nbytes == -1) {
-        SPDLOG_CRITICAL("send() failed: {} (errno={})", std::strerror(errno), errno);
+        SPDLOG_CRITICAL("sendmsg() failed: {} (errno={})", std::strerror(err), err);
+        return false;
+    }
+    if (nbytes != static_cast<ssize_t>(frame_size)) {
+        SPDLOG_ERROR("partial send: sent {} bytes, expected {} bytes", nbytes, frame_size);
+        return false;
+    }
+
+    SPDLOG_DEBUG("sent {} bytes zerocopy to socket {}", nbytes, conn.sockfd);
+    return true;
+}
+
+bool
+echo_server::send_frame_nonblocking(connection& conn, std::span<std::uint8_t const> header,
+        std::span<std::uint8_t const> payload) noexcept
+{
+    // whatever is queued goes first, in the same syscall
+    iovec iov[3];
+    std::size_t count = 0;
+    for (auto const part : {std::span<std::uint8_t const>(conn.pending_writes), header, payload}) {
+        if (!part.empty()) {
+            iov[count++] = {const_cast<std::uint8_t*>(part.data()), part.size()};
+        }
+    }
+
+    std::size_t sent = 0;
+    if (count != 0) {
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t const nbytes = send_to_client(conn, msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        ++stats_.write_syscalls;
+        if (nbytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            SPDLOG_ERROR("error: sendmsg: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+        sent = nbytes > 0 ? static_cast<std::size_t>(nbytes) : 0;
+    }
+
+    // keep what the socket didn't take, in order
+    std::size_t const from_queue = std::min(sent, conn.pending_writes.size());
+    conn.pending_writes.erase(conn.pending_writes.begin(),
+            conn.pending_writes.begin() + static_cast<std::ptrdiff_t>(from_queue));
+    sent -= from_queue;
+    for (auto const part : {header, payload}) {
+        std::size_t const skip = std::min(sent, part.size());
+        conn.pending_writes.insert(conn.pending_writes.end(), part.begin() + skip, part.end());
+        sent -= skip;
+    }
+
+    // and wait for the socket to drain before sending more
+    return watch_writable(conn, !conn.pending_writes.empty());
+}
+
+bool
+echo_server::watch_writable(connection& conn, bool blocked) noexcept
+{
+    if (blocked != conn.write_blocked) {
+        epoll_event event{};
+        event.events = blocked ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLET);
+        event.data.fd = conn.sockfd;
+        if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_MOD, conn.sockfd, &event); rv == -1) {
+            SPDLOG_ERROR("error: epoll_ctl (EPOLL_CTL_MOD): {} {}", std::strerror(errno), errno);
+            return false;
+        }
+        conn.write_blocked = blocked;
+        stats_.blocked_writes += blocked ? 1 : 0;
+        WS_PROBE(backpressure, conn.sockfd, blocked);
+    }
+    return true;
+}
+
+void
+echo_server::on_client_writable(connection& conn) noexcept
+{
+    if (!conn.write_blocked) {
+        return;
+    }
+
+    bool const sent = conn.file_fd != -1 && conn.pending_writes.empty()
+            ? send_static_file(conn)
+            : send_frame_nonblocking(conn, {}, {});
+    if (!sent) {
+        disconnect_and_cleanup_client(conn);
+        return;
+    }
+    if (conn.write_blocked) {
+        return; // still more than the socket will take
+    }
+
+    // the headers of a static file response are out, now the file
+    if (conn.file_fd != -1) {
+        if (!send_static_file(conn)) {
+            disconnect_and_cleanup_client(conn);
+            return;
+        }
+        if (conn.write_blocked) {
+            return;
+        }
+    }
+    if (finish_http_response(conn)) {
+        return;
+    }
+
+    // the send the handler was waiting for is out. let it carry on, then
+    // pick up the frames held back in the meantime
+    if (conn.handler != nullptr && conn.handler->waiting_for(HandlerWait::Writable)
+            && !resume_handler(conn)) {
+        disconnect_and_cleanup_client(conn);
+        return;
+    }
+    if (conn.handler == nullptr || conn.handler->accepts_message()) {
+        process_buffered_data(conn);
+    }
+}
+
+void
+echo_server::on_handler_timers() noexcept
+{
+    while (!handler_timers_.empty() && handler_timers_.front().deadline <= now_) {
+        std::pop_heap(handler_timers_.begin(), handler_timers_.end(), std::greater<>());
+        handler_timer const timer = handler_timers_.back();
+        handler_timers_.pop_back();
+
+        // the connection may be gone, its fd even reused by another one
+        auto itr = clients_.find(timer.sockfd);
+        if (itr == clients_.end() || itr->second.handler == nullptr
+                || !itr->second.handler->waiting_for_timer(timer.id)) {
+            continue;
+        }
+
+        connection& conn = itr->second;
+        if (!resume_handler(conn)) {
+            disconnect_and_cleanup_client(conn);
+        } else if (conn.handler->accepts_message()) {
+            process_buffered_data(conn);
+        }
+    }
+}
+
+std::uint64_t
+echo_server::add_handler_timer(int sockfd, std::chrono::steady_clock::duration delay)
+{
+    handler_timers_.push_back({clock::now() + delay, sockfd, ++next_timer_id_});
+    std::push_heap(handler_timers_.begin(), handler_timers_.end(), std::greater<>());
+    return next_timer_id_;
+}
+
+bool
+echo_server::start_handler(connection& conn)
+{
+    auto const itr = handlers_.try_emplace(conn.sockfd, *this, conn, handler_frames_).first;
+    conn.handler = &itr->second;
+    conn.handler->start(config_.handler(*conn.handler));
+    return resume_handler(conn);
+}
+
+bool
+echo_server::resume_handler(connection& conn)
+{
+    coro_connection& handler = *conn.handler;
+    handler.resume();
+    ++stats_.handler_resumes;
+    if (!handler.done() || conn.conn_state != ConnectionState::WebSocket) {
+        return true;
+    }
+
+    // the handler is finished with the connection
+    if (std::exception_ptr const ex = handler.exception()) {
+        try {
+            std::rethrow_exception(ex);
+        } catch (std::exception const& e) {
+            SPDLOG_ERROR("error: handler on fd {} threw: {}", conn.sockfd, e.what());
+        } catch (...) {
+            SPDLOG_ERROR("error: handler on fd {} threw", conn.sockfd);
+        }
+        return send_websocket_close(conn, CloseInternalError);
+    }
+    return send_websocket_close(conn, CloseNormal);
+}
+
+bool
+echo_server::deliver_to_handler(
+        connection& conn, std::vector<std::uint8_t>&& payload, OpCode op_code)
+{
+    // closing, or the handler has returned: nobody left to take it
+    if (conn.conn_state != ConnectionState::WebSocket || conn.handler->done()) {
+        return true;
+    }
+
+    conn.handler->deliver(message{op_code, std::move(payload)});
+    return !conn.handler->waiting_for(HandlerWait::Message) || resume_handler(conn);
+}
+
+bool
+echo_server::send_from_handler(
+        connection& conn, std::span<std::uint8_t const> payload, OpCode op_code)
+{
+    // rfc 6455 5.5.1: no data frames after we've sent a close frame
+    if (conn.conn_state != ConnectionState::WebSocket) {
+        return false;
+    }
+
+    std::uint8_t header[MaxFrameHeaderSize];
+    std::size_t const header_size = encode_frame_header(
+            header, op_code == OpCode::Text ? OpCode::Text : OpCode::Binary, payload.size());
+    std::span<std::uint8_t const> const header_bytes(header, header_size);
+
+    // small frames still join the end-of-pass flush when coalescing
+    if (config_.coalesce_writes && !conn.write_blocked
+            && conn.pending_writes.size() + header_size + payload.size()
+                    <= config_.coalesce_limit) {
+        return send_frame(conn, header_bytes, payload, /*urgent=*/false);
+    }
+    return send_frame_nonblocking(conn, header_bytes, payload);
+}
+
+bool
+echo_server::connect_backend(connection& conn) noexcept
+{
+    // backend bytes are spliced to the client, so the kernel has to do the
+    // client's encryption
+    if (conn.tls != nullptr) {
+        SPDLOG_ERROR("can't proxy tls connection on fd {}: needs kTLS both ways", conn.sockfd);
         return false;
     }
 
-    if (nbytes != static_cast<ssize_t>(gen.size())) {
-        SPDLOG_ERROR("partial send: sent {} bytes, expected {} bytes", nbytes, gen.size());
+    // backends are local services that answer a connect right away, so
+    // keep it simple and block
+    int const sock = connect_socket(*backend_);
+    if (sock == -1) {
+        SPDLOG_ERROR("error: connect (backend {}): {} {}", config_.backend, std::strerror(errno),
+                errno);
         return false;
     }
 
-    SPDLOG_DEBUG("successfully sent {} bytes to socket {}", nbytes, conn.sockfd);
+    // the backend is read until EAGAIN (edge-triggered) and written as far
+    // as it will take; writes to the client stay blocking like every send
+    if (int rv = ::fcntl(sock, F_SETFL, O_NONBLOCK); rv == -1) {
+        SPDLOG_ERROR("error: fcntl (O_NONBLOCK): {} {}", std::strerror(errno), errno);
+        ::close(sock);
+        return false;
+    }
+
+    // spliced chunks go out as soon as they arrive; nagle would hold back
+    // their tails waiting for an ack
+    int const yes = 1;
+    if (backend_->family() != AF_UNIX) {
+        ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+    ::setsockopt(conn.sockfd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+    epoll_event event{};
+    event.events = (EPOLLIN | EPOLLOUT | EPOLLET);
+    event.data.u64 = BackendTag | static_cast<std::uint32_t>(conn.sockfd);
+    if (int rv = ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, sock, &event); rv == -1) {
+        SPDLOG_ERROR("error: epoll_ctl (EPOLL_CTL_ADD): {} {}", std::strerror(errno), errno);
+        ::close(sock);
+        return false;
+    }
+
+    conn.backend_fd = sock;
+    ++stats_.backend_connections;
+    SPDLOG_INFO("client on fd {} paired with backend fd {}", conn.sockfd, sock);
+    return true;
+}
+
+void
+echo_server::close_backend(connection& conn) noexcept
+{
+    ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, conn.backend_fd, nullptr);
+    ::close(conn.backend_fd);
+    conn.backend_fd = -1;
+    conn.backend_backlog.clear();
+}
+
+void
+echo_server::on_backend_event(int client_fd, std::uint32_t events) noexcept
+{
+    auto itr = clients_.find(client_fd);
+    if (itr == clients_.end() || itr->second.backend_fd == -1) {
+        return; // closed earlier in this pass
+    }
+    connection& conn = itr->second;
+
+    if ((events & EPOLLOUT) != 0 && !conn.backend_backlog.empty()) {
+        if (!flush_backend_backlog(conn)) {
+            SPDLOG_ERROR("error: send (backend): {} {}", std::strerror(errno), errno);
+            close_backend(conn);
+            send_websocket_close(conn, CloseBadGateway);
+            return;
+        }
+
+        // pick up the client frames held back while the backend was full
+        if (conn.backend_backlog.empty()) {
+            process_buffered_data(conn);
+            itr = clients_.find(client_fd);
+            if (itr == clients_.end() || itr->second.backend_fd == -1) {
+                return;
+            }
+        }
+    }
+
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) {
+        on_backend_data(conn);
+    }
+}
+
+bool
+echo_server::on_backend_data(connection& conn) noexcept
+{
+    // edge-triggered: keep going until the backend runs dry
+    for (;;) {
+        ssize_t const nbytes = splice_pipe_->fill(conn.backend_fd);
+        if (nbytes == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            SPDLOG_ERROR("error: splice (backend): {} {}", std::strerror(errno), errno);
+            close_backend(conn);
+            return conn.conn_state != ConnectionState::WebSocket
+                    || send_websocket_close(conn, CloseBadGateway);
+        }
+
+        if (nbytes == 0) {
+            SPDLOG_INFO("backend of client on fd {} closed the connection", conn.sockfd);
+            close_backend(conn);
+            return conn.conn_state != ConnectionState::WebSocket
+                    || send_websocket_close(conn, CloseNormal);
+        }
+
+        if (!send_spliced(conn, static_cast<std::size_t>(nbytes))) {
+            disconnect_and_cleanup_client(conn);
+            return false;
+        }
+    }
+}
+
+bool
+echo_server::send_spliced(connection& conn, std::size_t nbytes) noexcept
+{
+    // rfc 6455 5.5.1: no data frames after we've sent a close frame
+    if (conn.conn_state != ConnectionState::WebSocket) {
+        splice_pipe_->clear();
+        return true;
+    }
+
+    // frames queued earlier in this pass go first
+    if (!flush_writes(conn)) {
+        splice_pipe_->clear();
+        return false;
+    }
+
+    // each chunk read from the backend becomes one binary message. only
+    // the header is written from user space; the payload moves from the
+    // backend's socket to the client's through the pipe
+    std::uint8_t header[MaxFrameHeaderSize];
+    std::size_t const header_size = encode_frame_header(header, OpCode::Binary, nbytes);
+    ssize_t const sent = ::send(conn.sockfd, header, header_size, MSG_NOSIGNAL | MSG_MORE);
+    stats_.write_syscalls += 2;
+    if (sent != static_cast<ssize_t>(header_size) || !splice_pipe_->drain(conn.sockfd)) {
+        SPDLOG_ERROR("error: send (spliced frame): {} {}", std::strerror(errno), errno);
+        splice_pipe_->clear();
+        return false;
+    }
+
+    stats_.bytes_spliced += nbytes;
+    return true;
+}
+
+bool
+echo_server::forward_to_backend(connection& conn, std::span<std::uint8_t const> payload)
+{
+    // the backend is gone; the client has been sent a close frame
+    if (conn.backend_fd == -1 || payload.empty()) {
+        return true;
+    }
+
+    // client payloads arrive masked and are unmasked in user space, so
+    // unlike the other direction they can't be spliced
+    if (conn.backend_backlog.empty()) {
+        ssize_t const nbytes
+                = ::send(conn.backend_fd, payload.data(), payload.size(), MSG_NOSIGNAL);
+        if (nbytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            SPDLOG_ERROR("error: send (backend): {} {}", std::strerror(errno), errno);
+            close_backend(conn);
+            return send_websocket_close(conn, CloseBadGateway);
+        }
+        if (nbytes > 0) {
+            stats_.bytes_to_backend += static_cast<std::uint64_t>(nbytes);
+            payload = payload.subspan(static_cast<std::size_t>(nbytes));
+        }
+    }
+
+    // whatever the backend couldn't take waits for it to become writable
+    conn.backend_backlog.insert(conn.backend_backlog.end(), payload.begin(), payload.end());
+    return true;
+}
+
+bool
+echo_server::flush_backend_backlog(connection& conn) noexcept
+{
+    ssize_t const nbytes = ::send(conn.backend_fd, conn.backend_backlog.data(),
+            conn.backend_backlog.size(), MSG_NOSIGNAL);
+    if (nbytes == -1) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
 
+    stats_.bytes_to_backend += static_cast<std::uint64_t>(nbytes);
+    conn.backend_backlog.erase(conn.backend_backlog.begin(), conn.backend_backlog.begin() + nbytes);
     return true;
 }
 
@@ -1,8 +1,26 @@
 #pragma once
 
+#include "coro_connection.hpp"
+#include "server_config.hpp"
+#include "server_stats.hpp"
+#include "util/capture_log.hpp"
+#include "util/frame_pool.hpp"
+#include "util/loop_arena.hpp"
+#include "util/mpsc_queue.hpp"
+#include "util/serial_executor.hpp"
+#include "util/socket_address.hpp"
+#include "util/splice_pipe.hpp"
 #include "ws/connection.hpp"
+#include <sys/socket.h> // sockaddr_storage
+#include <sys/types.h>  // ino_t
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -11,7 +29,25 @@ namespace ws {
 class echo_server
 {
 public:
-    echo_server(int port);
+    /// string hash that also takes string_views, for heterogeneous lookup
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        std::size_t
+        operator()(std::string_view s) const noexcept
+        {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    /// Header fields of an http request, by lower case name, allocated
+    /// from the event loop's arena
+    using header_map = std::pmr::unordered_map<std::pmr::string, std::pmr::string, string_hash,
+            std::equal_to<>>;
+
+public:
+    explicit echo_server(server_config const& config);
     ~echo_server() noexcept;
 
     // no copies/moves
@@ -20,32 +56,162 @@ public:
     echo_server& operator=(echo_server const&) = delete;
     echo_server&& operator=(echo_server&&) = delete;
 
-    /// Start the server and begin listening on socket.
+    /// Start the server and begin listening on socket. Returns once a
+    /// graceful shutdown has drained all connections.
     /// \return \c false on error
     bool run();
 
+    /// Ask the event loop to stop accepting and drain its connections. A
+    /// second request skips straight to the drain deadline. Safe to call
+    /// from any thread and from a signal handler.
+    void request_shutdown() noexcept;
+
+    /// Event loop counters (throttling, admission, ...)
+    server_stats const& stats() const noexcept;
+
+    /// Per-stage message latency of the connections with kernel
+    /// timestamps (server_config::timestamping)
+    message_latency const& latency() const noexcept;
+
+    /// Send \c payload as one message on connection \c id (as passed to
+    /// server_config::on_open). Safe to call from any thread; the event
+    /// loop carries it out on its next pass, in posting order. Messages for
+    /// a connection that is gone by then are dropped, as are empty ones.
+    /// \return \c false if the command queue is full
+    bool post_send(std::uint64_t id, std::vector<std::uint8_t> payload,
+            OpCode op_code = OpCode::Binary) noexcept;
+
+    /// Close connection \c id with \c code. Safe to call from any thread.
+    /// \return \c false if the command queue is full
+    bool post_close(std::uint64_t id, std::uint16_t code = 1000) noexcept;
+
+    /// Index of the reactor (see server_config::reactor_index) that owns
+    /// connection \c id
+    static std::size_t reactor_of(std::uint64_t id) noexcept;
+
 private:
+    // the awaitables send and set timers for their handler
+    friend class coro_connection;
+
+    /// A send or close posted by another thread
+    struct posted_command
+    {
+        std::uint64_t id = 0;              ///< target connection
+        OpCode op_code = OpCode::Binary;   ///< text, binary or close
+        std::uint16_t close_code = 0;      ///< status code of a close
+        std::vector<std::uint8_t> payload; ///< message to send
+        bool reply = false;                ///< a worker's reply to an offloaded message
+    };
+
+    /// A message on its way through the worker pool
+    struct offload_job
+    {
+        std::uint64_t id = 0; ///< connection it came from
+        message msg;          ///< the message, then the reply
+    };
+    using offload_executor = serial_executor<offload_job>;
+
+    /// A listening unix domain socket, see server_config::unix_listeners
+    struct unix_listener
+    {
+        int fd = -1;            ///< listening socket
+        socket_address address; ///< bound address
+        ino_t inode = 0;        ///< of the socket file we created, 0 if abstract
+    };
+
     /// Called on new connection
+    /// \param listen_fd the tcp listener or one of the unix ones
     /// \return \c false on error
-    bool on_incoming_connection() noexcept;
+    bool on_incoming_connection(int listen_fd) noexcept;
+
+    /// Called when a client socket is ready for the next step of its tls
+    /// handshake; once it's done, carries on with the data behind it
+    /// \return \c false on error
+    bool on_tls_handshake(connection&) noexcept;
 
     /// Called on incoming data
+    /// \param recv_flags extra flags for ::recv (e.g. MSG_DONTWAIT)
     /// \return \c false on error
-    bool on_incoming_data(connection&) noexcept;
+    bool on_incoming_data(connection&, int recv_flags = 0) noexcept;
+
+    /// Called once per event loop pass for connections that were cut
+    /// short by the per-pass frame budget or left data in the socket.
+    void on_deferred_connections() noexcept;
+
+    /// Called once per event loop pass: throttled connections whose
+    /// limiters have refilled are deferred to this pass
+    void on_throttled_connections() noexcept;
+
+    /// Called once per event loop pass to write out the frames every
+    /// connection queued during the pass (write coalescing)
+    void flush_pending_writes() noexcept;
+
+    /// Called when SIGINT/SIGTERM arrive on the signalfd
+    void on_signal() noexcept;
+
+    /// Called when another thread wrote to the wakeup eventfd
+    void on_wakeup() noexcept;
+
+    /// Called once per event loop pass to carry out the send/close
+    /// commands other threads posted
+    void on_posted_commands() noexcept;
+
+    /// Called when a new instance connects to the handoff socket; sends it
+    /// our listening socket and starts draining
+    void on_handoff_request() noexcept;
+
+    /// Called when a client socket reports an error; reads MSG_ZEROCOPY
+    /// completions and lets the connection reuse the buffers they release,
+    /// or the transmit timestamps of a timestamped connection
+    /// \return \c false if the socket has a real error
+    bool on_socket_error(connection&) noexcept;
+
+    /// Matches the transmit timestamps on the error queue of \c conn to
+    /// the replies waiting for them
+    /// \return \c false if the socket has a real error
+    bool on_tx_timestamps(connection& conn) noexcept;
+
+    /// Called when a client socket blocked by a coroutine handler's send
+    /// is writable again
+    void on_client_writable(connection&) noexcept;
+
+    /// Called once per event loop pass to wake the handlers whose
+    /// sleep_for() is up
+    void on_handler_timers() noexcept;
+
+    /// Called when the backend paired with a client is readable or writable
+    void on_backend_event(int client_fd, std::uint32_t events) noexcept;
+
+    /// Called when the backend paired with \c conn has data; splices it to
+    /// the client until the backend runs dry
+    /// \return \c false on error
+    bool on_backend_data(connection& conn) noexcept;
+
+    /// Stop accepting and schedule close frames for every connection
+    void begin_drain() noexcept;
+
+    /// Called once per event loop pass while draining
+    /// \return \c true once every connection is gone (or the deadline passed)
+    bool on_drain_tick() noexcept;
 
     /// Called on http request
-    bool on_http_request(connection&) const noexcept;
+    bool on_http_request(connection&) noexcept;
+
+    /// Called on an http request that isn't a websocket upgrade: health
+    /// checks and static files
+    /// \return \c false on error
+    bool on_plain_http_request(connection&, std::string_view method, std::string_view target,
+            header_map const& header_fields) noexcept;
 
     /// Called when a websocket upgrade request detected
-    bool on_websocket_upgrade_request(
-            connection&, std::unordered_map<std::string, std::string> const& header_fields) const;
+    bool on_websocket_upgrade_request(connection&, header_map const& header_fields);
 
     /// Called when receiving from a websocket that is already connected
     /// \return \c false on error
     bool on_websocket_frame(connection&);
 
     /// Called when receiving a text/binary/continuation frame
-    bool on_websocket_data_frame(connection&, frame const&);
+    bool on_websocket_data_frame(connection&, frame&);
 
     /// Called when a ping control frame received
     bool on_websocket_ping(connection&, std::span<std::uint8_t const> payload);
@@ -62,27 +228,153 @@ private:
     /// Called when a text frame received
     bool on_websocket_binary_frame(connection&, std::span<std::uint8_t const> payload);
 
+    /// Called with a complete binary message on a connection that agreed
+    /// to the batching subprotocol: unpacks it, answers it and sends the
+    /// replies back as one batch
+    /// \return \c false on error
+    bool on_websocket_batch(connection&, std::span<std::uint8_t const> payload);
+
 private:
     bool validate_request_method_uri_and_version(std::string const&) const noexcept;
-    bool validate_header_fields(
-            std::unordered_map<std::string, std::string> const& header_fields) const noexcept;
-    std::string generate_accept_key(std::string const&) const noexcept;
-    bool send_websocket_accept(connection&, std::string const& sec_websocket_key) const noexcept;
-    bool send_websocket_close(connection&);
+    bool validate_header_fields(header_map const& header_fields) const noexcept;
+    std::pmr::string generate_accept_key(std::string_view) const noexcept;
+    bool send_websocket_accept(connection&, std::string_view sec_websocket_key,
+            std::string_view protocol = {}) const noexcept;
+
+    /// Send a complete http response; what the socket doesn't take waits
+    /// for EPOLLOUT. While draining it gets a \c Connection: \c close header
+    /// \param head_only send the headers only (HEAD request)
+    /// \return \c false on error
+    bool send_http_response(
+            connection&, std::string_view response, bool head_only = false) noexcept;
+
+    /// Close \c conn if it's a plain http connection marked to close after
+    /// its response and nothing of that response is left to send
+    /// \return \c true if \c conn is gone
+    bool finish_http_response(connection& conn) noexcept;
+
+    /// Answer a request we won't serve with \c response, then close our
+    /// side of the connection
+    void reject_http_request(connection&, std::string_view response) noexcept;
+
+    /// Send the rest of the static file \c conn is in the middle of,
+    /// until it's out or the socket is full
+    /// \return \c false on error
+    bool send_static_file(connection& conn) noexcept;
+    bool send_websocket_close(connection&, std::uint16_t code);
+
+    /// ::recv() from the client, decrypted in user space if it is tls the
+    /// kernel doesn't decrypt
+    ssize_t recv_from_client(connection&, void* buf, std::size_t len, int flags) noexcept;
+
+    /// ::sendmsg() to the client, encrypted in user space if it is tls the
+    /// kernel doesn't encrypt. Such sockets are non-blocking; without
+    /// MSG_DONTWAIT in \c flags this waits until all of \c msg is out.
+    ssize_t send_to_client(connection&, msghdr const& msg, int flags) const noexcept;
+    bool post(posted_command&& command) noexcept;
+    bool process_message(connection&, std::vector<std::uint8_t>&& payload, OpCode);
+    void run_offloaded(offload_job& job) noexcept;
+    void run_posted_command(posted_command& command);
+    std::uint64_t make_connection_id(int sockfd) noexcept;
     bool disconnect_and_cleanup_client(connection&);
-    bool process_single_frame_message(connection&, frame const&);
+    bool process_single_frame_message(connection&, frame&);
     bool process_complete_fragmented_message(connection&, frame const&);
-    bool send_echo(connection&, std::span<std::uint8_t const> payload, OpCode);
-
+    void capture_message(connection const&, OpCode, std::span<std::uint8_t const> payload);
+    void time_message(connection&);
+    bool send_echo(connection&, std::vector<std::uint8_t>& payload, OpCode);
+    bool send_echo(connection&, std::span<std::uint8_t const> payload, OpCode,
+            std::vector<std::uint8_t>* owner = nullptr);
+    bool send_frame(connection&, std::span<std::uint8_t const> header,
+            std::span<std::uint8_t const> payload, bool urgent);
+    bool flush_writes(connection&);
+    bool send_zerocopy(connection&, std::span<std::uint8_t const> header,
+            std::vector<std::uint8_t>&& payload);
+    bool send_frame_nonblocking(connection&, std::span<std::uint8_t const> header,
+            std::span<std::uint8_t const> payload) noexcept;
+    bool watch_writable(connection&, bool blocked) noexcept;
+    bool start_handler(connection&);
+    bool resume_handler(connection&);
+    bool deliver_to_handler(connection&, std::vector<std::uint8_t>&& payload, OpCode);
+    bool send_from_handler(connection&, std::span<std::uint8_t const> payload, OpCode);
+    std::uint64_t add_handler_timer(int sockfd, std::chrono::steady_clock::duration delay);
+    bool connect_backend(connection&) noexcept;
+    void close_backend(connection&) noexcept;
+    bool forward_to_backend(connection&, std::span<std::uint8_t const> payload);
+    bool flush_backend_backlog(connection&) noexcept;
+    bool send_spliced(connection&, std::size_t nbytes) noexcept;
+    bool process_buffered_data(connection&);
+    bool admit_frame(connection&, frame const&) noexcept;
+    void defer(connection&);
+    void throttle(connection&, frame const&);
+    bool refuse_with_spare_fd(int listen_fd) noexcept;
+    bool add_client(int sock, sockaddr_storage const& their_addr) noexcept;
+    bool is_unix_listener(int fd) const noexcept;
+    void close_unix_listeners() noexcept;
 
 private:
-    static constexpr std::uint16_t ListenPort = 8000; ///< default listening port
+    using clock = std::chrono::steady_clock;
 
-private:
-    int port_ = ListenPort;                       ///< port to listen on
+    server_config config_;                        ///< runtime tunables
+    server_stats stats_;                          ///< event loop counters
+    message_latency latency_;                     ///< per-stage latency, timestamped conns
     int sockfd_ = -1;                             ///< listening socket
     int epollfd_ = -1;                            ///< epoll file descriptor
+    int spare_fd_ = -1;                           ///< reserved fd for refusing under EMFILE
+    int signal_fd_ = -1;                          ///< signalfd for SIGINT/SIGTERM
+    int wakeup_fd_ = -1;                          ///< eventfd other threads use to poke us
+    int handoff_fd_ = -1;                         ///< unix socket successors connect to
+    std::vector<unix_listener> unix_listeners_;   ///< bound config_.unix_listeners
     std::unordered_map<int, connection> clients_; ///< list of clients, keyed by socket fd
+    std::vector<int> deferred_;                   ///< fds to revisit on the next pass
+    std::vector<int> deferred_scratch_;           ///< swap space for deferred_
+    std::vector<int> throttled_;                  ///< fds waiting for their rate limits
+    clock::time_point throttle_wakeup_;           ///< earliest throttled_until of those
+    std::vector<int> flush_queue_;                ///< fds with frames queued this pass
+    clock::time_point now_ = clock::now();        ///< cached time of the current pass
+    mutable loop_arena loop_arena_;               ///< temporaries of the current pass
+
+    // reverse proxy
+    std::optional<socket_address> backend_;       ///< resolved config_.backend
+    std::optional<splice_pipe> splice_pipe_;      ///< moves backend bytes to clients
+
+    // coroutine handlers
+    struct handler_timer
+    {
+        clock::time_point deadline; ///< when the handler is due
+        int sockfd;                 ///< connection whose handler sleeps
+        std::uint64_t id;           ///< matches coro_connection::waiting_for_timer()
+
+        bool
+        operator>(handler_timer const& other) const noexcept
+        {
+            return deadline > other.deadline;
+        }
+    };
+    frame_pool handler_frames_;                          ///< handler coroutine frames
+    std::unordered_map<int, coro_connection> handlers_; ///< keyed by socket fd
+    std::vector<handler_timer> handler_timers_;          ///< min-heap on deadline
+    std::uint64_t next_timer_id_ = 0;                    ///< last id handed out
+
+    // cross-thread sends
+    mpsc_queue<posted_command> commands_;       ///< posted by other threads
+    std::atomic<bool> commands_pending_{false}; ///< wakeup eventfd was poked for commands_
+    std::uint32_t next_connection_serial_ = 0;  ///< last serial put in a connection id
+
+    // worker offload
+    std::unordered_map<std::uint64_t, std::unique_ptr<offload_executor>> executors_; ///< by id
+    std::vector<std::unique_ptr<offload_executor>> retired_executors_; ///< jobs still at workers
+
+    // traffic capture
+    std::unique_ptr<capture_writer> capture_;     ///< nullptr when not capturing
+
+    // graceful shutdown
+    std::atomic<int> shutdown_requests_{0};       ///< bumped by request_shutdown()
+    bool draining_ = false;                       ///< no longer accepting, closing clients
+    clock::time_point drain_start_{};             ///< when the drain began
+    clock::time_point drain_deadline_{};          ///< give up waiting for close acks
+    std::vector<int> drain_queue_;                ///< fds to close, idlest first
+    std::size_t drain_next_ = 0;                  ///< next entry of drain_queue_ to close
+    std::vector<int> drain_http_;                 ///< plain http connections to close when idle
 };
 
 } // namespace ws
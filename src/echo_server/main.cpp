@@ -1,6 +1,105 @@
+#include "coro_connection.hpp"
 #include "echo_server.hpp"
+#include "reactor_pool.hpp"
+#include "util/buffer_arena.hpp"
+#include <getopt.h>
 #include <spdlog/spdlog.h>
-#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <chrono>
+#include <csignal> // ::pthread_sigmask, SIGINT, SIGTERM
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS, std::atoi, std::strtod
+#include <print>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void
+print_usage(char const* prog)
+{
+    std::print(stderr,
+            "usage: {} [options] [port]\n"
+            "  -p, --port=PORT              port to listen on (default 8000)\n"
+            "  -c, --max-connections=N      refuse clients beyond N (default unlimited)\n"
+            "  -m, --max-msgs-per-sec=N     per-connection frame rate limit\n"
+            "  -b, --max-bytes-per-sec=N    per-connection byte rate limit\n"
+            "  -B, --burst-secs=SECS        rate limiter burst in seconds of rate, >0 (default 1)\n"
+            "  -f, --frame-budget=N         frames per connection per loop pass (default 64)\n"
+            "  -w, --drain-window-ms=MS     spread shutdown close frames over MS (default 5000)\n"
+            "  -t, --drain-timeout-ms=MS    drop unacknowledged clients after MS (default 10000)\n"
+            "  -H, --handoff=PATH           take over / hand off the listening socket via PATH\n"
+            "  -r, --reactors=N             event loop threads, 0 = one per cpu (default 1)\n"
+            "  -P, --pin                    pin reactors to cpus, NUMA-local memory\n"
+            "  -s, --steering=MODE          none, incoming-cpu or cbpf (default none)\n"
+            "  -l, --poll=MODE              block, spin or hybrid (default block)\n"
+            "  -S, --spin-us=US             hybrid: spin US after the last event (default 100)\n"
+            "  -u, --busy-poll-us=US        SO_BUSY_POLL / epoll busy-poll time (default off)\n"
+            "  -U, --busy-poll-budget=N     packets per busy-poll attempt (default kernel)\n"
+            "  -A, --prefer-busy-poll       SO_PREFER_BUSY_POLL\n"
+            "  -z, --zerocopy=BYTES         MSG_ZEROCOPY echoes of at least BYTES (default off)\n"
+            "  -C, --coalesce               write each connection's echoes once per loop pass\n"
+            "  -x, --backend=ADDR           proxy to host:port or unix:PATH instead of echoing\n"
+            "  -T, --socket=SPEC            socket profile, comma separated: latency,\n"
+            "                               throughput, nodelay, lowat=B, rcvbuf=B, sndbuf=B,\n"
+            "                               fastopen=N, defer=SECS (later items override)\n"
+            "  -k, --coroutines             echo from a coroutine handler instead of callbacks\n"
+            "  -W, --workers=N              echo from a pool of N work-stealing worker threads\n"
+            "  -R, --capture=PATH           append client messages to the capture log PATH\n"
+            "  -M, --capture-max=BYTES      stop capturing past BYTES (default 1 GiB)\n"
+            "  -G, --huge-pages=MODE        connection buffers from huge pages: off (default),\n"
+            "                               thp or hugetlb\n"
+            "  -d, --static=DIR             serve the files under DIR to plain http requests\n"
+            "  -L, --unix=ADDR              also listen on unix:PATH or unix:@NAME (abstract);\n"
+            "                               repeatable\n"
+            "  -e, --tls-cert=FILE          wss://: TLS on the tcp port with this PEM certificate\n"
+            "  -K, --tls-key=FILE           PEM private key of --tls-cert\n"
+            "  -N, --no-ktls                keep TLS in user space, don't hand keys to the kernel\n"
+            "  -a, --batching               agree to the batch.v1 subprotocol: many messages per\n"
+            "                               binary frame, echoed as one batch\n"
+            "  -I, --timestamping           kernel rx/tx timestamps, per-stage message latency\n"
+            "  -h, --help                   show this message\n",
+            prog);
+}
+
+/// Parse a --socket spec such as "latency,sndbuf=262144" into \c options
+/// \return \c false on an unknown item
+bool
+parse_socket_options(std::string_view spec, ws::socket_options& options)
+{
+    while (!spec.empty()) {
+        std::size_t const comma = spec.find(',');
+        std::string_view const item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+
+        std::size_t const equals = item.find('=');
+        std::string_view const key = item.substr(0, equals);
+        int const value = equals == std::string_view::npos
+                ? 0
+                : std::atoi(std::string(item.substr(equals + 1)).c_str());
+
+        if (key == "latency") {
+            options = ws::socket_options::latency();
+        } else if (key == "throughput") {
+            options = ws::socket_options::throughput();
+        } else if (key == "nodelay") {
+            options.nodelay = true;
+        } else if (key == "lowat") {
+            options.notsent_lowat = value;
+        } else if (key == "rcvbuf") {
+            options.recv_buffer = value;
+        } else if (key == "sndbuf") {
+            options.send_buffer = value;
+        } else if (key == "fastopen") {
+            options.fastopen_queue = value;
+        } else if (key == "defer") {
+            options.defer_accept_secs = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
 
 int
 main(int argc, char* argv[])
@@ -10,16 +109,242 @@ main(int argc, char* argv[])
     // [2025-07-17 11:10:13.674784] [info] [main.cpp:14] message
     spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%^%l%$] [%s:%#] %v");
 
-    int port = 8000;
-    if (argc == 2) {
-        port = std::atoi(argv[1]);
+    ws::server_config config;
+
+    static option const long_options[] = {
+            {"port", required_argument, nullptr, 'p'},
+            {"max-connections", required_argument, nullptr, 'c'},
+            {"max-msgs-per-sec", required_argument, nullptr, 'm'},
+            {"max-bytes-per-sec", required_argument, nullptr, 'b'},
+            {"burst-secs", required_argument, nullptr, 'B'},
+            {"frame-budget", required_argument, nullptr, 'f'},
+            {"drain-window-ms", required_argument, nullptr, 'w'},
+            {"drain-timeout-ms", required_argument, nullptr, 't'},
+            {"handoff", required_argument, nullptr, 'H'},
+            {"reactors", required_argument, nullptr, 'r'},
+            {"pin", no_argument, nullptr, 'P'},
+            {"steering", required_argument, nullptr, 's'},
+            {"poll", required_argument, nullptr, 'l'},
+            {"spin-us", required_argument, nullptr, 'S'},
+            {"busy-poll-us", required_argument, nullptr, 'u'},
+            {"busy-poll-budget", required_argument, nullptr, 'U'},
+            {"prefer-busy-poll", no_argument, nullptr, 'A'},
+            {"zerocopy", required_argument, nullptr, 'z'},
+            {"coalesce", no_argument, nullptr, 'C'},
+            {"backend", required_argument, nullptr, 'x'},
+            {"socket", required_argument, nullptr, 'T'},
+            {"coroutines", no_argument, nullptr, 'k'},
+            {"workers", required_argument, nullptr, 'W'},
+            {"capture", required_argument, nullptr, 'R'},
+            {"capture-max", required_argument, nullptr, 'M'},
+            {"huge-pages", required_argument, nullptr, 'G'},
+            {"static", required_argument, nullptr, 'd'},
+            {"unix", required_argument, nullptr, 'L'},
+            {"tls-cert", required_argument, nullptr, 'e'},
+            {"tls-key", required_argument, nullptr, 'K'},
+            {"no-ktls", no_argument, nullptr, 'N'},
+            {"batching", no_argument, nullptr, 'a'},
+            {"timestamping", no_argument, nullptr, 'I'},
+            {"help", no_argument, nullptr, 'h'},
+            {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    char const* const short_options
+            = "p:c:m:b:B:f:w:t:H:r:Ps:l:S:u:U:Az:Cx:T:kW:R:M:G:d:L:e:K:NaIh";
+    while ((opt = ::getopt_long(argc, argv, short_options, long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'p':
+                config.port = std::atoi(optarg);
+                break;
+            case 'c':
+                config.max_connections = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'm':
+                config.max_messages_per_sec = std::strtod(optarg, nullptr);
+                break;
+            case 'b':
+                config.max_bytes_per_sec = std::strtod(optarg, nullptr);
+                break;
+            case 'B':
+                config.rate_burst_secs = std::strtod(optarg, nullptr);
+                if (!(config.rate_burst_secs > 0.0)) {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'f':
+                config.max_frames_per_iteration = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'w':
+                config.drain_window = std::chrono::milliseconds(std::strtol(optarg, nullptr, 10));
+                break;
+            case 't':
+                config.drain_timeout = std::chrono::milliseconds(std::strtol(optarg, nullptr, 10));
+                break;
+            case 'H':
+                config.handoff_path = optarg;
+                break;
+            case 'r':
+                config.reactors = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'P':
+                config.pin_reactors = true;
+                break;
+            case 's':
+                if (std::string_view(optarg) == "none") {
+                    config.steering = ws::Steering::None;
+                } else if (std::string_view(optarg) == "incoming-cpu") {
+                    config.steering = ws::Steering::IncomingCpu;
+                } else if (std::string_view(optarg) == "cbpf") {
+                    config.steering = ws::Steering::Cbpf;
+                } else {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'l':
+                if (std::string_view(optarg) == "block") {
+                    config.poll_mode = ws::PollMode::Block;
+                } else if (std::string_view(optarg) == "spin") {
+                    config.poll_mode = ws::PollMode::Spin;
+                } else if (std::string_view(optarg) == "hybrid") {
+                    config.poll_mode = ws::PollMode::Hybrid;
+                } else {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'S':
+                config.spin_window = std::chrono::microseconds(std::strtol(optarg, nullptr, 10));
+                break;
+            case 'u':
+                config.busy_poll_usecs = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10));
+                break;
+            case 'U':
+                config.busy_poll_budget = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10));
+                break;
+            case 'A':
+                config.prefer_busy_poll = true;
+                break;
+            case 'z':
+                config.zerocopy_threshold = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'C':
+                config.coalesce_writes = true;
+                break;
+            case 'x':
+                config.backend = optarg;
+                break;
+            case 'T':
+                if (!parse_socket_options(optarg, config.sockets)) {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'k':
+                config.handler = ws::echo_handler;
+                break;
+            case 'W':
+                // the reply is the message itself
+                config.processor = [](ws::message&) {};
+                config.worker_threads = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'R':
+                config.capture_path = optarg;
+                break;
+            case 'M':
+                config.capture_max_bytes = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'G':
+                if (std::string_view(optarg) == "off") {
+                    ws::buffer_arena::instance().set_backing(ws::ArenaBacking::Heap);
+                } else if (std::string_view(optarg) == "thp") {
+                    ws::buffer_arena::instance().set_backing(ws::ArenaBacking::HugePages);
+                } else if (std::string_view(optarg) == "hugetlb") {
+                    ws::buffer_arena::instance().set_backing(ws::ArenaBacking::HugeTlb);
+                } else {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'd':
+                config.static_root = optarg;
+                break;
+            case 'L':
+                config.unix_listeners.emplace_back(optarg);
+                break;
+            case 'e':
+                config.tls_certificate = optarg;
+                break;
+            case 'K':
+                config.tls_private_key = optarg;
+                break;
+            case 'N':
+                config.ktls = false;
+                break;
+            case 'a':
+                config.batching = true;
+                break;
+            case 'I':
+                config.timestamping = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    // backwards compatible positional port
+    if (optind < argc) {
+        config.port = std::atoi(argv[optind]);
     }
 
+    // SIGINT/SIGTERM are consumed by the server's signalfd, which only
+    // works if nobody else gets them first
+    sigset_t mask;
+    ::sigemptyset(&mask);
+    ::sigaddset(&mask, SIGINT);
+    ::sigaddset(&mask, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
     try {
-        ws::echo_server server(port);
-        if (!server.run()) {
-            SPDLOG_CRITICAL("error: server shutdown with an error");
-            return EXIT_FAILURE;
+        if (config.reactors == 1) {
+            ws::echo_server server(config);
+            if (!server.run()) {
+                SPDLOG_CRITICAL("error: server shutdown with an error");
+                SPDLOG_INFO("{}", server.stats());
+                return EXIT_FAILURE;
+            }
+            SPDLOG_INFO("{}", server.stats());
+            if (config.timestamping) {
+                SPDLOG_INFO("{}", server.latency());
+            }
+        } else {
+            ws::reactor_pool pool(config);
+            bool const ok = pool.run();
+            auto const stats = pool.stats();
+            for (std::size_t i = 0; i < stats.size(); ++i) {
+                SPDLOG_INFO("reactor {}: {}", i, stats[i]);
+            }
+            if (config.timestamping) {
+                SPDLOG_INFO("{}", pool.latency());
+            }
+            if (!ok) {
+                SPDLOG_CRITICAL("error: server shutdown with an error");
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (ws::buffer_arena::instance().backing() != ws::ArenaBacking::Heap) {
+            auto const arena = ws::buffer_arena::instance().stats();
+            SPDLOG_INFO("buffer arena: regions={} (hugetlb={}), reserved_bytes={}, "
+                        "heap_fallbacks={}",
+                    arena.regions, arena.hugetlb_regions, arena.reserved_bytes,
+                    arena.heap_fallbacks);
         }
     } catch (std::exception const& e) {
         SPDLOG_CRITICAL("error: exception: {}", e.what());
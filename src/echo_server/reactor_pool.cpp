@@ -0,0 +1,289 @@
+#include "reactor_pool.hpp"
+#include "util/static_content.hpp"
+#include "util/tls.hpp"
+#include "util/worker_pool.hpp"
+#include <linux/mempolicy.h> // MPOL_LOCAL
+#include <pthread.h>         // ::pthread_setaffinity_np
+#include <sched.h>           // ::sched_getaffinity, CPU_SET
+#include <spdlog/spdlog.h>
+#include <sys/syscall.h> // SYS_set_mempolicy
+#include <unistd.h>      // ::syscall
+#include <csignal> // ::sigtimedwait, SIGINT, SIGTERM
+#include <cstring> // std::strerror
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility> // std::move
+
+
+namespace ws {
+
+namespace {
+    /// how often run() checks whether the reactors have finished
+    static constexpr long PollIntervalNsecs = 100'000'000;
+
+    /// connection ids have 8 bits for the reactor index
+    static constexpr std::size_t MaxReactors = 256;
+
+    /// Pin the calling thread to \c cpu
+    /// \return \c false on error
+    bool
+    pin_current_thread(int cpu) noexcept
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<std::size_t>(cpu), &set);
+        if (int rv = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set); rv != 0) {
+            SPDLOG_CRITICAL("error: pthread_setaffinity_np: {} {}", std::strerror(rv), rv);
+            return false;
+        }
+        return true;
+    }
+
+    /// Make the calling thread allocate from the NUMA node of whatever cpu
+    /// it runs on. Combined with pinning and first-touch, everything the
+    /// reactor allocates stays node-local. Not fatal: kernels without NUMA
+    /// support simply don't have the syscall.
+    void
+    prefer_local_memory() noexcept
+    {
+        if (::syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == -1) {
+            SPDLOG_DEBUG("set_mempolicy (MPOL_LOCAL): {}", std::strerror(errno));
+        }
+    }
+} // namespace
+
+reactor_pool::reactor_pool(server_config const& config)
+        : config_(config)
+        , cpus_()
+        , servers_()
+        , threads_()
+{
+    std::vector<int> const allowed = allowed_cpus();
+    std::size_t const count = config_.reactors == 0 ? allowed.size() : config_.reactors;
+
+    if (count > MaxReactors) {
+        throw std::runtime_error("at most " + std::to_string(MaxReactors) + " reactors");
+    }
+    if (count > 1 && !config_.handoff_path.empty()) {
+        throw std::runtime_error("handoff requires a single reactor");
+    }
+    if (config_.steering != Steering::None && !config_.pin_reactors) {
+        SPDLOG_INFO("connection steering needs pinned reactors; pinning");
+        config_.pin_reactors = true;
+    }
+
+    // reactor i runs on the i-th cpu we're allowed to use (wrapping around)
+    if (config_.pin_reactors) {
+        for (std::size_t i = 0; i < count; ++i) {
+            cpus_.push_back(allowed[i % allowed.size()]);
+        }
+    }
+
+    // one worker pool shared by every reactor
+    if (config_.processor && config_.worker_threads != 0 && !config_.workers) {
+        config_.workers = std::make_shared<worker_pool>(config_.worker_threads);
+    }
+
+    // and one copy of the static files
+    if (!config_.static_root.empty() && !config_.static_files) {
+        config_.static_files = std::make_shared<static_content const>(config_.static_root);
+    }
+
+    // and one tls context
+    if (!config_.tls_certificate.empty() && !config_.tls) {
+        tls_options options;
+        options.certificate = config_.tls_certificate;
+        options.private_key = config_.tls_private_key;
+        options.ktls = config_.ktls;
+        config_.tls = std::make_shared<tls_context const>(TlsRole::Server, options);
+    }
+
+    servers_.resize(count);
+    threads_.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        server_config reactor_config = config_;
+        reactor_config.handle_signals = false; // signals are handled in run()
+        reactor_config.cpu = config_.pin_reactors ? cpus_[i] : -1;
+        reactor_config.reactor_cpus = cpus_;
+        reactor_config.reactor_index = i;
+        if (i != 0) {
+            reactor_config.unix_listeners.clear();
+        }
+        if (count > 1 && !config_.capture_path.empty()) {
+            reactor_config.capture_path += "." + std::to_string(i);
+        }
+
+        std::promise<void> constructed;
+        std::future<void> done = constructed.get_future();
+        threads_.emplace_back(&reactor_pool::reactor_main, this, i, std::move(reactor_config),
+                std::move(constructed));
+
+        // wait before starting the next one: the SO_REUSEPORT group is
+        // ordered by listen(), and the steering program relies on it
+        try {
+            done.get();
+        } catch (...) {
+            shutdown_and_join();
+            throw;
+        }
+    }
+
+    SPDLOG_INFO("started {} reactors{}", count, config_.pin_reactors ? " (pinned)" : "");
+}
+
+reactor_pool::~reactor_pool() noexcept
+{
+    shutdown_and_join();
+}
+
+bool
+reactor_pool::run()
+{
+    sigset_t mask;
+    ::sigemptyset(&mask);
+    if (config_.handle_signals) {
+        ::sigaddset(&mask, SIGINT);
+        ::sigaddset(&mask, SIGTERM);
+    }
+
+    timespec const timeout{0, PollIntervalNsecs};
+    bool stopping = false;
+    while (finished_.load(std::memory_order_acquire) < threads_.size()) {
+        int const sig = ::sigtimedwait(&mask, nullptr, &timeout);
+        if (sig > 0) {
+            SPDLOG_INFO("received signal {}", sig);
+            request_shutdown();
+        }
+
+        // one reactor failing takes the others down with it
+        if (failed_.load() && !stopping) {
+            stopping = true;
+            request_shutdown();
+        }
+    }
+
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    return !failed_.load();
+}
+
+void
+reactor_pool::request_shutdown() noexcept
+{
+    for (auto& server : servers_) {
+        if (server) {
+            server->request_shutdown();
+        }
+    }
+}
+
+bool
+reactor_pool::post_send(
+        std::uint64_t id, std::vector<std::uint8_t> payload, OpCode op_code) noexcept
+{
+    std::size_t const index = echo_server::reactor_of(id);
+    return index < servers_.size() && servers_[index]
+            && servers_[index]->post_send(id, std::move(payload), op_code);
+}
+
+bool
+reactor_pool::post_close(std::uint64_t id, std::uint16_t code) noexcept
+{
+    std::size_t const index = echo_server::reactor_of(id);
+    return index < servers_.size() && servers_[index] && servers_[index]->post_close(id, code);
+}
+
+std::size_t
+reactor_pool::size() const noexcept
+{
+    return servers_.size();
+}
+
+std::vector<server_stats>
+reactor_pool::stats() const
+{
+    std::vector<server_stats> result;
+    for (auto const& server : servers_) {
+        result.push_back(server ? server->stats() : server_stats{});
+    }
+    return result;
+}
+
+message_latency
+reactor_pool::latency() const
+{
+    message_latency result;
+    for (auto const& server : servers_) {
+        if (server) {
+            result.merge(server->latency());
+        }
+    }
+    return result;
+}
+
+std::vector<int>
+reactor_pool::allowed_cpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == -1) {
+        throw std::runtime_error(std::string("sched_getaffinity: ") + std::strerror(errno));
+    }
+
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(static_cast<std::size_t>(cpu), &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void
+reactor_pool::reactor_main(
+        std::size_t index, server_config config, std::promise<void> constructed) noexcept
+{
+    // pin and set the memory policy first so the server's allocations
+    // (connection map, buffers, ...) are first touched on the local node
+    if (config.cpu != -1) {
+        if (!pin_current_thread(config.cpu)) {
+            constructed.set_exception(std::make_exception_ptr(
+                    std::runtime_error("failed to pin reactor " + std::to_string(index))));
+            finished_.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        prefer_local_memory();
+    }
+
+    try {
+        servers_[index] = std::make_unique<echo_server>(config);
+    } catch (...) {
+        constructed.set_exception(std::current_exception());
+        finished_.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    constructed.set_value();
+
+    if (!servers_[index]->run()) {
+        SPDLOG_CRITICAL("error: reactor {} stopped with an error", index);
+        failed_.store(true);
+    }
+    finished_.fetch_add(1, std::memory_order_release);
+}
+
+void
+reactor_pool::shutdown_and_join() noexcept
+{
+    request_shutdown();
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+} // namespace ws
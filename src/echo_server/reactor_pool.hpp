@@ -0,0 +1,87 @@
+#pragma once
+
+#include "echo_server.hpp"
+#include "server_config.hpp"
+#include "server_stats.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ws {
+
+/*! \class  reactor_pool
+ *  \brief  Runs several echo_server event loops ("reactors"), one per
+ *          thread, all listening on the same port through a SO_REUSEPORT
+ *          group. Optionally pins each reactor to a cpu, keeps its
+ *          memory on that cpu's NUMA node and steers new connections to
+ *          the reactor on the cpu that received them.
+ */
+class reactor_pool
+{
+public:
+    /// Start the reactor threads. Each reactor is constructed on its own
+    /// (pinned) thread, one after the other, so SO_REUSEPORT group order
+    /// matches reactor order.
+    explicit reactor_pool(server_config const& config);
+    ~reactor_pool() noexcept;
+
+    // no copies/moves
+    reactor_pool(reactor_pool const&) = delete;
+    reactor_pool(reactor_pool&&) = delete;
+    reactor_pool& operator=(reactor_pool const&) = delete;
+    reactor_pool&& operator=(reactor_pool&&) = delete;
+
+    /// Wait for every reactor to finish. If the config asks for signal
+    /// handling, SIGINT/SIGTERM (blocked by the caller) drain all reactors.
+    /// \return \c false if any reactor stopped with an error
+    bool run();
+
+    /// Ask every reactor to drain and stop. Safe to call from any thread.
+    void request_shutdown() noexcept;
+
+    /// Post a send to connection \c id on whichever reactor owns it, see
+    /// echo_server::post_send(). Safe to call from any thread.
+    /// \return \c false if that reactor's command queue is full
+    bool post_send(std::uint64_t id, std::vector<std::uint8_t> payload,
+            OpCode op_code = OpCode::Binary) noexcept;
+
+    /// Post a close to connection \c id, see echo_server::post_close().
+    /// Safe to call from any thread.
+    /// \return \c false if that reactor's command queue is full
+    bool post_close(std::uint64_t id, std::uint16_t code = 1000) noexcept;
+
+    /// Number of reactors
+    std::size_t size() const noexcept;
+
+    /// Per-reactor counters; only meaningful once run() has returned
+    std::vector<server_stats> stats() const;
+
+    /// Message latency of all reactors together, see
+    /// echo_server::latency(); only meaningful once run() has returned
+    message_latency latency() const;
+
+    /// cpus the calling thread may run on
+    static std::vector<int> allowed_cpus();
+
+private:
+    /// Body of each reactor thread
+    void reactor_main(
+            std::size_t index, server_config config, std::promise<void> constructed) noexcept;
+
+    /// Stop and join whatever has been started so far
+    void shutdown_and_join() noexcept;
+
+private:
+    server_config config_;                              ///< shared by all reactors
+    std::vector<int> cpus_;                             ///< cpu of each reactor (if pinned)
+    std::vector<std::unique_ptr<echo_server>> servers_; ///< one per reactor
+    std::vector<std::thread> threads_;                  ///< one per reactor
+    std::atomic<std::size_t> finished_{0};              ///< reactors whose run() returned
+    std::atomic<bool> failed_{false};                   ///< a reactor's run() returned false
+};
+
+} // namespace ws
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ws {
+
+class batch_writer;
+class coro_connection;
+class handler_task;
+class static_content;
+class tls_context;
+class worker_pool;
+struct message;
+
+/// Coroutine run for every websocket connection, see coro_connection.hpp
+using connection_handler = handler_task (*)(coro_connection&);
+
+/// Turns a client's message into the reply, in place, see
+/// server_config::processor
+using message_processor = std::function<void(message&)>;
+
+/// Answers a batch of messages with a batch of replies (possibly none),
+/// see server_config::on_batch
+using batch_handler = std::function<void(
+        std::span<std::span<std::uint8_t const> const> messages, batch_writer& replies)>;
+
+/// How new connections are spread over the reactors sharing a port
+enum class Steering
+{
+    None,        ///< kernel default: hash of the 4-tuple
+    IncomingCpu, ///< SO_INCOMING_CPU on each listener
+    Cbpf,        ///< SO_ATTACH_REUSEPORT_CBPF program picking the reactor by rx cpu
+};
+
+/// How the event loop waits for events
+enum class PollMode
+{
+    Block,  ///< epoll_wait with a timeout; the thread sleeps while idle
+    Spin,   ///< epoll_wait with a zero timeout; burns the cpu, never sleeps
+    Hybrid, ///< spin for spin_window after the last event, then block
+};
+
+/// Socket options for the listening and accepted sockets. A default
+/// constructed profile leaves every kernel default alone.
+struct socket_options
+{
+    bool nodelay = false;      ///< TCP_NODELAY: small frames go out right away, no nagle
+    int notsent_lowat = 0;     ///< TCP_NOTSENT_LOWAT bytes, 0 = kernel default (unlimited)
+    int recv_buffer = 0;       ///< SO_RCVBUF bytes, 0 = kernel default (autotuned)
+    int send_buffer = 0;       ///< SO_SNDBUF bytes, 0 = kernel default (autotuned)
+    int fastopen_queue = 0;    ///< TCP_FASTOPEN pending connections on the listener, 0 = off
+    int defer_accept_secs = 0; ///< TCP_DEFER_ACCEPT wait for the request, 0 = off
+
+    /// Small frames, prompt backpressure and cheap reconnects: no nagle,
+    /// at most 16 KiB unsent per socket, fast open and deferred accept
+    static constexpr socket_options
+    latency() noexcept
+    {
+        return {true, 16384, 0, 0, 256, 1};
+    }
+
+    /// Bulk transfers: no nagle, fixed 4 MiB buffers, fast open and
+    /// deferred accept
+    static constexpr socket_options
+    throughput() noexcept
+    {
+        return {true, 0, 4 << 20, 4 << 20, 256, 1};
+    }
+};
+
+/// Runtime tunables for an echo_server. A default constructed config
+/// behaves like the original server: no limits of any kind.
+struct server_config
+{
+    int port = 8000; ///< port to listen on
+
+    /// Also listen on these unix domain sockets, for clients on the same
+    /// host: "unix:PATH" in the filesystem (a stale socket file there is
+    /// replaced, and removed again on exit) or "unix:@NAME" in the
+    /// abstract namespace. Their connections get the same handshake and
+    /// frame handling as tcp ones, minus the tcp socket options. Unix
+    /// sockets can't share a listener group, so with several reactors the
+    /// first one listens on them alone. They are not handed off.
+    std::vector<std::string> unix_listeners;
+
+    // admission control
+
+    /// Max number of concurrently connected clients. Connections over
+    /// the limit are accepted and immediately closed. 0 = unlimited.
+    std::size_t max_connections = 0;
+
+    // per-connection rate limits (token buckets)
+
+    double max_messages_per_sec = 0.0; ///< frames/sec per connection, 0 = unlimited
+    double max_bytes_per_sec = 0.0;    ///< wire bytes/sec per connection, 0 = unlimited
+    double rate_burst_secs = 1.0;      ///< bucket depth, in seconds of rate; must be > 0
+
+    // fairness
+
+    /// Max number of frames handled for a single connection during one
+    /// pass of the event loop. Remaining frames are deferred to the next
+    /// pass so one busy client cannot starve the others. 0 = unlimited.
+    std::size_t max_frames_per_iteration = 64;
+
+    // graceful shutdown
+
+    /// Install a signalfd so SIGINT/SIGTERM start a graceful drain. The
+    /// signals must be blocked in every thread before the server is
+    /// constructed.
+    bool handle_signals = true;
+
+    /// Close frames (1001 going away) are spread evenly over this window,
+    /// idlest connections first.
+    std::chrono::milliseconds drain_window{5000};
+
+    /// Connections that haven't acknowledged the close by this point
+    /// (measured from the start of the drain) are dropped.
+    std::chrono::milliseconds drain_timeout{10000};
+
+    // zero-downtime restarts
+
+    /// Unix socket path used to hand the listening socket from a running
+    /// instance to its replacement. On startup the server connects here
+    /// and, if an instance answers, takes over its listening socket
+    /// instead of binding a new one; the old instance then drains. Empty
+    /// disables handoff.
+    std::string handoff_path;
+
+    // reactors
+
+    /// Number of event loop threads. Each runs its own echo_server with
+    /// its own listening socket in one SO_REUSEPORT group. 0 = one per cpu
+    /// the process may run on. Handoff requires a single reactor.
+    std::size_t reactors = 1;
+
+    /// Pin every reactor thread to its own cpu and allocate its memory on
+    /// that cpu's NUMA node
+    bool pin_reactors = false;
+
+    /// Hand each new connection to the reactor pinned to the cpu that
+    /// received it. Implies pin_reactors.
+    Steering steering = Steering::None;
+
+    /// cpu this reactor is pinned to, -1 if unpinned. Filled in by reactor_pool.
+    int cpu = -1;
+
+    /// Position of this reactor in its pool, part of every connection id.
+    /// Filled in by reactor_pool.
+    std::size_t reactor_index = 0;
+
+    /// cpu of every reactor, in SO_REUSEPORT group order. Filled in by
+    /// reactor_pool; used to build the steering program.
+    std::vector<int> reactor_cpus;
+
+    // latency
+
+    /// How run() waits for events
+    PollMode poll_mode = PollMode::Block;
+
+    /// Hybrid mode: how long to keep spinning after the last event before
+    /// going back to sleeping in epoll_wait
+    std::chrono::microseconds spin_window{100};
+
+    /// Let the kernel busy-poll the NIC queue for this long instead of
+    /// waiting for an interrupt, both in socket reads (SO_BUSY_POLL, set on
+    /// the listener and inherited by accepted sockets) and in epoll_wait
+    /// (EPIOCSPARAMS, linux 6.9+). Values above net.core.busy_read need
+    /// CAP_NET_ADMIN. 0 = off.
+    unsigned busy_poll_usecs = 0;
+
+    /// Packets handled per busy-poll attempt. 0 = kernel default.
+    unsigned busy_poll_budget = 0;
+
+    /// Ask the kernel to keep the NIC queue's interrupts masked while we
+    /// busy-poll it (SO_PREFER_BUSY_POLL). Only effective together with
+    /// napi_defer_hard_irqs/gro_flush_timeout on the device.
+    bool prefer_busy_poll = false;
+
+    /// Turn on kernel software timestamps (SO_TIMESTAMPING) on accepted
+    /// tcp sockets and break every message's latency down into stages:
+    /// kernel receive, read, parse, reply, kernel transmit, client ack
+    /// (see echo_server::latency()). The stages after parse are measured
+    /// for replies sent while the message is handled (echo, batches,
+    /// processors without workers). Tls connections are left out and
+    /// zerocopy is off for these connections; excludes a backend.
+    bool timestamping = false;
+
+    // large frames
+
+    /// Echo payloads of at least this many bytes with MSG_ZEROCOPY: the
+    /// kernel sends straight from our buffers instead of copying them.
+    /// Pays off only for large payloads; completions are read from the
+    /// socket's error queue. 0 = never.
+    std::size_t zerocopy_threshold = 0;
+
+    // write coalescing
+
+    /// Queue echoes per connection and write them with a single syscall at
+    /// the end of the event loop pass, instead of one send per frame.
+    /// Control frames (pong, close) bypass the queue, taking whatever is
+    /// queued ahead of them along.
+    bool coalesce_writes = false;
+
+    /// Flush a connection's queue early once it would grow past this many
+    /// bytes. Frames this large are never copied into the queue.
+    std::size_t coalesce_limit = 65536;
+
+    // socket tuning
+
+    /// Applied to the listening socket (buffers, fast open, deferred
+    /// accept; accepted sockets inherit the buffers) and to every accepted
+    /// socket (nodelay, notsent lowat). Failures are logged, not fatal.
+    socket_options sockets;
+
+    // coroutine handlers
+
+    /// Run this coroutine for every websocket connection instead of the
+    /// echo callbacks. Its frame comes from a pool owned by the reactor,
+    /// its sends never block the event loop. nullptr = callbacks.
+    connection_handler handler = nullptr;
+
+    // cross-thread sends
+
+    /// Capacity of the queue other threads post send/close commands to
+    /// (rounded up to a power of two). Posting to a full queue fails.
+    std::size_t command_queue_size = 4096;
+
+    /// Max posted commands carried out during one pass of the event loop;
+    /// the rest wait for the next pass. 0 = unlimited.
+    std::size_t max_commands_per_iteration = 1024;
+
+    /// Called on the reactor's thread when a connection has completed its
+    /// websocket upgrade, with the id echo_server::post_send() and
+    /// post_close() take
+    std::function<void(std::uint64_t id)> on_open;
+
+    /// Called on the reactor's thread when a connection on_open() was
+    /// called for goes away. Commands posted to its id are dropped; the
+    /// reactor reuses an id only after 2^24 more connections.
+    std::function<void(std::uint64_t id)> on_close;
+
+    // worker offload
+
+    /// Compute the reply to every message with this instead of echoing it:
+    /// it gets the client's message and leaves the reply in its place (an
+    /// empty payload sends nothing; throwing closes the connection with
+    /// 1011). With worker_threads it runs on the workers, concurrently for
+    /// different connections. nullptr = echo.
+    message_processor processor;
+
+    /// Run the processor on a pool of this many work-stealing threads
+    /// shared by all reactors, instead of on the reactor itself. Each
+    /// connection's messages are processed one at a time, in order, and
+    /// the replies come back through the reactor's command queue. 0 = on
+    /// the reactor.
+    std::size_t worker_threads = 0;
+
+    /// Max messages of one connection at the workers at once; further
+    /// frames wait in the buffer (and then the socket) for replies
+    std::size_t max_offloaded_per_connection = 64;
+
+    /// Pool processor runs on. Filled in by reactor_pool (or the server)
+    /// when worker_threads is set.
+    std::shared_ptr<worker_pool> workers;
+
+    // message batching
+
+    /// Agree to the batching subprotocol (ws::BatchProtocol, see
+    /// ws/batch.hpp) when a client offers it in Sec-WebSocket-Protocol.
+    /// On such a connection every binary message is a batch of length
+    /// prefixed messages; a malformed one closes the connection. Excludes
+    /// a coroutine handler, a processor and a backend.
+    bool batching = false;
+
+    /// Called with the messages of every batch, each pointing into the
+    /// received frame (valid during the call only); the replies go back in
+    /// one binary message. Throwing closes the connection with 1011.
+    /// nullptr = echo every message, in one batch.
+    batch_handler on_batch;
+
+    // reverse proxy
+
+    /// Pair every websocket connection with its own connection to this
+    /// backend instead of echoing: "host:port" for tcp or "unix:PATH".
+    /// Client message payloads are written to the backend as a byte
+    /// stream; whatever the backend sends is spliced back to the client
+    /// as binary messages. Empty = echo server.
+    std::string backend;
+
+    // traffic capture
+
+    /// Append every complete message a client sends (timestamp, connection
+    /// id, op code, payload) to this file, see util/capture_log.hpp. With
+    /// several reactors each writes its own file, the path suffixed with
+    /// ".<reactor index>". Empty = off.
+    std::string capture_path;
+
+    /// Stop capturing once the file would grow past this many bytes
+    std::size_t capture_max_bytes = 1UL << 30;
+
+    // plain http
+
+    /// Serve the files under this directory to http GET/HEAD requests
+    /// that aren't websocket upgrades, see util/static_content.hpp. The
+    /// files are read once, at startup. /health and /ready are answered
+    /// either way. Empty = no files.
+    std::string static_root;
+
+    /// Files loaded from static_root. Filled in by reactor_pool (or the
+    /// server) so the reactors share them.
+    std::shared_ptr<static_content const> static_files;
+
+    // wss://
+
+    /// Speak TLS on the tcp port with this PEM certificate chain: every tcp
+    /// connection starts with a TLS handshake, before the http request.
+    /// Connections on the unix_listeners stay plaintext. Empty = ws://.
+    std::string tls_certificate;
+
+    /// PEM private key of tls_certificate
+    std::string tls_private_key;
+
+    /// After the handshake, hand each connection's keys to the kernel
+    /// (kTLS), which then encrypts and decrypts on the socket: sends,
+    /// receives, sendfile() and splice() all stay what they are for
+    /// plaintext. Whatever the kernel or the cipher doesn't support is
+    /// done in user space instead, as it always is without this.
+    bool ktls = true;
+
+    /// Context built from the above. Filled in by reactor_pool (or the
+    /// server) so the reactors share it.
+    std::shared_ptr<tls_context const> tls;
+};
+
+} // namespace ws
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "util/latency_histogram.hpp"
+#include <cstdint>
+#include <format>
+
+namespace ws {
+
+/// Counters maintained by the event loop. Only ever touched from the
+/// thread running echo_server::run().
+struct server_stats
+{
+    std::uint64_t accepted_connections = 0; ///< connections admitted
+    std::uint64_t rejected_connections = 0; ///< connections refused by max_connections
+    std::uint64_t throttled_events = 0;     ///< times a connection hit its rate limit
+    std::uint64_t budget_exhausted = 0;     ///< times a connection used its per-pass budget
+    std::uint64_t frames_processed = 0;     ///< frames handled
+    std::uint64_t local_connections = 0;    ///< accepted on the cpu the reactor is pinned to
+    std::uint64_t unix_connections = 0;     ///< accepted on a unix domain socket listener
+    std::uint64_t empty_polls = 0;          ///< spinning epoll_wait calls that found nothing
+    std::uint64_t zerocopy_sends = 0;       ///< echoes sent with MSG_ZEROCOPY
+    std::uint64_t zerocopy_copied = 0;      ///< of those, ones the kernel copied anyway
+    std::uint64_t backend_connections = 0;  ///< connections opened to the proxy backend
+    std::uint64_t bytes_to_backend = 0;     ///< client payload bytes written to backends
+    std::uint64_t bytes_spliced = 0;        ///< backend bytes spliced to clients
+    std::uint64_t write_syscalls = 0;       ///< syscalls made to send frames to clients
+    std::uint64_t coalesced_frames = 0;     ///< frames queued for the end of the pass
+    std::uint64_t handler_resumes = 0;      ///< times a coroutine handler was resumed
+    std::uint64_t blocked_writes = 0;       ///< handler sends that had to wait for EPOLLOUT
+    std::uint64_t posted_commands = 0;      ///< commands other threads posted (taken off the queue)
+    std::uint64_t posted_dropped = 0;       ///< of those, ones whose connection was gone
+    std::uint64_t offloaded_messages = 0;   ///< messages handed to the worker pool
+    std::uint64_t captured_messages = 0;    ///< messages appended to the capture log
+    std::uint64_t capture_dropped = 0;      ///< messages not captured because the log was full
+    std::uint64_t http_requests = 0;        ///< plain http requests answered (no upgrade)
+    std::uint64_t not_modified = 0;         ///< of those, answered 304 (If-None-Match)
+    std::uint64_t bytes_sendfile = 0;       ///< static file bytes sent with sendfile()
+    std::uint64_t tls_handshakes = 0;       ///< tls handshakes completed
+    std::uint64_t tls_failures = 0;         ///< tls handshakes that failed
+    std::uint64_t ktls_send = 0;            ///< of the completed, ones the kernel encrypts for
+    std::uint64_t ktls_recv = 0;            ///< of the completed, ones the kernel decrypts for
+    std::uint64_t batched_connections = 0;  ///< upgrades that agreed to the batching subprotocol
+    std::uint64_t batches = 0;              ///< batch frames unpacked
+    std::uint64_t batched_messages = 0;     ///< messages in those batches
+    std::uint64_t stamped_connections = 0;  ///< connections with kernel timestamps on
+};
+
+/// Where the messages of timestamped connections spend their time (see
+/// server_config::timestamping), one histogram of nanoseconds per stage
+struct message_latency
+{
+    latency_histogram rx_to_read;     ///< kernel received the bytes .. recv() returned them
+    latency_histogram read_to_parse;  ///< .. the frame was parsed
+    latency_histogram parse_to_reply; ///< .. the handler's reply was queued for sending
+    latency_histogram reply_to_tx;    ///< .. the kernel passed the reply to the device
+    latency_histogram tx_to_ack;      ///< .. the client acknowledged every byte of it
+
+    /// Add the samples of \c other, another reactor's say
+    void
+    merge(message_latency const& other) noexcept
+    {
+        rx_to_read.merge(other.rx_to_read);
+        read_to_parse.merge(other.read_to_parse);
+        parse_to_reply.merge(other.parse_to_reply);
+        reply_to_tx.merge(other.reply_to_tx);
+        tx_to_ack.merge(other.tx_to_ack);
+    }
+};
+
+} // namespace ws
+
+
+// formatters must be in std
+
+template <>
+struct std::formatter<ws::server_stats>
+{
+    constexpr auto
+    parse(std::format_parse_context& ctx)
+    {
+        return ctx.begin();
+    }
+
+    auto
+    format(ws::server_stats const& s, std::format_context& ctx) const
+    {
+        return std::format_to(ctx.out(),
+                "server_stats(accepted={},rejected={},throttled={},budget_exhausted={},frames={},"
+                "local={},unix={},empty_polls={},zerocopy={},zerocopy_copied={},backends={},"
+                "bytes_to_backend={},bytes_spliced={},write_syscalls={},coalesced={},"
+                "handler_resumes={},blocked_writes={},posted={},posted_dropped={},"
+                "offloaded={},captured={},capture_dropped={},http_requests={},not_modified={},"
+                "bytes_sendfile={},tls_handshakes={},tls_failures={},ktls_send={},ktls_recv={},"
+                "batched_connections={},batches={},batched_messages={},stamped={})",
+                s.accepted_connections, s.rejected_connections, s.throttled_events,
+                s.budget_exhausted, s.frames_processed, s.local_connections, s.unix_connections,
+                s.empty_polls, s.zerocopy_sends, s.zerocopy_copied, s.backend_connections,
+                s.bytes_to_backend, s.bytes_spliced, s.write_syscalls, s.coalesced_frames,
+                s.handler_resumes, s.blocked_writes, s.posted_commands, s.posted_dropped,
+                s.offloaded_messages, s.captured_messages, s.capture_dropped, s.http_requests,
+                s.not_modified, s.bytes_sendfile, s.tls_handshakes, s.tls_failures, s.ktls_send,
+                s.ktls_recv, s.batched_connections, s.batches, s.batched_messages,
+                s.stamped_connections);
+    }
+};
+
+template <>
+struct std::formatter<ws::latency_histogram>
+{
+    constexpr auto
+    parse(std::format_parse_context& ctx)
+    {
+        return ctx.begin();
+    }
+
+    /// n=count, then p50/p99/p99.9/max in microseconds (samples are ns)
+    auto
+    format(ws::latency_histogram const& h, std::format_context& ctx) const
+    {
+        auto const us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        return std::format_to(ctx.out(),
+                "n={} p50={:.1f}us p99={:.1f}us p99.9={:.1f}us max={:.1f}us", h.count(),
+                us(h.percentile(50)), us(h.percentile(99)), us(h.percentile(99.9)), us(h.max()));
+    }
+};
+
+template <>
+struct std::formatter<ws::message_latency>
+{
+    constexpr auto
+    parse(std::format_parse_context& ctx)
+    {
+        return ctx.begin();
+    }
+
+    auto
+    format(ws::message_latency const& l, std::format_context& ctx) const
+    {
+        return std::format_to(ctx.out(),
+                "message_latency(\n  kernel_rx..read:  {}\n  read..parse:      {}\n"
+                "  parse..reply:     {}\n  reply..kernel_tx: {}\n  kernel_tx..ack:   {})",
+                l.rx_to_read, l.read_to_parse, l.parse_to_reply, l.reply_to_tx, l.tx_to_ack);
+    }
+};
@@ -0,0 +1,331 @@
+#include "load_client.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include <arpa/inet.h>   // ::inet_pton
+#include <netinet/in.h>  // sockaddr_in
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <unistd.h>  // ::close
+#include <algorithm> // std::sort
+#include <atomic>
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <format>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace ws {
+
+namespace {
+    using clock = std::chrono::steady_clock;
+
+    static constexpr int UpgradeTimeoutMsecs = 1000;
+    static constexpr int EchoTimeoutMsecs = 2000;
+    static constexpr std::size_t FloodFramesPerSend = 64;
+
+    int
+    connect_to_server(int port)
+    {
+        int const fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd == -1) {
+            SPDLOG_ERROR("socket: {}", std::strerror(errno));
+            return -1;
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+        if (::connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == -1) {
+            SPDLOG_ERROR("connect: {}", std::strerror(errno));
+            ::close(fd);
+            return -1;
+        }
+
+        int const yes = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        return fd;
+    }
+
+    bool
+    send_all(int fd, std::span<std::uint8_t const> data)
+    {
+        while (!data.empty()) {
+            ssize_t const nbytes = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (nbytes == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data = data.subspan(static_cast<std::size_t>(nbytes));
+        }
+        return true;
+    }
+
+    bool
+    wait_readable(int fd, int timeout_msecs)
+    {
+        pollfd pfd{fd, POLLIN, 0};
+        return ::poll(&pfd, 1, timeout_msecs) == 1;
+    }
+
+    /// Send the upgrade request and wait for the server's verdict.
+    /// \return \c true if the server switched protocols
+    bool
+    upgrade(int fd)
+    {
+        std::string const request = std::format("GET / HTTP/1.1\r\n"
+                                                "Host: 127.0.0.1\r\n"
+                                                "Upgrade: websocket\r\n"
+                                                "Connection: Upgrade\r\n"
+                                                "Sec-WebSocket-Key: {}\r\n"
+                                                "Sec-WebSocket-Version: 13\r\n"
+                                                "\r\n",
+                frame_generator::generate_websocket_key());
+
+        if (!send_all(fd,
+                    std::span(reinterpret_cast<std::uint8_t const*>(request.data()),
+                            request.size()))) {
+            return false;
+        }
+
+        std::string response;
+        char buf[512];
+        while (!response.contains("\r\n\r\n")) {
+            if (!wait_readable(fd, UpgradeTimeoutMsecs)) {
+                return false;
+            }
+            ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+            if (nbytes <= 0) {
+                return false; // refused
+            }
+            response.append(buf, static_cast<std::size_t>(nbytes));
+        }
+        return response.starts_with("HTTP/1.1 101");
+    }
+
+    double
+    percentile(std::vector<double>& sorted_samples, double pct)
+    {
+        if (sorted_samples.empty()) {
+            return 0.0;
+        }
+        auto const idx = static_cast<std::size_t>(
+                pct / 100.0 * static_cast<double>(sorted_samples.size() - 1));
+        return sorted_samples[idx];
+    }
+
+    /// A well-behaved client: one message per interval, waits for each echo.
+    struct echo_probe
+    {
+        int fd = -1;
+        std::vector<std::uint8_t> inbuf;
+        std::vector<double> rtts_ms;
+        std::size_t failures = 0;
+
+        /// Read until a text frame arrives, skipping any control frames.
+        bool
+        await_echo()
+        {
+            std::uint8_t chunk[4096];
+            for (;;) {
+                frame f;
+                if (f.parse_from_buffer(inbuf.data(), inbuf.size()) == ParseResult::Success) {
+                    inbuf.erase(inbuf.begin(), inbuf.begin() + f.total_size());
+                    if (f.op_code() == OpCode::Text) {
+                        return true;
+                    }
+                    continue;
+                }
+
+                if (!wait_readable(fd, EchoTimeoutMsecs)) {
+                    return false;
+                }
+                ssize_t const nbytes = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (nbytes <= 0) {
+                    return false;
+                }
+                inbuf.insert(inbuf.end(), chunk, chunk + nbytes);
+            }
+        }
+    };
+} // namespace
+
+load_client::load_client(load_options const& opts)
+        : opts_(opts)
+{
+    /* empty */
+}
+
+bool
+load_client::run_abusive_scenario()
+{
+    SPDLOG_INFO("abusive scenario: 1 flooding client, {} well-behaved clients, {} ms",
+            opts_.clients, opts_.duration.count());
+
+    std::string const payload(opts_.message_size, 'x');
+
+    // the abuser: pipelines batches of frames without pause
+    int const abuser_fd = connect_to_server(opts_.port);
+    if (abuser_fd == -1 || !upgrade(abuser_fd)) {
+        SPDLOG_ERROR("abusive client failed to connect");
+        return false;
+    }
+
+    std::vector<std::uint8_t> flood_batch;
+    for (std::size_t i = 0; i < FloodFramesPerSend; ++i) {
+        auto gen = frame_generator{}.text(payload, /*fin=*/true, /*mask=*/true);
+        flood_batch.insert(flood_batch.end(), gen.data().begin(), gen.data().end());
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> flood_frames_sent{0};
+    std::atomic<std::uint64_t> flood_bytes_echoed{0};
+
+    std::thread flooder([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            ssize_t const nbytes = ::send(
+                    abuser_fd, flood_batch.data(), flood_batch.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (nbytes == static_cast<ssize_t>(flood_batch.size())) {
+                flood_frames_sent += FloodFramesPerSend;
+            } else if (nbytes >= 0) {
+                // finish the partial batch so the stream stays frame aligned
+                auto rest = std::span<std::uint8_t const>(flood_batch).subspan(
+                        static_cast<std::size_t>(nbytes));
+                if (!send_all(abuser_fd, rest)) {
+                    break;
+                }
+                flood_frames_sent += FloodFramesPerSend;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd pfd{abuser_fd, POLLOUT, 0};
+                ::poll(&pfd, 1, 10);
+            } else {
+                break;
+            }
+        }
+    });
+
+    // drain echoes so the abuser's receive window never stalls the server
+    std::thread drainer([&] {
+        std::uint8_t buf[65536];
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (!wait_readable(abuser_fd, 100)) {
+                continue;
+            }
+            ssize_t const nbytes = ::recv(abuser_fd, buf, sizeof(buf), 0);
+            if (nbytes <= 0) {
+                break;
+            }
+            flood_bytes_echoed += static_cast<std::uint64_t>(nbytes);
+        }
+    });
+
+    // the victims
+    std::vector<echo_probe> probes(opts_.clients);
+    std::vector<std::thread> probe_threads;
+    for (auto& probe : probes) {
+        probe.fd = connect_to_server(opts_.port);
+        if (probe.fd == -1 || !upgrade(probe.fd)) {
+            SPDLOG_ERROR("well-behaved client failed to connect");
+            ++probe.failures;
+            continue;
+        }
+
+        probe_threads.emplace_back([&, p = &probe] {
+            auto const gen = frame_generator{}.text(payload, /*fin=*/true, /*mask=*/true);
+            auto const deadline = clock::now() + opts_.duration;
+            while (clock::now() < deadline) {
+                auto const start = clock::now();
+                if (!send_all(p->fd, gen.data()) || !p->await_echo()) {
+                    ++p->failures;
+                    break;
+                }
+                std::chrono::duration<double, std::milli> const rtt = clock::now() - start;
+                p->rtts_ms.push_back(rtt.count());
+                std::this_thread::sleep_for(opts_.interval);
+            }
+        });
+    }
+
+    for (auto& t : probe_threads) {
+        t.join();
+    }
+    stop = true;
+    flooder.join();
+    drainer.join();
+    ::close(abuser_fd);
+
+    std::vector<double> rtts;
+    std::size_t failures = 0;
+    for (auto& probe : probes) {
+        rtts.insert(rtts.end(), probe.rtts_ms.begin(), probe.rtts_ms.end());
+        failures += probe.failures;
+        if (probe.fd != -1) {
+            ::close(probe.fd);
+        }
+    }
+    std::sort(rtts.begin(), rtts.end());
+
+    double const p50 = percentile(rtts, 50);
+    double const p99 = percentile(rtts, 99);
+    double const secs = std::chrono::duration<double>(opts_.duration).count();
+
+    SPDLOG_INFO("abuser: sent {} frames ({:.0f} frames/s), {} bytes echoed back",
+            flood_frames_sent.load(), static_cast<double>(flood_frames_sent.load()) / secs,
+            flood_bytes_echoed.load());
+    SPDLOG_INFO("well-behaved: {} round trips, {} failures, p50={:.3f} ms, p99={:.3f} ms, "
+                "max={:.3f} ms",
+            rtts.size(), failures, p50, p99, rtts.empty() ? 0.0 : rtts.back());
+
+    bool const passed = failures == 0 && !rtts.empty() && p99 <= opts_.max_p99_ms;
+    if (!passed) {
+        SPDLOG_ERROR("abusive scenario FAILED: well-behaved clients starved (p99 limit {} ms)",
+                opts_.max_p99_ms);
+    } else {
+        SPDLOG_INFO("abusive scenario passed");
+    }
+    return passed;
+}
+
+bool
+load_client::run_connect_storm_scenario()
+{
+    SPDLOG_INFO("connect storm scenario: {} connection attempts", opts_.connections);
+
+    std::vector<int> fds;
+    fds.reserve(opts_.connections);
+
+    std::size_t upgraded = 0;
+    std::size_t refused = 0;
+    for (std::size_t i = 0; i < opts_.connections; ++i) {
+        int const fd = connect_to_server(opts_.port);
+        if (fd == -1) {
+            ++refused;
+            continue;
+        }
+        if (upgrade(fd)) {
+            ++upgraded;
+            fds.push_back(fd); // hold it open so it counts against the server's limit
+        } else {
+            ++refused;
+            ::close(fd);
+        }
+    }
+
+    for (int const fd : fds) {
+        ::close(fd);
+    }
+
+    SPDLOG_INFO("connect storm: {} upgraded, {} refused", upgraded, refused);
+    return upgraded > 0;
+}
+
+} // namespace ws
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace ws {
+
+struct load_options
+{
+    int port = 8000;                          ///< server port on 127.0.0.1
+    std::size_t clients = 8;                  ///< well-behaved clients
+    std::size_t connections = 256;            ///< connection attempts for the storm scenario
+    std::size_t message_size = 64;            ///< payload bytes per message
+    std::chrono::milliseconds duration{5000}; ///< how long to run the scenario
+    std::chrono::milliseconds interval{10};   ///< gap between well-behaved client messages
+    double max_p99_ms = 50.0;                 ///< pass/fail threshold for well-behaved clients
+};
+
+/*! \class  load_client
+ *  \brief  Drives load scenarios against a running echo_server and
+ *          reports whether the server held up.
+ */
+class load_client
+{
+public:
+    explicit load_client(load_options const&);
+
+    /// One client floods the server with frames as fast as the socket
+    /// allows while well-behaved clients measure their echo round trip.
+    /// \return \c false if the well-behaved clients were starved
+    bool run_abusive_scenario();
+
+    /// Open more connections than the server is expected to admit and
+    /// count how many were upgraded vs refused.
+    /// \return \c false if no connection could be upgraded
+    bool run_connect_storm_scenario();
+
+private:
+    load_options opts_;
+};
+
+} // namespace ws
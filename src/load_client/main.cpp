@@ -0,0 +1,102 @@
+#include "load_client/load_client.hpp"
+#include <getopt.h>
+#include <spdlog/spdlog.h>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <print>
+#include <string_view>
+
+namespace {
+
+void
+print_usage(char const* prog)
+{
+    std::print(stderr,
+            "usage: {} [options] <scenario>\n"
+            "scenarios:\n"
+            "  abusive        one client floods, well-behaved clients measure echo latency\n"
+            "  connect-storm  open many connections to exercise admission control\n"
+            "options:\n"
+            "  -p, --port=PORT          server port (default 8000)\n"
+            "  -n, --clients=N          well-behaved clients (default 8)\n"
+            "  -c, --connections=N      connection attempts for connect-storm (default 256)\n"
+            "  -s, --message-size=N     payload bytes per message (default 64)\n"
+            "  -d, --duration-ms=MS     scenario duration (default 5000)\n"
+            "  -l, --max-p99-ms=MS      well-behaved p99 pass threshold (default 50)\n"
+            "  -h, --help               show this message\n",
+            prog);
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    spdlog::set_level(spdlog::level::info);
+
+    // [2025-07-17 11:10:13.674784] [info] [main.cpp:14] message
+    spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%^%l%$] [%s:%#] %v");
+
+    ws::load_options opts;
+
+    static option const long_options[] = {
+            {"port", required_argument, nullptr, 'p'},
+            {"clients", required_argument, nullptr, 'n'},
+            {"connections", required_argument, nullptr, 'c'},
+            {"message-size", required_argument, nullptr, 's'},
+            {"duration-ms", required_argument, nullptr, 'd'},
+            {"max-p99-ms", required_argument, nullptr, 'l'},
+            {"help", no_argument, nullptr, 'h'},
+            {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = ::getopt_long(argc, argv, "p:n:c:s:d:l:h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'p':
+                opts.port = std::atoi(optarg);
+                break;
+            case 'n':
+                opts.clients = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'c':
+                opts.connections = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                opts.message_size = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'd':
+                opts.duration = std::chrono::milliseconds(std::strtol(optarg, nullptr, 10));
+                break;
+            case 'l':
+                opts.max_p99_ms = std::strtod(optarg, nullptr);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ws::load_client client(opts);
+
+    std::string_view const scenario = argv[optind];
+    bool passed = false;
+    if (scenario == "abusive") {
+        passed = client.run_abusive_scenario();
+    } else if (scenario == "connect-storm") {
+        passed = client.run_connect_storm_scenario();
+    } else {
+        SPDLOG_CRITICAL("unknown scenario: {}", scenario);
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
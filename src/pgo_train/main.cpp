@@ -0,0 +1,199 @@
+// Training workload for profile-guided builds (see pgo_build.sh): runs an
+// echo_server and drives it over loopback from ws::client and test_client,
+// so the profile covers both ends of handshakes, small and large messages,
+// pings and fragmented messages.
+
+#include "echo_server/echo_server.hpp"
+#include "test_client/test_client.hpp"
+#include "ws/client.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm> // std::min
+#include <chrono>
+#include <cstdint>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <exception>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace ws;
+using clock = std::chrono::steady_clock;
+
+static constexpr int Port = 18999;
+static constexpr std::chrono::milliseconds PollTimeout{10};
+static constexpr std::chrono::seconds PhaseTimeout{60};
+static constexpr std::size_t ConnectBatch = 8; ///< the server's listen backlog is small
+
+/// One phase of the workload: \c connections ws::client connections, each
+/// sending \c messages messages of \c payload_size bytes (and a ping
+/// every \c ping_every messages, 0 = none), \c pipeline at a time
+struct phase
+{
+    char const* name;
+    std::size_t connections;
+    std::size_t messages;
+    std::size_t payload_size;
+    std::size_t pipeline;
+    std::size_t ping_every;
+};
+
+static constexpr phase Phases[] = {
+        {"handshakes", 512, 1, 16, 1, 0},
+        {"small messages", 64, 2000, 32, 8, 0},
+        {"medium messages", 16, 500, 1500, 4, 50},
+        {"large messages", 4, 200, 200'000, 2, 10},
+};
+
+bool
+run_phase(phase const& p, std::string const& address)
+{
+    std::vector<std::uint8_t> const payload(p.payload_size, 't');
+    std::string const text(p.payload_size, 't');
+    std::vector<std::uint8_t> const ping = {'p', 'i', 'n', 'g'};
+    std::size_t opened = 0;
+    std::size_t finished = 0;
+    bool failed = false;
+
+    struct progress
+    {
+        std::size_t sent = 0;
+        std::size_t echoed = 0;
+    };
+    std::vector<progress> connections(p.connections);
+    std::vector<std::uint64_t> ids;
+
+    client_config options;
+    options.reconnect = false;
+    client* engine = nullptr;
+
+    // alternate text and binary messages, with the odd ping in between
+    auto const send_next = [&](std::uint64_t id, progress& c) {
+        if (p.ping_every != 0 && c.sent % p.ping_every == 0) {
+            engine->send(id, ping, OpCode::Ping);
+        }
+        bool const sent = c.sent % 2 == 0 ? engine->send_text(id, text) : engine->send(id, payload);
+        failed = failed || !sent;
+        ++c.sent;
+    };
+    auto const index_of = [&](std::uint64_t id) {
+        return static_cast<std::size_t>(std::find(ids.begin(), ids.end(), id) - ids.begin());
+    };
+
+    options.on_open = [&](std::uint64_t id) {
+        ++opened;
+        progress& c = connections[index_of(id)];
+        for (std::size_t i = 0; i < std::min(p.pipeline, p.messages); ++i) {
+            send_next(id, c);
+        }
+    };
+    options.on_message = [&](std::uint64_t id, OpCode, std::span<std::uint8_t const>) {
+        progress& c = connections[index_of(id)];
+        if (++c.echoed == p.messages) {
+            engine->close(id);
+            ++finished;
+        } else if (c.sent < p.messages) {
+            send_next(id, c);
+        }
+    };
+    options.on_close = [&](std::uint64_t, std::uint16_t code) { failed = failed || code != 1000; };
+
+    client c(options);
+    engine = &c;
+
+    auto const deadline = clock::now() + PhaseTimeout;
+    for (std::size_t connected = 0; connected < p.connections && !failed;) {
+        std::size_t const batch = std::min(ConnectBatch, p.connections - connected);
+        for (std::size_t i = 0; i < batch; ++i) {
+            ids.push_back(c.connect(address));
+        }
+        connected += batch;
+        while (opened < connected && !failed && clock::now() < deadline && c.poll(PollTimeout)) {
+        }
+        failed = failed || opened < connected;
+    }
+    while (finished < p.connections && !failed && clock::now() < deadline && c.poll(PollTimeout)) {
+    }
+
+    // let the closing handshakes complete
+    while (c.size() != 0 && clock::now() < deadline && c.poll(PollTimeout)) {
+    }
+    return !failed && finished == p.connections;
+}
+
+/// Fragmented messages and interleaved pings, from test_client
+bool
+run_fragmentation(int port)
+{
+    test_client client("127.0.0.1", port);
+    if (!client.connect() || !client.send_websocket_upgrade_request()) {
+        return false;
+    }
+    client.mark_read(client.recv().size());
+
+    // these read (and check) their echoes themselves
+    bool (test_client::* const tests[])() = {
+            &test_client::send_large_fragmented_text_message,
+            &test_client::send_binary_fragmented_message,
+            &test_client::send_many_small_fragments,
+            &test_client::send_empty_fragments,
+            &test_client::send_single_byte_fragments,
+            &test_client::send_fragmented_message_with_interleaved_ping,
+    };
+    for (int round = 0; round < 20; ++round) {
+        if (!client.send_simple_fragmented_message()) {
+            return false;
+        }
+        client.mark_read(client.recv().size());
+        for (auto const test : tests) {
+            if (!(client.*test)()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+
+int
+main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    server_config config;
+    config.port = Port;
+    config.handle_signals = false;
+    config.drain_window = std::chrono::milliseconds(0);
+
+    try {
+        echo_server server(config);
+        std::thread server_thread([&] { server.run(); });
+
+        bool ok = true;
+        std::string const address = "127.0.0.1:" + std::to_string(Port);
+        for (phase const& p : Phases) {
+            auto const start = clock::now();
+            bool const passed = run_phase(p, address);
+            std::chrono::duration<double> const elapsed = clock::now() - start;
+            std::print("{:<16} {:>5} conns {:>8.3f}s {}\n", p.name, p.connections,
+                    elapsed.count(), passed ? "ok" : "FAILED");
+            ok = ok && passed;
+        }
+
+        bool const passed = run_fragmentation(Port);
+        std::print("{:<16} {}\n", "fragmentation", passed ? "ok" : "FAILED");
+        ok = ok && passed;
+
+        server.request_shutdown();
+        server_thread.join();
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (std::exception const& e) {
+        std::print(stderr, "error: {}\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,83 @@
+#include "replay/replay.hpp"
+#include <getopt.h>
+#include <spdlog/spdlog.h>
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+#include <exception>
+#include <print>
+
+namespace {
+
+void
+print_usage(char const* prog)
+{
+    std::print(stderr,
+            "usage: {} [options] <capture>...\n"
+            "replays captured client messages against an echo server and reports the latency\n"
+            "options:\n"
+            "  -a, --address=ADDR       server, host:port or unix:PATH (default 127.0.0.1:8000)\n"
+            "  -s, --speed=X            1 = as captured, X times faster, 0 = max (default 1)\n"
+            "  -w, --window=N           speed 0: messages in flight per connection (default 64)\n"
+            "  -d, --drain-ms=MS        give up after MS without an echo (default 5000)\n"
+            "  -h, --help               show this message\n",
+            prog);
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    spdlog::set_level(spdlog::level::info);
+
+    // [2025-07-17 11:10:13.674784] [info] [main.cpp:14] message
+    spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%^%l%$] [%s:%#] %v");
+
+    ws::replay_options opts;
+
+    static option const long_options[] = {
+            {"address", required_argument, nullptr, 'a'},
+            {"speed", required_argument, nullptr, 's'},
+            {"window", required_argument, nullptr, 'w'},
+            {"drain-ms", required_argument, nullptr, 'd'},
+            {"help", no_argument, nullptr, 'h'},
+            {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = ::getopt_long(argc, argv, "a:s:w:d:h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'a':
+                opts.address = optarg;
+                break;
+            case 's':
+                opts.speed = std::strtod(optarg, nullptr);
+                break;
+            case 'w':
+                opts.window = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'd':
+                opts.drain_timeout = std::chrono::milliseconds(std::strtol(optarg, nullptr, 10));
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    opts.capture_paths.assign(argv + optind, argv + argc);
+
+    try {
+        ws::replayer replayer(opts);
+        return replayer.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (std::exception const& e) {
+        SPDLOG_CRITICAL("error: {}", e.what());
+        return EXIT_FAILURE;
+    }
+}
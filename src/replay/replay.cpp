@@ -0,0 +1,261 @@
+#include "replay.hpp"
+#include "ws/client.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm> // std::all_of, std::max, std::min, std::sort, std::stable_sort
+#include <deque>
+#include <span>
+#include <unordered_map>
+
+
+namespace ws {
+
+namespace {
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t ConnectBatch = 8;            ///< the listen backlog is small
+    static constexpr std::chrono::seconds ConnectTimeout{30};
+    static constexpr std::chrono::milliseconds PollTimeout{10};
+    static constexpr std::size_t MaxPendingBytes = 256 << 20; ///< bursts replayed at speed
+    static constexpr std::size_t SendBatch = 1024;            ///< due messages sent between polls
+
+    /// One captured connection and the connection replaying it
+    struct stream
+    {
+        std::uint64_t client_id = 0;             ///< ws::client id
+        std::vector<std::size_t> records;        ///< indexes into records_, in order
+        std::size_t next = 0;                    ///< records sent (or failed to)
+        std::deque<clock::time_point> in_flight; ///< send times of unanswered messages
+        bool open = false;                       ///< between on_open and on_close
+    };
+
+    double
+    percentile(std::vector<double>& sorted_samples, double pct)
+    {
+        if (sorted_samples.empty()) {
+            return 0.0;
+        }
+        auto const idx = static_cast<std::size_t>(
+                pct / 100.0 * static_cast<double>(sorted_samples.size() - 1));
+        return sorted_samples[idx];
+    }
+
+    double
+    to_ms(clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+} // namespace
+
+replayer::replayer(replay_options const& opts)
+        : opts_(opts)
+{
+    opts_.window = std::max<std::size_t>(opts_.window, 1);
+    for (std::string const& path : opts_.capture_paths) {
+        auto& reader = readers_.emplace_back(std::make_unique<capture_reader>(path));
+        while (auto record = reader->next()) {
+            if (record->payload.empty()) {
+                ++skipped_;
+            } else {
+                records_.push_back(*record);
+            }
+        }
+    }
+
+    // each log is in order already; merging several takes a sort
+    std::stable_sort(records_.begin(), records_.end(),
+            [](capture_record const& a, capture_record const& b) {
+                return a.timestamp_ns < b.timestamp_ns;
+            });
+}
+
+bool
+replayer::run()
+{
+    if (records_.empty()) {
+        SPDLOG_ERROR("nothing to replay");
+        return false;
+    }
+
+    // one stream per captured connection, in order of first message
+    std::vector<stream> streams;
+    std::unordered_map<std::uint64_t, std::size_t> by_captured_id;
+    std::vector<std::size_t> stream_of(records_.size());
+    for (std::size_t i = 0; i < records_.size(); ++i) {
+        auto const [itr, inserted]
+                = by_captured_id.try_emplace(records_[i].connection_id, streams.size());
+        if (inserted) {
+            streams.emplace_back();
+        }
+        streams[itr->second].records.push_back(i);
+        stream_of[i] = itr->second;
+    }
+
+    std::unordered_map<std::uint64_t, std::size_t> by_client_id;
+    std::vector<double> latencies_ms;
+    latencies_ms.reserve(records_.size());
+    std::size_t opened = 0;
+    std::size_t dropped = 0;
+    std::size_t sent = 0;
+    std::size_t send_failures = 0;
+    clock::time_point last_echo{};
+
+    client_config config;
+    config.reconnect = false;
+    config.max_pending_bytes = MaxPendingBytes;
+    client* engine = nullptr;
+
+    // queue a record on its stream's connection
+    auto const send_record = [&](stream& s, std::size_t record) {
+        capture_record const& r = records_[record];
+        OpCode const op_code = r.op_code == static_cast<std::uint8_t>(OpCode::Text)
+                ? OpCode::Text
+                : OpCode::Binary;
+        if (!engine->send(s.client_id, r.payload, op_code)) {
+            ++send_failures;
+            return false;
+        }
+        s.in_flight.push_back(clock::now());
+        ++sent;
+        return true;
+    };
+
+    // speed 0: keep the stream's window full
+    auto const top_up = [&](stream& s) {
+        while (s.open && s.next < s.records.size() && s.in_flight.size() < opts_.window) {
+            send_record(s, s.records[s.next++]);
+        }
+    };
+
+    config.on_open = [&](std::uint64_t id) {
+        streams[by_client_id.at(id)].open = true;
+        ++opened;
+    };
+    config.on_message = [&](std::uint64_t id, OpCode, std::span<std::uint8_t const>) {
+        stream& s = streams[by_client_id.at(id)];
+        if (s.in_flight.empty()) {
+            return; // not an echo of ours
+        }
+        last_echo = clock::now();
+        latencies_ms.push_back(to_ms(last_echo - s.in_flight.front()));
+        s.in_flight.pop_front();
+        if (opts_.speed <= 0.0) {
+            top_up(s);
+        }
+    };
+    config.on_close = [&](std::uint64_t id, std::uint16_t code) {
+        stream& s = streams[by_client_id.at(id)];
+        SPDLOG_WARN("connection {} closed with {}, {} echoes outstanding", id, code,
+                s.in_flight.size());
+        s.open = false;
+        ++dropped;
+    };
+
+    client c(config);
+    engine = &c;
+
+    // open the connections a few at a time
+    SPDLOG_INFO("replaying {} messages from {} connections to {}", records_.size(),
+            streams.size(), opts_.address);
+    auto const connect_deadline = clock::now() + ConnectTimeout;
+    for (std::size_t connected = 0; connected < streams.size();) {
+        std::size_t const batch = std::min(ConnectBatch, streams.size() - connected);
+        for (std::size_t i = connected; i < connected + batch; ++i) {
+            streams[i].client_id = c.connect(opts_.address);
+            by_client_id.emplace(streams[i].client_id, i);
+        }
+        connected += batch;
+        while (opened + dropped < connected && clock::now() < connect_deadline) {
+            if (!c.poll(PollTimeout)) {
+                return false;
+            }
+        }
+        if (opened < connected) {
+            SPDLOG_ERROR("only {} of {} connections opened", opened, connected);
+            return false;
+        }
+    }
+
+    auto const start = clock::now();
+    std::vector<double> lags_ms;
+    if (opts_.speed > 0.0) {
+        // send every message at its captured offset from the first, scaled
+        lags_ms.reserve(records_.size());
+        std::int64_t const first_ns = records_.front().timestamp_ns;
+        auto const due_at = [&](std::size_t i) {
+            auto const offset = static_cast<double>(records_[i].timestamp_ns - first_ns);
+            return start
+                    + std::chrono::duration_cast<clock::duration>(
+                            std::chrono::duration<double, std::nano>(offset / opts_.speed));
+        };
+
+        std::size_t next = 0;
+        while (next < records_.size()) {
+            auto now = clock::now();
+            for (std::size_t n = 0; n < SendBatch && next < records_.size(); ++n, ++next) {
+                clock::time_point const due = due_at(next);
+                if (due > now) {
+                    now = clock::now();
+                    if (due > now) {
+                        break;
+                    }
+                }
+                lags_ms.push_back(to_ms(now - due));
+                stream& s = streams[stream_of[next]];
+                ++s.next;
+                send_record(s, next);
+            }
+
+            // sleep in epoll until the next message is due, spin the last ms
+            auto const wait = next < records_.size()
+                    ? std::chrono::floor<std::chrono::milliseconds>(due_at(next) - clock::now())
+                    : std::chrono::milliseconds(0);
+            if (!c.poll(std::max(wait, std::chrono::milliseconds(0)))) {
+                return false;
+            }
+        }
+    } else {
+        for (stream& s : streams) {
+            top_up(s);
+        }
+    }
+
+    // wait for the last echoes; at speed 0 the echoes also keep the sending going
+    auto const done = [](stream const& s) {
+        return !s.open || (s.in_flight.empty() && s.next == s.records.size());
+    };
+    auto deadline = clock::now() + opts_.drain_timeout;
+    while (!std::all_of(streams.begin(), streams.end(), done) && clock::now() < deadline) {
+        std::size_t const echoed = latencies_ms.size();
+        if (!c.poll(PollTimeout)) {
+            return false;
+        }
+        if (latencies_ms.size() != echoed) {
+            deadline = clock::now() + opts_.drain_timeout;
+        }
+    }
+
+    std::size_t lost = 0;
+    for (stream const& s : streams) {
+        lost += s.in_flight.size();
+    }
+    clock::time_point const end = last_echo == clock::time_point{} ? clock::now() : last_echo;
+    double const secs = std::chrono::duration<double>(end - start).count();
+
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    SPDLOG_INFO("sent {} messages in {:.3f} s ({:.0f} msgs/s), {} echoed, {} lost, "
+                "{} send failures, {} empty skipped, {} connections dropped",
+            sent, secs, static_cast<double>(sent) / std::max(secs, 1e-9), latencies_ms.size(),
+            lost, send_failures, skipped_, dropped);
+    SPDLOG_INFO("latency: p50={:.3f} ms, p99={:.3f} ms, p99.9={:.3f} ms, max={:.3f} ms",
+            percentile(latencies_ms, 50), percentile(latencies_ms, 99),
+            percentile(latencies_ms, 99.9), latencies_ms.empty() ? 0.0 : latencies_ms.back());
+    if (!lags_ms.empty()) {
+        std::sort(lags_ms.begin(), lags_ms.end());
+        SPDLOG_INFO("schedule lag: p50={:.3f} ms, p99={:.3f} ms, max={:.3f} ms",
+                percentile(lags_ms, 50), percentile(lags_ms, 99), lags_ms.back());
+    }
+
+    return lost == 0 && send_failures == 0 && dropped == 0 && sent == records_.size();
+}
+
+} // namespace ws
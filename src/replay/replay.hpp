@@ -0,0 +1,50 @@
+#pragma once
+
+#include "util/capture_log.hpp"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ws {
+
+struct replay_options
+{
+    std::vector<std::string> capture_paths;        ///< logs to replay, merged by timestamp
+    std::string address = "127.0.0.1:8000";        ///< server, "host:port" or "unix:PATH"
+    double speed = 1.0;                            ///< 1 = as recorded, N = N times faster, 0 = max
+    std::size_t window = 64;                       ///< speed 0: messages in flight per connection
+    std::chrono::milliseconds drain_timeout{5000}; ///< give up after this long without an echo
+};
+
+/*! \class  replayer
+ *  \brief  Plays capture logs (see util/capture_log.hpp) back at an echo
+ *          server and reports the echo latency.
+ *
+ *  Every captured connection gets a connection of its own, all driven by
+ *  one ws::client. At a given speed each message goes out at its captured
+ *  offset from the first message, divided by the speed, so inter-arrival
+ *  times (and bursts) are kept, only scaled; at speed 0 every connection
+ *  sends its messages in order, as fast as the window allows. The logs
+ *  of a server's reactors can be replayed together: their timestamps
+ *  come from the same clock and their connection ids don't collide.
+ */
+class replayer
+{
+public:
+    /// \throw std::runtime_error if a capture log can't be read
+    explicit replayer(replay_options const&);
+
+    /// Connect, replay every message and wait for the echoes
+    /// \return \c false if a connection failed or echoes were lost
+    bool run();
+
+private:
+    replay_options opts_;
+    std::vector<std::unique_ptr<capture_reader>> readers_; ///< keep the payloads mapped
+    std::vector<capture_record> records_;                  ///< non-empty messages, by timestamp
+    std::size_t skipped_ = 0;                              ///< empty messages, never echoed
+};
+
+} // namespace ws
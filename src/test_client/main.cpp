@@ -4,6 +4,8 @@
 #include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
 #include <cstring> // std::memset, std::strerror
 #include <span>
+#include <string>
+#include <string_view>
 
 int
 main(int argc, char* argv[])
@@ -13,12 +15,21 @@ main(int argc, char* argv[])
     // [2025-07-17 11:10:13.674784] [info] [main.cpp:14] message
     spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%^%l%$] [%s:%#] %v");
 
+    // [port | unix:PATH | unix:@NAME] [--fastopen]
+    std::string address = "127.0.0.1";
     int port = 8000;
-    if (argc == 2) {
-        port = std::atoi(argv[1]);
+    bool fastopen = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--fastopen") {
+            fastopen = true;
+        } else if (std::string_view(argv[i]).starts_with("unix:")) {
+            address = argv[i];
+        } else {
+            port = std::atoi(argv[i]);
+        }
     }
 
-    ws::test_client client("127.0.0.1", port);
+    ws::test_client client(address, port, fastopen);
 
     if (!client.connect()) {
         SPDLOG_CRITICAL("client failed to connect");
@@ -1,7 +1,10 @@
 #include "test_client.hpp"
+#include "util/socket_address.hpp"
 #include "ws/frame.hpp"
 #include "ws/frame_generator.hpp"
-#include <netdb.h> // ::getaddrinfo
+#include <netdb.h>       // ::getaddrinfo
+#include <netinet/in.h>  // IPPROTO_TCP
+#include <netinet/tcp.h> // TCP_FASTOPEN_CONNECT
 #include <spdlog/spdlog.h>
 #include <sys/socket.h> // ::connect, ::getsockname, ::send, ::setsockopt, ::socket
 #include <sys/types.h>
@@ -10,6 +13,7 @@
 #include <bit>       // std::byteswap
 #include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
 #include <cstring>   // std::memset, std::strerror
+#include <stdexcept>
 
 
 namespace ws {
@@ -48,9 +52,10 @@ namespace {
     }
 } // namespace
 
-test_client::test_client(std::string const& ip, int port)
+test_client::test_client(std::string const& ip, int port, bool fastopen)
         : ip_(ip)
         , port_(port)
+        , fastopen_(fastopen)
         , sockfd_(-1)
 {
     /* empty */
@@ -64,6 +69,21 @@ test_client::~test_client() noexcept
 bool
 test_client::connect()
 {
+    // unix domain socket listener: no port, no tcp options
+    if (ip_.starts_with("unix:")) {
+        try {
+            sockfd_ = connect_socket(resolve_socket_address(ip_));
+        } catch (std::runtime_error const& e) {
+            SPDLOG_CRITICAL("{}", e.what());
+            return false;
+        }
+        if (sockfd_ == -1) {
+            SPDLOG_CRITICAL("connect ({}): {}", ip_, std::strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
     addrinfo hints{};
     std::memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_UNSPEC;     // ipv4 or ipv6
@@ -83,6 +103,14 @@ test_client::connect()
         return false;
     }
 
+    // connect() returns right away; the SYN goes out with the first send
+    if (fastopen_) {
+        int const yes = 1;
+        if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &yes, sizeof(yes)) == -1) {
+            SPDLOG_WARN("setsockopt (TCP_FASTOPEN_CONNECT): {}", std::strerror(errno));
+        }
+    }
+
     if (int rv = ::connect(sockfd_, result->ai_addr, result->ai_addrlen); rv == -1) {
         SPDLOG_CRITICAL("connect: {}", std::strerror(errno));
         return false;
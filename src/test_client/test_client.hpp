@@ -12,7 +12,11 @@ namespace ws {
 class test_client
 {
 public:
-    test_client(std::string const& ip, int port);
+    /// \param ip server address; "unix:PATH" or "unix:@NAME" connects to
+    ///        a unix domain socket listener instead, ignoring \c port
+    /// \param fastopen connect with TCP_FASTOPEN_CONNECT: once the server
+    ///        has handed out a cookie, the upgrade request rides in the SYN
+    test_client(std::string const& ip, int port, bool fastopen = false);
     ~test_client() noexcept;
 
     // no copies/moves
@@ -46,6 +50,7 @@ public:
 private:
     std::string ip_;
     int port_ = 0;
+    bool fastopen_ = false;
     int sockfd_ = -1;
     byte_buffer<524'288> buf_;
 };
@@ -8,12 +8,15 @@ base64_codec::encode(std::string_view const input)
     if (input.empty())
         return {};
 
-    std::size_t const input_len = input.size();
-    std::size_t const output_len = ((input_len + 2) / 3) * 4;
-
-    std::string result;
-    result.reserve(output_len);
+    std::string result(encoded_size(input.size()), '\0');
+    encode(input, result.data());
+    return result;
+}
 
+void
+base64_codec::encode(std::string_view const input, char* output) noexcept
+{
+    std::size_t const input_len = input.size();
     unsigned char const* data = reinterpret_cast<unsigned char const*>(input.data());
     std::size_t i = 0;
 
@@ -23,10 +26,10 @@ base64_codec::encode(std::string_view const input)
                 | (static_cast<std::uint32_t>(data[i + 1]) << 8)
                 | static_cast<std::uint32_t>(data[i + 2]);
 
-        result += encode_table[(chunk >> 18) & 0x3F];
-        result += encode_table[(chunk >> 12) & 0x3F];
-        result += encode_table[(chunk >> 6) & 0x3F];
-        result += encode_table[chunk & 0x3F];
+        *output++ = encode_table[(chunk >> 18) & 0x3F];
+        *output++ = encode_table[(chunk >> 12) & 0x3F];
+        *output++ = encode_table[(chunk >> 6) & 0x3F];
+        *output++ = encode_table[chunk & 0x3F];
     }
 
     // handle remaining bytes
@@ -35,18 +38,17 @@ base64_codec::encode(std::string_view const input)
 
         if (i + 1 < input_len) {
             chunk |= static_cast<std::uint32_t>(data[i + 1]) << 8;
-            result += encode_table[(chunk >> 18) & 0x3F];
-            result += encode_table[(chunk >> 12) & 0x3F];
-            result += encode_table[(chunk >> 6) & 0x3F];
-            result += '=';
+            *output++ = encode_table[(chunk >> 18) & 0x3F];
+            *output++ = encode_table[(chunk >> 12) & 0x3F];
+            *output++ = encode_table[(chunk >> 6) & 0x3F];
+            *output++ = '=';
         } else {
-            result += encode_table[(chunk >> 18) & 0x3F];
-            result += encode_table[(chunk >> 12) & 0x3F];
-            result += "==";
+            *output++ = encode_table[(chunk >> 18) & 0x3F];
+            *output++ = encode_table[(chunk >> 12) & 0x3F];
+            *output++ = '=';
+            *output++ = '=';
         }
     }
-
-    return result;
 }
 
 std::string
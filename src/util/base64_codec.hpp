@@ -38,6 +38,22 @@ public:
      */
     static std::string encode(std::string_view const input);
 
+    /**
+     * Encode a string to base64 into a caller's buffer
+     * @param input The input string to encode
+     * @param output Room for encoded_size(input.size()) characters
+     */
+    static void encode(std::string_view const input, char* output) noexcept;
+
+    /**
+     * @return Length of the base64 encoding of \c input_len bytes
+     */
+    static constexpr std::size_t
+    encoded_size(std::size_t input_len) noexcept
+    {
+        return ((input_len + 2) / 3) * 4;
+    }
+
     /**
      * Decode a base64 string
      * @param input The base64 string to decode
@@ -0,0 +1,220 @@
+#include "buffer_arena.hpp"
+#include <spdlog/spdlog.h>
+#include <sys/mman.h> // ::mmap, ::munmap, ::madvise
+#include <algorithm>  // std::upper_bound
+#include <bit>        // std::bit_ceil, std::countr_zero
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <new>     // std::bad_alloc, std::align_val_t
+
+namespace ws {
+
+namespace {
+    void*
+    heap_allocate(std::size_t size)
+    {
+        return ::operator new(size, std::align_val_t{buffer_arena::Alignment});
+    }
+
+    void
+    heap_deallocate(void* ptr) noexcept
+    {
+        ::operator delete(ptr, std::align_val_t{buffer_arena::Alignment});
+    }
+} // namespace
+
+buffer_arena&
+buffer_arena::instance() noexcept
+{
+    // buffers may outlive static destruction
+    static buffer_arena* const arena = new buffer_arena;
+    return *arena;
+}
+
+buffer_arena::~buffer_arena() noexcept
+{
+    for (region const& r : regions_) {
+        ::munmap(r.begin, static_cast<std::size_t>(r.end - r.begin));
+    }
+}
+
+void
+buffer_arena::set_backing(ArenaBacking backing) noexcept
+{
+    backing_.store(backing, std::memory_order_relaxed);
+}
+
+ArenaBacking
+buffer_arena::backing() const noexcept
+{
+    return backing_.load(std::memory_order_relaxed);
+}
+
+void*
+buffer_arena::allocate(std::size_t size)
+{
+    if (size > MaxBlockSize || backing() == ArenaBacking::Heap) {
+        heap_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+        return heap_allocate(size);
+    }
+
+    std::size_t const size_class = buffer_arena::size_class(size);
+    {
+        std::lock_guard lock(mutex_);
+        void* block = free_lists_[size_class];
+        if (block != nullptr) {
+            free_lists_[size_class] = free_lists_[size_class]->next;
+        } else {
+            block = carve(MinBlockSize << size_class);
+        }
+        if (block != nullptr) {
+            ++stats_.blocks_in_use;
+            return block;
+        }
+    }
+
+    // out of address space or mappings: the heap may still have room
+    heap_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    return heap_allocate(size);
+}
+
+void
+buffer_arena::deallocate(void* ptr, std::size_t size) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+
+    // until a region exists, everything came from the heap
+    if (size > MaxBlockSize || !mapped_.load(std::memory_order_acquire)) {
+        heap_deallocate(ptr);
+        return;
+    }
+
+    std::lock_guard lock(mutex_);
+    if (!owns(ptr)) {
+        heap_deallocate(ptr);
+        return;
+    }
+
+    std::size_t const size_class = buffer_arena::size_class(size);
+    auto* const block = static_cast<free_block*>(ptr);
+    block->next = free_lists_[size_class];
+    free_lists_[size_class] = block;
+    --stats_.blocks_in_use;
+}
+
+arena_stats
+buffer_arena::stats() const noexcept
+{
+    std::lock_guard lock(mutex_);
+    arena_stats stats = stats_;
+    stats.heap_fallbacks = heap_fallbacks_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::size_t
+buffer_arena::size_class(std::size_t size) noexcept
+{
+    std::size_t const block_size = std::bit_ceil(std::max(size, MinBlockSize));
+    return static_cast<std::size_t>(
+            std::countr_zero(block_size) - std::countr_zero(MinBlockSize));
+}
+
+bool
+buffer_arena::owns(void const* ptr) const noexcept
+{
+    auto const* const p = static_cast<std::uint8_t const*>(ptr);
+    auto const itr = std::upper_bound(regions_.begin(), regions_.end(), p,
+            [](std::uint8_t const* q, region const& r) { return q < r.begin; });
+    return itr != regions_.begin() && p < std::prev(itr)->end;
+}
+
+void*
+buffer_arena::carve(std::size_t block_size) noexcept
+{
+    if (static_cast<std::size_t>(region_end_ - region_pos_) < block_size) {
+        // hand what is left of the region to the free lists; every block
+        // size is a multiple of MinBlockSize, so the rest is one too
+        for (std::size_t c = NumClasses; c-- > 0;) {
+            std::size_t const size = MinBlockSize << c;
+            while (static_cast<std::size_t>(region_end_ - region_pos_) >= size) {
+                auto* const block = reinterpret_cast<free_block*>(region_pos_);
+                block->next = free_lists_[c];
+                free_lists_[c] = block;
+                region_pos_ += size;
+            }
+        }
+        if (!map_region()) {
+            return nullptr;
+        }
+    }
+
+    void* const block = region_pos_;
+    region_pos_ += block_size;
+    return block;
+}
+
+bool
+buffer_arena::map_region() noexcept
+{
+    void* map = MAP_FAILED;
+    bool hugetlb = false;
+
+    // no MAP_NORESERVE: if the pool can't cover the region, fail here
+    // rather than with SIGBUS on first touch
+    if (backing() == ArenaBacking::HugeTlb && !hugetlb_exhausted_) {
+        map = ::mmap(nullptr, RegionSize, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (map == MAP_FAILED) {
+            SPDLOG_WARN("mmap (MAP_HUGETLB): {}, falling back to transparent huge pages",
+                    std::strerror(errno));
+            hugetlb_exhausted_ = true;
+        } else {
+            hugetlb = true;
+        }
+    }
+
+    if (map == MAP_FAILED) {
+        // over-map by a huge page, then trim to a 2 MiB aligned region so
+        // every huge page of it can be backed by one
+        std::size_t const length = RegionSize + HugePageSize;
+        void* raw = ::mmap(
+                nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            SPDLOG_ERROR("mmap: {}", std::strerror(errno));
+            return false;
+        }
+        auto* const begin = static_cast<std::uint8_t*>(raw);
+        auto* const aligned = reinterpret_cast<std::uint8_t*>(
+                (reinterpret_cast<std::uintptr_t>(begin) + HugePageSize - 1)
+                & ~(HugePageSize - 1));
+        std::size_t const head = static_cast<std::size_t>(aligned - begin);
+        if (head != 0) {
+            ::munmap(begin, head);
+        }
+        if (std::size_t const tail = HugePageSize - head; tail != 0) {
+            ::munmap(aligned + RegionSize, tail);
+        }
+        if (::madvise(aligned, RegionSize, MADV_HUGEPAGE) == -1) {
+            SPDLOG_DEBUG("madvise (MADV_HUGEPAGE): {}", std::strerror(errno));
+        }
+        map = aligned;
+    }
+
+    auto* const begin = static_cast<std::uint8_t*>(map);
+    region const r{begin, begin + RegionSize};
+    regions_.insert(std::upper_bound(regions_.begin(), regions_.end(), r,
+                            [](region const& a, region const& b) { return a.begin < b.begin; }),
+            r);
+    region_pos_ = r.begin;
+    region_end_ = r.end;
+
+    ++stats_.regions;
+    stats_.hugetlb_regions += hugetlb ? 1 : 0;
+    stats_.reserved_bytes += RegionSize;
+    mapped_.store(true, std::memory_order_release);
+    return true;
+}
+
+} // namespace ws
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace ws {
+
+/// Where buffer_arena gets its memory
+enum class ArenaBacking
+{
+    Heap,      ///< arena off: every buffer comes from operator new
+    HugePages, ///< 2 MiB aligned regions with madvise(MADV_HUGEPAGE) (transparent huge pages)
+    HugeTlb,   ///< MAP_HUGETLB regions from the hugetlbfs pool, HugePages once that runs dry
+};
+
+/// Counters kept by a buffer_arena
+struct arena_stats
+{
+    std::size_t regions = 0;          ///< regions mapped
+    std::size_t hugetlb_regions = 0;  ///< of those, backed by the hugetlbfs pool
+    std::size_t reserved_bytes = 0;   ///< size of all regions
+    std::size_t blocks_in_use = 0;    ///< arena blocks handed out
+    std::uint64_t heap_fallbacks = 0; ///< requests passed to operator new
+};
+
+/*! \class  buffer_arena
+ *  \brief  Process-wide allocator for connection-sized i/o buffers
+ *          (read buffers, send queues, reassembly buffers), carved out of
+ *          huge page regions.
+ *
+ *  Allocated one at a time from the heap, every buffer sits on its own
+ *  4 KiB pages, and with tens of thousands of connections the dTLB stops
+ *  covering the buffers touched per pass of the event loop. The arena maps
+ *  RegionSize regions backed by 2 MiB pages and hands out power-of-two
+ *  blocks from MinBlockSize to MaxBlockSize, recycling freed blocks per
+ *  size class (most recently freed first, while it's still cached).
+ *  Requests above MaxBlockSize, and every request while the backing is
+ *  Heap, go to operator new. Regions are unmapped with the arena, so
+ *  instance() is never destroyed.
+ *
+ *  Huge pages are faulted in whole: with HugePages, touching the first
+ *  byte of a fresh 1 MiB buffer commits its 2 MiB page. Memory per idle
+ *  connection grows accordingly, which is why the default is Heap.
+ *
+ *  Thread safe; a block may be freed on any thread. The lock is only
+ *  taken when buffers are created, grown or freed, never per message.
+ */
+class buffer_arena
+{
+public:
+    static constexpr std::size_t MinBlockSize = 256;            ///< smallest size class
+    static constexpr std::size_t MaxBlockSize = 4 * 1024 * 1024; ///< larger requests go to the heap
+    static constexpr std::size_t RegionSize = 32 * 1024 * 1024; ///< bytes mapped at once
+    static constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+    static constexpr std::size_t Alignment = 64; ///< of every buffer, arena or heap
+
+private:
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    struct region
+    {
+        std::uint8_t* begin;
+        std::uint8_t* end;
+    };
+
+    static constexpr std::size_t NumClasses = 15; ///< MinBlockSize << 14 == MaxBlockSize
+
+public:
+    /// The arena every byte_buffer and arena_allocator uses
+    static buffer_arena& instance() noexcept;
+
+    buffer_arena() noexcept = default;
+    ~buffer_arena() noexcept;
+
+    // blocks point into our regions: no copies/moves
+    buffer_arena(buffer_arena const&) = delete;
+    buffer_arena(buffer_arena&&) = delete;
+    buffer_arena& operator=(buffer_arena const&) = delete;
+    buffer_arena&& operator=(buffer_arena&&) = delete;
+
+    /// Choose where buffers allocated from now on come from. Buffers
+    /// already handed out are unaffected and freed where they came from.
+    void set_backing(ArenaBacking) noexcept;
+    ArenaBacking backing() const noexcept;
+
+    /// \return at least \c size bytes, aligned to Alignment
+    /// \throw std::bad_alloc if neither a region nor the heap has room
+    void* allocate(std::size_t size);
+
+    /// Return a buffer obtained from allocate() with the same \c size
+    void deallocate(void* ptr, std::size_t size) noexcept;
+
+    arena_stats stats() const noexcept;
+
+private:
+    /// \return the size class \c size falls into
+    static std::size_t size_class(std::size_t size) noexcept;
+
+    /// \return \c true if \c ptr lies in one of our regions
+    bool owns(void const* ptr) const noexcept;
+
+    /// Take a block of \c block_size from the current region, mapping a
+    /// new one if needed
+    /// \return \c nullptr if no region could be mapped
+    void* carve(std::size_t block_size) noexcept;
+
+    /// \return \c false if the region couldn't be mapped
+    bool map_region() noexcept;
+
+private:
+    std::atomic<ArenaBacking> backing_{ArenaBacking::Heap}; ///< for new allocations
+    std::atomic<bool> mapped_{false};                       ///< regions_ isn't empty
+    std::atomic<std::uint64_t> heap_fallbacks_{0};          ///< see arena_stats
+    mutable std::mutex mutex_;                              ///< guards everything below
+    std::array<free_block*, NumClasses> free_lists_{};      ///< recycled blocks per size class
+    std::vector<region> regions_;                           ///< sorted by address
+    std::uint8_t* region_pos_ = nullptr;                    ///< next free byte of the newest region
+    std::uint8_t* region_end_ = nullptr;                    ///< end of the newest region
+    bool hugetlb_exhausted_ = false;                        ///< MAP_HUGETLB failed, don't retry
+    arena_stats stats_;                                     ///< heap_fallbacks aside
+};
+
+/// Standard allocator handing out buffer_arena blocks, for containers used
+/// as connection buffers
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator() noexcept = default;
+
+    template <typename U>
+    arena_allocator(arena_allocator<U> const&) noexcept
+    {
+    }
+
+    T*
+    allocate(std::size_t n)
+    {
+        return static_cast<T*>(buffer_arena::instance().allocate(n * sizeof(T)));
+    }
+
+    void
+    deallocate(T* ptr, std::size_t n) noexcept
+    {
+        buffer_arena::instance().deallocate(ptr, n * sizeof(T));
+    }
+
+    friend bool
+    operator==(arena_allocator const&, arena_allocator const&) noexcept
+    {
+        return true;
+    }
+};
+
+/// Byte vector backed by the buffer arena
+using arena_bytes = std::vector<std::uint8_t, arena_allocator<std::uint8_t>>;
+
+} // namespace ws
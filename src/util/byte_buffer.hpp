@@ -1,5 +1,6 @@
 #pragma once
 
+#include "buffer_arena.hpp"
 #include <cstdint>
 #include <cstring> // std::memmove
 #include <utility> // std::exchange
@@ -41,7 +42,7 @@ public:
 
 template <std::size_t Capacity>
 byte_buffer<Capacity>::byte_buffer() noexcept
-        : buf_(new std::uint8_t[Capacity])
+        : buf_(static_cast<std::uint8_t*>(ws::buffer_arena::instance().allocate(Capacity)))
         , rptr_(buf_)
         , wptr_(buf_)
 {
@@ -51,7 +52,7 @@ byte_buffer<Capacity>::byte_buffer() noexcept
 template <std::size_t Capacity>
 byte_buffer<Capacity>::~byte_buffer() noexcept
 {
-    delete[] buf_;
+    ws::buffer_arena::instance().deallocate(buf_, Capacity);
 }
 
 template <std::size_t Capacity>
@@ -68,7 +69,7 @@ byte_buffer<Capacity>&
 byte_buffer<Capacity>::operator=(byte_buffer&& rhs) noexcept
 {
     if (this != &rhs) {
-        delete[] buf_;
+        ws::buffer_arena::instance().deallocate(buf_, Capacity);
         buf_ = std::exchange(rhs.buf_, nullptr);
         rptr_ = std::exchange(rhs.rptr_, nullptr);
         wptr_ = std::exchange(rhs.wptr_, nullptr);
@@ -0,0 +1,234 @@
+#include "capture_log.hpp"
+#include <fcntl.h>    // ::open, ::fallocate
+#include <sys/mman.h> // ::mmap, ::mremap, ::munmap, ::madvise
+#include <sys/stat.h> // ::fstat
+#include <unistd.h>   // ::close, ::ftruncate
+#include <algorithm>  // std::max, std::min
+#include <cerrno>
+#include <chrono>
+#include <cstring> // std::memcpy, std::memcmp, std::strerror
+#include <stdexcept>
+
+namespace ws {
+
+namespace {
+    static constexpr char Magic[8] = {'W', 'S', 'C', 'A', 'P', '0', '0', '1'};
+    static constexpr std::uint32_t Version = 1;
+    static constexpr std::size_t ChunkSize = 16 << 20; ///< bytes the file grows by at a time
+
+    struct file_header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t header_size;
+        std::int64_t created_ns;
+    };
+
+    struct record_header
+    {
+        std::int64_t timestamp_ns;
+        std::uint64_t connection_id;
+        std::uint32_t payload_size;
+        std::uint8_t op_code;
+        std::uint8_t padding[3];
+    };
+
+    static_assert(sizeof(file_header) % 8 == 0 && sizeof(record_header) % 8 == 0);
+
+    constexpr std::size_t
+    align8(std::size_t n) noexcept
+    {
+        return (n + 7) & ~std::size_t{7};
+    }
+
+    /// Reserve [offset, offset + length) of the file. Falls back to a
+    /// sparse extension where fallocate isn't supported.
+    bool
+    extend_file(int fd, std::size_t offset, std::size_t length) noexcept
+    {
+        if (::fallocate(fd, 0, static_cast<off_t>(offset), static_cast<off_t>(length)) == 0) {
+            return true;
+        }
+        return errno == EOPNOTSUPP && ::ftruncate(fd, static_cast<off_t>(offset + length)) == 0;
+    }
+} // namespace
+
+capture_writer::capture_writer(std::string const& path, std::size_t max_bytes)
+        : max_bytes_(std::max(max_bytes, sizeof(file_header)))
+{
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        throw std::runtime_error("open (" + path + "): " + std::strerror(errno));
+    }
+
+    std::size_t const initial = std::min(ChunkSize, max_bytes_);
+    if (!extend_file(fd_, 0, initial)) {
+        int const err = errno;
+        ::close(fd_);
+        throw std::runtime_error("fallocate (" + path + "): " + std::strerror(err));
+    }
+    void* map = ::mmap(nullptr, initial, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        int const err = errno;
+        ::close(fd_);
+        throw std::runtime_error("mmap (" + path + "): " + std::strerror(err));
+    }
+    map_ = static_cast<std::uint8_t*>(map);
+    mapped_ = initial;
+
+    file_header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.header_size = sizeof(file_header);
+    header.created_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+    std::memcpy(map_, &header, sizeof(header));
+    used_ = sizeof(header);
+}
+
+capture_writer::~capture_writer() noexcept
+{
+    ::munmap(map_, mapped_);
+
+    // drop the unused part of the last chunk; should that fail, readers
+    // stop at the zeroes anyway
+    [[maybe_unused]] int const rv = ::ftruncate(fd_, static_cast<off_t>(used_));
+    ::close(fd_);
+}
+
+bool
+capture_writer::append(std::int64_t timestamp_ns, std::uint64_t connection_id,
+        std::uint8_t op_code, std::span<std::uint8_t const> payload) noexcept
+{
+    if (payload.size() > UINT32_MAX) {
+        return false;
+    }
+    std::size_t const size = sizeof(record_header) + align8(payload.size());
+    if (used_ + size > mapped_ && !grow(size)) {
+        return false;
+    }
+
+    // the file is zero-filled, so the padding needs no writing
+    record_header header{};
+    header.timestamp_ns = timestamp_ns;
+    header.connection_id = connection_id;
+    header.payload_size = static_cast<std::uint32_t>(payload.size());
+    header.op_code = op_code;
+    std::memcpy(map_ + used_, &header, sizeof(header));
+    if (!payload.empty()) {
+        std::memcpy(map_ + used_ + sizeof(header), payload.data(), payload.size());
+    }
+    used_ += size;
+    ++records_;
+    return true;
+}
+
+std::size_t
+capture_writer::size() const noexcept
+{
+    return used_;
+}
+
+std::uint64_t
+capture_writer::records() const noexcept
+{
+    return records_;
+}
+
+bool
+capture_writer::grow(std::size_t needed) noexcept
+{
+    std::size_t const new_size
+            = std::min(std::max(mapped_ + ChunkSize, align8(used_ + needed)), max_bytes_);
+    if (new_size < used_ + needed) {
+        return false; // over max_bytes
+    }
+    if (!extend_file(fd_, mapped_, new_size - mapped_)) {
+        return false;
+    }
+
+    void* map = ::mremap(map_, mapped_, new_size, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    map_ = static_cast<std::uint8_t*>(map);
+    mapped_ = new_size;
+    return true;
+}
+
+capture_reader::capture_reader(std::string const& path)
+{
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ == -1) {
+        throw std::runtime_error("open (" + path + "): " + std::strerror(errno));
+    }
+
+    struct stat st{};
+    if (::fstat(fd_, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(file_header)) {
+        ::close(fd_);
+        throw std::runtime_error("not a capture file: " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        int const err = errno;
+        ::close(fd_);
+        throw std::runtime_error("mmap (" + path + "): " + std::strerror(err));
+    }
+    map_ = static_cast<std::uint8_t const*>(map);
+    ::madvise(map, size_, MADV_SEQUENTIAL);
+
+    file_header header{};
+    std::memcpy(&header, map_, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version
+            || header.header_size < sizeof(file_header) || header.header_size > size_) {
+        ::munmap(map, size_);
+        ::close(fd_);
+        throw std::runtime_error("not a capture file: " + path);
+    }
+    pos_ = header.header_size;
+    created_ns_ = header.created_ns;
+}
+
+capture_reader::~capture_reader() noexcept
+{
+    ::munmap(const_cast<std::uint8_t*>(map_), size_);
+    ::close(fd_);
+}
+
+std::optional<capture_record>
+capture_reader::next() noexcept
+{
+    if (size_ - pos_ < sizeof(record_header)) {
+        return std::nullopt;
+    }
+    record_header header{};
+    std::memcpy(&header, map_ + pos_, sizeof(header));
+
+    // zeroes: the end of a log whose writer didn't get to trim it
+    if (header.timestamp_ns == 0
+            || size_ - pos_ - sizeof(record_header) < header.payload_size) {
+        return std::nullopt;
+    }
+
+    capture_record record;
+    record.timestamp_ns = header.timestamp_ns;
+    record.connection_id = header.connection_id;
+    record.op_code = header.op_code;
+    record.payload = std::span(map_ + pos_ + sizeof(record_header), header.payload_size);
+    pos_ += sizeof(record_header) + align8(header.payload_size);
+    if (pos_ > size_) {
+        pos_ = size_; // the last record's padding was trimmed
+    }
+    return record;
+}
+
+std::int64_t
+capture_reader::created_ns() const noexcept
+{
+    return created_ns_;
+}
+
+} // namespace ws
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace ws {
+
+/*
+ * Capture file layout (native byte order, every record 8 byte aligned):
+ *
+ *   file header   magic "WSCAP001", u32 version, u32 header size,
+ *                 i64 wall clock at creation (ns since the epoch)
+ *   record        i64 timestamp (steady clock ns), u64 connection id,
+ *                 u32 payload size, u8 op code, 3 bytes padding,
+ *                 payload, padding to the next multiple of 8
+ *
+ * The file grows in preallocated chunks, so after a crash its tail is
+ * zeroes; a record with a zero timestamp ends the log.
+ */
+
+/// One captured message, as read back by capture_reader
+struct capture_record
+{
+    std::int64_t timestamp_ns = 0;         ///< steady clock, only differences mean anything
+    std::uint64_t connection_id = 0;       ///< the server's connection id
+    std::uint8_t op_code = 0;              ///< websocket op code of the message
+    std::span<std::uint8_t const> payload; ///< points into the mapped file
+};
+
+/*! \class  capture_writer
+ *  \brief  Append-only capture log, written through a shared memory
+ *          mapping of the file.
+ *
+ *  Appending a record is two memcpys into the mapping; the kernel writes
+ *  the pages back on its own schedule. The only syscalls happen when the
+ *  file has to grow, one chunk at a time (fallocate, so a full disk fails
+ *  the append instead of faulting on a page later, and mremap). The
+ *  destructor trims the file to the records written.
+ */
+class capture_writer
+{
+public:
+    /// \param path file to create (an existing one is truncated)
+    /// \param max_bytes appends that would grow the file past this fail
+    /// \throw std::runtime_error if the file can't be created and mapped
+    capture_writer(std::string const& path, std::size_t max_bytes);
+    ~capture_writer() noexcept;
+
+    // owns the mapping: no copies/moves
+    capture_writer(capture_writer const&) = delete;
+    capture_writer(capture_writer&&) = delete;
+    capture_writer& operator=(capture_writer const&) = delete;
+    capture_writer&& operator=(capture_writer&&) = delete;
+
+    /// Append a record
+    /// \return \c false if the log is full or couldn't grow
+    bool append(std::int64_t timestamp_ns, std::uint64_t connection_id, std::uint8_t op_code,
+            std::span<std::uint8_t const> payload) noexcept;
+
+    /// Bytes of the file in use
+    std::size_t size() const noexcept;
+
+    /// Records appended
+    std::uint64_t records() const noexcept;
+
+private:
+    /// Make room for \c needed more bytes
+    bool grow(std::size_t needed) noexcept;
+
+private:
+    int fd_ = -1;
+    std::uint8_t* map_ = nullptr; ///< the whole file
+    std::size_t mapped_ = 0;      ///< file (and mapping) size
+    std::size_t used_ = 0;        ///< bytes written
+    std::size_t max_bytes_ = 0;   ///< file size limit
+    std::uint64_t records_ = 0;   ///< records written
+};
+
+/*! \class  capture_reader
+ *  \brief  Reads a capture file back, record by record, from a read-only
+ *          mapping. Record payloads stay valid as long as the reader.
+ */
+class capture_reader
+{
+public:
+    /// \throw std::runtime_error if the file can't be mapped or isn't a capture
+    explicit capture_reader(std::string const& path);
+    ~capture_reader() noexcept;
+
+    // owns the mapping: no copies/moves
+    capture_reader(capture_reader const&) = delete;
+    capture_reader(capture_reader&&) = delete;
+    capture_reader& operator=(capture_reader const&) = delete;
+    capture_reader&& operator=(capture_reader&&) = delete;
+
+    /// \return the next record, \c std::nullopt at the end of the log
+    std::optional<capture_record> next() noexcept;
+
+    /// Wall clock when the log was created, ns since the epoch
+    std::int64_t created_ns() const noexcept;
+
+private:
+    int fd_ = -1;
+    std::uint8_t const* map_ = nullptr;
+    std::size_t size_ = 0; ///< file size
+    std::size_t pos_ = 0;  ///< offset of the next record
+    std::int64_t created_ns_ = 0;
+};
+
+} // namespace ws
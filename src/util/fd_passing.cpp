@@ -0,0 +1,98 @@
+#include "fd_passing.hpp"
+#include <sys/socket.h>
+#include <unistd.h> // ::close
+#include <cerrno>
+#include <cstring> // std::memcpy
+
+namespace ws {
+
+namespace {
+    /// one byte of real data must accompany the ancillary data
+    static constexpr char Tag = 'F';
+} // namespace
+
+bool
+send_fds(int sock, std::span<int const> fds) noexcept
+{
+    if (fds.empty() || fds.size() > MaxPassedFds) {
+        errno = EINVAL;
+        return false;
+    }
+
+    char tag = Tag;
+    iovec iov{&tag, sizeof(tag)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MaxPassedFds)] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    ssize_t nbytes = -1;
+    do {
+        nbytes = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (nbytes == -1 && errno == EINTR);
+    return nbytes == sizeof(tag);
+}
+
+int
+recv_fds(int sock, std::span<int> fds) noexcept
+{
+    char tag = 0;
+    iovec iov{&tag, sizeof(tag)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MaxPassedFds)] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t nbytes = -1;
+    do {
+        nbytes = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (nbytes == -1 && errno == EINTR);
+
+    if (nbytes != sizeof(tag) || tag != Tag) {
+        if (nbytes >= 0) {
+            errno = EPROTO;
+        }
+        return -1;
+    }
+
+    int count = 0;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        std::size_t const n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (std::size_t i = 0; i < n; ++i) {
+            int fd = -1;
+            std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (static_cast<std::size_t>(count) < fds.size()) {
+                fds[static_cast<std::size_t>(count++)] = fd;
+            } else {
+                ::close(fd); // no room for it; don't leak
+            }
+        }
+    }
+
+    if ((msg.msg_flags & MSG_CTRUNC) != 0) {
+        errno = EMSGSIZE;
+        for (int i = 0; i < count; ++i) {
+            ::close(fds[static_cast<std::size_t>(i)]);
+        }
+        return -1;
+    }
+    return count;
+}
+
+} // namespace ws
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+namespace ws {
+
+/// Max number of descriptors sent in a single fd_passing message
+static constexpr std::size_t MaxPassedFds = 16;
+
+/**
+ * Send file descriptors over a connected unix domain socket using
+ * SCM_RIGHTS. The receiver gets its own duplicates; the caller's copies
+ * stay open.
+ * @param sock Connected AF_UNIX socket
+ * @param fds Descriptors to send (at most MaxPassedFds)
+ * @return false on error (errno is set)
+ */
+bool send_fds(int sock, std::span<int const> fds) noexcept;
+
+/**
+ * Receive file descriptors sent with send_fds().
+ * @param sock Connected AF_UNIX socket
+ * @param fds Output; filled with the received descriptors
+ * @return number of descriptors received, or -1 on error
+ */
+int recv_fds(int sock, std::span<int> fds) noexcept;
+
+} // namespace ws
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+namespace ws {
+
+/*! \class  frame_pool
+ *  \brief  Allocator for coroutine frames. Blocks are carved out of large
+ *          chunks and recycled through one free list per size class, so
+ *          once warmed up, starting a coroutine allocates nothing from the
+ *          heap. Not thread safe: every reactor owns its own pool.
+ *
+ *  Each block starts with a small header naming its pool and size class,
+ *  which lets deallocate() be called without a pool at hand (as a
+ *  promise's operator delete is). Requests above MaxPooledSize are passed
+ *  through to the global operator new.
+ */
+class frame_pool
+{
+public:
+    static constexpr std::size_t Granularity = 64;      ///< size classes are multiples of this
+    static constexpr std::size_t MaxPooledSize = 4096;  ///< larger requests go to the heap
+    static constexpr std::size_t ChunkSize = 64 * 1024; ///< bytes requested from the heap at once
+
+private:
+    struct alignas(std::max_align_t) block_header
+    {
+        frame_pool* owner;      ///< pool the block came from, nullptr if from the heap
+        std::size_t size_class; ///< index into free_lists_
+    };
+
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    static constexpr std::size_t NumClasses = MaxPooledSize / Granularity;
+
+    std::array<free_block*, NumClasses> free_lists_{}; ///< recycled blocks per size class
+    std::vector<std::unique_ptr<std::byte[]>> chunks_; ///< memory the blocks are carved from
+    std::byte* chunk_pos_ = nullptr;                   ///< next unused byte of the last chunk
+    std::byte* chunk_end_ = nullptr;                   ///< end of the last chunk
+    std::size_t in_use_ = 0;                           ///< pooled blocks handed out
+    std::uint64_t heap_allocations_ = 0;               ///< chunks and oversized blocks allocated
+
+public:
+    frame_pool() noexcept = default;
+
+    // blocks point back at their pool: no copies/moves
+    frame_pool(frame_pool const&) = delete;
+    frame_pool(frame_pool&&) = delete;
+    frame_pool& operator=(frame_pool const&) = delete;
+    frame_pool&& operator=(frame_pool&&) = delete;
+
+    /// \return \c size bytes aligned for any type
+    /// \throw std::bad_alloc if the heap is exhausted
+    void* allocate(std::size_t size);
+
+    /// Return a block obtained from allocate() on any pool to that pool
+    static void deallocate(void* ptr) noexcept;
+
+    /// Pooled blocks currently handed out
+    std::size_t in_use() const noexcept;
+
+    /// Times the pool itself had to go to the heap
+    std::uint64_t heap_allocations() const noexcept;
+
+private:
+    void* carve(std::size_t block_size);
+};
+
+
+/**********************************************************************/
+
+inline void*
+frame_pool::allocate(std::size_t size)
+{
+    std::size_t const total = sizeof(block_header) + size;
+
+    block_header* header = nullptr;
+    if (total > MaxPooledSize) {
+        header = static_cast<block_header*>(::operator new(total));
+        header->owner = nullptr;
+        header->size_class = 0;
+        ++heap_allocations_;
+    } else {
+        std::size_t const size_class = (total - 1) / Granularity;
+        if (free_block* block = free_lists_[size_class]; block != nullptr) {
+            free_lists_[size_class] = block->next;
+            header = reinterpret_cast<block_header*>(block);
+        } else {
+            header = static_cast<block_header*>(carve((size_class + 1) * Granularity));
+        }
+        header->owner = this;
+        header->size_class = size_class;
+        ++in_use_;
+    }
+    return header + 1;
+}
+
+inline void
+frame_pool::deallocate(void* ptr) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+
+    block_header* const header = static_cast<block_header*>(ptr) - 1;
+    frame_pool* const pool = header->owner;
+    if (pool == nullptr) {
+        ::operator delete(header);
+        return;
+    }
+
+    std::size_t const size_class = header->size_class;
+    auto* const block = reinterpret_cast<free_block*>(header);
+    block->next = pool->free_lists_[size_class];
+    pool->free_lists_[size_class] = block;
+    --pool->in_use_;
+}
+
+inline std::size_t
+frame_pool::in_use() const noexcept
+{
+    return in_use_;
+}
+
+inline std::uint64_t
+frame_pool::heap_allocations() const noexcept
+{
+    return heap_allocations_;
+}
+
+inline void*
+frame_pool::carve(std::size_t block_size)
+{
+    // whatever is left of the current chunk is abandoned; it is at most
+    // one block's worth
+    if (static_cast<std::size_t>(chunk_end_ - chunk_pos_) < block_size) {
+        chunks_.push_back(std::make_unique_for_overwrite<std::byte[]>(ChunkSize));
+        chunk_pos_ = chunks_.back().get();
+        chunk_end_ = chunk_pos_ + ChunkSize;
+        ++heap_allocations_;
+    }
+
+    void* const block = chunk_pos_;
+    chunk_pos_ += block_size;
+    return block;
+}
+
+} // namespace ws
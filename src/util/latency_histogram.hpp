@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <array>
+#include <bit>   // std::bit_width
+#include <cmath> // std::ceil
+#include <cstddef>
+#include <cstdint>
+
+
+namespace ws {
+
+/*! \class  latency_histogram
+ *  \brief  Fixed-size log-linear histogram of durations (any unit, ns
+ *          in practice): every power of two is split into 8 buckets, so
+ *          a reported percentile is at most 12.5% above the true one.
+ *
+ *  Recording is a few instructions and never allocates, so it can sit on
+ *  the event loop's hot path. Not thread-safe; merge() per-thread copies.
+ */
+class latency_histogram
+{
+public:
+    static constexpr std::size_t SubBuckets = 8; ///< buckets per power of two
+
+    /// Count one sample of \c value
+    void record(std::uint64_t value) noexcept;
+
+    /// Add the samples of \c other
+    void merge(latency_histogram const& other) noexcept;
+
+    std::uint64_t count() const noexcept;
+    std::uint64_t max() const noexcept;
+    double mean() const noexcept;
+
+    /// \param pct 0 to 100
+    /// \return the upper bound of the bucket holding the \c pct th
+    ///         percentile (never above max()), 0 if empty
+    std::uint64_t percentile(double pct) const noexcept;
+
+private:
+    static constexpr std::size_t SubBits = 3; ///< log2(SubBuckets)
+    static constexpr std::size_t Buckets = (64 - SubBits + 1) * SubBuckets;
+
+    static std::size_t bucket_of(std::uint64_t value) noexcept;
+    static std::uint64_t upper_bound_of(std::size_t bucket) noexcept;
+
+    std::array<std::uint64_t, Buckets> buckets_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+
+/**********************************************************************/
+
+inline void
+latency_histogram::record(std::uint64_t value) noexcept
+{
+    ++buckets_[bucket_of(value)];
+    ++count_;
+    sum_ += value;
+    max_ = value > max_ ? value : max_;
+}
+
+inline void
+latency_histogram::merge(latency_histogram const& other) noexcept
+{
+    for (std::size_t i = 0; i < Buckets; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = other.max_ > max_ ? other.max_ : max_;
+}
+
+inline std::uint64_t
+latency_histogram::count() const noexcept
+{
+    return count_;
+}
+
+inline std::uint64_t
+latency_histogram::max() const noexcept
+{
+    return max_;
+}
+
+inline double
+latency_histogram::mean() const noexcept
+{
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+inline std::uint64_t
+latency_histogram::percentile(double pct) const noexcept
+{
+    if (count_ == 0) {
+        return 0;
+    }
+    auto const rank = static_cast<std::uint64_t>(
+            std::ceil(pct / 100.0 * static_cast<double>(count_)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < Buckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank && seen != 0) {
+            return std::min(upper_bound_of(i), max_);
+        }
+    }
+    return max_;
+}
+
+inline std::size_t
+latency_histogram::bucket_of(std::uint64_t value) noexcept
+{
+    // values below SubBuckets get a bucket each; above, the top SubBits
+    // bits under the leading one pick the bucket within its power of two
+    if (value < SubBuckets) {
+        return value;
+    }
+    std::size_t const width = std::bit_width(value);
+    std::size_t const shift = width - 1 - SubBits;
+    return (shift + 1) * SubBuckets + ((value >> shift) & (SubBuckets - 1));
+}
+
+inline std::uint64_t
+latency_histogram::upper_bound_of(std::size_t bucket) noexcept
+{
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+    std::size_t const shift = bucket / SubBuckets - 1;
+    std::uint64_t const lower = (SubBuckets + bucket % SubBuckets) << shift;
+    return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+} // namespace ws
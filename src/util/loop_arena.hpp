@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <bit>       // std::bit_ceil
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+
+namespace ws {
+
+/*! \class  loop_arena
+ *  \brief  Monotonic memory resource for the temporaries of one pass of an
+ *          event loop (parsed payloads, text copies, log previews, header
+ *          maps). reset() at the end of the pass frees everything at once.
+ *
+ *  Allocation bumps a pointer through the current chunk. Deallocation is
+ *  a no-op, except that freeing the most recent allocation gives its
+ *  bytes back, so a frame parsed, handled and destroyed per iteration of
+ *  an inner loop reuses the same bytes. When a pass needs more than one
+ *  chunk, reset() replaces the chunks with a single one big enough for
+ *  all of them: after a few passes the arena settles on its high water
+ *  mark and stops touching the heap. Not thread safe: every reactor owns
+ *  its own arena.
+ */
+class loop_arena : public std::pmr::memory_resource
+{
+public:
+    static constexpr std::size_t ChunkSize = 64 * 1024; ///< initial chunk size
+
+private:
+    struct chunk
+    {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size = 0;
+    };
+
+    std::vector<chunk> chunks_;          ///< the first one survives reset()
+    std::byte* pos_ = nullptr;           ///< next free byte of the last chunk
+    std::byte* end_ = nullptr;           ///< end of the last chunk
+    std::uint64_t heap_allocations_ = 0; ///< chunks allocated
+
+public:
+    loop_arena() noexcept = default;
+
+    // allocations point into our chunks: no copies/moves
+    loop_arena(loop_arena const&) = delete;
+    loop_arena(loop_arena&&) = delete;
+    loop_arena& operator=(loop_arena const&) = delete;
+    loop_arena&& operator=(loop_arena&&) = delete;
+
+    /// Free everything allocated since the last reset. Nothing allocated
+    /// from the arena may be used afterwards.
+    void reset();
+
+    /// Bytes the chunks hold
+    std::size_t capacity() const noexcept;
+
+    /// Times the arena itself had to go to the heap
+    std::uint64_t heap_allocations() const noexcept;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+
+    void add_chunk(std::size_t size);
+};
+
+
+/**********************************************************************/
+
+inline void
+loop_arena::reset()
+{
+    if (chunks_.size() > 1) {
+        std::size_t const total = capacity();
+        chunks_.clear();
+        add_chunk(std::bit_ceil(total));
+        return;
+    }
+    if (!chunks_.empty()) {
+        pos_ = chunks_.front().data.get();
+    }
+}
+
+inline std::size_t
+loop_arena::capacity() const noexcept
+{
+    std::size_t total = 0;
+    for (chunk const& c : chunks_) {
+        total += c.size;
+    }
+    return total;
+}
+
+inline std::uint64_t
+loop_arena::heap_allocations() const noexcept
+{
+    return heap_allocations_;
+}
+
+inline void*
+loop_arena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    auto const aligned = [&] {
+        auto const addr = reinterpret_cast<std::uintptr_t>(pos_);
+        return reinterpret_cast<std::byte*>((addr + alignment - 1) & ~(alignment - 1));
+    };
+
+    std::byte* ptr = aligned();
+    if (pos_ == nullptr || ptr > end_ || static_cast<std::size_t>(end_ - ptr) < bytes) {
+        add_chunk(std::max(ChunkSize, std::bit_ceil(bytes + alignment)));
+        ptr = aligned();
+    }
+    pos_ = ptr + bytes;
+    return ptr;
+}
+
+inline void
+loop_arena::do_deallocate(void* ptr, std::size_t bytes, std::size_t)
+{
+    // only the last allocation can be given back
+    if (static_cast<std::byte*>(ptr) + bytes == pos_) {
+        pos_ = static_cast<std::byte*>(ptr);
+    }
+}
+
+inline bool
+loop_arena::do_is_equal(std::pmr::memory_resource const& other) const noexcept
+{
+    return this == &other;
+}
+
+inline void
+loop_arena::add_chunk(std::size_t size)
+{
+    chunks_.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+    pos_ = chunks_.back().data.get();
+    end_ = pos_ + size;
+    ++heap_allocations_;
+}
+
+} // namespace ws
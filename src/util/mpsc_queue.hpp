@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <bit> // std::bit_ceil
+#include <cstddef>
+#include <memory>
+#include <utility> // std::move
+
+
+namespace ws {
+
+/*! \class  mpsc_queue
+ *  \brief  Bounded lock-free queue with any number of producer threads
+ *          and a single consumer thread. A ring of slots, each carrying
+ *          a sequence number that says whose turn it is (D. Vyukov's
+ *          bounded queue): producers claim a slot with one CAS on the
+ *          tail, the consumer needs no atomic read-modify-write at all.
+ *
+ *  Pushing to a full queue fails instead of waiting; slots are reused in
+ *  place, so nothing is allocated after construction (beyond what moving
+ *  a \c T allocates).
+ */
+template <typename T>
+class mpsc_queue
+{
+private:
+    struct slot
+    {
+        std::atomic<std::size_t> sequence; ///< == pos: free for the push at pos, pos + 1: full
+        T value;
+    };
+
+    static constexpr std::size_t CacheLine = 64;
+
+    std::size_t mask_;                                    ///< capacity - 1
+    std::unique_ptr<slot[]> slots_;                       ///< the ring
+    alignas(CacheLine) std::atomic<std::size_t> tail_{0}; ///< next position to push to
+    alignas(CacheLine) std::size_t head_ = 0;             ///< next position to pop from
+
+public:
+    /// \param capacity max queued elements, rounded up to a power of two
+    explicit mpsc_queue(std::size_t capacity);
+
+    // producers hold on to the slots: no copies/moves
+    mpsc_queue(mpsc_queue const&) = delete;
+    mpsc_queue(mpsc_queue&&) = delete;
+    mpsc_queue& operator=(mpsc_queue const&) = delete;
+    mpsc_queue&& operator=(mpsc_queue&&) = delete;
+
+    /// Append \c value. Safe to call from any thread.
+    /// \return \c false if the queue is full (\c value is left alone)
+    bool try_push(T&& value);
+
+    /// Take the oldest element. Consumer thread only.
+    /// \return \c false if the queue is empty
+    bool try_pop(T& out);
+
+    /// \return \c true if nothing is queued. Exact on the consumer thread
+    ///         as far as completed pushes go.
+    bool empty() const noexcept;
+
+    std::size_t capacity() const noexcept;
+};
+
+
+/**********************************************************************/
+
+template <typename T>
+mpsc_queue<T>::mpsc_queue(std::size_t capacity)
+        : mask_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1)
+        , slots_(std::make_unique<slot[]>(mask_ + 1))
+{
+    for (std::size_t i = 0; i <= mask_; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+bool
+mpsc_queue<T>::try_push(T&& value)
+{
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    slot* s = nullptr;
+    for (;;) {
+        s = &slots_[pos & mask_];
+        std::size_t const sequence = s->sequence.load(std::memory_order_acquire);
+        auto const diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        if (diff == 0) {
+            // our turn, if no other producer beats us to it
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // the consumer hasn't freed this slot yet: full
+        } else {
+            pos = tail_.load(std::memory_order_relaxed); // lost the race, retry
+        }
+    }
+
+    s->value = std::move(value);
+    s->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool
+mpsc_queue<T>::try_pop(T& out)
+{
+    slot& s = slots_[head_ & mask_];
+    if (s.sequence.load(std::memory_order_acquire) != head_ + 1) {
+        return false;
+    }
+
+    out = std::move(s.value);
+    s.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return true;
+}
+
+template <typename T>
+bool
+mpsc_queue<T>::empty() const noexcept
+{
+    return slots_[head_ & mask_].sequence.load(std::memory_order_acquire) != head_ + 1;
+}
+
+template <typename T>
+std::size_t
+mpsc_queue<T>::capacity() const noexcept
+{
+    return mask_ + 1;
+}
+
+} // namespace ws
@@ -0,0 +1,37 @@
+#pragma once
+
+/**
+ * USDT (user-level statically defined tracing) probes, provider \c ws.
+ *
+ * With <sys/sdt.h> available (systemtap-sdt-dev, meson option \c probes)
+ * every WS_PROBE() compiles to a single nop plus an ELF note saying where
+ * its arguments live; nothing runs until a tracer attaches, e.g.
+ * `bpftrace -e 'usdt:build/echo_server:ws:frame_parsed { @[arg1] = count(); }'`.
+ * Without it WS_PROBE() compiles to nothing and its arguments aren't
+ * evaluated, so they must have no side effects. Arguments are integers
+ * or pointers, at most 12 of them.
+ *
+ * Probes of the event loop (see scripts/bpftrace for histograms built
+ * from them):
+ *   accept(fd, ip, port)              connection admitted; ip is a C string,
+ *                                     "unix" for unix domain sockets
+ *   handshake_start(fd)               upgrade request received in full
+ *   handshake_end(fd, id)             101 sent; id as in server_config::on_open
+ *   frame_parsed(fd, opcode, length)  frame parsed, about to be handled
+ *   message_dispatched(fd, opcode, length)
+ *                                     complete message handed to its handler
+ *                                     (echo, batch, processor, coroutine, backend)
+ *   send_queued(fd, bytes, queued)    frame queued for the end of the pass;
+ *                                     queued is the connection's total since
+ *   send_flushed(fd, bytes)           bytes written to the socket in one syscall
+ *   backpressure(fd, on)              socket full (1), we wait for EPOLLOUT; or
+ *                                     writable again (0)
+ *   disconnect(fd)                    connection torn down
+ */
+
+#ifdef WS_PROBES
+#include <sys/sdt.h>
+#define WS_PROBE(...) STAP_PROBEV(ws, __VA_ARGS__)
+#else
+#define WS_PROBE(...) ((void)0)
+#endif
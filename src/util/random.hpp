@@ -0,0 +1,98 @@
+#pragma once
+
+#include <sys/random.h> // ::getrandom
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace ws {
+
+/*! \class  wyrand
+ *  \brief  Tiny, fast, non-cryptographic 64-bit PRNG (wyrand, from
+ *          wyhash). One multiply per call and 8 bytes of state; good
+ *          enough for websocket masking keys in load generators and
+ *          proxies, never for anything secret.
+ */
+class wyrand
+{
+private:
+    std::uint64_t state_ = 0;
+
+public:
+    constexpr explicit wyrand(std::uint64_t seed) noexcept;
+
+    /// \return next 64 random bits
+    constexpr std::uint64_t next() noexcept;
+
+    /// \return next 32 random bits
+    constexpr std::uint32_t next_u32() noexcept;
+};
+
+/// Fill \c out from the kernel CSPRNG (getrandom(2)). Blocks only until
+/// the kernel pool is initialized at boot.
+/// \return \c false on error
+bool secure_random_bytes(std::span<std::uint8_t> out) noexcept;
+
+/// 32 random bits from a thread-local wyrand seeded from the kernel
+/// CSPRNG. Fast, but predictable to anyone who observes enough output.
+std::uint32_t fast_random_u32() noexcept;
+
+
+/**********************************************************************/
+
+constexpr wyrand::wyrand(std::uint64_t seed) noexcept
+        : state_(seed)
+{
+    // empty
+}
+
+constexpr std::uint64_t
+wyrand::next() noexcept
+{
+    __extension__ using uint128_t = unsigned __int128;
+
+    state_ += 0xa0761d6478bd642fULL;
+    uint128_t const product = static_cast<uint128_t>(state_) * (state_ ^ 0xe7037ed1a0b428dbULL);
+    return static_cast<std::uint64_t>(product >> 64) ^ static_cast<std::uint64_t>(product);
+}
+
+constexpr std::uint32_t
+wyrand::next_u32() noexcept
+{
+    return static_cast<std::uint32_t>(next() >> 32);
+}
+
+inline bool
+secure_random_bytes(std::span<std::uint8_t> out) noexcept
+{
+    while (!out.empty()) {
+        ssize_t const nbytes = ::getrandom(out.data(), out.size(), 0);
+        if (nbytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        out = out.subspan(static_cast<std::size_t>(nbytes));
+    }
+    return true;
+}
+
+inline std::uint32_t
+fast_random_u32() noexcept
+{
+    static thread_local wyrand rng([] {
+        std::uint64_t seed = 0;
+        auto const seed_bytes = std::span(reinterpret_cast<std::uint8_t*>(&seed), sizeof(seed));
+        if (!secure_random_bytes(seed_bytes)) {
+            // no kernel entropy; distinct per thread is all masking needs
+            seed = reinterpret_cast<std::uintptr_t>(&seed) ^ 0x9e3779b97f4a7c15ULL;
+        }
+        return wyrand(seed);
+    }());
+    return rng.next_u32();
+}
+
+} // namespace ws
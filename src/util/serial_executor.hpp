@@ -0,0 +1,124 @@
+#pragma once
+
+#include "mpsc_queue.hpp"
+#include "worker_pool.hpp"
+#include <algorithm> // std::min
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <utility> // std::move
+
+
+namespace ws {
+
+/*! \class  serial_executor
+ *  \brief  Runs jobs on a worker_pool one at a time, in the order they
+ *          were submitted (a strand). Whatever number of workers the pool
+ *          has, no two jobs of one executor ever overlap, so per-executor
+ *          state needs no locking.
+ *
+ *  Jobs wait in a bounded lock-free queue. The submit that finds the
+ *  executor idle schedules it; once on a worker it runs a batch of jobs
+ *  and, if more have arrived, schedules itself again, which keeps it on
+ *  that worker unless another one steals it.
+ */
+template <typename Job>
+class serial_executor final : public worker_pool::task
+{
+public:
+    /// Jobs run per turn on a worker before giving the others a chance
+    static constexpr std::size_t Batch = 16;
+
+    /// \param capacity max jobs waiting, rounded up to a power of two
+    /// \param fn called on a worker with each job
+    serial_executor(worker_pool& pool, std::size_t capacity, std::function<void(Job&)> fn);
+
+    // the pool holds on to us: no copies/moves
+    serial_executor(serial_executor const&) = delete;
+    serial_executor(serial_executor&&) = delete;
+    serial_executor& operator=(serial_executor const&) = delete;
+    serial_executor&& operator=(serial_executor&&) = delete;
+
+    /// Queue \c job. Safe to call from any thread.
+    /// \return \c false if \c capacity jobs are already waiting
+    bool submit(Job&& job);
+
+    /// \return \c true once every submitted job has run and no worker is
+    ///         touching the executor any more, i.e. it may be destroyed.
+    ///         Only conclusive while nothing is being submitted.
+    bool idle() const noexcept;
+
+    /// Run a batch of jobs. Called by the pool.
+    void run() noexcept override;
+
+private:
+    worker_pool& pool_;                   ///< where we run
+    std::function<void(Job&)> fn_;        ///< what we run
+    mpsc_queue<Job> jobs_;                ///< waiting jobs
+    std::atomic<std::size_t> pending_{0}; ///< submitted, not yet run
+    std::atomic<bool> running_{false};    ///< a worker is in run()
+};
+
+
+/**********************************************************************/
+
+template <typename Job>
+serial_executor<Job>::serial_executor(
+        worker_pool& pool, std::size_t capacity, std::function<void(Job&)> fn)
+        : pool_(pool)
+        , fn_(std::move(fn))
+        , jobs_(capacity)
+{
+    // empty
+}
+
+template <typename Job>
+bool
+serial_executor<Job>::submit(Job&& job)
+{
+    if (!jobs_.try_push(std::move(job))) {
+        return false;
+    }
+
+    // the first job since we went idle puts us on the pool
+    if (pending_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        pool_.schedule(*this);
+    }
+    return true;
+}
+
+template <typename Job>
+bool
+serial_executor<Job>::idle() const noexcept
+{
+    // in this order: run() clears running_ after its last pending_ update
+    return pending_.load(std::memory_order_acquire) == 0
+            && !running_.load(std::memory_order_acquire);
+}
+
+template <typename Job>
+void
+serial_executor<Job>::run() noexcept
+{
+    running_.store(true, std::memory_order_relaxed);
+
+    // only jobs that have been counted; one pushed but not yet counted
+    // comes with a schedule() of its own. a counted job may still be
+    // missing from the queue: another producer claimed the slot ahead of
+    // it and hasn't filled it yet. it stays pending, for the next turn
+    std::size_t const count = std::min(Batch, pending_.load(std::memory_order_acquire));
+    std::size_t ran = 0;
+    Job job;
+    while (ran < count && jobs_.try_pop(job)) {
+        fn_(job);
+        ++ran;
+    }
+
+    bool const more = pending_.fetch_sub(ran, std::memory_order_acq_rel) > ran;
+    running_.store(false, std::memory_order_release);
+    if (more) {
+        pool_.schedule(*this);
+    }
+}
+
+} // namespace ws
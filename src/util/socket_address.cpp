@@ -0,0 +1,93 @@
+#include "socket_address.hpp"
+#include <netdb.h>  // ::getaddrinfo
+#include <sys/un.h> // sockaddr_un
+#include <unistd.h> // ::close
+#include <cerrno>
+#include <cstddef> // offsetof
+#include <cstring> // std::memcpy
+#include <stdexcept>
+#include <string_view>
+
+namespace ws {
+namespace {
+    static constexpr std::string_view UnixPrefix = "unix:";
+} // namespace
+
+socket_address
+resolve_socket_address(std::string const& address)
+{
+    socket_address result;
+
+    if (address.starts_with(UnixPrefix)) {
+        std::string_view const path = std::string_view(address).substr(UnixPrefix.size());
+        bool const abstract = path.starts_with('@');
+        sockaddr_un addr{};
+        if (path.size() <= (abstract ? 1 : 0) || path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("invalid unix socket path: " + address);
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.data(), path.size());
+        result.size = sizeof(addr);
+        if (abstract) {
+            // a leading nul, and the name is exactly as long as the
+            // address says: no terminator, no padding
+            addr.sun_path[0] = '\0';
+            result.size = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+        }
+        std::memcpy(&result.storage, &addr, sizeof(addr));
+        return result;
+    }
+
+    // host:port, with the host of an ipv6 address in brackets
+    std::size_t const colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+        throw std::runtime_error("expected host:port or unix:PATH: " + address);
+    }
+    std::string host = address.substr(0, colon);
+    std::string const port = address.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;     // ipv4 or ipv6
+    hints.ai_socktype = SOCK_STREAM; // tcp
+
+    addrinfo* info = nullptr;
+    if (int rv = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &info); rv != 0) {
+        throw std::runtime_error("getaddrinfo (" + address + "): " + ::gai_strerror(rv));
+    }
+    std::memcpy(&result.storage, info->ai_addr, info->ai_addrlen);
+    result.size = info->ai_addrlen;
+    ::freeaddrinfo(info);
+    return result;
+}
+
+std::string
+unix_socket_path(socket_address const& addr)
+{
+    if (addr.family() != AF_UNIX) {
+        return {};
+    }
+    char const* path = reinterpret_cast<sockaddr_un const*>(addr.get())->sun_path;
+    return path[0] == '\0' ? std::string() : std::string(path);
+}
+
+int
+connect_socket(socket_address const& addr) noexcept
+{
+    int const sock = ::socket(addr.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1) {
+        return -1;
+    }
+
+    if (::connect(sock, addr.get(), addr.size) == -1) {
+        int const err = errno;
+        ::close(sock);
+        errno = err;
+        return -1;
+    }
+    return sock;
+}
+
+} // namespace ws
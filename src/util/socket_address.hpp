@@ -0,0 +1,54 @@
+#pragma once
+
+#include <sys/socket.h> // sockaddr, sockaddr_storage, socklen_t
+#include <string>
+
+namespace ws {
+
+/// A resolved address for a stream socket: tcp over ipv4/ipv6 or a unix
+/// domain socket
+struct socket_address
+{
+    sockaddr_storage storage{}; ///< sockaddr_in, sockaddr_in6 or sockaddr_un
+    socklen_t size = 0;         ///< bytes of storage in use
+
+    int
+    family() const noexcept
+    {
+        return storage.ss_family;
+    }
+
+    sockaddr const*
+    get() const noexcept
+    {
+        return reinterpret_cast<sockaddr const*>(&storage);
+    }
+};
+
+/**
+ * Resolve a textual address: "host:port" for tcp (an ipv6 host goes in
+ * brackets, "[::1]:9000"), "unix:PATH" for a unix domain socket in the
+ * filesystem or "unix:@NAME" for one in the (linux) abstract namespace.
+ * @param address Address to resolve
+ * @return the first address the host resolves to
+ * @throw std::runtime_error if the address is malformed or doesn't resolve
+ */
+socket_address resolve_socket_address(std::string const& address);
+
+/**
+ * The filesystem path of a unix domain socket address, which its listener
+ * has to unlink.
+ * @param addr Address to look at
+ * @return the path, empty for tcp and abstract unix addresses
+ */
+std::string unix_socket_path(socket_address const& addr);
+
+/**
+ * Open a stream socket of the right family and connect it to \c addr. The
+ * connect blocks, which is only reasonable for local or nearby peers.
+ * @param addr Address to connect to
+ * @return the connected (blocking) socket, or -1 on error (errno is set)
+ */
+int connect_socket(socket_address const& addr) noexcept;
+
+} // namespace ws
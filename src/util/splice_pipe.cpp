@@ -0,0 +1,143 @@
+#include "splice_pipe.hpp"
+#include <fcntl.h>  // ::pipe2, ::splice, F_GETPIPE_SZ, F_SETPIPE_SZ
+#include <unistd.h> // ::close, ::read
+#include <algorithm> // std::min
+#include <cerrno>
+#include <cstdint>
+#include <cstring> // std::strerror
+#include <stdexcept>
+#include <string>
+#include <utility> // std::exchange
+
+namespace ws {
+
+splice_pipe::splice_pipe(std::size_t size)
+{
+    int fds[2] = {-1, -1};
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+        throw std::runtime_error(std::string("pipe2: ") + std::strerror(errno));
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+
+    // a bigger pipe moves more per splice. not fatal: the default works
+    if (size != 0) {
+        ::fcntl(write_fd_, F_SETPIPE_SZ, static_cast<int>(size));
+    }
+
+    int const capacity = ::fcntl(write_fd_, F_GETPIPE_SZ);
+    if (capacity == -1) {
+        int const err = errno;
+        close();
+        throw std::runtime_error(std::string("fcntl (F_GETPIPE_SZ): ") + std::strerror(err));
+    }
+    capacity_ = static_cast<std::size_t>(capacity);
+}
+
+splice_pipe::~splice_pipe() noexcept
+{
+    close();
+}
+
+splice_pipe::splice_pipe(splice_pipe&& other) noexcept
+        : read_fd_(std::exchange(other.read_fd_, -1))
+        , write_fd_(std::exchange(other.write_fd_, -1))
+        , capacity_(std::exchange(other.capacity_, 0))
+        , pending_(std::exchange(other.pending_, 0))
+{
+    // empty
+}
+
+splice_pipe&
+splice_pipe::operator=(splice_pipe&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        read_fd_ = std::exchange(other.read_fd_, -1);
+        write_fd_ = std::exchange(other.write_fd_, -1);
+        capacity_ = std::exchange(other.capacity_, 0);
+        pending_ = std::exchange(other.pending_, 0);
+    }
+    return *this;
+}
+
+ssize_t
+splice_pipe::fill(int fd, std::size_t max) noexcept
+{
+    std::size_t const room = std::min(max, capacity_ - pending_);
+    if (room == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    ssize_t nbytes = -1;
+    do {
+        nbytes = ::splice(fd, nullptr, write_fd_, nullptr, room, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    } while (nbytes == -1 && errno == EINTR);
+
+    if (nbytes > 0) {
+        pending_ += static_cast<std::size_t>(nbytes);
+    }
+    return nbytes;
+}
+
+bool
+splice_pipe::drain(int fd) noexcept
+{
+    while (pending_ > 0) {
+        ssize_t const nbytes = ::splice(
+                read_fd_, nullptr, fd, nullptr, pending_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (nbytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        pending_ -= static_cast<std::size_t>(nbytes);
+    }
+    return true;
+}
+
+void
+splice_pipe::clear() noexcept
+{
+    std::uint8_t scratch[4096];
+    while (pending_ > 0) {
+        ssize_t const nbytes = ::read(read_fd_, scratch, std::min(pending_, sizeof(scratch)));
+        if (nbytes <= 0) {
+            if (nbytes == -1 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        pending_ -= static_cast<std::size_t>(nbytes);
+    }
+    pending_ = 0;
+}
+
+std::size_t
+splice_pipe::pending() const noexcept
+{
+    return pending_;
+}
+
+std::size_t
+splice_pipe::capacity() const noexcept
+{
+    return capacity_;
+}
+
+void
+splice_pipe::close() noexcept
+{
+    if (read_fd_ != -1) {
+        ::close(read_fd_);
+        read_fd_ = -1;
+    }
+    if (write_fd_ != -1) {
+        ::close(write_fd_);
+        write_fd_ = -1;
+    }
+}
+
+} // namespace ws
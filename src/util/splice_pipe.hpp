@@ -0,0 +1,59 @@
+#pragma once
+
+#include <sys/types.h> // ssize_t
+#include <cstddef>
+
+namespace ws {
+
+/*! \class  splice_pipe
+ *  \brief  A pipe used to move bytes from one socket to another with
+ *          splice(2), so they never pass through user space. Keeps track
+ *          of how many bytes are sitting in the pipe.
+ *
+ *  Both ends of the pipe are non-blocking; whether a fill or drain blocks
+ *  is up to the socket on the other side.
+ */
+class splice_pipe
+{
+private:
+    int read_fd_ = -1;         ///< read end of the pipe
+    int write_fd_ = -1;        ///< write end of the pipe
+    std::size_t capacity_ = 0; ///< pipe buffer size
+    std::size_t pending_ = 0;  ///< bytes spliced in but not out yet
+
+public:
+    /// \param size requested pipe buffer size (F_SETPIPE_SZ), 0 = kernel
+    ///        default. Sizes above fs.pipe-max-size keep the default.
+    /// \throw std::runtime_error if the pipe can't be created
+    explicit splice_pipe(std::size_t size = 0);
+    ~splice_pipe() noexcept;
+
+    splice_pipe(splice_pipe&&) noexcept;
+    splice_pipe& operator=(splice_pipe&&) noexcept;
+
+    // no copies
+    splice_pipe(splice_pipe const&) = delete;
+    splice_pipe& operator=(splice_pipe const&) = delete;
+
+    /// Move up to \c max bytes (and no more than there is room for) from
+    /// \c fd into the pipe.
+    /// \return bytes moved, 0 at end of file, -1 on error (errno is set;
+    ///         EAGAIN if \c fd had nothing to read or the pipe is full)
+    ssize_t fill(int fd, std::size_t max = static_cast<std::size_t>(-1)) noexcept;
+
+    /// Move every pending byte to \c fd.
+    /// \return \c false on error (errno is set; EAGAIN if \c fd is
+    ///         non-blocking and full). pending() tells what is left.
+    bool drain(int fd) noexcept;
+
+    /// Throw away whatever is still in the pipe
+    void clear() noexcept;
+
+    std::size_t pending() const noexcept;
+    std::size_t capacity() const noexcept;
+
+private:
+    void close() noexcept;
+};
+
+} // namespace ws
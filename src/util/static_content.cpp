@@ -0,0 +1,231 @@
+#include "static_content.hpp"
+#include "sha1.hpp"
+#include <fcntl.h>    // ::open
+#include <sys/mman.h> // ::mmap, ::munmap
+#include <sys/stat.h> // ::fstat
+#include <unistd.h>   // ::close
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <filesystem>
+#include <format>
+#include <iterator> // std::back_inserter
+#include <stdexcept>
+#include <utility> // std::move
+
+namespace ws {
+
+namespace {
+    /// Unmaps on scope exit
+    struct file_mapping
+    {
+        void* data = MAP_FAILED;
+        std::size_t size = 0;
+
+        ~file_mapping() noexcept
+        {
+            if (data != MAP_FAILED) {
+                ::munmap(data, size);
+            }
+        }
+    };
+
+    /// \c s without leading and trailing spaces and tabs
+    std::string_view
+    trimmed(std::string_view s) noexcept
+    {
+        std::size_t const begin = s.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) {
+            return {};
+        }
+        return s.substr(begin, s.find_last_not_of(" \t") - begin + 1);
+    }
+} // namespace
+
+static_content::static_content(std::string const& root)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        throw std::runtime_error("static content root is not a directory: " + root);
+    }
+
+    auto itr = fs::recursive_directory_iterator(root, ec);
+    if (ec) {
+        throw std::runtime_error("static content root (" + root + "): " + ec.message());
+    }
+    for (auto const end = fs::recursive_directory_iterator(); itr != end; itr.increment(ec)) {
+        if (ec) {
+            throw std::runtime_error("static content root (" + root + "): " + ec.message());
+        }
+        fs::path const& path = itr->path();
+        if (path.filename().native().starts_with('.')) {
+            if (itr->is_directory(ec)) {
+                itr.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (itr->is_regular_file(ec)) {
+            load(path.native(), "/" + fs::relative(path, root).generic_string());
+        }
+    }
+}
+
+static_content::~static_content() noexcept
+{
+    for (auto const& [path, file] : files_) {
+        if (file.fd != -1) {
+            ::close(file.fd);
+        }
+    }
+}
+
+static_file const*
+static_content::find(std::string_view target) const noexcept
+{
+    target = target.substr(0, target.find_first_of("?#"));
+
+    auto itr = files_.end();
+    if (target.ends_with('/')) {
+        // "/" + "index.html" without allocating
+        char path[512];
+        constexpr std::string_view Index = "index.html";
+        if (target.size() + Index.size() <= sizeof(path)) {
+            target.copy(path, target.size());
+            Index.copy(path + target.size(), Index.size());
+            itr = files_.find(std::string_view(path, target.size() + Index.size()));
+        }
+    } else {
+        itr = files_.find(target);
+    }
+    return itr != files_.end() ? &itr->second : nullptr;
+}
+
+std::size_t
+static_content::size() const noexcept
+{
+    return files_.size();
+}
+
+std::size_t
+static_content::memory_bytes() const noexcept
+{
+    return memory_bytes_;
+}
+
+void
+static_content::load(std::string const& path, std::string request_path)
+{
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("open (" + path + "): " + std::strerror(errno));
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) == -1) {
+        int const err = errno;
+        ::close(fd);
+        throw std::runtime_error("fstat (" + path + "): " + std::strerror(err));
+    }
+
+    static_file file;
+    file.size = static_cast<std::size_t>(st.st_size);
+    file.content_type = content_type(path);
+
+    file_mapping map;
+    map.size = file.size;
+    std::string_view contents;
+    if (file.size != 0) {
+        map.data = ::mmap(nullptr, map.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map.data == MAP_FAILED) {
+            int const err = errno;
+            ::close(fd);
+            throw std::runtime_error("mmap (" + path + "): " + std::strerror(err));
+        }
+        contents = std::string_view(static_cast<char const*>(map.data), map.size);
+    }
+
+    sha1::digest_type const digest = sha1::hash(contents);
+    file.etag = "\"";
+    for (std::size_t i = 0; i < 8; ++i) {
+        std::format_to(std::back_inserter(file.etag), "{:02x}", digest[i]);
+    }
+    file.etag += '"';
+
+    file.response = std::format("HTTP/1.1 200 OK\r\n"
+                                "Content-Type: {}\r\n"
+                                "Content-Length: {}\r\n"
+                                "ETag: {}\r\n"
+                                "Cache-Control: no-cache\r\n"
+                                "\r\n",
+            file.content_type, file.size, file.etag);
+    file.header_size = file.response.size();
+    file.not_modified = std::format("HTTP/1.1 304 Not Modified\r\n"
+                                     "ETag: {}\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "\r\n",
+            file.etag);
+
+    if (file.size <= MemoryLimit) {
+        file.response.append(contents);
+        ::close(fd);
+    } else {
+        file.fd = fd;
+    }
+    memory_bytes_ += file.response.size() + file.not_modified.size();
+
+    files_.emplace(std::move(request_path), std::move(file));
+}
+
+bool
+if_none_match(std::string_view header, std::string_view etag) noexcept
+{
+    // a comma separated list of (possibly weak) entity tags; the weak
+    // comparison applies (rfc 9110, 13.1.2)
+    while (!header.empty()) {
+        std::size_t const comma = header.find(',');
+        std::string_view tag = trimmed(header.substr(0, comma));
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+        if (tag == "*") {
+            return true;
+        }
+        if (tag.starts_with("W/")) {
+            tag.remove_prefix(2);
+        }
+        if (tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view
+content_type(std::string_view file_name) noexcept
+{
+    static constexpr std::pair<std::string_view, std::string_view> Types[] = {
+            {".html", "text/html; charset=utf-8"},
+            {".htm", "text/html; charset=utf-8"},
+            {".js", "text/javascript; charset=utf-8"},
+            {".mjs", "text/javascript; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"},
+            {".json", "application/json"},
+            {".map", "application/json"},
+            {".txt", "text/plain; charset=utf-8"},
+            {".svg", "image/svg+xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".ico", "image/x-icon"},
+            {".wasm", "application/wasm"},
+    };
+
+    for (auto const& [extension, type] : Types) {
+        if (file_name.ends_with(extension)) {
+            return type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+} // namespace ws
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+namespace ws {
+
+/// A file served by static_content, with its responses built when it was
+/// loaded
+struct static_file
+{
+    std::string content_type;
+    std::string etag;            ///< strong validator, quoted: content hash
+    std::size_t size = 0;        ///< content length
+    std::string response;        ///< 200 response headers, followed by the contents if in_memory
+    std::size_t header_size = 0; ///< of response
+    std::string not_modified;    ///< complete 304 response
+    int fd = -1;                 ///< open file to sendfile() from if not in_memory, else -1
+
+    bool
+    in_memory() const noexcept
+    {
+        return fd == -1;
+    }
+};
+
+/*! \class  static_content
+ *  \brief  The files under a directory, loaded once and served from
+ *          memory or with sendfile().
+ *
+ *  Every regular file under the root (dot files and directories aside) is
+ *  opened, hashed for its ETag and given precomputed 200 and 304
+ *  responses when the content is loaded. Files up to MemoryLimit are kept
+ *  in memory, right behind their headers, so a response is one send;
+ *  larger ones stay open for sendfile(). Changes on disk after loading
+ *  are not picked up. Request paths are matched literally (no percent
+ *  decoding), so nothing outside the root can be named.
+ */
+class static_content
+{
+public:
+    static constexpr std::size_t MemoryLimit = 64 * 1024; ///< larger files go out with sendfile()
+
+private:
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        std::size_t
+        operator()(std::string_view s) const noexcept
+        {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+public:
+    /// \throw std::runtime_error if \c root isn't a directory or a file
+    ///        under it can't be read
+    explicit static_content(std::string const& root);
+    ~static_content() noexcept;
+
+    // owns the file descriptors: no copies/moves
+    static_content(static_content const&) = delete;
+    static_content(static_content&&) = delete;
+    static_content& operator=(static_content const&) = delete;
+    static_content&& operator=(static_content&&) = delete;
+
+    /// \param target request target; the query is ignored, "/" and paths
+    ///        ending in "/" mean their index.html
+    /// \return the file, \c nullptr if there is none
+    static_file const* find(std::string_view target) const noexcept;
+
+    /// Files loaded
+    std::size_t size() const noexcept;
+
+    /// Bytes kept in memory, headers included
+    std::size_t memory_bytes() const noexcept;
+
+private:
+    void load(std::string const& path, std::string request_path);
+
+private:
+    std::unordered_map<std::string, static_file, string_hash, std::equal_to<>> files_;
+    std::size_t memory_bytes_ = 0;
+};
+
+/// \return \c true if an If-None-Match header value names \c etag (or is "*")
+bool if_none_match(std::string_view header, std::string_view etag) noexcept;
+
+/// \return the Content-Type for a file name, by extension
+std::string_view content_type(std::string_view file_name) noexcept;
+
+} // namespace ws
@@ -0,0 +1,127 @@
+#include "timestamping.hpp"
+#include <time.h>             // ::clock_gettime, timespec (<linux/errqueue.h> expects it)
+#include <linux/errqueue.h>   // sock_extended_err, scm_timestamping, SCM_TSTAMP_*
+#include <linux/net_tstamp.h> // SOF_TIMESTAMPING_*
+#include <netinet/in.h>       // IPPROTO_IP, IPPROTO_IPV6, IP_RECVERR, IPV6_RECVERR
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring> // std::memcpy
+
+namespace ws {
+
+namespace {
+    /// software stamps only: no hardware or driver support needed. OPT_ID
+    /// keys every send by its byte offset, OPT_TSONLY keeps the payload
+    /// off the error queue
+    static constexpr unsigned TimestampingFlags = SOF_TIMESTAMPING_RX_SOFTWARE
+            | SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_ACK | SOF_TIMESTAMPING_SOFTWARE
+            | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+    std::int64_t
+    to_ns(timespec const& ts) noexcept
+    {
+        return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+} // namespace
+
+bool
+enable_timestamping(int sock) noexcept
+{
+#ifdef SOF_TIMESTAMPING_OPT_ID_TCP
+    // count from the next byte written rather than the next one acked
+    // (linux 6.2); older kernels reject the flag
+    unsigned const flags = TimestampingFlags | SOF_TIMESTAMPING_OPT_ID_TCP;
+    if (::setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        return true;
+    }
+#endif
+    unsigned const flags_without = TimestampingFlags;
+    return ::setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags_without, sizeof(flags_without))
+            == 0;
+}
+
+std::int64_t
+realtime_ns() noexcept
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return to_ns(ts);
+}
+
+ssize_t
+recv_timestamped(int sock, void* buf, std::size_t len, int flags, std::int64_t& rx_ns) noexcept
+{
+    iovec iov{buf, len};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t const nbytes = ::recvmsg(sock, &msg, flags);
+    if (nbytes <= 0) {
+        return nbytes;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            scm_timestamping stamps{};
+            std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            if (std::int64_t const ns = to_ns(stamps.ts[0]); ns != 0) {
+                rx_ns = ns;
+            }
+        }
+    }
+    return nbytes;
+}
+
+int
+read_tx_timestamps(int sock, std::span<tx_timestamp> out) noexcept
+{
+    std::size_t count = 0;
+    while (count < out.size()) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))
+                + CMSG_SPACE(sizeof(sock_extended_err) + 64)] = {};
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // the error queue never blocks: EAGAIN means it's empty
+        if (::recvmsg(sock, &msg, MSG_ERRQUEUE) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? static_cast<int>(count) : -1;
+        }
+
+        // the stamp comes first, then what it is for
+        std::int64_t ns = 0;
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping stamps{};
+                std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                ns = to_ns(stamps.ts[0]);
+                continue;
+            }
+
+            bool const is_error = (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR)
+                    || (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+            if (!is_error) {
+                continue;
+            }
+            sock_extended_err err{};
+            std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+                errno = static_cast<int>(err.ee_errno);
+                return -1;
+            }
+            if (ns != 0 && (err.ee_info == SCM_TSTAMP_SND || err.ee_info == SCM_TSTAMP_ACK)) {
+                out[count++] = {err.ee_data,
+                        err.ee_info == SCM_TSTAMP_ACK ? TxStamp::Acked : TxStamp::Sent, ns};
+            }
+        }
+    }
+    return static_cast<int>(count);
+}
+
+} // namespace ws
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <sys/types.h> // ssize_t
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ws {
+
+/// Which point of a send a transmit timestamp marks
+enum class TxStamp : std::uint8_t
+{
+    Sent,  ///< SCM_TSTAMP_SND: handed to the device (loopback: delivered)
+    Acked, ///< SCM_TSTAMP_ACK: every byte of the send acknowledged by the peer
+};
+
+/// A transmit timestamp read from a socket's error queue
+struct tx_timestamp
+{
+    /// Offset of the last byte of the stamped send: bytes sent since
+    /// enable_timestamping(), up to and including it, minus one. Wraps at 2^32.
+    std::uint32_t key = 0;
+    TxStamp kind = TxStamp::Sent; ///< what happened at \c ns
+    std::int64_t ns = 0;          ///< when, CLOCK_REALTIME nanoseconds
+};
+
+/**
+ * Turn on kernel software timestamps on a tcp socket (SO_TIMESTAMPING):
+ * receive timestamps, read with recv_timestamped(), and transmit plus
+ * ack timestamps of every send, read with read_tx_timestamps(). Sends
+ * are keyed by their byte offset from this point on.
+ * @param sock connected TCP socket, nothing sent on it yet or every byte
+ *        acknowledged (before linux 6.2 the count starts at the last
+ *        unacknowledged byte)
+ * @return false on error (errno is set)
+ */
+bool enable_timestamping(int sock) noexcept;
+
+/// CLOCK_REALTIME now, in nanoseconds: the clock of the kernel's timestamps
+std::int64_t realtime_ns() noexcept;
+
+/**
+ * ::recv() that also returns the kernel's receive timestamp of the
+ * latest data it read
+ * @param rx_ns set to the timestamp, left alone if there is none
+ * @return as ::recv()
+ */
+ssize_t recv_timestamped(
+        int sock, void* buf, std::size_t len, int flags, std::int64_t& rx_ns) noexcept;
+
+/**
+ * Read up to out.size() transmit timestamps from the error queue of
+ * \c sock. Fewer than out.size() means the queue is drained.
+ * @param sock TCP socket with enable_timestamping() on
+ * @return number of timestamps read, -1 if the queue held a real socket
+ *         error or recvmsg failed (errno is set)
+ */
+int read_tx_timestamps(int sock, std::span<tx_timestamp> out) noexcept;
+
+} // namespace ws
@@ -0,0 +1,367 @@
+#include "tls.hpp"
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <algorithm> // std::min
+#include <cerrno>
+#include <climits> // INT_MAX
+#include <csignal> // ::sigaction, SIGPIPE
+#include <cstdint>
+#include <cstdio>  // std::fopen
+#include <cstring> // std::strerror
+#include <memory>
+#include <stdexcept>
+
+namespace ws {
+
+namespace {
+    /// OpenSSL objects free themselves on scope exit
+    template <auto Free>
+    struct openssl_deleter
+    {
+        template <typename T>
+        void
+        operator()(T* p) const noexcept
+        {
+            Free(p);
+        }
+    };
+    using pkey_ptr = std::unique_ptr<EVP_PKEY, openssl_deleter<EVP_PKEY_free>>;
+    using pkey_ctx_ptr = std::unique_ptr<EVP_PKEY_CTX, openssl_deleter<EVP_PKEY_CTX_free>>;
+    using x509_ptr = std::unique_ptr<X509, openssl_deleter<X509_free>>;
+    using extension_ptr = std::unique_ptr<X509_EXTENSION, openssl_deleter<X509_EXTENSION_free>>;
+
+    /// Closes on scope exit
+    struct file_closer
+    {
+        void
+        operator()(std::FILE* f) const noexcept
+        {
+            std::fclose(f);
+        }
+    };
+
+    /// The oldest error in this thread's OpenSSL error queue, which is cleared
+    std::string
+    openssl_error()
+    {
+        unsigned long const code = ERR_get_error();
+        ERR_clear_error();
+        if (code == 0) {
+            return "unknown error";
+        }
+        char buf[256];
+        ERR_error_string_n(code, buf, sizeof(buf));
+        return buf;
+    }
+
+    /// OpenSSL writes to sockets without MSG_NOSIGNAL; a peer that has gone
+    /// away must not kill the process
+    void
+    ignore_sigpipe() noexcept
+    {
+        struct sigaction current{};
+        if (::sigaction(SIGPIPE, nullptr, &current) == 0 && current.sa_handler == SIG_DFL) {
+            struct sigaction ignore{};
+            ignore.sa_handler = SIG_IGN;
+            ::sigaction(SIGPIPE, &ignore, nullptr);
+        }
+    }
+} // namespace
+
+tls_context::tls_context(TlsRole role, tls_options const& options)
+        : role_(role)
+        , ktls_(options.ktls)
+        , verify_peer_(role == TlsRole::Client && options.verify_peer)
+{
+    ctx_ = SSL_CTX_new(role == TlsRole::Server ? TLS_server_method() : TLS_client_method());
+    if (ctx_ == nullptr) {
+        throw std::runtime_error("SSL_CTX_new: " + openssl_error());
+    }
+    auto const fail = [this](std::string const& what) {
+        std::string const message = what + ": " + openssl_error();
+        SSL_CTX_free(ctx_);
+        throw std::runtime_error(message);
+    };
+
+    SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+
+    // a peer closing without close_notify is the end of the stream; the
+    // websocket close handshake already says whether that was expected
+    std::uint64_t flags = SSL_OP_IGNORE_UNEXPECTED_EOF | SSL_OP_NO_RENEGOTIATION;
+    if (ktls_) {
+        flags |= SSL_OP_ENABLE_KTLS;
+    }
+    SSL_CTX_set_options(ctx_, flags);
+
+    // send() semantics: a non-blocking socket takes what it can, and the
+    // caller's buffer may move between retries
+    SSL_CTX_set_mode(ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    if (role == TlsRole::Server) {
+        if (SSL_CTX_use_certificate_chain_file(ctx_, options.certificate.c_str()) != 1) {
+            fail("certificate (" + options.certificate + ")");
+        }
+        if (SSL_CTX_use_PrivateKey_file(ctx_, options.private_key.c_str(), SSL_FILETYPE_PEM)
+                != 1) {
+            fail("private key (" + options.private_key + ")");
+        }
+        if (SSL_CTX_check_private_key(ctx_) != 1) {
+            fail("private key (" + options.private_key + ")");
+        }
+
+        // no resumption: tickets would be the only records after the
+        // handshake that aren't application data
+        SSL_CTX_set_num_tickets(ctx_, 0);
+        SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_OFF);
+    } else if (verify_peer_) {
+        SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER, nullptr);
+        int const loaded = options.ca_file.empty()
+                ? SSL_CTX_set_default_verify_paths(ctx_)
+                : SSL_CTX_load_verify_locations(ctx_, options.ca_file.c_str(), nullptr);
+        if (loaded != 1) {
+            fail("trusted certificates (" + options.ca_file + ")");
+        }
+    }
+
+    ignore_sigpipe();
+}
+
+tls_context::~tls_context() noexcept
+{
+    SSL_CTX_free(ctx_);
+}
+
+TlsRole
+tls_context::role() const noexcept
+{
+    return role_;
+}
+
+bool
+tls_context::ktls() const noexcept
+{
+    return ktls_;
+}
+
+bool
+tls_context::verify_peer() const noexcept
+{
+    return verify_peer_;
+}
+
+ssl_ctx_st*
+tls_context::get() const noexcept
+{
+    return ctx_;
+}
+
+tls_session::tls_session(tls_context const& context, int fd, std::string const& server_name)
+        : ssl_(SSL_new(context.get()))
+{
+    if (ssl_ == nullptr) {
+        throw std::runtime_error("SSL_new: " + openssl_error());
+    }
+    if (SSL_set_fd(ssl_, fd) != 1) {
+        std::string const message = "SSL_set_fd: " + openssl_error();
+        SSL_free(ssl_);
+        throw std::runtime_error(message);
+    }
+
+    if (context.role() == TlsRole::Server) {
+        SSL_set_accept_state(ssl_);
+        return;
+    }
+
+    SSL_set_connect_state(ssl_);
+    if (!server_name.empty()) {
+        SSL_set_tlsext_host_name(ssl_, server_name.c_str());
+        if (context.verify_peer()) {
+            SSL_set1_host(ssl_, server_name.c_str());
+        }
+    }
+}
+
+tls_session::~tls_session() noexcept
+{
+    SSL_free(ssl_);
+}
+
+TlsProgress
+tls_session::handshake() noexcept
+{
+    ERR_clear_error();
+    int const rv = SSL_do_handshake(ssl_);
+    if (rv == 1) {
+        // decrypting in user space: fill the buffer from the socket in as
+        // few reads as it takes, not two per record. only now, as kTLS
+        // can't take over with records already read ahead
+        if (!kernel_recv()) {
+            SSL_set_read_ahead(ssl_, 1);
+        }
+        return TlsProgress::Done;
+    }
+
+    switch (int const err = SSL_get_error(ssl_, rv); err) {
+        case SSL_ERROR_WANT_READ:
+            return TlsProgress::WantRead;
+        case SSL_ERROR_WANT_WRITE:
+            return TlsProgress::WantWrite;
+        case SSL_ERROR_SYSCALL:
+            error_ = errno != 0 ? std::strerror(errno) : "connection closed";
+            return TlsProgress::Failed;
+        default:
+            error_ = openssl_error();
+            return TlsProgress::Failed;
+    }
+}
+
+bool
+tls_session::kernel_send() const noexcept
+{
+    return BIO_get_ktls_send(SSL_get_wbio(ssl_)) != 0;
+}
+
+bool
+tls_session::kernel_recv() const noexcept
+{
+    return BIO_get_ktls_recv(SSL_get_rbio(ssl_)) != 0;
+}
+
+ssize_t
+tls_session::recv(void* buf, std::size_t len) noexcept
+{
+    auto* const out = static_cast<std::uint8_t*>(buf);
+    std::size_t total = 0;
+    while (total < len) {
+        ERR_clear_error();
+        int const chunk = static_cast<int>(std::min<std::size_t>(len - total, INT_MAX));
+        int const nbytes = SSL_read(ssl_, out + total, chunk);
+        if (nbytes > 0) {
+            total += static_cast<std::size_t>(nbytes);
+            continue;
+        }
+
+        int const err = SSL_get_error(ssl_, nbytes);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE || total > 0) {
+            break; // an error shows up again on the next call
+        }
+        if (err == SSL_ERROR_ZERO_RETURN) {
+            return 0;
+        }
+        if (err != SSL_ERROR_SYSCALL || errno == 0) {
+            ERR_clear_error();
+            errno = EPROTO;
+        }
+        return -1;
+    }
+
+    if (total == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return static_cast<ssize_t>(total);
+}
+
+ssize_t
+tls_session::send(void const* buf, std::size_t len) noexcept
+{
+    ERR_clear_error();
+    std::size_t written = 0;
+    int const rv = SSL_write_ex(ssl_, buf, len, &written);
+    if (rv == 1) {
+        return static_cast<ssize_t>(written);
+    }
+
+    int const err = SSL_get_error(ssl_, rv);
+    if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) {
+        errno = EAGAIN;
+    } else if (err != SSL_ERROR_SYSCALL || errno == 0) {
+        ERR_clear_error();
+        errno = EPROTO;
+    }
+    return -1;
+}
+
+std::string_view
+tls_session::version() const noexcept
+{
+    return SSL_get_version(ssl_);
+}
+
+std::string_view
+tls_session::cipher() const noexcept
+{
+    char const* name = SSL_get_cipher_name(ssl_);
+    return name != nullptr ? name : "";
+}
+
+std::string const&
+tls_session::error() const noexcept
+{
+    return error_;
+}
+
+void
+write_self_signed_certificate(std::string const& certificate_path, std::string const& key_path,
+        std::string const& common_name)
+{
+    auto const fail = [](std::string const& what) {
+        throw std::runtime_error(what + ": " + openssl_error());
+    };
+
+    pkey_ctx_ptr const keygen(EVP_PKEY_CTX_new_from_name(nullptr, "EC", nullptr));
+    EVP_PKEY* raw_key = nullptr;
+    if (keygen == nullptr || EVP_PKEY_keygen_init(keygen.get()) != 1
+            || EVP_PKEY_CTX_set_group_name(keygen.get(), "P-256") != 1
+            || EVP_PKEY_generate(keygen.get(), &raw_key) != 1) {
+        fail("key generation");
+    }
+    pkey_ptr const key(raw_key);
+
+    x509_ptr const cert(X509_new());
+    if (cert == nullptr) {
+        fail("X509_new");
+    }
+    X509_set_version(cert.get(), 2); // v3, for the extension
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert.get()), 365L * 24 * 60 * 60);
+    X509_set_pubkey(cert.get(), key.get());
+
+    X509_NAME* name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+            reinterpret_cast<unsigned char const*>(common_name.c_str()), -1, -1, 0);
+    X509_set_issuer_name(cert.get(), name);
+
+    // host name verification only looks at the subject alternative names
+    X509V3_CTX v3{};
+    X509V3_set_ctx(&v3, cert.get(), cert.get(), nullptr, nullptr, 0);
+    extension_ptr const san(X509V3_EXT_conf_nid(
+            nullptr, &v3, NID_subject_alt_name, ("DNS:" + common_name).c_str()));
+    if (san == nullptr || X509_add_ext(cert.get(), san.get(), -1) != 1) {
+        fail("subjectAltName");
+    }
+    if (X509_sign(cert.get(), key.get(), EVP_sha256()) == 0) {
+        fail("X509_sign");
+    }
+
+    std::unique_ptr<std::FILE, file_closer> const cert_file(
+            std::fopen(certificate_path.c_str(), "w"));
+    if (cert_file == nullptr || PEM_write_X509(cert_file.get(), cert.get()) != 1) {
+        throw std::runtime_error("write certificate (" + certificate_path + ")");
+    }
+    std::unique_ptr<std::FILE, file_closer> const key_file(std::fopen(key_path.c_str(), "w"));
+    if (key_file == nullptr
+            || PEM_write_PrivateKey(
+                       key_file.get(), key.get(), nullptr, nullptr, 0, nullptr, nullptr)
+                    != 1) {
+        throw std::runtime_error("write private key (" + key_path + ")");
+    }
+}
+
+} // namespace ws
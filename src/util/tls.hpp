@@ -0,0 +1,157 @@
+#pragma once
+
+#include <sys/types.h> // ssize_t
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// OpenSSL's SSL_CTX and SSL, without pulling in its headers
+struct ssl_ctx_st;
+struct ssl_st;
+
+namespace ws {
+
+/// Which end of the connection a tls_context is for
+enum class TlsRole
+{
+    Server,
+    Client,
+};
+
+/// Outcome of a step of the TLS handshake
+enum class TlsProgress
+{
+    Done,      ///< handshake complete, application data can flow
+    WantRead,  ///< call again once the socket is readable
+    WantWrite, ///< call again once the socket is writable
+    Failed,    ///< handshake failed, see tls_session::error()
+};
+
+/// Settings for a tls_context
+struct tls_options
+{
+    std::string certificate; ///< PEM certificate chain, required for servers
+    std::string private_key; ///< PEM private key of the certificate, required for servers
+    std::string ca_file;     ///< clients: PEM certificates to trust, empty = system store
+    bool verify_peer = true; ///< clients: check the server's certificate and host name
+    bool ktls = true;        ///< hand the session keys to the kernel after the handshake
+};
+
+/*! \class  tls_context
+ *  \brief  OpenSSL context shared by every TLS session of one side of
+ *          the connection.
+ *
+ *  TLS 1.2 and 1.3. With kTLS asked for, OpenSSL pushes each session's
+ *  keys and sequence numbers into the socket (TCP_ULP "tls") once the
+ *  handshake is done, direction by direction, wherever the kernel and the
+ *  negotiated cipher allow it; see tls_session::kernel_send(). Servers
+ *  send no session tickets, so nothing but application data follows the
+ *  handshake on the wire. Safe to share between threads. Ignores SIGPIPE
+ *  for the process if it wasn't handled already: OpenSSL writes to the
+ *  socket without MSG_NOSIGNAL.
+ */
+class tls_context
+{
+public:
+    /// \throw std::runtime_error if OpenSSL fails to set up the context or
+    ///        the certificate, key or trusted certificates can't be loaded
+    tls_context(TlsRole role, tls_options const& options);
+    ~tls_context() noexcept;
+
+    // owns the SSL_CTX: no copies/moves
+    tls_context(tls_context const&) = delete;
+    tls_context(tls_context&&) = delete;
+    tls_context& operator=(tls_context const&) = delete;
+    tls_context&& operator=(tls_context&&) = delete;
+
+    TlsRole role() const noexcept;
+
+    /// \c true if sessions try to move to kTLS
+    bool ktls() const noexcept;
+
+    /// \c true if clients check the server's certificate
+    bool verify_peer() const noexcept;
+
+    ssl_ctx_st* get() const noexcept;
+
+private:
+    ssl_ctx_st* ctx_ = nullptr;
+    TlsRole role_;
+    bool ktls_;
+    bool verify_peer_;
+};
+
+/*! \class  tls_session
+ *  \brief  One TLS connection over a connected tcp socket.
+ *
+ *  Drive handshake() until it's done, then check kernel_send() and
+ *  kernel_recv(). A direction the kernel took over is plain send()/recv()
+ *  (and writev, sendfile, splice) on the socket from then on; the other
+ *  goes through send() and recv() here, which want the socket
+ *  non-blocking. The session doesn't own the socket.
+ */
+class tls_session
+{
+public:
+    /// \param server_name clients: sent as SNI, and the name the server's
+    ///        certificate must carry
+    /// \throw std::runtime_error if OpenSSL can't create the session
+    tls_session(tls_context const& context, int fd, std::string const& server_name = {});
+    ~tls_session() noexcept;
+
+    // owns the SSL: no copies/moves
+    tls_session(tls_session const&) = delete;
+    tls_session(tls_session&&) = delete;
+    tls_session& operator=(tls_session const&) = delete;
+    tls_session&& operator=(tls_session&&) = delete;
+
+    /// Take the handshake as far as the socket allows
+    TlsProgress handshake() noexcept;
+
+    /// \c true once the kernel encrypts what is sent on the socket
+    bool kernel_send() const noexcept;
+
+    /// \c true once the kernel decrypts what is received on the socket
+    bool kernel_recv() const noexcept;
+
+    /**
+     * Decrypt what has arrived into \c buf, up to \c len bytes, reading
+     * from the socket until it runs dry
+     * @return bytes read; 0 at the end of the stream; -1 with errno set:
+     *         EAGAIN if nothing has arrived, EPROTO on a TLS error
+     */
+    ssize_t recv(void* buf, std::size_t len) noexcept;
+
+    /**
+     * Encrypt and send (part of) \c buf, like ::send(): a non-blocking
+     * socket may take only part of it, in whole records. Retry with the
+     * rest, which must start with the same bytes.
+     * @return bytes sent, or -1 with errno set: EAGAIN if the socket is
+     *         full, EPROTO on a TLS error, or the socket's error
+     */
+    ssize_t send(void const* buf, std::size_t len) noexcept;
+
+    /// Negotiated protocol version ("TLSv1.3"), valid after the handshake
+    std::string_view version() const noexcept;
+
+    /// Negotiated cipher suite, valid after the handshake
+    std::string_view cipher() const noexcept;
+
+    /// Why the handshake failed
+    std::string const& error() const noexcept;
+
+private:
+    ssl_st* ssl_ = nullptr;
+    std::string error_;
+};
+
+/**
+ * Write a self-signed certificate for \c common_name (also its DNS
+ * subject alternative name) and its P-256 key, valid for a year. For
+ * tests, benchmarks and trying out wss:// locally.
+ * @throw std::runtime_error if generating or writing them fails
+ */
+void write_self_signed_certificate(std::string const& certificate_path,
+        std::string const& key_path, std::string const& common_name = "localhost");
+
+} // namespace ws
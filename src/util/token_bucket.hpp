@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <chrono>
+#include <stdexcept>
+
+
+namespace ws {
+
+/*! \class  token_bucket
+ *  \brief  Classic token-bucket rate limiter. Tokens refill
+ *          continuously at \c rate per second up to \c burst. A rate of
+ *          zero disables the limiter entirely.
+ *
+ *  The bucket is allowed to go into debt: a request larger than the
+ *  burst size is granted once the bucket is full, otherwise such a
+ *  request could never be satisfied.
+ */
+class token_bucket
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    double rate_ = 0.0;   ///< tokens added per second, 0 = unlimited
+    double burst_ = 0.0;  ///< max tokens the bucket can hold
+    double tokens_ = 0.0; ///< tokens currently available
+    clock::time_point last_refill_{};
+
+public:
+    token_bucket() noexcept = default;
+    /// \throw std::runtime_error if \c rate limits but \c burst isn't
+    ///        positive: an empty bucket would let everything through
+    token_bucket(double rate, double burst, clock::time_point now = clock::now());
+
+    /// Attempt to take \c n tokens from the bucket.
+    /// \return \c false if the caller should be throttled
+    bool try_consume(double n, clock::time_point now) noexcept;
+
+    /// Same check as try_consume() but without taking any tokens.
+    bool can_consume(double n, clock::time_point now) noexcept;
+
+    /// How long until can_consume(n) succeeds, if nothing else is taken
+    /// meanwhile
+    /// \return zero if it already does
+    clock::duration wait_time(double n, clock::time_point now) noexcept;
+
+    /// \return \c true if the bucket enforces a limit
+    bool limited() const noexcept;
+
+    double tokens() const noexcept;
+    double rate() const noexcept;
+    double burst() const noexcept;
+
+private:
+    void refill(clock::time_point now) noexcept;
+};
+
+
+/**********************************************************************/
+
+inline token_bucket::token_bucket(double rate, double burst, clock::time_point now)
+        : rate_(rate)
+        , burst_(burst)
+        , tokens_(burst)
+        , last_refill_(now)
+{
+    if (limited() && !(burst_ > 0.0)) {
+        throw std::runtime_error("token_bucket: burst must be positive");
+    }
+}
+
+inline bool
+token_bucket::try_consume(double n, clock::time_point now) noexcept
+{
+    if (!limited()) {
+        return true;
+    }
+
+    if (!can_consume(n, now)) {
+        return false;
+    }
+    tokens_ -= n;
+    return true;
+}
+
+inline bool
+token_bucket::can_consume(double n, clock::time_point now) noexcept
+{
+    if (!limited()) {
+        return true;
+    }
+
+    refill(now);
+    return tokens_ >= n || tokens_ >= burst_;
+}
+
+inline token_bucket::clock::duration
+token_bucket::wait_time(double n, clock::time_point now) noexcept
+{
+    if (can_consume(n, now)) {
+        return clock::duration::zero();
+    }
+
+    // requests larger than the burst only need a full bucket
+    std::chrono::duration<double> const missing((std::min(n, burst_) - tokens_) / rate_);
+    return std::chrono::ceil<clock::duration>(missing);
+}
+
+inline bool
+token_bucket::limited() const noexcept
+{
+    return rate_ > 0.0;
+}
+
+inline double
+token_bucket::tokens() const noexcept
+{
+    return tokens_;
+}
+
+inline double
+token_bucket::rate() const noexcept
+{
+    return rate_;
+}
+
+inline double
+token_bucket::burst() const noexcept
+{
+    return burst_;
+}
+
+inline void
+token_bucket::refill(clock::time_point now) noexcept
+{
+    if (now <= last_refill_) {
+        return;
+    }
+
+    std::chrono::duration<double> const elapsed = now - last_refill_;
+    tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+    last_refill_ = now;
+}
+
+} // namespace ws
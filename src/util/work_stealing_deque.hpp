@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+
+namespace ws {
+
+/*! \class  work_stealing_deque
+ *  \brief  Chase-Lev deque (with the memory orderings of Lê et al., "Correct
+ *          and Efficient Work-Stealing for Weak Memory Models"). The owning
+ *          thread pushes and pops at the bottom, LIFO; any other thread may
+ *          steal from the top, FIFO. Grows as needed.
+ *
+ *  Stealers may still be reading a ring the owner has outgrown, so old
+ *  rings are kept until the deque is destroyed; growth doubles, so they
+ *  add up to less than the current one.
+ */
+template <typename T>
+class work_stealing_deque
+{
+    static_assert(std::is_trivially_copyable_v<T>, "stealers read slots racily");
+
+private:
+    struct ring
+    {
+        std::int64_t mask;                       ///< capacity - 1
+        std::unique_ptr<std::atomic<T>[]> slots; ///< indexed by position & mask
+
+        explicit ring(std::int64_t capacity)
+                : mask(capacity - 1)
+                , slots(std::make_unique<std::atomic<T>[]>(static_cast<std::size_t>(capacity)))
+        {
+            // empty
+        }
+
+        T
+        get(std::int64_t pos) const noexcept
+        {
+            return slots[static_cast<std::size_t>(pos & mask)].load(std::memory_order_relaxed);
+        }
+
+        void
+        put(std::int64_t pos, T value) noexcept
+        {
+            slots[static_cast<std::size_t>(pos & mask)].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    static constexpr std::size_t CacheLine = 64;
+
+    alignas(CacheLine) std::atomic<std::int64_t> top_{0};    ///< next position to steal
+    alignas(CacheLine) std::atomic<std::int64_t> bottom_{0}; ///< next position to push
+    std::atomic<ring*> ring_;                                ///< current ring
+    std::vector<std::unique_ptr<ring>> rings_;               ///< current and outgrown rings
+
+public:
+    /// \param capacity initial number of slots, rounded up to a power of two
+    explicit work_stealing_deque(std::size_t capacity = 256);
+
+    // stealers hold on to the rings: no copies/moves
+    work_stealing_deque(work_stealing_deque const&) = delete;
+    work_stealing_deque(work_stealing_deque&&) = delete;
+    work_stealing_deque& operator=(work_stealing_deque const&) = delete;
+    work_stealing_deque&& operator=(work_stealing_deque&&) = delete;
+
+    /// Add \c value at the bottom. Owner only.
+    void push(T value);
+
+    /// Take the most recently pushed element. Owner only.
+    std::optional<T> pop() noexcept;
+
+    /// Take the oldest element. Any thread.
+    /// \return \c std::nullopt if the deque is empty or another thread won
+    ///         the race for the element
+    std::optional<T> steal() noexcept;
+
+    /// \return \c true if the deque looked empty at the time of the call
+    bool empty() const noexcept;
+};
+
+
+/**********************************************************************/
+
+template <typename T>
+work_stealing_deque<T>::work_stealing_deque(std::size_t capacity)
+{
+    std::size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    rings_.push_back(std::make_unique<ring>(static_cast<std::int64_t>(size)));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+}
+
+template <typename T>
+void
+work_stealing_deque<T>::push(T value)
+{
+    std::int64_t const bottom = bottom_.load(std::memory_order_relaxed);
+    std::int64_t const top = top_.load(std::memory_order_acquire);
+    ring* r = ring_.load(std::memory_order_relaxed);
+
+    // full: move everything to a ring twice the size
+    if (bottom - top > r->mask) {
+        auto bigger = std::make_unique<ring>(2 * (r->mask + 1));
+        for (std::int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, r->get(i));
+        }
+        r = bigger.get();
+        rings_.push_back(std::move(bigger));
+        ring_.store(r, std::memory_order_release);
+    }
+
+    r->put(bottom, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+template <typename T>
+std::optional<T>
+work_stealing_deque<T>::pop() noexcept
+{
+    std::int64_t const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    ring* const r = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        bottom_.store(bottom + 1, std::memory_order_relaxed); // was empty
+        return std::nullopt;
+    }
+
+    std::optional<T> value = r->get(bottom);
+    if (top == bottom) {
+        // the last element: race the stealers for it
+        if (!top_.compare_exchange_strong(
+                    top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            value.reset();
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return value;
+}
+
+template <typename T>
+std::optional<T>
+work_stealing_deque<T>::steal() noexcept
+{
+    std::int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t const bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return std::nullopt;
+    }
+
+    T const value = ring_.load(std::memory_order_acquire)->get(top);
+    if (!top_.compare_exchange_strong(
+                top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+template <typename T>
+bool
+work_stealing_deque<T>::empty() const noexcept
+{
+    return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+}
+
+} // namespace ws
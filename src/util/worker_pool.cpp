@@ -0,0 +1,162 @@
+#include "worker_pool.hpp"
+#include <stdexcept>
+
+
+namespace ws {
+
+namespace {
+    /// tasks the hand-over queue holds before schedule() has to wait
+    static constexpr std::size_t InjectedQueueSize = 4096;
+
+    /// max tasks a worker moves from the hand-over queue to its deque at once
+    static constexpr std::size_t MaxInjectedBatch = 64;
+
+    /// times an idle worker looks for work again (yielding) before sleeping
+    static constexpr std::size_t SpinRounds = 64;
+
+    /// pool and index of the worker running on this thread, if any
+    thread_local worker_pool const* current_pool = nullptr;
+    thread_local std::size_t current_index = 0;
+} // namespace
+
+worker_pool::worker_pool(std::size_t threads)
+        : workers_()
+        , injected_(InjectedQueueSize)
+{
+    if (threads == 0) {
+        throw std::invalid_argument("worker_pool: need at least one thread");
+    }
+
+    // every deque exists before any worker starts stealing
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<worker>());
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_[i]->thread = std::thread(&worker_pool::worker_main, this, i);
+    }
+}
+
+worker_pool::~worker_pool() noexcept
+{
+    stop_.store(true, std::memory_order_seq_cst);
+    wakeups_.fetch_add(1, std::memory_order_seq_cst);
+    wakeups_.notify_all();
+    for (auto& w : workers_) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+}
+
+void
+worker_pool::schedule(task& t) noexcept
+{
+    if (current_pool == this) {
+        // our own worker: its deque. wake another worker only if this one
+        // already has something else to do
+        work_stealing_deque<task*>& deque = workers_[current_index]->deque;
+        bool const busy = !deque.empty();
+        deque.push(&t);
+        if (busy) {
+            wake_one();
+        }
+        return;
+    }
+
+    while (!injected_.try_push(&t)) {
+        std::this_thread::yield();
+    }
+    wake_one();
+}
+
+std::size_t
+worker_pool::size() const noexcept
+{
+    return workers_.size();
+}
+
+void
+worker_pool::worker_main(std::size_t index) noexcept
+{
+    current_pool = this;
+    current_index = index;
+
+    while (!stop_.load(std::memory_order_acquire)) {
+        task* t = find_task(index);
+        for (std::size_t i = 0; t == nullptr && i < SpinRounds; ++i) {
+            std::this_thread::yield();
+            t = find_task(index);
+        }
+
+        // announce that we're going to sleep, then look once more: a task
+        // scheduled in between either shows up here or wakes us
+        if (t == nullptr) {
+            std::uint32_t const seen = wakeups_.load(std::memory_order_seq_cst);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            t = find_task(index);
+            if (t == nullptr && !stop_.load(std::memory_order_seq_cst)) {
+                wakeups_.wait(seen, std::memory_order_seq_cst);
+            }
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        if (t != nullptr) {
+            t->run();
+        }
+    }
+}
+
+worker_pool::task*
+worker_pool::find_task(std::size_t index) noexcept
+{
+    worker& self = *workers_[index];
+    if (std::optional<task*> const t = self.deque.pop()) {
+        return *t;
+    }
+
+    // tasks from outside the pool: run the first, move the rest to our
+    // deque, where the other workers can steal them
+    if (!injected_taken_.test_and_set(std::memory_order_acquire)) {
+        task* first = nullptr;
+        task* t = nullptr;
+        std::size_t moved = 0;
+        while (moved < MaxInjectedBatch && injected_.try_pop(t)) {
+            if (first == nullptr) {
+                first = t;
+            } else {
+                self.deque.push(t);
+            }
+            ++moved;
+        }
+        injected_taken_.clear(std::memory_order_release);
+
+        if (first != nullptr) {
+            if (moved > 1) {
+                wake_one();
+            }
+            return first;
+        }
+    }
+
+    // steal, starting with our neighbour
+    for (std::size_t i = 1; i < workers_.size(); ++i) {
+        if (std::optional<task*> const t = workers_[(index + i) % workers_.size()]->deque.steal()) {
+            return *t;
+        }
+    }
+    return nullptr;
+}
+
+void
+worker_pool::wake_one() noexcept
+{
+    // pairs with the fence between announcing sleep and looking once more
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) != 0) {
+        wakeups_.fetch_add(1, std::memory_order_seq_cst);
+        wakeups_.notify_one();
+    }
+}
+
+} // namespace ws
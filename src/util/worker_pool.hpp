@@ -0,0 +1,83 @@
+#pragma once
+
+#include "mpsc_queue.hpp"
+#include "work_stealing_deque.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace ws {
+
+/*! \class  worker_pool
+ *  \brief  Fixed set of threads running tasks, balanced by work stealing:
+ *          every worker owns a deque it pushes to and pops from, and idle
+ *          workers steal from the others.
+ *
+ *  Threads outside the pool (the reactors) hand tasks over through one
+ *  bounded lock-free queue; whichever worker gets there first moves them
+ *  to its deque, where the others can steal them. A task scheduled from a
+ *  worker goes straight to that worker's deque. Idle workers sleep on a
+ *  futex and are woken only when a worker is actually asleep.
+ */
+class worker_pool
+{
+public:
+    /// Unit of work. Not owned by the pool: it must stay alive until it
+    /// has run.
+    class task
+    {
+    public:
+        virtual ~task() = default;
+        virtual void run() noexcept = 0;
+    };
+
+    /// \param threads number of workers, at least one
+    explicit worker_pool(std::size_t threads);
+
+    /// Stops and joins the workers. Tasks that haven't started are dropped.
+    ~worker_pool() noexcept;
+
+    // workers point back at us: no copies/moves
+    worker_pool(worker_pool const&) = delete;
+    worker_pool(worker_pool&&) = delete;
+    worker_pool& operator=(worker_pool const&) = delete;
+    worker_pool&& operator=(worker_pool&&) = delete;
+
+    /// Run \c t on some worker. Safe to call from any thread; from outside
+    /// the pool it waits (yielding) while the hand-over queue is full.
+    void schedule(task& t) noexcept;
+
+    /// Number of workers
+    std::size_t size() const noexcept;
+
+private:
+    struct worker
+    {
+        work_stealing_deque<task*> deque; ///< pushed and popped by this worker only
+        std::thread thread;
+    };
+
+    /// Body of each worker thread
+    void worker_main(std::size_t index) noexcept;
+
+    /// Pop, take from the hand-over queue, or steal
+    /// \return \c nullptr if there's nothing to do
+    task* find_task(std::size_t index) noexcept;
+
+    /// Wake a sleeping worker, if there is one
+    void wake_one() noexcept;
+
+private:
+    std::vector<std::unique_ptr<worker>> workers_; ///< one per thread
+    mpsc_queue<task*> injected_;                   ///< scheduled from outside the pool
+    std::atomic_flag injected_taken_;              ///< a worker is moving injected_ to its deque
+    std::atomic<std::uint32_t> wakeups_{0};        ///< bumped to wake sleeping workers
+    std::atomic<std::size_t> sleepers_{0};         ///< workers asleep (or about to be)
+    std::atomic<bool> stop_{false};                ///< set by the destructor
+};
+
+} // namespace ws
@@ -0,0 +1,59 @@
+#include "zerocopy.hpp"
+#include <time.h>           // timespec, which <linux/errqueue.h> expects to be declared
+#include <linux/errqueue.h> // sock_extended_err, SO_EE_ORIGIN_ZEROCOPY
+#include <netinet/in.h>     // IPPROTO_IP, IPPROTO_IPV6, IP_RECVERR, IPV6_RECVERR
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring> // std::memcpy
+
+namespace ws {
+
+bool
+enable_zerocopy(int sock) noexcept
+{
+    int const yes = 1;
+    return ::setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &yes, sizeof(yes)) == 0;
+}
+
+bool
+read_zerocopy_completions(int sock, zerocopy_completions& out) noexcept
+{
+    for (;;) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err) + 64)] = {};
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // the error queue never blocks: EAGAIN means it's empty
+        if (::recvmsg(sock, &msg, MSG_ERRQUEUE) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            bool const is_error = (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR)
+                    || (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+            if (!is_error) {
+                continue;
+            }
+
+            sock_extended_err err{};
+            std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                errno = static_cast<int>(err.ee_errno);
+                return false;
+            }
+
+            // sends ee_info..ee_data (inclusive) are done
+            std::uint32_t const count = err.ee_data - err.ee_info + 1;
+            out.released += count;
+            if ((err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0) {
+                out.copied += count;
+            }
+        }
+    }
+}
+
+} // namespace ws
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ws {
+
+/// MSG_ZEROCOPY completions read from a socket's error queue
+struct zerocopy_completions
+{
+    std::uint32_t released = 0; ///< zerocopy sends whose pages the kernel let go of
+    std::uint32_t copied = 0;   ///< of those, sends the kernel ended up copying anyway
+};
+
+/**
+ * Allow MSG_ZEROCOPY sends on a tcp socket (SO_ZEROCOPY).
+ * @param sock TCP socket
+ * @return false on error (errno is set)
+ */
+bool enable_zerocopy(int sock) noexcept;
+
+/**
+ * Drain every notification queued on the error queue of \c sock and add
+ * the MSG_ZEROCOPY completions to \c out. The kernel numbers zerocopy
+ * sends from 0 per socket and, for tcp, releases them in order; once
+ * \c released reaches n, the buffers of the first n sends may be reused.
+ * @param sock TCP socket with SO_ZEROCOPY enabled
+ * @param out Accumulated completions
+ * @return false if the queue held a real socket error or recvmsg failed
+ *         (errno is set)
+ */
+bool read_zerocopy_completions(int sock, zerocopy_completions& out) noexcept;
+
+} // namespace ws
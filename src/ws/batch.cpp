@@ -0,0 +1,115 @@
+#include "batch.hpp"
+#include <limits>
+
+
+namespace ws {
+
+std::size_t
+encode_batch_prefix(std::uint8_t* out, std::uint32_t len) noexcept
+{
+    std::size_t n = 0;
+    while (len >= 0x80) {
+        out[n++] = static_cast<std::uint8_t>(len | 0x80);
+        len >>= 7;
+    }
+    out[n++] = static_cast<std::uint8_t>(len);
+    return n;
+}
+
+batch_reader::batch_reader(std::span<std::uint8_t const> batch) noexcept
+        : rest_(batch)
+{
+    // empty
+}
+
+bool
+batch_reader::next(std::span<std::uint8_t const>& message) noexcept
+{
+    if (rest_.empty() || error_) {
+        return false;
+    }
+
+    // the prefix: 7 bits per byte, least significant first
+    std::uint64_t len = 0;
+    std::size_t prefix = 0;
+    for (;;) {
+        if (prefix == rest_.size() || prefix == MaxBatchPrefixSize) {
+            error_ = true;
+            return false;
+        }
+        std::uint8_t const byte = rest_[prefix];
+        len |= static_cast<std::uint64_t>(byte & 0x7f) << (7 * prefix);
+        ++prefix;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+
+    if (len > std::numeric_limits<std::uint32_t>::max() || len > rest_.size() - prefix) {
+        error_ = true;
+        return false;
+    }
+    message = rest_.subspan(prefix, len);
+    rest_ = rest_.subspan(prefix + len);
+    return true;
+}
+
+bool
+batch_reader::error() const noexcept
+{
+    return error_;
+}
+
+batch_writer::batch_writer(std::pmr::memory_resource* resource)
+        : data_(resource)
+{
+    // empty
+}
+
+bool
+batch_writer::add(std::span<std::uint8_t const> message)
+{
+    if (message.size() > UINT32_MAX) {
+        return false;
+    }
+    std::uint8_t prefix[MaxBatchPrefixSize];
+    std::size_t const prefix_size
+            = encode_batch_prefix(prefix, static_cast<std::uint32_t>(message.size()));
+    data_.insert(data_.end(), prefix, prefix + prefix_size);
+    data_.insert(data_.end(), message.begin(), message.end());
+    ++size_;
+    return true;
+}
+
+bool
+batch_writer::add(std::string_view message)
+{
+    return add(std::span(reinterpret_cast<std::uint8_t const*>(message.data()), message.size()));
+}
+
+std::size_t
+batch_writer::size() const noexcept
+{
+    return size_;
+}
+
+bool
+batch_writer::empty() const noexcept
+{
+    return size_ == 0;
+}
+
+std::span<std::uint8_t const>
+batch_writer::data() const noexcept
+{
+    return data_;
+}
+
+void
+batch_writer::clear() noexcept
+{
+    data_.clear();
+    size_ = 0;
+}
+
+} // namespace ws
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ws {
+
+/// Sec-WebSocket-Protocol token of the batching subprotocol. On a
+/// connection that agreed to it every binary message is a batch: any
+/// number of messages, each a LEB128 length followed by that many bytes,
+/// back to back. Text messages stay single messages.
+static constexpr std::string_view BatchProtocol = "batch.v1";
+
+/// largest length prefix: messages are at most 2^32 - 1 bytes
+static constexpr std::size_t MaxBatchPrefixSize = 5;
+
+/// Write the length prefix of a \c len byte message to \c out, which must
+/// have room for MaxBatchPrefixSize bytes
+/// \return number of bytes written
+std::size_t encode_batch_prefix(std::uint8_t* out, std::uint32_t len) noexcept;
+
+/*! \class  batch_reader
+ *  \brief  Walks the messages of a batch in place; nothing is copied.
+ */
+class batch_reader
+{
+public:
+    explicit batch_reader(std::span<std::uint8_t const> batch) noexcept;
+
+    /// Point \c message at the next message of the batch
+    /// \return \c false at the end of the batch, or if it is malformed
+    bool next(std::span<std::uint8_t const>& message) noexcept;
+
+    /// \return \c true if next() stopped at a malformed length prefix or a
+    ///         message running past the end of the batch
+    bool error() const noexcept;
+
+private:
+    std::span<std::uint8_t const> rest_; ///< what next() hasn't handed out yet
+    bool error_ = false;
+};
+
+/*! \class  batch_writer
+ *  \brief  Packs messages into a batch, one length prefix and copy each.
+ */
+class batch_writer
+{
+public:
+    explicit batch_writer(
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// Append \c message to the batch
+    /// \return \c false, adding nothing, if \c message is too large for
+    ///         its length prefix (over 4 GiB)
+    bool add(std::span<std::uint8_t const> message);
+    bool add(std::string_view message);
+
+    /// Number of messages added
+    std::size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    /// The batch so far, a binary message payload
+    std::span<std::uint8_t const> data() const noexcept;
+
+    /// Start a new batch, keeping the memory
+    void clear() noexcept;
+
+private:
+    std::pmr::vector<std::uint8_t> data_;
+    std::size_t size_ = 0;
+};
+
+} // namespace ws
@@ -0,0 +1,801 @@
+#include "client.hpp"
+#include "frame_generator.hpp"
+#include "frame_header.hpp"
+#include "handshake.hpp"
+#include <netinet/in.h>  // IPPROTO_TCP
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <spdlog/spdlog.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>  // ::close
+#include <algorithm> // std::min
+#include <array>
+#include <cctype> // std::isdigit
+#include <cerrno>
+#include <cstring> // std::memcpy, std::strerror
+#include <stdexcept>
+#include <string_view>
+
+
+namespace ws {
+
+namespace {
+    static constexpr int EpollMaxEvents = 256;   ///< max num of epoll events per poll()
+    static constexpr int EpollTimeoutMsecs = 10; ///< how often run() looks at stop()
+    static constexpr std::uint16_t CloseProtocolError = 1002; ///< rfc 6455 7.4.1
+    static constexpr std::uint16_t CloseNoStatus = 1005;      ///< rfc 6455 7.4.1, never sent
+    static constexpr std::uint16_t CloseAbnormal = 1006;      ///< rfc 6455 7.4.1, never sent
+    static constexpr std::uint16_t CloseTooBig = 1009;        ///< rfc 6455 7.4.1
+    static constexpr std::uint32_t MaxBackoffDoublings = 20;  ///< keeps the shift in range
+
+    std::uint64_t
+    random_seed() noexcept
+    {
+        std::uint64_t seed = 0;
+        if (!secure_random_bytes(std::span(reinterpret_cast<std::uint8_t*>(&seed), sizeof(seed)))) {
+            seed = reinterpret_cast<std::uintptr_t>(&seed) ^ 0x9e3779b97f4a7c15ULL;
+        }
+        return seed;
+    }
+
+    /// Host field without its port or ipv6 brackets: the name tls checks
+    std::string
+    server_name(std::string_view host)
+    {
+        if (std::size_t const colon = host.rfind(':');
+                colon != std::string_view::npos && colon + 1 < host.size()
+                && std::ranges::all_of(host.substr(colon + 1),
+                        [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; })
+                && (host.front() == '[' || host.find(':') == colon)) {
+            host = host.substr(0, colon);
+        }
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        return std::string(host);
+    }
+} // namespace
+
+client::client(client_config const& config)
+        : config_(config)
+        , rng_(random_seed())
+        , now_(clock::now())
+{
+    epollfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd_ == -1) {
+        throw std::runtime_error(std::string("epoll_create1: ") + std::strerror(errno));
+    }
+}
+
+client::~client() noexcept
+{
+    for (auto& s : sessions_) {
+        close_socket(*s);
+    }
+    ::close(epollfd_);
+}
+
+std::uint64_t
+client::connect(std::string const& address, std::string const& path, std::string host)
+{
+    socket_address const addr = resolve_socket_address(address);
+
+    std::uint32_t slot = 0;
+    if (free_slots_.empty()) {
+        slot = static_cast<std::uint32_t>(sessions_.size());
+        sessions_.push_back(std::make_unique<session>());
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    session& s = *sessions_[slot];
+    s.id = (std::uint64_t{++generation_} << 32) | slot;
+    s.addr = addr;
+    s.path = path;
+    if (!host.empty()) {
+        s.host = std::move(host);
+    } else {
+        s.host = addr.family() == AF_UNIX ? "localhost" : address;
+    }
+    s.attempts = 0;
+    s.closing_for_good = false;
+    ++live_;
+
+    now_ = clock::now();
+    start_attempt(s);
+    return s.id;
+}
+
+bool
+client::send(std::uint64_t id, std::span<std::uint8_t const> payload, OpCode op_code)
+{
+    session* s = find(id);
+    if (s == nullptr || s->state != State::Open) {
+        return false;
+    }
+    if (s->out.size() - s->out_sent + payload.size() > config_.max_pending_bytes) {
+        return false;
+    }
+
+    queue_frame(*s, op_code, payload);
+    ++stats_.messages_sent;
+    return true;
+}
+
+bool
+client::send_text(std::uint64_t id, std::string_view text)
+{
+    return send(id,
+            std::span(reinterpret_cast<std::uint8_t const*>(text.data()), text.size()),
+            OpCode::Text);
+}
+
+void
+client::close(std::uint64_t id, std::uint16_t code)
+{
+    session* s = find(id);
+    if (s == nullptr) {
+        return;
+    }
+
+    s->closing_for_good = true;
+    switch (s->state) {
+        case State::Open: {
+            std::array<std::uint8_t, 2> const payload = {
+                    static_cast<std::uint8_t>(code >> 8), static_cast<std::uint8_t>(code)};
+            queue_frame(*s, OpCode::Close, payload);
+            s->state = State::Closing;
+            set_timer(*s, config_.close_timeout);
+            break;
+        }
+        case State::Waiting:
+        case State::Connecting:
+        case State::Tls:
+        case State::Handshake:
+            // never opened, so nobody to tell
+            close_socket(*s);
+            release(*s);
+            break;
+        case State::Closing:
+        case State::Free:
+        default:
+            break;
+    }
+}
+
+bool
+client::is_open(std::uint64_t id) const noexcept
+{
+    session const* s = find(id);
+    return s != nullptr && s->state == State::Open;
+}
+
+bool
+client::poll(std::chrono::milliseconds timeout)
+{
+    // whatever was sent since the last pass
+    flush_pending_writes();
+
+    // wake up in time for the first timer
+    if (!timers_.empty()) {
+        auto const until = std::chrono::ceil<std::chrono::milliseconds>(
+                timers_.top().when - clock::now());
+        timeout = std::clamp(until, std::chrono::milliseconds(0), timeout);
+    }
+
+    epoll_event events[EpollMaxEvents];
+    int num_events = ::epoll_wait(epollfd_, static_cast<epoll_event*>(events), EpollMaxEvents,
+            static_cast<int>(timeout.count()));
+    if (num_events == -1) {
+        if (errno != EINTR) {
+            SPDLOG_CRITICAL("error: epoll_wait: {} {}", std::strerror(errno), errno);
+            return false;
+        }
+        num_events = 0;
+    }
+    now_ = clock::now();
+
+    for (int i = 0; i < num_events; ++i) {
+        // the id of a connection closed earlier in this pass no longer resolves
+        if (session* s = find(events[i].data.u64)) {
+            on_event(*s, events[i].events);
+        }
+    }
+
+    on_timers();
+    flush_pending_writes();
+    return true;
+}
+
+bool
+client::run()
+{
+    while (!stop_.load(std::memory_order_relaxed) && live_ != 0) {
+        if (!poll(std::chrono::milliseconds(EpollTimeoutMsecs))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+client::stop() noexcept
+{
+    stop_.store(true, std::memory_order_relaxed);
+}
+
+std::size_t
+client::size() const noexcept
+{
+    return live_;
+}
+
+client_stats const&
+client::stats() const noexcept
+{
+    return stats_;
+}
+
+client::session*
+client::find(std::uint64_t id) const noexcept
+{
+    std::size_t const slot = id & 0xffff'ffff;
+    if (slot >= sessions_.size()) {
+        return nullptr;
+    }
+    session* s = sessions_[slot].get();
+    return s->id == id && s->state != State::Free ? s : nullptr;
+}
+
+void
+client::start_attempt(session& s)
+{
+    ++stats_.connect_attempts;
+    s.state = State::Connecting;
+
+    s.fd = ::socket(s.addr.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s.fd == -1) {
+        SPDLOG_ERROR("error: socket: {} {}", std::strerror(errno), errno);
+        drop(s, CloseAbnormal);
+        return;
+    }
+
+    if (config_.nodelay && s.addr.family() != AF_UNIX) {
+        int const yes = 1;
+        if (::setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) == -1) {
+            SPDLOG_WARN("setsockopt (TCP_NODELAY): {}", std::strerror(errno));
+        }
+    }
+
+    // EPOLLOUT reports the outcome
+    if (::connect(s.fd, s.addr.get(), s.addr.size) == -1 && errno != EINPROGRESS) {
+        SPDLOG_ERROR("error: connect: {} {}", std::strerror(errno), errno);
+        drop(s, CloseAbnormal);
+        return;
+    }
+    watch(s, EPOLLOUT, EPOLL_CTL_ADD);
+    set_timer(s, config_.connect_timeout);
+}
+
+void
+client::on_event(session& s, std::uint32_t events)
+{
+    switch (s.state) {
+        case State::Connecting:
+            on_connected(s);
+            break;
+        case State::Tls:
+            on_tls_handshake(s);
+            break;
+        case State::Handshake:
+        case State::Open:
+        case State::Closing:
+            if ((events & EPOLLOUT) != 0 && !flush(s)) {
+                break;
+            }
+            // errors and hangups show up as recv() failing or returning 0
+            if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+                on_readable(s);
+            }
+            break;
+        case State::Free:
+        case State::Waiting:
+        default:
+            break;
+    }
+}
+
+void
+client::on_connected(session& s)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1) {
+        err = errno;
+    }
+    if (err != 0) {
+        SPDLOG_DEBUG("connect: {} {}", std::strerror(err), err);
+        drop(s, CloseAbnormal);
+        return;
+    }
+
+    // wss: the tls handshake comes first
+    if (config_.tls && s.addr.family() != AF_UNIX) {
+        try {
+            s.tls = std::make_unique<tls_session>(*config_.tls, s.fd, server_name(s.host));
+        } catch (std::exception const& e) {
+            SPDLOG_ERROR("error: tls: {}", e.what());
+            drop(s, CloseAbnormal);
+            return;
+        }
+        s.state = State::Tls;
+        on_tls_handshake(s);
+        return;
+    }
+    start_upgrade(s);
+}
+
+void
+client::on_tls_handshake(session& s)
+{
+    switch (s.tls->handshake()) {
+        case TlsProgress::WantRead:
+            watch(s, EPOLLIN, EPOLL_CTL_MOD);
+            return;
+        case TlsProgress::WantWrite:
+            watch(s, EPOLLOUT, EPOLL_CTL_MOD);
+            return;
+        case TlsProgress::Failed:
+            SPDLOG_ERROR("error: tls handshake: {}", s.tls->error());
+            ++stats_.handshake_failures;
+            drop(s, CloseAbnormal);
+            return;
+        case TlsProgress::Done:
+        default:
+            break;
+    }
+
+    ++stats_.tls_handshakes;
+    bool const kernel_send = s.tls->kernel_send();
+    bool const kernel_recv = s.tls->kernel_recv();
+    stats_.ktls_send += kernel_send ? 1 : 0;
+    stats_.ktls_recv += kernel_recv ? 1 : 0;
+    SPDLOG_DEBUG("connection {:#x}: {} {}, kTLS send={} recv={}", s.id, s.tls->version(),
+            s.tls->cipher(), kernel_send, kernel_recv);
+
+    // the kernel does it all: plain syscalls from here on
+    if (kernel_send && kernel_recv) {
+        s.tls.reset();
+    }
+    start_upgrade(s);
+}
+
+void
+client::start_upgrade(session& s)
+{
+    // a fresh key per attempt
+    std::string const key = frame_generator::generate_websocket_key();
+    s.expected_accept = websocket_accept_key(key);
+    s.handshake_scanned = 0;
+    std::string const request = make_upgrade_request(s.host, s.path, key, config_.protocol);
+    s.out.insert(s.out.end(), request.begin(), request.end());
+
+    s.state = State::Handshake;
+    watch(s, EPOLLIN, EPOLL_CTL_MOD);
+    flush(s);
+}
+
+bool
+client::on_readable(session& s)
+{
+    for (;;) {
+        if (s.in.bytes_unread() == 0 || s.in.bytes_left() == 0) {
+            s.in.shift();
+        }
+
+        std::size_t const room = s.in.bytes_left();
+        ssize_t const nbytes = s.tls != nullptr && !s.tls->kernel_recv()
+                ? s.tls->recv(s.in.write_ptr(), room)
+                : ::recv(s.fd, s.in.write_ptr(), room, MSG_DONTWAIT);
+        if (nbytes == 0) {
+            drop(s, CloseAbnormal);
+            return false;
+        }
+        if (nbytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            SPDLOG_ERROR("error: recv: {} {}", std::strerror(errno), errno);
+            drop(s, CloseAbnormal);
+            return false;
+        }
+        s.in.bytes_written(static_cast<std::size_t>(nbytes));
+
+        bool const ok = s.state == State::Handshake ? on_handshake_data(s) : on_frames(s);
+        if (!ok) {
+            return false;
+        }
+
+        // the socket is drained
+        if (static_cast<std::size_t>(nbytes) < room) {
+            return true;
+        }
+    }
+}
+
+bool
+client::on_handshake_data(session& s)
+{
+    // resume the search for the end of the header where the last one stopped
+    std::string_view const response(
+            reinterpret_cast<char const*>(s.in.read_ptr()), s.in.bytes_unread());
+    std::size_t const from = s.handshake_scanned < 3 ? 0 : s.handshake_scanned - 3;
+    std::size_t const end = response.find("\r\n\r\n", from);
+    if (end == std::string_view::npos) {
+        if (response.size() > MaxUpgradeResponseSize) {
+            SPDLOG_ERROR("error: upgrade response over {} bytes", MaxUpgradeResponseSize);
+            ++stats_.handshake_failures;
+            drop(s, CloseAbnormal);
+            return false;
+        }
+        s.handshake_scanned = response.size();
+        return true;
+    }
+
+    std::size_t const header_size = end + 4;
+    if (!validate_upgrade_response(
+                response.substr(0, header_size), s.expected_accept, config_.protocol)) {
+        ++stats_.handshake_failures;
+        drop(s, CloseAbnormal);
+        return false;
+    }
+    s.in.bytes_read(header_size);
+
+    s.state = State::Open;
+    s.attempts = 0;
+    ++s.timer_seq; // no more connect timeout
+    ++stats_.connections_opened;
+    if (config_.on_open) {
+        config_.on_open(s.id);
+    }
+
+    // frames may have come right behind the response
+    return on_frames(s);
+}
+
+bool
+client::on_frames(session& s)
+{
+    frame header;
+    while (s.in.bytes_unread() >= MinFrameHeaderSize) {
+        std::size_t const available = s.in.bytes_unread();
+        ParseResult const result = header.parse_header(s.in.read_ptr(), available);
+        if (result == ParseResult::NeedMoreData) {
+            break;
+        }
+
+        // servers never mask (rfc 6455 5.1)
+        if (result == ParseResult::InvalidFrame || header.masked()) {
+            return protocol_error(s, CloseProtocolError);
+        }
+
+        std::size_t const header_size = header.header_size();
+        std::uint64_t const payload_len = header.payload_len();
+        if (payload_len > ReadBufferSize - header_size || payload_len > config_.max_message_size) {
+            return protocol_error(s, CloseTooBig);
+        }
+        if (available < header_size + payload_len) {
+            break;
+        }
+
+        bool const fin = header.fin();
+        OpCode const op_code = header.op_code();
+        std::span<std::uint8_t const> const payload(s.in.read_ptr() + header_size, payload_len);
+        s.in.bytes_read(header_size + payload_len);
+
+        switch (op_code) {
+            case OpCode::Text:
+            case OpCode::Binary:
+                if (s.message_op != OpCode::Continuation) {
+                    return protocol_error(s, CloseProtocolError);
+                }
+                if (fin) {
+                    deliver(s, op_code, payload);
+                } else {
+                    s.message_op = op_code;
+                    s.message.assign(payload.begin(), payload.end());
+                }
+                break;
+            case OpCode::Continuation:
+                if (s.message_op == OpCode::Continuation) {
+                    return protocol_error(s, CloseProtocolError);
+                }
+                if (s.message.size() + payload.size() > config_.max_message_size) {
+                    return protocol_error(s, CloseTooBig);
+                }
+                s.message.insert(s.message.end(), payload.begin(), payload.end());
+                if (fin) {
+                    OpCode const message_op = std::exchange(s.message_op, OpCode::Continuation);
+                    deliver(s, message_op, s.message);
+                    s.message.clear();
+                }
+                break;
+            case OpCode::Close:
+            case OpCode::Ping:
+            case OpCode::Pong:
+                // parse_header() checked FIN and the 125 byte limit
+                if (!on_control_frame(s, op_code, payload)) {
+                    return false;
+                }
+                break;
+            default:
+                return protocol_error(s, CloseProtocolError);
+        }
+    }
+    return true;
+}
+
+bool
+client::on_control_frame(session& s, OpCode op_code, std::span<std::uint8_t const> payload)
+{
+    switch (op_code) {
+        case OpCode::Ping:
+            if (s.state == State::Open) {
+                queue_frame(s, OpCode::Pong, payload);
+            }
+            return true;
+        case OpCode::Close: {
+            if (payload.size() == 1) {
+                return protocol_error(s, CloseProtocolError);
+            }
+            std::uint16_t const code = payload.empty()
+                    ? CloseNoStatus
+                    : static_cast<std::uint16_t>((payload[0] << 8) | payload[1]);
+
+            // the server started the closing handshake: answer with its code
+            if (s.state == State::Open) {
+                std::size_t const code_size = std::min<std::size_t>(payload.size(), 2);
+                queue_frame(s, OpCode::Close, payload.first(code_size));
+                if (!flush(s)) {
+                    return false;
+                }
+            }
+            drop(s, code);
+            return false;
+        }
+        case OpCode::Pong:
+        case OpCode::Continuation:
+        case OpCode::Text:
+        case OpCode::Binary:
+        default:
+            return true;
+    }
+}
+
+bool
+client::protocol_error(session& s, std::uint16_t code)
+{
+    SPDLOG_ERROR("error: connection {:#x}: closing with {}", s.id, code);
+    if (s.state == State::Open) {
+        std::array<std::uint8_t, 2> const payload = {
+                static_cast<std::uint8_t>(code >> 8), static_cast<std::uint8_t>(code)};
+        queue_frame(s, OpCode::Close, payload);
+        if (!flush(s)) {
+            return false;
+        }
+    }
+    drop(s, code);
+    return false;
+}
+
+void
+client::deliver(session& s, OpCode op_code, std::span<std::uint8_t const> payload)
+{
+    ++stats_.messages_received;
+    if (config_.on_message) {
+        config_.on_message(s.id, op_code, payload);
+    }
+}
+
+void
+client::queue_frame(session& s, OpCode op_code, std::span<std::uint8_t const> payload)
+{
+    // mask while copying into the write buffer: one pass over the payload
+    std::array<std::uint8_t, 4> masking_key{};
+    std::uint32_t const key_bits = rng_.next_u32();
+    std::memcpy(masking_key.data(), &key_bits, sizeof(key_bits));
+
+    std::size_t const header_size = frame_header_size(payload.size(), /*masked=*/true);
+    std::size_t const pos = s.out.size();
+    s.out.resize(pos + header_size + payload.size());
+    encode_frame_header(&s.out[pos], op_code, payload.size(), /*fin=*/true, masking_key.data());
+    copy_masked(&s.out[pos + header_size], payload, masking_key);
+
+    queue_flush(s);
+}
+
+void
+client::queue_flush(session& s)
+{
+    // a blocked connection is flushed by EPOLLOUT instead
+    if (!s.flush_queued && !s.write_blocked) {
+        s.flush_queued = true;
+        flush_queue_.push_back(static_cast<std::uint32_t>(s.id & 0xffff'ffff));
+    }
+}
+
+bool
+client::flush(session& s)
+{
+    while (s.out_sent < s.out.size()) {
+        std::uint8_t const* const data = s.out.data() + s.out_sent;
+        std::size_t const len = s.out.size() - s.out_sent;
+        ssize_t const nbytes = s.tls != nullptr && !s.tls->kernel_send()
+                ? s.tls->send(data, len)
+                : ::send(s.fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        ++stats_.write_syscalls;
+        if (nbytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!s.write_blocked) {
+                    s.write_blocked = true;
+                    watch(s, EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+                }
+                return true;
+            }
+            SPDLOG_ERROR("error: send: {} {}", std::strerror(errno), errno);
+            drop(s, CloseAbnormal);
+            return false;
+        }
+        s.out_sent += static_cast<std::size_t>(nbytes);
+    }
+
+    s.out.clear();
+    s.out_sent = 0;
+    if (s.write_blocked) {
+        s.write_blocked = false;
+        watch(s, EPOLLIN, EPOLL_CTL_MOD);
+    }
+    return true;
+}
+
+void
+client::flush_pending_writes()
+{
+    // a failed flush may run on_close, which may send on other connections
+    for (std::size_t i = 0; i < flush_queue_.size(); ++i) {
+        session& s = *sessions_[flush_queue_[i]];
+        s.flush_queued = false;
+        if (s.fd != -1 && (s.state == State::Handshake || s.state == State::Open
+                                  || s.state == State::Closing)) {
+            flush(s);
+        }
+    }
+    flush_queue_.clear();
+}
+
+void
+client::set_timer(session& s, clock::duration delay)
+{
+    ++s.timer_seq;
+    timers_.push(timer{now_ + delay, static_cast<std::uint32_t>(s.id & 0xffff'ffff), s.timer_seq});
+}
+
+void
+client::on_timers()
+{
+    while (!timers_.empty() && timers_.top().when <= now_) {
+        timer const t = timers_.top();
+        timers_.pop();
+
+        session& s = *sessions_[t.slot];
+        if (t.seq != s.timer_seq) {
+            continue; // superseded
+        }
+
+        switch (s.state) {
+            case State::Waiting:
+                start_attempt(s);
+                break;
+            case State::Connecting:
+            case State::Tls:
+            case State::Handshake:
+                SPDLOG_WARN("connection {:#x}: no upgrade within {}ms", s.id,
+                        config_.connect_timeout.count());
+                drop(s, CloseAbnormal);
+                break;
+            case State::Closing:
+                drop(s, CloseAbnormal); // the server never answered our close
+                break;
+            case State::Free:
+            case State::Open:
+            default:
+                break;
+        }
+    }
+}
+
+void
+client::drop(session& s, std::uint16_t code)
+{
+    bool const was_open = s.state == State::Open || s.state == State::Closing;
+    if (!was_open) {
+        ++stats_.connect_failures;
+    }
+    close_socket(s);
+    s.state = State::Waiting;
+    ++s.timer_seq;
+
+    std::uint64_t const id = s.id;
+    if (was_open && config_.on_close) {
+        config_.on_close(id, code);
+        if (s.id != id || s.state != State::Waiting) {
+            return; // closed for good, maybe reused, from the callback
+        }
+    }
+
+    if (s.closing_for_good || !config_.reconnect) {
+        release(s);
+        return;
+    }
+
+    // exponential backoff with "equal jitter": at least half the cap, so
+    // a server refusing everyone isn't hammered, plus a random share of
+    // the other half, so clients dropped together don't return together
+    std::uint32_t const doublings = std::min(s.attempts, MaxBackoffDoublings);
+    auto const cap = std::min(config_.backoff_max, config_.backoff_min * (1U << doublings));
+    auto const half = cap / 2;
+    auto const jitter = std::chrono::milliseconds(
+            rng_.next() % static_cast<std::uint64_t>(cap.count() - half.count() + 1));
+    ++s.attempts;
+
+    SPDLOG_DEBUG("connection {:#x}: attempt {} in {}ms", s.id, s.attempts,
+            (half + jitter).count());
+    set_timer(s, half + jitter);
+}
+
+void
+client::release(session& s) noexcept
+{
+    s.state = State::Free;
+    ++s.timer_seq;
+    free_slots_.push_back(static_cast<std::uint32_t>(s.id & 0xffff'ffff));
+    --live_;
+}
+
+void
+client::close_socket(session& s) noexcept
+{
+    s.tls.reset();
+    if (s.fd != -1) {
+        ::close(s.fd); // also takes it out of the epoll set
+        s.fd = -1;
+    }
+    s.in.bytes_read(s.in.bytes_unread());
+    s.in.shift();
+    s.out.clear();
+    s.out_sent = 0;
+    s.write_blocked = false;
+    s.message.clear();
+    s.message_op = OpCode::Continuation;
+    s.handshake_scanned = 0;
+}
+
+void
+client::watch(session& s, std::uint32_t events, int op) noexcept
+{
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = s.id;
+    if (::epoll_ctl(epollfd_, op, s.fd, &ev) == -1) {
+        SPDLOG_ERROR("error: epoll_ctl: {} {}", std::strerror(errno), errno);
+    }
+}
+
+} // namespace ws
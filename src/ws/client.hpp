@@ -0,0 +1,258 @@
+#pragma once
+
+#include "frame.hpp"
+#include "util/buffer_arena.hpp"
+#include "util/byte_buffer.hpp"
+#include "util/random.hpp"
+#include "util/socket_address.hpp"
+#include "util/tls.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace ws {
+
+/// Settings and callbacks shared by all of a client's connections
+struct client_config
+{
+    std::chrono::milliseconds connect_timeout{5000}; ///< tcp connect plus the upgrade handshake
+    std::chrono::milliseconds close_timeout{1000};   ///< wait for the server to answer a close
+    bool reconnect = true;                           ///< reconnect connections that fail or drop
+    std::chrono::milliseconds backoff_min{100};      ///< backoff cap after the first failure
+    std::chrono::milliseconds backoff_max{30'000};   ///< backoff cap however many failures
+    std::size_t max_message_size = 16'777'216;       ///< larger messages close with 1009
+    std::size_t max_pending_bytes = 4'194'304;       ///< send() fails past this many unsent bytes
+    bool nodelay = true;                             ///< TCP_NODELAY on tcp connections
+
+    /// wss://: a client side context (see util/tls.hpp) for TLS on tcp
+    /// connections; unix socket ones stay plaintext. The server name is
+    /// the Host field without its port. nullptr = ws://.
+    std::shared_ptr<tls_context const> tls;
+
+    /// Subprotocol to offer in Sec-WebSocket-Protocol, e.g. BatchProtocol
+    /// (see ws/batch.hpp). The server has to agree to it or the handshake
+    /// fails. Empty = none.
+    std::string protocol;
+
+    /// Upgrade accepted; the connection can send
+    std::function<void(std::uint64_t id)> on_open;
+
+    /// A complete (reassembled) text or binary message. The payload is
+    /// only valid during the call.
+    std::function<void(std::uint64_t id, OpCode, std::span<std::uint8_t const>)> on_message;
+
+    /// An open connection ended: the server's close code, or 1006 if it
+    /// went away without one. Reconnecting (if enabled) starts afterwards.
+    std::function<void(std::uint64_t id, std::uint16_t code)> on_close;
+};
+
+/// Counters kept by a client
+struct client_stats
+{
+    std::uint64_t connect_attempts = 0;   ///< sockets opened
+    std::uint64_t connect_failures = 0;   ///< attempts that failed before the upgrade
+    std::uint64_t handshake_failures = 0; ///< of those, responses that failed validation
+    std::uint64_t connections_opened = 0; ///< upgrades accepted
+    std::uint64_t messages_sent = 0;      ///< frames queued by send()
+    std::uint64_t messages_received = 0;  ///< messages handed to on_message
+    std::uint64_t write_syscalls = 0;     ///< send(2) calls
+    std::uint64_t tls_handshakes = 0;     ///< tls handshakes completed
+    std::uint64_t ktls_send = 0;          ///< of those, ones the kernel encrypts for
+    std::uint64_t ktls_recv = 0;          ///< of those, ones the kernel decrypts for
+};
+
+/*! \class  client
+ *  \brief  Non-blocking websocket client: one thread, one epoll set, as
+ *          many connections as there are file descriptors.
+ *
+ *  Connects are non-blocking and the upgrade handshake resumes wherever
+ *  the response stops, then checks Sec-WebSocket-Accept. Frames are
+ *  masked while they are copied into the connection's write buffer, and
+ *  everything queued during a pass of poll() goes out in one send(2) per
+ *  connection. Failed or dropped connections reconnect after a jittered
+ *  exponential backoff, keeping their id.
+ *
+ *  Not thread-safe: call everything (except stop()) from the thread that
+ *  runs poll().
+ */
+class client
+{
+public:
+    /// \throw std::runtime_error if the epoll set can't be created
+    explicit client(client_config const&);
+    ~client() noexcept;
+
+    // connections point back at us: no copies/moves
+    client(client const&) = delete;
+    client(client&&) = delete;
+    client& operator=(client const&) = delete;
+    client&& operator=(client&&) = delete;
+
+    /// Start connecting to \c address ("host:port", "unix:PATH" or
+    /// "unix:@NAME", see resolve_socket_address()). Returns at once; on_open reports the
+    /// upgrade.
+    /// \param path request target of the upgrade
+    /// \param host Host field, \c address if empty
+    /// \return id naming the connection until it is closed for good
+    /// \throw std::runtime_error if \c address doesn't resolve
+    std::uint64_t connect(
+            std::string const& address, std::string const& path = "/", std::string host = "");
+
+    /// Queue a (masked) message on an open connection; it goes out by the
+    /// end of the current or next poll()
+    /// \return \c false if the connection isn't open or too much is queued
+    bool send(std::uint64_t id, std::span<std::uint8_t const> payload,
+            OpCode op_code = OpCode::Binary);
+    bool send_text(std::uint64_t id, std::string_view text);
+
+    /// Close a connection for good: an open one sends a close frame and
+    /// waits for the server's (or close_timeout), any other stops trying
+    void close(std::uint64_t id, std::uint16_t code = 1000);
+
+    /// \return \c true if \c id is open, i.e. between on_open and on_close
+    bool is_open(std::uint64_t id) const noexcept;
+
+    /// Wait up to \c timeout for socket events, handle them, fire due
+    /// timers and send whatever was queued
+    /// \return \c false on a fatal error
+    bool poll(std::chrono::milliseconds timeout);
+
+    /// poll() until stop() or until no connection is left
+    /// \return \c false on a fatal error
+    bool run();
+
+    /// Make run() return; safe to call from any thread
+    void stop() noexcept;
+
+    /// Connections not closed for good
+    std::size_t size() const noexcept;
+
+    client_stats const& stats() const noexcept;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    /// largest frame we take in one piece; bigger messages must be fragmented
+    static constexpr std::size_t ReadBufferSize = 262'144;
+
+    enum class State : std::uint8_t
+    {
+        Free,       ///< slot unused
+        Waiting,    ///< backing off before the next attempt
+        Connecting, ///< tcp connect in progress
+        Tls,        ///< tls handshake in progress (wss://)
+        Handshake,  ///< upgrade request sent, reading the response
+        Open,       ///< websocket frames flowing
+        Closing     ///< close frame sent, waiting for the server's
+    };
+
+    struct session
+    {
+        std::uint64_t id = 0;
+        State state = State::Free;
+        int fd = -1;
+        socket_address addr;
+        std::string path;
+        std::string host;
+        std::string expected_accept;              ///< Sec-WebSocket-Accept for this attempt
+        std::size_t handshake_scanned = 0;        ///< response bytes known not to end the header
+        byte_buffer<ReadBufferSize> in;           ///< bytes read, not yet parsed
+        arena_bytes out;                          ///< frames queued, not yet sent
+        std::size_t out_sent = 0;                 ///< bytes of out already sent
+        bool flush_queued = false;                ///< in flush_queue_
+        bool write_blocked = false;               ///< out waits for EPOLLOUT
+        bool closing_for_good = false;            ///< close() called: no reconnect
+        std::uint32_t attempts = 0;               ///< failures since the last open
+        std::uint32_t timer_seq = 0;              ///< invalidates older timers
+        OpCode message_op = OpCode::Continuation; ///< of the fragmented message, if any
+        arena_bytes message;                      ///< fragments so far
+        std::unique_ptr<tls_session> tls;         ///< wss:// the kernel doesn't do all of
+    };
+
+    struct timer
+    {
+        clock::time_point when;
+        std::uint32_t slot = 0;
+        std::uint32_t seq = 0;
+
+        bool
+        operator>(timer const& rhs) const noexcept
+        {
+            return when > rhs.when;
+        }
+    };
+
+    /// \return the live session named \c id, \c nullptr if there's none
+    session* find(std::uint64_t id) const noexcept;
+
+    /// Open a socket and start a non-blocking connect
+    void start_attempt(session&);
+
+    void on_event(session&, std::uint32_t events);
+    void on_connected(session&);
+    void on_tls_handshake(session&);
+
+    /// Send the upgrade request
+    void start_upgrade(session&);
+
+    /// Read until the socket is drained and handle what came in
+    /// \return \c false if the connection was dropped
+    bool on_readable(session&);
+
+    /// \return \c false if the connection was dropped
+    bool on_handshake_data(session&);
+    bool on_frames(session&);
+    bool on_control_frame(session&, OpCode, std::span<std::uint8_t const> payload);
+
+    /// Send a close frame with \c code (if still open) and drop the connection
+    /// \return \c false, for the caller to pass on
+    bool protocol_error(session&, std::uint16_t code);
+
+    void deliver(session&, OpCode, std::span<std::uint8_t const> payload);
+
+    /// Append a masked frame to the connection's write buffer
+    void queue_frame(session&, OpCode, std::span<std::uint8_t const> payload);
+
+    void queue_flush(session&);
+
+    /// Send as much of the write buffer as the socket takes
+    /// \return \c false if the connection was dropped
+    bool flush(session&);
+
+    void flush_pending_writes();
+    void set_timer(session&, clock::duration delay);
+    void on_timers();
+
+    /// The connection failed or ended: tell on_close if it was open, then
+    /// back off and reconnect, or free the slot
+    void drop(session&, std::uint16_t code);
+
+    void release(session&) noexcept;
+    void close_socket(session&) noexcept;
+    void watch(session&, std::uint32_t events, int op) noexcept;
+
+private:
+    client_config config_;
+    int epollfd_ = -1;
+    std::vector<std::unique_ptr<session>> sessions_; ///< indexed by slot, kept when freed
+    std::vector<std::uint32_t> free_slots_;          ///< slots of sessions_ to reuse
+    std::vector<std::uint32_t> flush_queue_;         ///< slots with frames queued this pass
+    std::priority_queue<timer, std::vector<timer>, std::greater<>> timers_; ///< earliest first
+    std::uint32_t generation_ = 0;  ///< high half of ids, so a reused slot gets a new id
+    std::size_t live_ = 0;          ///< sessions not Free
+    std::atomic<bool> stop_{false}; ///< set by stop()
+    wyrand rng_;                    ///< masking keys and backoff jitter
+    clock::time_point now_;         ///< as of the last epoll_wait
+    client_stats stats_;
+};
+
+} // namespace ws
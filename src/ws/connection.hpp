@@ -1,10 +1,18 @@
 #pragma once
 
 #include "frame.hpp"
+#include "util/buffer_arena.hpp"
 #include "util/byte_buffer.hpp"
+#include "util/tls.hpp"
+#include "util/token_bucket.hpp"
 #include <arpa/inet.h> // INET_ADDRSTRLEN
+#include <chrono>
+#include <array>
 #include <cstdint>
+#include <deque>
 #include <format>
+#include <memory>
+#include <vector>
 
 
 namespace {
@@ -13,8 +21,11 @@ static constexpr std::size_t BufferSize = 1'048'576; ///< max size of connection
 
 namespace ws {
 
+class coro_connection;
+
 enum class ConnectionState : std::uint8_t
 {
+    TlsHandshake,
     TcpConnected,
     Http,
     WebSocket,
@@ -22,15 +33,89 @@ enum class ConnectionState : std::uint8_t
     Undefined
 };
 
+/// A frame handed to the kernel with MSG_ZEROCOPY. The kernel reads it in
+/// place until it reports the send released, so it must stay put until then:
+/// connection::zerocopy_frames is a deque, only ever grown at the back and
+/// released from the front, which never moves the frames in between.
+struct zerocopy_frame
+{
+    std::uint32_t release_count = 0;                       ///< released once this many sends are
+    std::array<std::uint8_t, MaxFrameHeaderSize> header{}; ///< encoded frame header
+    std::size_t header_size = 0;                           ///< bytes used in header
+    std::vector<std::uint8_t> payload;                     ///< frame payload
+};
+
+/// A reply of a timestamped connection still waiting for its kernel
+/// transmit timestamps
+struct timed_reply
+{
+    std::uint32_t key = 0;     ///< offset of its last byte in the stream sent, see tx_timestamp
+    std::int64_t reply_ns = 0; ///< when the handler produced it
+    std::int64_t sent_ns = 0;  ///< when the kernel passed it to the device, 0 until then
+};
+
 struct connection
 {
     int sockfd;
+    std::uint64_t id = 0; ///< names the connection to other threads, 0 until upgraded
     byte_buffer<BufferSize> buf;
     char ip[INET_ADDRSTRLEN];
     std::uint16_t port = 0;
 
     ConnectionState conn_state = ConnectionState::Undefined;
 
+    // rate limiting and fairness
+    token_bucket msg_limiter;   ///< frames per second
+    token_bucket byte_limiter;  ///< wire bytes per second
+    bool deferred = false;      ///< queued for another pass of the event loop
+    bool throttled = false;     ///< a frame waits for the limiters to refill
+    bool read_pending = false;  ///< socket may still hold data we haven't recv'd
+    bool flush_queued = false;  ///< pending_writes is due at the end of the pass
+    std::chrono::steady_clock::time_point throttled_until{}; ///< limiters have enough by then
+    std::chrono::steady_clock::time_point last_activity{}; ///< last time data arrived
+
+    // write coalescing
+    arena_bytes pending_writes; ///< frames queued during this pass
+    bool write_blocked = false; ///< pending_writes waits for EPOLLOUT
+
+    // coroutine handler, owned by the event loop
+    coro_connection* handler = nullptr;
+
+    // worker offload
+    std::uint32_t offloaded = 0; ///< messages at the worker pool, not yet replied to
+
+    // MSG_ZEROCOPY sends
+    bool zerocopy = false;                       ///< SO_ZEROCOPY enabled on sockfd
+    std::uint32_t zerocopy_sent = 0;             ///< sends made with MSG_ZEROCOPY
+    std::uint32_t zerocopy_released = 0;         ///< of those, released by the kernel (in order)
+    std::deque<zerocopy_frame> zerocopy_frames;  ///< frames the kernel may still be reading
+
+    // reverse proxy
+    int backend_fd = -1;         ///< paired backend connection, -1 if none
+    arena_bytes backend_backlog; ///< client payload the backend couldn't take yet
+
+    // wss://
+    bool secure = false;              ///< tls, in the kernel or in user space
+    std::unique_ptr<tls_session> tls; ///< the directions the kernel didn't take, else nullptr
+
+    // message batching
+    bool batched = false; ///< agreed to the batching subprotocol, binary messages are batches
+
+    // kernel timestamps (SO_TIMESTAMPING)
+    bool timestamping = false;              ///< rx and tx timestamps enabled on sockfd
+    std::int64_t rx_ns = 0;                 ///< kernel receive stamp of the latest bytes read
+    std::int64_t read_ns = 0;               ///< when recv() returned them
+    std::int64_t parse_ns = 0;              ///< when the current frame was parsed
+    std::uint32_t parse_position = 0;       ///< bytes sent or queued when it was
+    std::uint32_t tx_bytes = 0;             ///< bytes handed to the kernel (wraps like the key)
+    std::vector<timed_reply> timed_replies; ///< replies waiting for their tx stamps, in order
+
+    // static http responses
+    int file_fd = -1;                  ///< file being sent with sendfile(), not owned; -1 if none
+    std::size_t file_offset = 0;       ///< next byte of it to send
+    std::size_t file_end = 0;          ///< its size
+    bool close_after_response = false; ///< draining: close once the response is out
+
     // fragmentation handling
     OpCode current_frame_type = OpCode::Continuation;
     bool is_fragmented_msg = false;
@@ -48,6 +133,12 @@ struct connection
         fragments_received = 0;
     }
 
+    bool
+    zerocopy_in_flight() const noexcept
+    {
+        return zerocopy_sent != zerocopy_released;
+    }
+
     std::string
     fragmentation_status() const
     {
@@ -11,6 +11,8 @@ constexpr std::string_view
 to_string(ConnectionState s) noexcept
 {
     switch (s) {
+        case ConnectionState::TlsHandshake:
+            return "TlsHandshake";
         case ConnectionState::TcpConnected:
             return "TcpConnected";
         case ConnectionState::Http:
@@ -1,6 +1,8 @@
 #include "frame.hpp"
+#include "frame_header.hpp"
 #include <bit>     // std::byteswap, std::endian
 #include <cstring> // std::memcpy, std::memset
+#include <utility> // std::move
 
 namespace ws {
 
@@ -48,6 +50,12 @@ basic_websocket_header::payload_len_indicator() const noexcept
 
 /**********************************************************************/
 
+frame::frame(allocator_type alloc) noexcept
+        : payload_data_(alloc)
+{
+    // empty
+}
+
 void
 frame::reset() noexcept
 {
@@ -64,6 +72,33 @@ frame::reset() noexcept
 
 ParseResult
 frame::parse_from_buffer(std::uint8_t const* data, std::size_t avail) noexcept
+{
+    if (ParseResult const result = parse_header(data, avail); result != ParseResult::Success) {
+        return result;
+    }
+    valid_ = false;
+
+    // check if we have complete frame
+    if (avail < header_size_ + payload_len_) {
+        return ParseResult::NeedMoreData;
+    }
+
+    // extract and store payload data
+    std::uint8_t const* payload_start = data + header_size_;
+    payload_data_.resize(payload_len_);
+    std::memcpy(payload_data_.data(), payload_start, payload_len_);
+
+    if (masked_) {
+        // store unmasked payload
+        apply_mask(payload_data_, masking_key());
+    }
+
+    valid_ = true;
+    return ParseResult::Success;
+}
+
+ParseResult
+frame::parse_header(std::uint8_t const* data, std::size_t avail) noexcept
 {
     reset();
 
@@ -125,26 +160,7 @@ frame::parse_from_buffer(std::uint8_t const* data, std::size_t avail) noexcept
         header_size_ += 4;
     }
 
-    // check if we have complete frame
-    if (avail < header_size_ + payload_len_) {
-        return ParseResult::NeedMoreData;
-    }
-
-    // extract and store payload data
-    std::uint8_t const* payload_start = data + header_size_;
-    payload_data_.resize(payload_len_);
-
-    if (masked_) {
-        // store unmasked payload
-        for (std::uint64_t i = 0; i < payload_len_; ++i) {
-            payload_data_[i] = payload_start[i] ^ masking_key_[i % 4];
-        }
-    } else {
-        // store payload directly
-        std::memcpy(payload_data_.data(), payload_start, payload_len_);
-    }
-
-    // additional validation
+    // everything but the payload is known by now
     if (!is_valid_frame()) {
         return ParseResult::InvalidFrame;
     }
@@ -226,6 +242,12 @@ frame::get_payload_data() const noexcept
     return std::span<std::uint8_t const>(payload_data_);
 }
 
+std::pmr::vector<std::uint8_t>
+frame::take_payload_data() noexcept
+{
+    return std::move(payload_data_);
+}
+
 std::span<std::uint8_t const>
 frame::get_raw_payload_data() const noexcept
 {
@@ -236,13 +258,23 @@ frame::get_raw_payload_data() const noexcept
 
 std::optional<std::string>
 frame::get_text_payload() const
+{
+    if (auto const text = get_text_view()) {
+        return std::string(*text);
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string_view>
+frame::get_text_view() const noexcept
 {
     if (!valid_ || op_code_ != OpCode::Text) {
         return std::nullopt;
     }
 
     // payload_data_ is already unmasked if it was masked
-    return std::string(reinterpret_cast<char const*>(payload_data_.data()), payload_data_.size());
+    return std::string_view(
+            reinterpret_cast<char const*>(payload_data_.data()), payload_data_.size());
 }
 
 bool
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <memory_resource>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ws {
@@ -60,11 +62,16 @@ private:
     std::uint8_t masking_key_[4] = {0};
     std::size_t header_size_ = 0;
     bool valid_ = false;
-    std::vector<std::uint8_t> payload_data_; // store the actual payload data
+    std::pmr::vector<std::uint8_t> payload_data_; // store the actual payload data
 
 public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::uint8_t>;
+
     frame() = default;
 
+    /// \param alloc where the payload is allocated
+    explicit frame(allocator_type alloc) noexcept;
+
     /// reset frame to initial state
     void reset() noexcept;
 
@@ -73,6 +80,12 @@ public:
     /// \return ParseResult indicating success, need more data, or invalid frame
     ParseResult parse_from_buffer(std::uint8_t const*, std::size_t) noexcept;
 
+    /// Parse and validate only the frame header; the payload is neither
+    /// needed nor copied. On success payload_len() bytes follow the
+    /// header_size() bytes of header, still masked if masked().
+    /// \return ParseResult as for parse_from_buffer()
+    ParseResult parse_header(std::uint8_t const*, std::size_t) noexcept;
+
 public:
     bool fin() const noexcept;
     bool rsv1() const noexcept;
@@ -92,6 +105,11 @@ public:
     /// @return Span pointing to payload data
     std::span<std::uint8_t const> get_payload_data() const noexcept;
 
+    /// Move the (unmasked) payload out of the frame, e.g. to keep it alive
+    /// after the frame is gone. The frame's payload is empty afterwards.
+    /// The payload keeps the frame's allocator.
+    std::pmr::vector<std::uint8_t> take_payload_data() noexcept;
+
     /// Get raw payload data (still masked if frame was masked)
     /// @return Span pointing to raw payload data
     std::span<std::uint8_t const> get_raw_payload_data() const noexcept;
@@ -100,6 +118,10 @@ public:
     /// @return String of the text payload (automatically unmasked)
     std::optional<std::string> get_text_payload() const;
 
+    /// Get text payload without copying it (for text frames)
+    /// @return View of the text payload, valid as long as the payload is
+    std::optional<std::string_view> get_text_view() const noexcept;
+
 private:
     /// validate frame according to RFC 6455
     bool is_valid_frame() const noexcept;
@@ -1,13 +1,20 @@
 #include "frame_generator.hpp"
+#include "frame_header.hpp"
 #include "util/base64_codec.hpp"
+#include "util/random.hpp"
+#include <array>
 #include <bit>     // std::byteswap, std::endian
 #include <cstring> // std::memcpy
-#include <random>  // std::mt19937, std::random_device,
-                   // std::uniform_int_distribution
 #include <stdexcept>
 
 namespace ws {
 
+frame_generator::frame_generator(allocator_type alloc) noexcept
+        : frame_data_(alloc)
+{
+    // empty
+}
+
 frame_generator&
 frame_generator::text(std::string_view text, bool fin, bool mask)
 {
@@ -47,21 +54,16 @@ frame_generator::pong(std::span<std::uint8_t const> payload, bool mask)
 frame_generator&
 frame_generator::close(std::uint16_t code, std::string_view reason, bool mask)
 {
-    std::vector<std::uint8_t> close_payload;
+    if (reason.size() + 2 > MaxControlPayloadSize) {
+        throw std::invalid_argument("close payload (code + reason) cannot exceed 125 bytes");
+    }
 
-    // add close code (big-endian)
-    close_payload.resize(2);
+    // close code (big-endian) followed by the optional reason
+    std::array<std::uint8_t, MaxControlPayloadSize> close_payload{};
     write_be16(close_payload.data(), code);
+    std::memcpy(close_payload.data() + 2, reason.data(), reason.size());
 
-    // add reason if provided
-    if (!reason.empty()) {
-        if (reason.size() + 2 > 125) {
-            throw std::invalid_argument("close payload (code + reason) cannot exceed 125 bytes");
-        }
-        close_payload.insert(close_payload.end(), reason.begin(), reason.end());
-    }
-
-    build_frame(OpCode::Close, std::span<std::uint8_t const>(close_payload), true, mask);
+    build_frame(OpCode::Close, std::span(close_payload).first(2 + reason.size()), true, mask);
     return *this;
 }
 
@@ -91,23 +93,22 @@ frame_generator::reset() noexcept
     return *this;
 }
 
-std::vector<std::uint8_t>
+std::pmr::vector<std::uint8_t>
 frame_generator::take_data() noexcept
 {
     return std::move(frame_data_);
 }
 
-// In websocket_frame_generator.cpp
 std::string
 frame_generator::generate_websocket_key() noexcept
 {
-    static thread_local std::random_device rd;
-    static thread_local std::mt19937 gen(rd());
-    static thread_local std::uniform_int_distribution<std::uint8_t> dis(0, 255);
-
+    // rfc 6455 4.1: the nonce must be randomly selected; use the kernel CSPRNG
     std::array<std::uint8_t, 16> key_bytes{};
-    for (auto& byte : key_bytes) {
-        byte = dis(gen);
+    if (!secure_random_bytes(key_bytes)) {
+        for (std::size_t i = 0; i < key_bytes.size(); i += 4) {
+            std::uint32_t const bits = fast_random_u32();
+            std::memcpy(&key_bytes[i], &bits, sizeof(bits));
+        }
     }
 
     std::string_view raw_bytes(reinterpret_cast<const char*>(key_bytes.data()), key_bytes.size());
@@ -118,63 +119,22 @@ void
 frame_generator::build_frame(
         OpCode opcode, std::span<std::uint8_t const> payload, bool fin, bool mask)
 {
-    frame_data_.clear();
-
-    std::uint64_t const payload_len = payload.size();
-    std::size_t header_size = 2; // Basic header
-
-    // calculate extended length size
-    if (payload_len >= 65536) {
-        header_size += 8;
-    } else if (payload_len >= 126) {
-        header_size += 2;
-    }
-
-    // add masking key size if needed
-    if (mask) {
-        header_size += 4;
-    }
-
-    // reserve space for header + payload
-    frame_data_.reserve(header_size + payload_len);
-    frame_data_.resize(header_size);
-
-    std::uint8_t* header = frame_data_.data();
-    std::size_t header_pos = 0;
-
-    // byte 1: FIN + RSV + OpCode
-    header[header_pos++] = (fin ? 0x80 : 0x00) | static_cast<std::uint8_t>(opcode);
-
-    // byte 2: MASK + Payload length
-    std::uint8_t mask_bit = mask ? 0x80 : 0x00;
-
-    if (payload_len < 126) {
-        header[header_pos++] = mask_bit | static_cast<std::uint8_t>(payload_len);
-    } else if (payload_len < 65536) {
-        header[header_pos++] = mask_bit | 126;
-        write_be16(&header[header_pos], static_cast<std::uint16_t>(payload_len));
-        header_pos += 2;
-    } else {
-        header[header_pos++] = mask_bit | 127;
-        write_be64(&header[header_pos], payload_len);
-        header_pos += 8;
-    }
-
-    // add masking key if needed
     std::array<std::uint8_t, 4> masking_key{};
     if (mask) {
         masking_key = generate_mask();
-        std::memcpy(&header[header_pos], masking_key.data(), 4);
-        header_pos += 4;
     }
 
-    // add payload
-    if (!payload.empty()) {
-        frame_data_.insert(frame_data_.end(), payload.begin(), payload.end());
+    std::size_t const header_size = frame_header_size(payload.size(), mask);
+    frame_data_.resize(header_size + payload.size());
+    encode_frame_header(frame_data_.data(), opcode, payload.size(), fin,
+            mask ? masking_key.data() : nullptr);
 
-        // Apply masking if needed
+    // add payload, masking it on the way in if needed
+    if (!payload.empty()) {
         if (mask) {
-            apply_mask(&frame_data_[header_size], payload_len, masking_key);
+            copy_masked(&frame_data_[header_size], payload, masking_key);
+        } else {
+            std::memcpy(&frame_data_[header_size], payload.data(), payload.size());
         }
     }
 }
@@ -188,32 +148,15 @@ frame_generator::write_be16(std::uint8_t* data, std::uint16_t value) noexcept
     std::memcpy(data, &value, sizeof(value));
 }
 
-void
-frame_generator::write_be64(std::uint8_t* data, std::uint64_t value) noexcept
-{
-    if constexpr (std::endian::native == std::endian::little) {
-        value = std::byteswap(value);
-    }
-    std::memcpy(data, &value, sizeof(value));
-}
-
 std::array<std::uint8_t, 4>
 frame_generator::generate_mask() noexcept
 {
-    static thread_local std::random_device rd;
-    static thread_local std::mt19937 gen(rd());
-    static thread_local std::uniform_int_distribution<std::uint8_t> dis(0, 255);
-
-    return {dis(gen), dis(gen), dis(gen), dis(gen)};
-}
+    // one 32-bit draw per mask rather than one distribution call per byte
+    std::uint32_t const bits = fast_random_u32();
 
-void
-frame_generator::apply_mask(
-        std::uint8_t* payload, std::size_t length, std::array<std::uint8_t, 4> const& mask) noexcept
-{
-    for (std::size_t i = 0; i < length; ++i) {
-        payload[i] ^= mask[i % 4];
-    }
+    std::array<std::uint8_t, 4> mask{};
+    std::memcpy(mask.data(), &bits, sizeof(bits));
+    return mask;
 }
 
 } // namespace ws
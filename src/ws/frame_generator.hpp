@@ -1,6 +1,7 @@
 #pragma once
 
 #include "frame.hpp"
+#include <memory_resource>
 #include <span>
 #include <string_view>
 #include <vector>
@@ -15,11 +16,16 @@ namespace ws {
 class frame_generator
 {
 private:
-    std::vector<std::uint8_t> frame_data_;
+    std::pmr::vector<std::uint8_t> frame_data_;
 
 public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::uint8_t>;
+
     frame_generator() = default;
 
+    /// \param alloc where the frame is built
+    explicit frame_generator(allocator_type alloc) noexcept;
+
     /// Create a ping frame
     /// \param payload Optional payload (max 125 bytes)
     /// \param mask Whether to mask the payload (default: false for server-to-client)
@@ -75,9 +81,11 @@ public:
     frame_generator& reset() noexcept;
 
     /// Move the frame data out (for zero-copy scenarios)
-    /// \return The frame data vector
-    std::vector<std::uint8_t> take_data() noexcept;
+    /// \return The frame data vector, with the generator's allocator
+    std::pmr::vector<std::uint8_t> take_data() noexcept;
 
+    /// Generate a Sec-WebSocket-Key nonce from the kernel CSPRNG
+    /// \return base64 encoded 16 byte nonce
     static std::string generate_websocket_key() noexcept;
 
 private:
@@ -87,15 +95,8 @@ private:
     /// Write big-endian 16-bit value
     static void write_be16(std::uint8_t* data, std::uint16_t value) noexcept;
 
-    /// Write big-endian 64-bit value
-    static void write_be64(std::uint8_t* data, std::uint64_t value) noexcept;
-
-    /// Generate random masking key
+    /// Generate random masking key (fast thread-local PRNG, not a CSPRNG)
     static std::array<std::uint8_t, 4> generate_mask() noexcept;
-
-    /// Apply masking to payload
-    static void apply_mask(std::uint8_t* payload, std::size_t length,
-            std::array<std::uint8_t, 4> const& mask) noexcept;
 };
 
 } // namespace ws
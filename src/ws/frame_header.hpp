@@ -0,0 +1,215 @@
+#pragma once
+
+#include "frame.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <span>
+
+
+namespace ws {
+
+/// max payload of a control frame (rfc 6455 5.5)
+static constexpr std::size_t MaxControlPayloadSize = 125;
+
+/// Number of header bytes needed for a frame carrying \c payload_len bytes
+constexpr std::size_t frame_header_size(std::uint64_t payload_len, bool masked = false) noexcept;
+
+/// Write a frame header straight into \c out, which must have room for
+/// at least frame_header_size() bytes (MaxFrameHeaderSize always suffices).
+/// The payload is not touched; when \c masking_key is given the caller is
+/// responsible for masking the payload with it.
+/// \return number of header bytes written
+constexpr std::size_t encode_frame_header(std::uint8_t* out, OpCode, std::uint64_t payload_len,
+        bool fin = true, std::uint8_t const* masking_key = nullptr) noexcept;
+
+/// XOR \c payload in place with \c masking_key (rfc 6455 5.3); masking
+/// and unmasking are the same operation
+void apply_mask(
+        std::span<std::uint8_t> payload, std::span<std::uint8_t const, 4> masking_key) noexcept;
+
+/// Copy \c payload to \c out masked with \c masking_key, in a single pass
+/// over the data. \c out must have room for the payload and not overlap it.
+void copy_masked(std::uint8_t* out, std::span<std::uint8_t const> payload,
+        std::span<std::uint8_t const, 4> masking_key) noexcept;
+
+/// Complete, unmasked close frame carrying only a status code, built at
+/// compile time
+template <std::uint16_t Code>
+constexpr std::array<std::uint8_t, 4> make_close_frame() noexcept;
+
+/// Complete, unmasked control frame without payload, built at compile time
+template <OpCode Op>
+constexpr std::array<std::uint8_t, 2> make_empty_control_frame() noexcept;
+
+/*! \class  control_frame_buffer
+ *  \brief  Fixed-size, stack-allocated storage for a single unmasked
+ *          control frame (header + up to 125 bytes of payload). Used to
+ *          reply to pings without touching the heap.
+ */
+class control_frame_buffer
+{
+private:
+    /// only the first size_ bytes are ever written or read
+    std::array<std::uint8_t, MinFrameHeaderSize + MaxControlPayloadSize> data_;
+    std::size_t size_ = 0;
+
+public:
+    /// Build a control frame; payloads over 125 bytes are truncated
+    constexpr control_frame_buffer(OpCode, std::span<std::uint8_t const> payload = {}) noexcept;
+
+    constexpr std::span<std::uint8_t const> data() const noexcept;
+    constexpr std::size_t size() const noexcept;
+};
+
+
+/**********************************************************************/
+
+constexpr std::size_t
+frame_header_size(std::uint64_t payload_len, bool masked) noexcept
+{
+    std::size_t size = MinFrameHeaderSize;
+    if (payload_len >= 65536) {
+        size += 8;
+    } else if (payload_len >= 126) {
+        size += 2;
+    }
+    return masked ? size + 4 : size;
+}
+
+constexpr std::size_t
+encode_frame_header(std::uint8_t* out, OpCode op_code, std::uint64_t payload_len, bool fin,
+        std::uint8_t const* masking_key) noexcept
+{
+    std::size_t pos = 0;
+
+    // byte 1: FIN + RSV + OpCode
+    out[pos++] = static_cast<std::uint8_t>(
+            (fin ? 0x80 : 0x00) | static_cast<std::uint8_t>(op_code));
+
+    // byte 2: MASK + payload length, then the extended length (big-endian)
+    std::uint8_t const mask_bit = masking_key != nullptr ? 0x80 : 0x00;
+    if (payload_len < 126) {
+        out[pos++] = static_cast<std::uint8_t>(mask_bit | payload_len);
+    } else if (payload_len < 65536) {
+        out[pos++] = mask_bit | 126;
+        out[pos++] = static_cast<std::uint8_t>(payload_len >> 8);
+        out[pos++] = static_cast<std::uint8_t>(payload_len);
+    } else {
+        out[pos++] = mask_bit | 127;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out[pos++] = static_cast<std::uint8_t>(payload_len >> shift);
+        }
+    }
+
+    if (masking_key != nullptr) {
+        for (std::size_t i = 0; i < 4; ++i) {
+            out[pos++] = masking_key[i];
+        }
+    }
+    return pos;
+}
+
+inline void
+apply_mask(std::span<std::uint8_t> payload, std::span<std::uint8_t const, 4> masking_key) noexcept
+{
+    // xor 8 bytes at a time; the key repeats every 4 bytes, so a 64-bit
+    // word of it lines up with every 8 byte offset into the payload
+    std::uint32_t key32 = 0;
+    std::memcpy(&key32, masking_key.data(), sizeof(key32));
+    std::uint64_t const key64 = (static_cast<std::uint64_t>(key32) << 32) | key32;
+
+    std::uint8_t* data = payload.data();
+    std::size_t const length = payload.size();
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, sizeof(word));
+        word ^= key64;
+        std::memcpy(data + i, &word, sizeof(word));
+    }
+    for (; i < length; ++i) {
+        data[i] ^= masking_key[i % 4];
+    }
+}
+
+inline void
+copy_masked(std::uint8_t* out, std::span<std::uint8_t const> payload,
+        std::span<std::uint8_t const, 4> masking_key) noexcept
+{
+    // same 8 bytes at a time as apply_mask(), reading the source instead
+    // of making a second pass over the copy
+    std::uint32_t key32 = 0;
+    std::memcpy(&key32, masking_key.data(), sizeof(key32));
+    std::uint64_t const key64 = (static_cast<std::uint64_t>(key32) << 32) | key32;
+
+    std::uint8_t const* data = payload.data();
+    std::size_t const length = payload.size();
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, sizeof(word));
+        word ^= key64;
+        std::memcpy(out + i, &word, sizeof(word));
+    }
+    for (; i < length; ++i) {
+        out[i] = data[i] ^ masking_key[i % 4];
+    }
+}
+
+template <std::uint16_t Code>
+constexpr std::array<std::uint8_t, 4>
+make_close_frame() noexcept
+{
+    std::array<std::uint8_t, 4> bytes{};
+    encode_frame_header(bytes.data(), OpCode::Close, 2);
+    bytes[2] = static_cast<std::uint8_t>(Code >> 8);
+    bytes[3] = static_cast<std::uint8_t>(Code);
+    return bytes;
+}
+
+template <OpCode Op>
+constexpr std::array<std::uint8_t, 2>
+make_empty_control_frame() noexcept
+{
+    static_assert((static_cast<std::uint8_t>(Op) & 0x08) != 0, "not a control frame opcode");
+
+    std::array<std::uint8_t, 2> bytes{};
+    encode_frame_header(bytes.data(), Op, 0);
+    return bytes;
+}
+
+// prebuilt control frames
+
+static constexpr auto CloseNormalFrame = make_close_frame<1000>();    ///< rfc 6455 7.4.1
+static constexpr auto CloseGoingAwayFrame = make_close_frame<1001>(); ///< rfc 6455 7.4.1
+static constexpr auto EmptyPingFrame = make_empty_control_frame<OpCode::Ping>();
+static constexpr auto EmptyPongFrame = make_empty_control_frame<OpCode::Pong>();
+
+constexpr control_frame_buffer::control_frame_buffer(
+        OpCode op_code, std::span<std::uint8_t const> payload) noexcept
+{
+    if (payload.size() > MaxControlPayloadSize) {
+        payload = payload.first(MaxControlPayloadSize);
+    }
+
+    size_ = encode_frame_header(data_.data(), op_code, payload.size());
+    for (std::uint8_t const byte : payload) {
+        data_[size_++] = byte;
+    }
+}
+
+constexpr std::span<std::uint8_t const>
+control_frame_buffer::data() const noexcept
+{
+    return std::span<std::uint8_t const>(data_.data(), size_);
+}
+
+constexpr std::size_t
+control_frame_buffer::size() const noexcept
+{
+    return size_;
+}
+
+} // namespace ws
@@ -0,0 +1,161 @@
+#include "handshake.hpp"
+#include "util/base64_codec.hpp"
+#include "util/sha1.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm> // std::ranges::equal
+#include <cctype>    // std::tolower
+#include <format>
+
+
+namespace ws {
+
+namespace {
+    /// appended to the client's key before hashing (rfc 6455 1.3)
+    static constexpr std::string_view MagicGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    bool
+    iequals(std::string_view lhs, std::string_view rhs) noexcept
+    {
+        return std::ranges::equal(lhs, rhs, [](unsigned char a, unsigned char b) {
+            return std::tolower(a) == std::tolower(b);
+        });
+    }
+
+    /// \return \c true if the comma separated \c list holds \c token
+    bool
+    contains_token(std::string_view list, std::string_view token) noexcept
+    {
+        while (!list.empty()) {
+            std::size_t const comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+                item.remove_prefix(1);
+            }
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+                item.remove_suffix(1);
+            }
+            if (iequals(item, token)) {
+                return true;
+            }
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        }
+        return false;
+    }
+
+    template <typename String>
+    String
+    accept_key(std::string_view key, typename String::allocator_type const& alloc)
+    {
+        String concat(alloc);
+        concat.reserve(key.size() + MagicGuid.size());
+        concat.append(key).append(MagicGuid);
+
+        // base64 of the raw digest bytes, not of the hex string
+        auto const digest = sha1::hash(concat);
+        std::string_view const raw(reinterpret_cast<char const*>(digest.data()), digest.size());
+        String accept(base64_codec::encoded_size(raw.size()), '\0', alloc);
+        base64_codec::encode(raw, accept.data());
+        return accept;
+    }
+} // namespace
+
+std::string
+websocket_accept_key(std::string_view key)
+{
+    return accept_key<std::string>(key, {});
+}
+
+std::pmr::string
+websocket_accept_key(std::string_view key, std::pmr::memory_resource* resource)
+{
+    return accept_key<std::pmr::string>(key, resource);
+}
+
+std::string
+make_upgrade_request(std::string_view host, std::string_view path, std::string_view key,
+        std::string_view protocol)
+{
+    return std::format("GET {} HTTP/1.1\r\n"
+                       "Host: {}\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Key: {}\r\n"
+                       "Sec-WebSocket-Version: 13\r\n"
+                       "{}{}{}"
+                       "\r\n",
+            path, host, key, protocol.empty() ? "" : "Sec-WebSocket-Protocol: ", protocol,
+            protocol.empty() ? "" : "\r\n");
+}
+
+bool
+validate_upgrade_response(
+        std::string_view response, std::string_view expected_accept, std::string_view protocol)
+{
+    std::size_t line_end = response.find("\r\n");
+    if (line_end == std::string_view::npos) {
+        SPDLOG_ERROR("error: upgrade response: no status line");
+        return false;
+    }
+
+    // "HTTP/1.1 101 Switching Protocols"
+    std::string_view const status_line = response.substr(0, line_end);
+    if (!status_line.starts_with("HTTP/1.1 101")
+            || (status_line.size() > 12 && status_line[12] != ' ')) {
+        SPDLOG_ERROR("error: upgrade response: [{}]", status_line);
+        return false;
+    }
+
+    bool upgrade = false;
+    bool connection = false;
+    bool accepted = false;
+    bool agreed = protocol.empty();
+    for (std::size_t pos = line_end + 2; pos < response.size(); pos = line_end + 2) {
+        line_end = response.find("\r\n", pos);
+        if (line_end == std::string_view::npos || line_end == pos) {
+            break; // the empty line ending the header
+        }
+
+        std::string_view const line = response.substr(pos, line_end - pos);
+        std::size_t const colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            SPDLOG_ERROR("error: upgrade response: malformed field [{}]", line);
+            return false;
+        }
+        std::string_view const name = line.substr(0, colon);
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+
+        if (iequals(name, "upgrade")) {
+            upgrade = iequals(value, "websocket");
+        } else if (iequals(name, "connection")) {
+            connection = contains_token(value, "upgrade");
+        } else if (iequals(name, "sec-websocket-accept")) {
+            accepted = value == expected_accept;
+        } else if (iequals(name, "sec-websocket-protocol") && !protocol.empty()) {
+            // subprotocol names are case-sensitive (rfc 6455 4.3)
+            if (value != protocol) {
+                SPDLOG_ERROR("error: upgrade response: protocol [{}] not offered", value);
+                return false;
+            }
+            agreed = true;
+        } else if (iequals(name, "sec-websocket-extensions")
+                || iequals(name, "sec-websocket-protocol")) {
+            SPDLOG_ERROR("error: upgrade response: {} not requested", name);
+            return false;
+        }
+    }
+
+    if (!upgrade || !connection || !accepted || !agreed) {
+        SPDLOG_ERROR("error: upgrade response: upgrade={} connection={} accept={} protocol={}",
+                upgrade, connection, accepted, agreed);
+        return false;
+    }
+    return true;
+}
+
+} // namespace ws
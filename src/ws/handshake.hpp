@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+namespace ws {
+
+/// Largest upgrade response a client accepts, status line and headers
+static constexpr std::size_t MaxUpgradeResponseSize = 8192;
+
+/// Sec-WebSocket-Accept value the server answers \c key with (rfc 6455 4.2.2)
+std::string websocket_accept_key(std::string_view key);
+
+/// websocket_accept_key(), allocated from \c resource
+std::pmr::string websocket_accept_key(std::string_view key, std::pmr::memory_resource* resource);
+
+/// Client upgrade request for \c path on \c host (rfc 6455 4.1)
+/// \param key Sec-WebSocket-Key, see frame_generator::generate_websocket_key()
+/// \param protocol subprotocol to offer (Sec-WebSocket-Protocol), none if empty
+std::string make_upgrade_request(std::string_view host, std::string_view path,
+        std::string_view key, std::string_view protocol = {});
+
+/// Check a server's response to an upgrade request: status 101, the
+/// Upgrade and Connection fields, the expected Sec-WebSocket-Accept, no
+/// extension (we offer none) and the subprotocol we offered, if any
+/// (rfc 6455 4.1). A server that declines our subprotocol fails the
+/// handshake too: we only offer one we can't do without.
+/// \param response status line and header fields, up to and including
+///        the empty line that ends them
+/// \param expected_accept websocket_accept_key() of the key we sent
+/// \param protocol subprotocol we offered, none if empty
+/// \return \c false if the handshake failed; the reason is logged
+bool validate_upgrade_response(std::string_view response, std::string_view expected_accept,
+        std::string_view protocol = {});
+
+} // namespace ws
@@ -0,0 +1,273 @@
+#include "echo_server/echo_server.hpp"
+#include "ws/client.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include "ws/handshake.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h> // timeval
+#include <unistd.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    using namespace std::chrono_literals;
+
+    static constexpr int BasePort = 19960;  ///< each test case listens on its own port
+    static constexpr auto Deadline = 3s;    ///< how long a test waits for anything
+
+    /// An echo_server running on its own thread until destroyed
+    class running_server
+    {
+    public:
+        explicit running_server(server_config const& config)
+                : server_(config)
+                , thread_([this] { server_.run(); })
+        {
+            // empty
+        }
+
+        ~running_server()
+        {
+            stop();
+        }
+
+        running_server(running_server const&) = delete;
+        running_server& operator=(running_server const&) = delete;
+
+        /// Stop the server and wait for it
+        /// \return its counters, safe to read once it has stopped
+        server_stats const&
+        stop()
+        {
+            if (thread_.joinable()) {
+                server_.request_shutdown();
+                thread_.join();
+            }
+            return server_.stats();
+        }
+
+    private:
+        echo_server server_;
+        std::thread thread_;
+    };
+
+    server_config
+    make_config(int port)
+    {
+        server_config config;
+        config.port = port;
+        config.handle_signals = false;
+        config.drain_window = 0ms;
+        config.drain_timeout = 500ms;
+        return config;
+    }
+
+    /// Client retrying until the server listens; counts what comes back
+    struct test_client
+    {
+        std::size_t received = 0;
+        std::vector<std::uint16_t> closed;
+        client c;
+
+        test_client()
+                : c(make_client_config())
+        {
+            // empty
+        }
+
+        client_config
+        make_client_config()
+        {
+            client_config config;
+            config.backoff_min = 10ms;
+            config.backoff_max = 20ms;
+            config.on_message = [this](std::uint64_t, OpCode, std::span<std::uint8_t const>) {
+                ++received;
+            };
+            config.on_close = [this](std::uint64_t, std::uint16_t code) {
+                closed.push_back(code);
+            };
+            return config;
+        }
+
+        /// poll() until \c done, or fail the test after Deadline
+        void
+        poll_until(std::function<bool()> const& done)
+        {
+            auto const until = std::chrono::steady_clock::now() + Deadline;
+            while (!done()) {
+                REQUIRE(std::chrono::steady_clock::now() < until);
+                REQUIRE(c.poll(1ms));
+            }
+        }
+    };
+
+    /// Blocking tcp connection to \c port; reads time out after Deadline
+    /// \return the socket
+    int
+    connect_tcp(int port)
+    {
+        int const fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        REQUIRE(::connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == 0);
+
+        timeval const timeout{3, 0};
+        REQUIRE(::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0);
+        return fd;
+    }
+
+    void
+    send_all(int fd, std::string_view data)
+    {
+        REQUIRE(::send(fd, data.data(), data.size(), MSG_NOSIGNAL)
+                == static_cast<ssize_t>(data.size()));
+    }
+
+    /// Blocking tcp connection to \c port, upgraded by hand so the test
+    /// can send anything at all
+    /// \return the socket
+    int
+    connect_upgraded(int port)
+    {
+        int const fd = connect_tcp(port);
+        std::string const key = frame_generator::generate_websocket_key();
+        send_all(fd, make_upgrade_request("localhost", "/", key));
+
+        std::string response;
+        while (!response.contains("\r\n\r\n")) {
+            char buf[512];
+            ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+            REQUIRE(nbytes > 0);
+            response.append(buf, static_cast<std::size_t>(nbytes));
+        }
+        REQUIRE(validate_upgrade_response(response, websocket_accept_key(key)));
+        return fd;
+    }
+
+    /// Everything the server sends until it closes the connection
+    std::vector<std::uint8_t>
+    receive_until_closed(int fd)
+    {
+        std::vector<std::uint8_t> received;
+        for (;;) {
+            std::uint8_t buf[4096];
+            ssize_t const nbytes = ::recv(fd, buf, sizeof(buf), 0);
+            REQUIRE(nbytes >= 0);
+            if (nbytes == 0) {
+                return received;
+            }
+            received.insert(received.end(), buf, buf + nbytes);
+        }
+    }
+} // namespace
+
+
+TEST_CASE("throttled client doesn't spin the event loop", "[echo_server]")
+{
+    server_config config = make_config(BasePort);
+    config.max_messages_per_sec = 20;
+    config.rate_burst_secs = 0.25; // 5 frames right away, then one every 50ms
+    running_server server(config);
+
+    test_client tc;
+    std::uint64_t const id = tc.c.connect("127.0.0.1:" + std::to_string(BasePort));
+    tc.poll_until([&] { return tc.c.is_open(id); });
+
+    // 15 frames take half a second; the loop sleeps in between
+    std::vector<std::uint8_t> const payload(16, 'x');
+    for (int i = 0; i < 15; ++i) {
+        REQUIRE(tc.c.send(id, payload));
+    }
+    auto const start = std::chrono::steady_clock::now();
+    tc.poll_until([&] { return tc.received == 15; });
+    REQUIRE(std::chrono::steady_clock::now() - start >= 400ms);
+
+    tc.c.close(id);
+    tc.poll_until([&] { return tc.c.size() == 0; });
+    server_stats const& stats = server.stop();
+    REQUIRE(stats.frames_processed >= 15);
+    REQUIRE(stats.throttled_events <= 50);
+    REQUIRE(stats.empty_polls <= 50);
+}
+
+TEST_CASE("frames larger than the buffer close with 1009", "[echo_server]")
+{
+    running_server server(make_config(BasePort + 1));
+    int const fd = connect_upgraded(BasePort + 1);
+
+    // only the header and the start of the payload: the length says enough
+    std::array<std::uint8_t, MaxFrameHeaderSize + 1024> bytes{};
+    std::array<std::uint8_t, 4> const masking_key = {1, 2, 3, 4};
+    std::size_t const header_size = encode_frame_header(
+            bytes.data(), OpCode::Binary, BufferSize, /*fin=*/true, masking_key.data());
+    std::size_t const size = header_size + 1024;
+    REQUIRE(::send(fd, bytes.data(), size, MSG_NOSIGNAL) == static_cast<ssize_t>(size));
+
+    std::vector<std::uint8_t> const received = receive_until_closed(fd);
+    ::close(fd);
+    frame close;
+    REQUIRE(close.parse_from_buffer(received.data(), received.size()) == ParseResult::Success);
+    REQUIRE(close.op_code() == OpCode::Close);
+    REQUIRE(close.get_payload_data().size() == 2);
+    REQUIRE(close.get_payload_data()[0] == 1009 >> 8);
+    REQUIRE(close.get_payload_data()[1] == (1009 & 0xff));
+    REQUIRE(server.stop().frames_processed == 0);
+}
+
+TEST_CASE("a drain closes keep-alive http connections", "[echo_server]")
+{
+    server_config config = make_config(BasePort + 2);
+    config.drain_timeout = 5s;
+    running_server server(config);
+
+    // a health check that keeps its connection open, and one halfway
+    // through its next request when the drain begins
+    int const idle = connect_tcp(BasePort + 2);
+    send_all(idle, "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    std::string response;
+    while (!response.ends_with("ok\n")) {
+        char buf[512];
+        ssize_t const nbytes = ::recv(idle, buf, sizeof(buf), 0);
+        REQUIRE(nbytes > 0);
+        response.append(buf, static_cast<std::size_t>(nbytes));
+    }
+    REQUIRE_FALSE(response.contains("Connection: close"));
+    int const busy = connect_tcp(BasePort + 2);
+    send_all(busy, "GET /ready HTTP/1.1\r\n");
+    std::this_thread::sleep_for(100ms); // buffered by the server, not idle
+
+    auto const start = std::chrono::steady_clock::now();
+    std::thread stopping([&] { server.stop(); });
+    REQUIRE(receive_until_closed(idle).empty());
+
+    // the rest of the request is answered, then the connection closed
+    send_all(busy, "Host: localhost\r\n\r\n");
+    std::vector<std::uint8_t> const received = receive_until_closed(busy);
+    std::string_view const last(reinterpret_cast<char const*>(received.data()), received.size());
+    REQUIRE(last.starts_with("HTTP/1.1 503 "));
+    REQUIRE(last.contains("\r\nConnection: close\r\n"));
+    REQUIRE(last.ends_with("\r\n\r\ndraining\n"));
+
+    // both gone, so the drain is over long before its deadline
+    stopping.join();
+    REQUIRE(std::chrono::steady_clock::now() - start < 2s);
+    ::close(idle);
+    ::close(busy);
+}
+
+} // namespace ws::test
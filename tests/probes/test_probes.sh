@@ -0,0 +1,73 @@
+#!/bin/bash
+# The USDT probes of util/probes.hpp are in the echo server binary and,
+# where bpftrace can attach (root, a kernel with bpf and uprobes), fire
+# while a client connects, upgrades, echoes a frame and leaves.
+#   tests/probes/test_probes.sh build/echo_server
+# Exit 77 (skipped) if the binary was built without probes.
+
+set -u
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <echo_server>" >&2
+    exit 1
+fi
+server=$(realpath "$1")
+probes="accept handshake_start handshake_end frame_parsed message_dispatched send_queued
+        send_flushed backpressure disconnect"
+
+# every probe has a note
+notes=$(readelf --notes "$server") || exit 1
+if ! grep -q "Provider: ws" <<<"$notes"; then
+    echo "no ws probes in $server (built without sys/sdt.h?)"
+    exit 77
+fi
+for probe in $probes; do
+    if ! grep -q "Name: $probe\$" <<<"$notes"; then
+        echo "FAIL: probe $probe missing"
+        exit 1
+    fi
+done
+echo "all probes present"
+
+# and they fire
+if ! command -v bpftrace >/dev/null || ! bpftrace -e 'BEGIN { exit(); }' >/dev/null 2>&1; then
+    echo "bpftrace can't run here, not tracing"
+    exit 0
+fi
+
+port=19950
+"$server" --port=$port --coalesce >/dev/null 2>&1 &
+server_pid=$!
+trap 'kill $server_pid 2>/dev/null; wait $server_pid 2>/dev/null' EXIT
+sleep 0.5
+
+out=$(mktemp)
+fired="accept handshake_start handshake_end frame_parsed message_dispatched send_queued
+       send_flushed disconnect"
+attach=""
+for probe in $fired; do
+    attach="$attach${attach:+,}usdt:$server:ws:$probe"
+done
+bpftrace -p $server_pid -e "$attach { @[probe] = count(); } interval:s:3 { exit(); }" >"$out" &
+tracer_pid=$!
+sleep 1.5
+
+# upgrade, one masked text frame (zero mask key), then close the socket
+exec 3<>/dev/tcp/127.0.0.1/$port
+printf 'GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n' >&3
+printf 'Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n' >&3
+printf '\x81\x85\x00\x00\x00\x00hello' >&3
+timeout 1 cat <&3 >/dev/null
+exec 3>&-
+
+wait $tracer_pid
+status=0
+for probe in $fired; do
+    if ! grep -q "ws:$probe\]: [1-9]" "$out"; then
+        echo "FAIL: probe $probe didn't fire"
+        status=1
+    fi
+done
+[ $status -eq 0 ] && echo "all probes fired"
+rm -f "$out"
+exit $status
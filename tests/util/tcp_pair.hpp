@@ -0,0 +1,34 @@
+#pragma once
+
+#include <catch2/catch_test_macros.hpp>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+
+
+namespace ws::test {
+
+/// Connected tcp pair over loopback: {client, server}. Both blocking; the
+/// caller closes them.
+inline std::array<int, 2>
+tcp_pair()
+{
+    int const listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    REQUIRE(::bind(listener, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(::listen(listener, 1) == 0);
+    REQUIRE(::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+
+    int const client = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(::connect(client, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == 0);
+    int const server = ::accept(listener, nullptr, nullptr);
+    REQUIRE(server != -1);
+    ::close(listener);
+    return {client, server};
+}
+
+} // namespace ws::test
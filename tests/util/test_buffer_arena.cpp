@@ -0,0 +1,177 @@
+#include "util/buffer_arena.hpp"
+#include "util/byte_buffer.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring> // std::memset
+#include <thread>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    bool
+    aligned(void const* ptr)
+    {
+        return reinterpret_cast<std::uintptr_t>(ptr) % buffer_arena::Alignment == 0;
+    }
+} // namespace
+
+TEST_CASE("heap backing", "[buffer_arena]")
+{
+    buffer_arena arena;
+    REQUIRE(arena.backing() == ArenaBacking::Heap);
+
+    void* ptr = arena.allocate(1000);
+    REQUIRE(ptr != nullptr);
+    REQUIRE(aligned(ptr));
+    std::memset(ptr, 0xab, 1000);
+    arena.deallocate(ptr, 1000);
+
+    arena_stats const stats = arena.stats();
+    REQUIRE(stats.regions == 0);
+    REQUIRE(stats.blocks_in_use == 0);
+    REQUIRE(stats.heap_fallbacks == 1);
+}
+
+TEST_CASE("huge page backing", "[buffer_arena]")
+{
+    buffer_arena arena;
+    arena.set_backing(ArenaBacking::HugePages);
+
+    SECTION("size classes")
+    {
+        void* small = arena.allocate(1);
+        void* medium = arena.allocate(5000);
+        void* large = arena.allocate(buffer_arena::MaxBlockSize);
+        REQUIRE(aligned(small));
+        REQUIRE(aligned(medium));
+        REQUIRE(aligned(large));
+        std::memset(small, 1, 1);
+        std::memset(medium, 2, 5000);
+        std::memset(large, 3, buffer_arena::MaxBlockSize);
+
+        arena_stats stats = arena.stats();
+        REQUIRE(stats.regions == 1);
+        REQUIRE(stats.reserved_bytes == buffer_arena::RegionSize);
+        REQUIRE(stats.blocks_in_use == 3);
+        REQUIRE(stats.heap_fallbacks == 0);
+
+        arena.deallocate(small, 1);
+        arena.deallocate(medium, 5000);
+        arena.deallocate(large, buffer_arena::MaxBlockSize);
+        REQUIRE(arena.stats().blocks_in_use == 0);
+    }
+
+    SECTION("freed blocks are reused, most recent first")
+    {
+        void* first = arena.allocate(16384);
+        void* second = arena.allocate(16384);
+        REQUIRE(first != second);
+
+        arena.deallocate(first, 16384);
+        arena.deallocate(second, 16384);
+        REQUIRE(arena.allocate(10000) == second); // same size class
+        REQUIRE(arena.allocate(16384) == first);
+        REQUIRE(arena.stats().regions == 1);
+    }
+
+    SECTION("oversized requests go to the heap")
+    {
+        std::size_t const size = buffer_arena::MaxBlockSize + 1;
+        void* ptr = arena.allocate(size);
+        REQUIRE(aligned(ptr));
+        REQUIRE(arena.stats().heap_fallbacks == 1);
+        REQUIRE(arena.stats().blocks_in_use == 0);
+        arena.deallocate(ptr, size);
+    }
+
+    SECTION("new regions once one is used up")
+    {
+        std::vector<void*> blocks;
+        for (std::size_t i = 0; i < 3 * buffer_arena::RegionSize / (1 << 20); ++i) {
+            blocks.push_back(arena.allocate(1 << 20));
+        }
+        REQUIRE(arena.stats().regions == 3);
+        for (void* ptr : blocks) {
+            arena.deallocate(ptr, 1 << 20);
+        }
+        REQUIRE(arena.stats().blocks_in_use == 0);
+    }
+
+    SECTION("blocks from before the switch to heap")
+    {
+        void* ptr = arena.allocate(4096);
+        arena.set_backing(ArenaBacking::Heap);
+        void* heap = arena.allocate(4096);
+        arena.deallocate(ptr, 4096);
+        arena.deallocate(heap, 4096);
+
+        arena_stats const stats = arena.stats();
+        REQUIRE(stats.blocks_in_use == 0);
+        REQUIRE(stats.heap_fallbacks == 1);
+    }
+}
+
+TEST_CASE("hugetlb backing", "[buffer_arena]")
+{
+    // without a hugetlbfs pool this falls back to transparent huge pages
+    buffer_arena arena;
+    arena.set_backing(ArenaBacking::HugeTlb);
+
+    void* ptr = arena.allocate(65536);
+    REQUIRE(ptr != nullptr);
+    std::memset(ptr, 0x5a, 65536);
+    arena.deallocate(ptr, 65536);
+
+    arena_stats const stats = arena.stats();
+    REQUIRE(stats.regions == 1);
+    REQUIRE(stats.hugetlb_regions <= 1);
+    REQUIRE(stats.heap_fallbacks == 0);
+}
+
+TEST_CASE("freed on another thread", "[buffer_arena]")
+{
+    buffer_arena arena;
+    arena.set_backing(ArenaBacking::HugePages);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 100; ++i) {
+        blocks.push_back(arena.allocate(2048));
+    }
+    std::thread([&] {
+        for (void* ptr : blocks) {
+            arena.deallocate(ptr, 2048);
+        }
+    }).join();
+
+    REQUIRE(arena.stats().blocks_in_use == 0);
+    REQUIRE(arena.allocate(2048) == blocks.back());
+}
+
+TEST_CASE("containers and byte_buffer", "[buffer_arena]")
+{
+    buffer_arena& arena = buffer_arena::instance();
+    ArenaBacking const backing = arena.backing();
+    arena.set_backing(ArenaBacking::HugePages);
+    std::size_t const in_use = arena.stats().blocks_in_use;
+
+    {
+        arena_bytes bytes;
+        for (int i = 0; i < 100'000; ++i) {
+            bytes.push_back(static_cast<std::uint8_t>(i));
+        }
+        REQUIRE(bytes[99'999] == static_cast<std::uint8_t>(99'999));
+
+        byte_buffer<16384> buf;
+        std::memset(buf.write_ptr(), 'x', buf.bytes_left());
+        buf.bytes_written(buf.capacity());
+        REQUIRE(buf.bytes_unread() == 16384);
+        REQUIRE(arena.stats().blocks_in_use == in_use + 2);
+    }
+
+    REQUIRE(arena.stats().blocks_in_use == in_use);
+    arena.set_backing(backing);
+}
+
+} // namespace ws::test
@@ -0,0 +1,138 @@
+#include "util/capture_log.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <unistd.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    /// \return a path in the temp directory unique to this process
+    std::string
+    temp_path(std::string const& name)
+    {
+        return (std::filesystem::temp_directory_path()
+                       / ("test_capture_log." + std::to_string(::getpid()) + "." + name))
+                .string();
+    }
+} // namespace
+
+TEST_CASE("round trip", "[capture_log]")
+{
+    std::string const path = temp_path("round_trip");
+    std::vector<std::uint8_t> const first = {'h', 'e', 'l', 'l', 'o'};
+    std::vector<std::uint8_t> const second(1000, 0xab);
+
+    {
+        capture_writer writer(path, 1 << 20);
+        REQUIRE(writer.append(100, 1, 0x1, first));
+        REQUIRE(writer.append(250, 2, 0x2, second));
+        REQUIRE(writer.append(300, 1, 0x2, {}));
+        REQUIRE(writer.records() == 3);
+    }
+
+    // the destructor trims the file to the records written
+    REQUIRE(std::filesystem::file_size(path) < 2048);
+
+    capture_reader reader(path);
+    REQUIRE(reader.created_ns() > 0);
+
+    auto record = reader.next();
+    REQUIRE(record.has_value());
+    REQUIRE(record->timestamp_ns == 100);
+    REQUIRE(record->connection_id == 1);
+    REQUIRE(record->op_code == 0x1);
+    REQUIRE(std::vector(record->payload.begin(), record->payload.end()) == first);
+
+    record = reader.next();
+    REQUIRE(record.has_value());
+    REQUIRE(record->timestamp_ns == 250);
+    REQUIRE(record->connection_id == 2);
+    REQUIRE(record->op_code == 0x2);
+    REQUIRE(std::vector(record->payload.begin(), record->payload.end()) == second);
+
+    record = reader.next();
+    REQUIRE(record.has_value());
+    REQUIRE(record->timestamp_ns == 300);
+    REQUIRE(record->payload.empty());
+
+    REQUIRE_FALSE(reader.next().has_value());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("growth", "[capture_log]")
+{
+    std::string const path = temp_path("growth");
+    std::vector<std::uint8_t> const payload(65'536, 0x5a);
+    std::size_t const count = 600; // well past the first 16MiB chunk
+
+    {
+        capture_writer writer(path, 1UL << 30);
+        for (std::size_t i = 0; i < count; ++i) {
+            REQUIRE(writer.append(static_cast<std::int64_t>(i + 1), i, 0x2, payload));
+        }
+    }
+
+    capture_reader reader(path);
+    std::size_t read = 0;
+    while (auto record = reader.next()) {
+        REQUIRE(record->timestamp_ns == static_cast<std::int64_t>(read + 1));
+        REQUIRE(record->payload.size() == payload.size());
+        REQUIRE(record->payload.back() == 0x5a);
+        ++read;
+    }
+    REQUIRE(read == count);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("max bytes", "[capture_log]")
+{
+    std::string const path = temp_path("max_bytes");
+    std::vector<std::uint8_t> const payload(1000, 0x11);
+
+    std::uint64_t written = 0;
+    {
+        capture_writer writer(path, 8192);
+        while (writer.append(1, 1, 0x2, payload)) {
+        }
+        written = writer.records();
+        REQUIRE(written > 0);
+        REQUIRE(writer.size() <= 8192);
+
+        // smaller records may still fit
+        while (writer.append(1, 1, 0x2, {})) {
+        }
+        REQUIRE(writer.size() <= 8192);
+        written = writer.records();
+    }
+
+    capture_reader reader(path);
+    std::uint64_t read = 0;
+    while (reader.next()) {
+        ++read;
+    }
+    REQUIRE(read == written);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("not a capture file", "[capture_log]")
+{
+    REQUIRE_THROWS_AS(capture_reader(temp_path("missing")), std::runtime_error);
+
+    std::string const path = temp_path("garbage");
+    {
+        std::ofstream out(path);
+        out << "this is not a capture file, it's just text";
+    }
+    REQUIRE_THROWS_AS(capture_reader(path), std::runtime_error);
+    std::filesystem::remove(path);
+
+    REQUIRE_THROWS_AS(capture_writer("/nonexistent/dir/capture", 1 << 20), std::runtime_error);
+}
+
+} // namespace ws::test
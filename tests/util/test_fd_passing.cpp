@@ -0,0 +1,87 @@
+#include "util/fd_passing.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <array>
+
+
+namespace ws::test {
+
+namespace {
+    /// \return true if both descriptors refer to the same open file
+    bool
+    same_file(int lhs, int rhs)
+    {
+        struct stat a{};
+        struct stat b{};
+        return ::fstat(lhs, &a) == 0 && ::fstat(rhs, &b) == 0 && a.st_dev == b.st_dev
+                && a.st_ino == b.st_ino;
+    }
+} // namespace
+
+TEST_CASE("basic usage", "[fd_passing]")
+{
+    int sv[2] = {-1, -1};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    SECTION("single descriptor")
+    {
+        int pipefd[2] = {-1, -1};
+        REQUIRE(::pipe(pipefd) == 0);
+
+        REQUIRE(send_fds(sv[0], std::array{pipefd[1]}));
+
+        std::array<int, 1> received{-1};
+        REQUIRE(recv_fds(sv[1], received) == 1);
+        REQUIRE(received[0] != pipefd[1]);
+        REQUIRE(same_file(received[0], pipefd[1]));
+
+        // the passed descriptor is usable
+        REQUIRE(::write(received[0], "x", 1) == 1);
+        char c = 0;
+        REQUIRE(::read(pipefd[0], &c, 1) == 1);
+        REQUIRE(c == 'x');
+
+        ::close(received[0]);
+        ::close(pipefd[0]);
+        ::close(pipefd[1]);
+    }
+
+    SECTION("multiple descriptors")
+    {
+        int pipefd[2] = {-1, -1};
+        REQUIRE(::pipe(pipefd) == 0);
+
+        REQUIRE(send_fds(sv[0], std::array{pipefd[0], pipefd[1]}));
+
+        std::array<int, MaxPassedFds> received{};
+        REQUIRE(recv_fds(sv[1], received) == 2);
+        REQUIRE(same_file(received[0], pipefd[0]));
+        REQUIRE(same_file(received[1], pipefd[1]));
+
+        for (int const fd : {received[0], received[1], pipefd[0], pipefd[1]}) {
+            ::close(fd);
+        }
+    }
+
+    SECTION("invalid arguments")
+    {
+        REQUIRE_FALSE(send_fds(sv[0], {}));
+        std::array<int, MaxPassedFds + 1> too_many{};
+        REQUIRE_FALSE(send_fds(sv[0], too_many));
+    }
+
+    SECTION("peer closed")
+    {
+        ::close(sv[0]);
+        sv[0] = -1;
+        std::array<int, 1> received{-1};
+        REQUIRE(recv_fds(sv[1], received) == -1);
+    }
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+} // namespace ws::test
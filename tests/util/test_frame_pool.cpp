@@ -0,0 +1,93 @@
+#include "util/frame_pool.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+namespace ws::test {
+
+TEST_CASE("allocate and recycle", "[frame_pool]")
+{
+    frame_pool pool;
+
+    SECTION("blocks are aligned and writable")
+    {
+        std::vector<void*> blocks;
+        for (std::size_t size : {1UL, 63UL, 64UL, 100UL, 1000UL, 4000UL}) {
+            void* p = pool.allocate(size);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(p) % alignof(std::max_align_t) == 0);
+            std::memset(p, 0xab, size);
+            blocks.push_back(p);
+        }
+        REQUIRE(pool.in_use() == blocks.size());
+
+        for (void* p : blocks) {
+            frame_pool::deallocate(p);
+        }
+        REQUIRE(pool.in_use() == 0);
+    }
+
+    SECTION("freed blocks are reused without touching the heap")
+    {
+        void* first = pool.allocate(200);
+        frame_pool::deallocate(first);
+        std::uint64_t const heap = pool.heap_allocations();
+
+        for (int i = 0; i < 1000; ++i) {
+            void* p = pool.allocate(200);
+            REQUIRE(p == first);
+            frame_pool::deallocate(p);
+        }
+        REQUIRE(pool.heap_allocations() == heap);
+    }
+
+    SECTION("size classes don't mix")
+    {
+        void* small = pool.allocate(16);
+        frame_pool::deallocate(small);
+        void* large = pool.allocate(1024);
+        REQUIRE(large != small);
+        REQUIRE(pool.allocate(16) == small);
+        frame_pool::deallocate(large);
+    }
+
+    SECTION("many live blocks span several chunks")
+    {
+        std::vector<void*> blocks;
+        for (std::size_t i = 0; i < 3 * frame_pool::ChunkSize / 512; ++i) {
+            blocks.push_back(pool.allocate(500));
+        }
+        REQUIRE(pool.heap_allocations() >= 3);
+        for (void* p : blocks) {
+            frame_pool::deallocate(p);
+        }
+        REQUIRE(pool.in_use() == 0);
+    }
+
+    SECTION("oversized requests bypass the pool")
+    {
+        void* p = pool.allocate(frame_pool::MaxPooledSize * 2);
+        std::memset(p, 0, frame_pool::MaxPooledSize * 2);
+        REQUIRE(pool.in_use() == 0);
+        REQUIRE(pool.heap_allocations() == 1);
+        frame_pool::deallocate(p);
+    }
+}
+
+TEST_CASE("deallocate finds the owning pool", "[frame_pool]")
+{
+    frame_pool a;
+    frame_pool b;
+    void* pa = a.allocate(128);
+    void* pb = b.allocate(128);
+    frame_pool::deallocate(pa);
+    frame_pool::deallocate(pb);
+    REQUIRE(a.in_use() == 0);
+    REQUIRE(b.in_use() == 0);
+    REQUIRE(a.allocate(128) == pa);
+    REQUIRE(b.allocate(128) == pb);
+    frame_pool::deallocate(nullptr);
+}
+
+} // namespace ws::test
@@ -0,0 +1,76 @@
+#include "util/latency_histogram.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+
+
+namespace ws::test {
+
+TEST_CASE("empty", "[latency_histogram]")
+{
+    latency_histogram const h;
+    REQUIRE(h.count() == 0);
+    REQUIRE(h.max() == 0);
+    REQUIRE_FALSE(h.mean() > 0.0);
+    REQUIRE(h.percentile(50) == 0);
+}
+
+TEST_CASE("small values are exact", "[latency_histogram]")
+{
+    latency_histogram h;
+    for (std::uint64_t v = 0; v < 16; ++v) {
+        h.record(v);
+    }
+    REQUIRE(h.count() == 16);
+    REQUIRE(h.max() == 15);
+    REQUIRE(h.mean() > 7.49);
+    REQUIRE(h.mean() < 7.51);
+    REQUIRE(h.percentile(0) == 0);
+    REQUIRE(h.percentile(50) == 7);
+    REQUIRE(h.percentile(100) == 15);
+}
+
+TEST_CASE("percentiles within a bucket's width", "[latency_histogram]")
+{
+    latency_histogram h;
+    for (std::uint64_t v = 1; v <= 100'000; ++v) {
+        h.record(v * 1000);
+    }
+
+    for (double const pct : {50.0, 90.0, 99.0, 99.9}) {
+        auto const exact = static_cast<std::uint64_t>(pct * 1000.0) * 1000;
+        std::uint64_t const reported = h.percentile(pct);
+        REQUIRE(reported >= exact);
+        REQUIRE(reported <= exact + exact / latency_histogram::SubBuckets);
+    }
+    REQUIRE(h.percentile(100) == 100'000'000);
+}
+
+TEST_CASE("huge values", "[latency_histogram]")
+{
+    latency_histogram h;
+    h.record(UINT64_MAX);
+    h.record(std::uint64_t{1} << 63);
+    REQUIRE(h.count() == 2);
+    REQUIRE(h.max() == UINT64_MAX);
+    REQUIRE(h.percentile(50) >= std::uint64_t{1} << 63);
+    REQUIRE(h.percentile(100) == UINT64_MAX);
+}
+
+TEST_CASE("merge", "[latency_histogram]")
+{
+    latency_histogram a;
+    latency_histogram b;
+    for (std::uint64_t v = 0; v < 100; ++v) {
+        a.record(10);
+        b.record(1'000'000);
+    }
+    a.merge(b);
+    REQUIRE(a.count() == 200);
+    REQUIRE(a.max() == 1'000'000);
+    REQUIRE(a.percentile(50) == 10);
+    REQUIRE(a.percentile(51) >= 1'000'000);
+    REQUIRE(a.mean() > 500'004.99);
+    REQUIRE(a.mean() < 500'005.01);
+}
+
+} // namespace ws::test
@@ -0,0 +1,85 @@
+#include "util/loop_arena.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+
+namespace ws::test {
+
+TEST_CASE("allocate and reset", "[loop_arena]")
+{
+    loop_arena arena;
+
+    SECTION("allocations are aligned and writable")
+    {
+        for (std::size_t alignment : {1UL, 8UL, 16UL, 64UL}) {
+            void* p = arena.allocate(100, alignment);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(p) % alignment == 0);
+            std::memset(p, 0xab, 100);
+        }
+        REQUIRE(arena.heap_allocations() == 1);
+    }
+
+    SECTION("reset reuses the chunk")
+    {
+        void* first = arena.allocate(200);
+        REQUIRE(arena.allocate(300) != first);
+        arena.reset();
+        REQUIRE(arena.allocate(200) == first);
+        REQUIRE(arena.heap_allocations() == 1);
+    }
+
+    SECTION("the last allocation can be given back")
+    {
+        void* first = arena.allocate(200);
+        arena.deallocate(first, 200);
+        REQUIRE(arena.allocate(200) == first);
+
+        // anything else is freed by reset()
+        void* second = arena.allocate(200);
+        REQUIRE(arena.allocate(8) != nullptr);
+        arena.deallocate(second, 200);
+        REQUIRE(arena.allocate(200) != second);
+    }
+
+    SECTION("a busy pass grows the arena once")
+    {
+        for (int pass = 0; pass < 5; ++pass) {
+            for (int i = 0; i < 100; ++i) {
+                std::memset(arena.allocate(4000), 0x11, 4000);
+            }
+            arena.reset();
+        }
+        REQUIRE(arena.capacity() >= 400'000);
+        std::uint64_t const heap = arena.heap_allocations();
+
+        for (int i = 0; i < 100; ++i) {
+            std::memset(arena.allocate(4000), 0x33, 4000);
+        }
+        arena.reset();
+        REQUIRE(arena.heap_allocations() == heap);
+    }
+
+    SECTION("larger than a chunk")
+    {
+        void* p = arena.allocate(loop_arena::ChunkSize * 3);
+        std::memset(p, 0x22, loop_arena::ChunkSize * 3);
+        REQUIRE(arena.capacity() >= loop_arena::ChunkSize * 3);
+    }
+}
+
+TEST_CASE("pmr containers", "[loop_arena]")
+{
+    loop_arena arena;
+    std::pmr::vector<std::uint8_t> payload(&arena);
+    payload.assign(1000, 'x');
+    std::pmr::string text("a string too long for the small string buffer", &arena);
+    REQUIRE(payload.size() == 1000);
+    REQUIRE(text.size() > 15);
+    REQUIRE(arena.heap_allocations() == 1);
+}
+
+} // namespace ws::test
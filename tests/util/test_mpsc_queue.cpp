@@ -0,0 +1,107 @@
+#include "util/mpsc_queue.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace ws::test {
+
+TEST_CASE("single thread", "[mpsc_queue]")
+{
+    SECTION("capacity rounds up to a power of two")
+    {
+        REQUIRE(mpsc_queue<int>(5).capacity() == 8);
+        REQUIRE(mpsc_queue<int>(8).capacity() == 8);
+        REQUIRE(mpsc_queue<int>(0).capacity() == 2);
+    }
+
+    SECTION("fifo, full and empty")
+    {
+        mpsc_queue<int> queue(4);
+        int out = 0;
+        REQUIRE(queue.empty());
+        REQUIRE_FALSE(queue.try_pop(out));
+
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(queue.try_push(int{i}));
+        }
+        REQUIRE_FALSE(queue.try_push(99));
+
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(queue.try_pop(out));
+            REQUIRE(out == i);
+        }
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("wraps around")
+    {
+        mpsc_queue<std::string> queue(4);
+        std::string out;
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(queue.try_push(std::to_string(i)));
+            REQUIRE(queue.try_push(std::to_string(i) + "b"));
+            REQUIRE(queue.try_pop(out));
+            REQUIRE(out == std::to_string(i));
+            REQUIRE(queue.try_pop(out));
+            REQUIRE(out == std::to_string(i) + "b");
+        }
+    }
+
+    SECTION("a failed push leaves the value alone")
+    {
+        mpsc_queue<std::vector<int>> queue(2);
+        REQUIRE(queue.try_push(std::vector<int>{1}));
+        REQUIRE(queue.try_push(std::vector<int>{2}));
+        std::vector<int> value{3, 4};
+        REQUIRE_FALSE(queue.try_push(std::move(value)));
+        REQUIRE(value.size() == 2);
+    }
+}
+
+TEST_CASE("many producers", "[mpsc_queue]")
+{
+    static constexpr std::uint64_t Producers = 4;
+    static constexpr std::uint64_t PerProducer = 50'000;
+
+    // every element says who pushed it and in which order
+    mpsc_queue<std::uint64_t> queue(64);
+    std::vector<std::thread> producers;
+    for (std::uint64_t p = 0; p < Producers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (std::uint64_t i = 0; i < PerProducer; ++i) {
+                while (!queue.try_push(p << 32 | i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::uint64_t> next(Producers, 0);
+    std::uint64_t received = 0;
+    bool in_order = true;
+    while (received < Producers * PerProducer) {
+        std::uint64_t value = 0;
+        if (!queue.try_pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::uint64_t const producer = value >> 32;
+        in_order = in_order && (value & 0xffffffff) == next[producer];
+        ++next[producer];
+        ++received;
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    REQUIRE(in_order);
+    REQUIRE(queue.empty());
+    for (std::uint64_t p = 0; p < Producers; ++p) {
+        REQUIRE(next[p] == PerProducer);
+    }
+}
+
+} // namespace ws::test
@@ -0,0 +1,71 @@
+#include "util/random.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm> // std::all_of
+#include <array>
+#include <bit> // std::popcount
+#include <cstdint>
+#include <set>
+
+
+namespace ws::test {
+
+TEST_CASE("wyrand", "[random]")
+{
+    SECTION("deterministic for a given seed")
+    {
+        wyrand a(42);
+        wyrand b(42);
+        wyrand c(43);
+        for (int i = 0; i < 100; ++i) {
+            std::uint64_t const va = a.next();
+            REQUIRE(va == b.next());
+            REQUIRE(va != c.next());
+        }
+    }
+
+    SECTION("usable at compile time")
+    {
+        constexpr std::uint64_t first = [] {
+            wyrand rng(1);
+            return rng.next();
+        }();
+        wyrand rng(1);
+        REQUIRE(rng.next() == first);
+    }
+
+    SECTION("bits are roughly balanced")
+    {
+        wyrand rng(0);
+        std::uint64_t ones = 0;
+        static constexpr int Draws = 10000;
+        for (int i = 0; i < Draws; ++i) {
+            ones += static_cast<std::uint64_t>(std::popcount(rng.next_u32()));
+        }
+        // expected 160000; 1% is several standard deviations
+        REQUIRE(ones > 158400);
+        REQUIRE(ones < 161600);
+    }
+}
+
+TEST_CASE("secure_random_bytes", "[random]")
+{
+    std::array<std::uint8_t, 32> a{};
+    std::array<std::uint8_t, 32> b{};
+    REQUIRE(secure_random_bytes(a));
+    REQUIRE(secure_random_bytes(b));
+    REQUIRE(a != b);
+    REQUIRE_FALSE(std::all_of(a.begin(), a.end(), [](std::uint8_t x) { return x == 0; }));
+
+    REQUIRE(secure_random_bytes({}));
+}
+
+TEST_CASE("fast_random_u32", "[random]")
+{
+    std::set<std::uint32_t> seen;
+    for (int i = 0; i < 1000; ++i) {
+        seen.insert(fast_random_u32());
+    }
+    REQUIRE(seen.size() > 990);
+}
+
+} // namespace ws::test
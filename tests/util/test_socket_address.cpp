@@ -0,0 +1,109 @@
+#include "util/socket_address.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <netinet/in.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+namespace ws::test {
+
+TEST_CASE("resolve", "[socket_address]")
+{
+    SECTION("ipv4")
+    {
+        socket_address const addr = resolve_socket_address("127.0.0.1:9000");
+        REQUIRE(addr.family() == AF_INET);
+        REQUIRE(addr.size == sizeof(sockaddr_in));
+        auto const* sin = reinterpret_cast<sockaddr_in const*>(addr.get());
+        REQUIRE(ntohs(sin->sin_port) == 9000);
+        REQUIRE(ntohl(sin->sin_addr.s_addr) == INADDR_LOOPBACK);
+    }
+
+    SECTION("ipv6 in brackets")
+    {
+        socket_address const addr = resolve_socket_address("[::1]:9001");
+        REQUIRE(addr.family() == AF_INET6);
+        auto const* sin6 = reinterpret_cast<sockaddr_in6 const*>(addr.get());
+        REQUIRE(ntohs(sin6->sin6_port) == 9001);
+    }
+
+    SECTION("unix")
+    {
+        socket_address const addr = resolve_socket_address("unix:/tmp/backend.sock");
+        REQUIRE(addr.family() == AF_UNIX);
+        auto const* sun = reinterpret_cast<sockaddr_un const*>(addr.get());
+        REQUIRE(std::strcmp(sun->sun_path, "/tmp/backend.sock") == 0);
+        REQUIRE(unix_socket_path(addr) == "/tmp/backend.sock");
+    }
+
+    SECTION("abstract unix")
+    {
+        socket_address const addr = resolve_socket_address("unix:@ws.test");
+        REQUIRE(addr.family() == AF_UNIX);
+        REQUIRE(addr.size == offsetof(sockaddr_un, sun_path) + 8);
+        auto const* sun = reinterpret_cast<sockaddr_un const*>(addr.get());
+        REQUIRE(sun->sun_path[0] == '\0');
+        REQUIRE(std::memcmp(sun->sun_path + 1, "ws.test", 7) == 0);
+        REQUIRE(unix_socket_path(addr).empty());
+        REQUIRE(unix_socket_path(resolve_socket_address("127.0.0.1:9000")).empty());
+    }
+
+    SECTION("malformed")
+    {
+        REQUIRE_THROWS_AS(resolve_socket_address("localhost"), std::runtime_error);
+        REQUIRE_THROWS_AS(resolve_socket_address(":9000"), std::runtime_error);
+        REQUIRE_THROWS_AS(resolve_socket_address("127.0.0.1:"), std::runtime_error);
+        REQUIRE_THROWS_AS(resolve_socket_address("unix:"), std::runtime_error);
+        REQUIRE_THROWS_AS(resolve_socket_address("unix:@"), std::runtime_error);
+        REQUIRE_THROWS_AS(
+                resolve_socket_address("unix:" + std::string(200, 'x')), std::runtime_error);
+    }
+}
+
+TEST_CASE("connect", "[socket_address]")
+{
+    std::string const path = "/tmp/ws_test_socket_address." + std::to_string(::getpid());
+    socket_address const addr = resolve_socket_address("unix:" + path);
+
+    SECTION("nobody listening")
+    {
+        ::unlink(path.c_str());
+        REQUIRE(connect_socket(addr) == -1);
+    }
+
+    SECTION("listening")
+    {
+        int const listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ::unlink(path.c_str());
+        REQUIRE(::bind(listener, addr.get(), addr.size) == 0);
+        REQUIRE(::listen(listener, 1) == 0);
+
+        int const sock = connect_socket(addr);
+        REQUIRE(sock != -1);
+        ::close(sock);
+        ::close(listener);
+        ::unlink(path.c_str());
+    }
+
+    SECTION("abstract")
+    {
+        std::string const name = "unix:@ws_test_socket_address." + std::to_string(::getpid());
+        socket_address const abstract = resolve_socket_address(name);
+        REQUIRE(connect_socket(abstract) == -1);
+
+        int const listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        REQUIRE(::bind(listener, abstract.get(), abstract.size) == 0);
+        REQUIRE(::listen(listener, 1) == 0);
+
+        int const sock = connect_socket(abstract);
+        REQUIRE(sock != -1);
+        ::close(sock);
+        ::close(listener);
+    }
+}
+
+} // namespace ws::test
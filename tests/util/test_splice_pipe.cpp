@@ -0,0 +1,120 @@
+#include "util/splice_pipe.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <string>
+#include <utility>
+
+
+namespace ws::test {
+
+namespace {
+    /// \return everything readable from \c fd right now
+    std::string
+    read_available(int fd)
+    {
+        std::string result;
+        char buf[4096];
+        ssize_t nbytes = 0;
+        while ((nbytes = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            result.append(buf, static_cast<std::size_t>(nbytes));
+        }
+        return result;
+    }
+} // namespace
+
+TEST_CASE("socket to socket", "[splice_pipe]")
+{
+    int in[2] = {-1, -1};
+    int out[2] = {-1, -1};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, in) == 0);
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, out) == 0);
+    REQUIRE(::fcntl(in[1], F_SETFL, O_NONBLOCK) == 0);
+
+    splice_pipe pipe;
+    REQUIRE(pipe.capacity() > 0);
+    REQUIRE(pipe.pending() == 0);
+
+    SECTION("nothing to read")
+    {
+        REQUIRE(pipe.fill(in[1]) == -1);
+        REQUIRE(errno == EAGAIN);
+        REQUIRE(pipe.pending() == 0);
+    }
+
+    SECTION("bytes arrive unchanged")
+    {
+        std::string const message = "hello, backend";
+        REQUIRE(::send(in[0], message.data(), message.size(), 0)
+                == static_cast<ssize_t>(message.size()));
+
+        REQUIRE(pipe.fill(in[1]) == static_cast<ssize_t>(message.size()));
+        REQUIRE(pipe.pending() == message.size());
+
+        REQUIRE(pipe.drain(out[0]));
+        REQUIRE(pipe.pending() == 0);
+        REQUIRE(read_available(out[1]) == message);
+    }
+
+    SECTION("fill is capped")
+    {
+        std::string const message(100, 'x');
+        REQUIRE(::send(in[0], message.data(), message.size(), 0) == 100);
+
+        REQUIRE(pipe.fill(in[1], 30) == 30);
+        REQUIRE(pipe.fill(in[1], 30) == 30);
+        REQUIRE(pipe.pending() == 60);
+        REQUIRE(pipe.drain(out[0]));
+        REQUIRE(read_available(out[1]).size() == 60);
+    }
+
+    SECTION("end of file")
+    {
+        ::shutdown(in[0], SHUT_WR);
+        REQUIRE(pipe.fill(in[1]) == 0);
+    }
+
+    SECTION("clear discards pending bytes")
+    {
+        std::string const message(5000, 'y');
+        REQUIRE(::send(in[0], message.data(), message.size(), 0) == 5000);
+        REQUIRE(pipe.fill(in[1]) == 5000);
+
+        pipe.clear();
+        REQUIRE(pipe.pending() == 0);
+
+        // the next fill starts from an empty pipe
+        REQUIRE(::send(in[0], "z", 1, 0) == 1);
+        REQUIRE(pipe.fill(in[1]) == 1);
+        REQUIRE(pipe.drain(out[0]));
+        REQUIRE(read_available(out[1]) == "z");
+    }
+
+    SECTION("move")
+    {
+        REQUIRE(::send(in[0], "abc", 3, 0) == 3);
+        REQUIRE(pipe.fill(in[1]) == 3);
+
+        splice_pipe moved(std::move(pipe));
+        REQUIRE(moved.pending() == 3);
+        REQUIRE(moved.drain(out[0]));
+        REQUIRE(read_available(out[1]) == "abc");
+    }
+
+    for (int const fd : {in[0], in[1], out[0], out[1]}) {
+        ::close(fd);
+    }
+}
+
+TEST_CASE("pipe size", "[splice_pipe]")
+{
+    splice_pipe const small(4096);
+    REQUIRE(small.capacity() == 4096);
+
+    splice_pipe const large(256 * 1024);
+    REQUIRE(large.capacity() == 256 * 1024);
+}
+
+} // namespace ws::test
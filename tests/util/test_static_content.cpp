@@ -0,0 +1,129 @@
+#include "util/static_content.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+
+namespace ws::test {
+
+namespace {
+    namespace fs = std::filesystem;
+
+    /// A directory of files in the temp directory, removed on scope exit
+    struct temp_root
+    {
+        fs::path path = fs::temp_directory_path()
+                / ("test_static_content." + std::to_string(::getpid()));
+
+        temp_root()
+        {
+            fs::create_directories(path / "js");
+            fs::create_directories(path / ".git");
+            write("index.html", "<html></html>");
+            write("js/app.js", "console.log(1);");
+            write("big.bin", std::string(static_content::MemoryLimit + 1, 'b'));
+            write("empty.txt", "");
+            write(".hidden", "secret");
+            write(".git/config", "secret");
+        }
+
+        ~temp_root()
+        {
+            fs::remove_all(path);
+        }
+
+        void
+        write(std::string const& name, std::string const& contents) const
+        {
+            std::ofstream(path / name, std::ios::binary) << contents;
+        }
+    };
+} // namespace
+
+TEST_CASE("loading", "[static_content]")
+{
+    temp_root const root;
+    static_content const content(root.path.string());
+    REQUIRE(content.size() == 4);
+
+    SECTION("small files are kept in memory, behind their headers")
+    {
+        static_file const* index = content.find("/index.html");
+        REQUIRE(index != nullptr);
+        REQUIRE(index->in_memory());
+        REQUIRE(index->size == 13);
+        REQUIRE(index->content_type == "text/html; charset=utf-8");
+        std::string_view const response = index->response;
+        REQUIRE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+        REQUIRE(response.contains("\r\nContent-Length: 13\r\n"));
+        REQUIRE(response.contains("\r\nETag: " + index->etag + "\r\n"));
+        REQUIRE(response.substr(0, index->header_size).ends_with("\r\n\r\n"));
+        REQUIRE(response.substr(index->header_size) == "<html></html>");
+        REQUIRE(index->not_modified.starts_with("HTTP/1.1 304 Not Modified\r\n"));
+        REQUIRE(index->not_modified.contains("\r\nETag: " + index->etag + "\r\n"));
+    }
+
+    SECTION("large files are sent from their file")
+    {
+        static_file const* big = content.find("/big.bin");
+        REQUIRE(big != nullptr);
+        REQUIRE_FALSE(big->in_memory());
+        REQUIRE(big->response.size() == big->header_size);
+        REQUIRE(big->size == static_content::MemoryLimit + 1);
+        REQUIRE(big->content_type == "application/octet-stream");
+    }
+
+    SECTION("request targets")
+    {
+        REQUIRE(content.find("/") == content.find("/index.html"));
+        REQUIRE(content.find("/index.html?v=2") == content.find("/index.html"));
+        REQUIRE(content.find("/js/app.js") != nullptr);
+        REQUIRE(content.find("/empty.txt") != nullptr);
+        REQUIRE(content.find("/js/") == nullptr);
+        REQUIRE(content.find("/missing") == nullptr);
+        REQUIRE(content.find("/.hidden") == nullptr);
+        REQUIRE(content.find("/.git/config") == nullptr);
+        REQUIRE(content.find("/js/../index.html") == nullptr);
+    }
+
+    SECTION("etags follow the contents")
+    {
+        static_file const* index = content.find("/index.html");
+        static_file const* app = content.find("/js/app.js");
+        REQUIRE(index->etag.size() == 18);
+        REQUIRE(index->etag.front() == '"');
+        REQUIRE(index->etag != app->etag);
+
+        static_content const again(root.path.string());
+        REQUIRE(again.find("/index.html")->etag == index->etag);
+    }
+}
+
+TEST_CASE("missing root", "[static_content]")
+{
+    REQUIRE_THROWS_AS(static_content("/nonexistent/static/root"), std::runtime_error);
+}
+
+TEST_CASE("if_none_match", "[static_content]")
+{
+    REQUIRE(if_none_match("\"abc\"", "\"abc\""));
+    REQUIRE(if_none_match("W/\"abc\"", "\"abc\""));
+    REQUIRE(if_none_match("\"x\", \"abc\"", "\"abc\""));
+    REQUIRE(if_none_match("*", "\"abc\""));
+    REQUIRE_FALSE(if_none_match("\"abd\"", "\"abc\""));
+    REQUIRE_FALSE(if_none_match("abc", "\"abc\""));
+    REQUIRE_FALSE(if_none_match("", "\"abc\""));
+}
+
+TEST_CASE("content_type", "[static_content]")
+{
+    REQUIRE(content_type("a/index.html") == "text/html; charset=utf-8");
+    REQUIRE(content_type("bundle.js") == "text/javascript; charset=utf-8");
+    REQUIRE(content_type("logo.png") == "image/png");
+    REQUIRE(content_type("README") == "application/octet-stream");
+}
+
+} // namespace ws::test
@@ -0,0 +1,93 @@
+#include "util/timestamping.hpp"
+#include "tcp_pair.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    /// Read transmit timestamps off \c sock until \c wanted of them have
+    /// arrived or a second has passed
+    std::vector<tx_timestamp>
+    wait_for_tx_timestamps(int sock, std::size_t wanted)
+    {
+        std::vector<tx_timestamp> stamps;
+        for (int i = 0; i < 100 && stamps.size() < wanted; ++i) {
+            pollfd pfd{sock, 0, 0};
+            ::poll(&pfd, 1, 10); // errors are always reported
+            std::array<tx_timestamp, 8> batch;
+            int const n = read_tx_timestamps(sock, batch);
+            REQUIRE(n != -1);
+            stamps.insert(stamps.end(), batch.begin(), batch.begin() + n);
+        }
+        return stamps;
+    }
+} // namespace
+
+TEST_CASE("receive timestamps", "[timestamping]")
+{
+    auto const [client, server] = tcp_pair();
+    REQUIRE(enable_timestamping(server));
+
+    std::int64_t const before = realtime_ns();
+    REQUIRE(::send(client, "hello", 5, 0) == 5);
+
+    char buf[16];
+    std::int64_t rx_ns = 0;
+    REQUIRE(recv_timestamped(server, buf, sizeof(buf), 0, rx_ns) == 5);
+    std::int64_t const after = realtime_ns();
+    REQUIRE(rx_ns >= before);
+    REQUIRE(rx_ns <= after);
+
+    // nothing there: no stamp, and rx_ns is left alone
+    std::int64_t untouched = 42;
+    REQUIRE(recv_timestamped(server, buf, sizeof(buf), MSG_DONTWAIT, untouched) == -1);
+    REQUIRE(untouched == 42);
+
+    ::close(client);
+    ::close(server);
+}
+
+TEST_CASE("transmit timestamps", "[timestamping]")
+{
+    auto const [client, server] = tcp_pair();
+    REQUIRE(enable_timestamping(server));
+
+    SECTION("empty error queue")
+    {
+        std::array<tx_timestamp, 4> stamps;
+        REQUIRE(read_tx_timestamps(server, stamps) == 0);
+    }
+
+    SECTION("every send is stamped sent and acked, keyed by its last byte")
+    {
+        std::int64_t const before = realtime_ns();
+        std::vector<std::uint8_t> const payload(100, 't');
+        REQUIRE(::send(server, payload.data(), 100, 0) == 100);
+        REQUIRE(::send(server, payload.data(), 50, 0) == 50);
+
+        std::vector<tx_timestamp> const stamps = wait_for_tx_timestamps(server, 4);
+        REQUIRE(stamps.size() == 4);
+        std::size_t sent = 0;
+        std::size_t acked = 0;
+        for (tx_timestamp const& stamp : stamps) {
+            REQUIRE((stamp.key == 99 || stamp.key == 149));
+            REQUIRE(stamp.ns >= before);
+            REQUIRE(stamp.ns <= realtime_ns());
+            (stamp.kind == TxStamp::Sent ? sent : acked) += 1;
+        }
+        REQUIRE(sent == 2);
+        REQUIRE(acked == 2);
+    }
+
+    ::close(client);
+    ::close(server);
+}
+
+} // namespace ws::test
@@ -0,0 +1,201 @@
+#include "util/tls.hpp"
+#include "tcp_pair.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    namespace fs = std::filesystem;
+
+    /// A self-signed certificate for "localhost" and its key, removed on scope exit
+    struct temp_certificate
+    {
+        fs::path certificate
+                = fs::temp_directory_path() / ("test_tls." + std::to_string(::getpid()) + ".crt");
+        fs::path key
+                = fs::temp_directory_path() / ("test_tls." + std::to_string(::getpid()) + ".key");
+
+        temp_certificate()
+        {
+            write_self_signed_certificate(certificate.string(), key.string());
+        }
+
+        ~temp_certificate()
+        {
+            fs::remove(certificate);
+            fs::remove(key);
+        }
+    };
+
+    void
+    set_nonblocking(int fd)
+    {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    /// Step both ends of the handshake in turn until both are done
+    /// \return \c false if either fails
+    bool
+    handshake(tls_session& server, tls_session& client)
+    {
+        TlsProgress s = TlsProgress::WantRead;
+        TlsProgress c = TlsProgress::WantRead;
+        for (int i = 0; i < 100 && (s != TlsProgress::Done || c != TlsProgress::Done); ++i) {
+            if (c != TlsProgress::Done) {
+                c = client.handshake();
+            }
+            if (s != TlsProgress::Done) {
+                s = server.handshake();
+            }
+            if (s == TlsProgress::Failed || c == TlsProgress::Failed) {
+                return false;
+            }
+        }
+        return s == TlsProgress::Done && c == TlsProgress::Done;
+    }
+
+    /// Send \c data from \c from, through the kernel if it took over
+    bool
+    send_all(tls_session& from, int fd, std::vector<std::uint8_t> const& data)
+    {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t const nbytes = from.kernel_send()
+                    ? ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL)
+                    : from.send(data.data() + sent, data.size() - sent);
+            if (nbytes <= 0) {
+                return false;
+            }
+            sent += static_cast<std::size_t>(nbytes);
+        }
+        return true;
+    }
+
+    /// Read \c len bytes into \c to, through the kernel if it took over
+    bool
+    recv_all(tls_session& to, int fd, std::vector<std::uint8_t>& out, std::size_t len)
+    {
+        out.resize(len);
+        std::size_t received = 0;
+        for (int idle = 0; received < len && idle < 1000;) {
+            ssize_t const nbytes = to.kernel_recv()
+                    ? ::recv(fd, out.data() + received, len - received, MSG_DONTWAIT)
+                    : to.recv(out.data() + received, len - received);
+            if (nbytes == 0 || (nbytes == -1 && errno != EAGAIN)) {
+                return false;
+            }
+            if (nbytes == -1) {
+                ++idle;
+                ::usleep(1000);
+                continue;
+            }
+            received += static_cast<std::size_t>(nbytes);
+        }
+        return received == len;
+    }
+} // namespace
+
+TEST_CASE("handshake and data", "[tls]")
+{
+    temp_certificate const cert;
+    tls_options server_options;
+    server_options.certificate = cert.certificate.string();
+    server_options.private_key = cert.key.string();
+    tls_options client_options;
+    client_options.ca_file = cert.certificate.string();
+    tls_context const server_ctx(TlsRole::Server, server_options);
+    tls_context const client_ctx(TlsRole::Client, client_options);
+
+    SECTION("socketpair, in user space")
+    {
+        int fds[2];
+        REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+        {
+            tls_session server(server_ctx, fds[0]);
+            tls_session client(client_ctx, fds[1], "localhost");
+            REQUIRE(handshake(server, client));
+            REQUIRE(client.version() == "TLSv1.3");
+            REQUIRE_FALSE(client.cipher().empty());
+
+            // the kernel only takes over tcp sockets
+            REQUIRE_FALSE(server.kernel_send());
+            REQUIRE_FALSE(server.kernel_recv());
+
+            std::vector<std::uint8_t> const request(10'000, 'q');
+            std::vector<std::uint8_t> const reply{'o', 'k'};
+            std::vector<std::uint8_t> received;
+            REQUIRE(send_all(client, fds[1], request));
+            REQUIRE(recv_all(server, fds[0], received, request.size()));
+            REQUIRE(received == request);
+            REQUIRE(send_all(server, fds[0], reply));
+            REQUIRE(recv_all(client, fds[1], received, 2));
+            REQUIRE(received == reply);
+
+            // nothing more has arrived
+            std::uint8_t byte = 0;
+            REQUIRE(server.recv(&byte, 1) == -1);
+            REQUIRE(errno == EAGAIN);
+        }
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    SECTION("loopback tcp, through the kernel if it can")
+    {
+        auto const [client_fd, server_fd] = tcp_pair();
+        set_nonblocking(server_fd);
+        set_nonblocking(client_fd);
+        {
+            tls_session server(server_ctx, server_fd);
+            tls_session client(client_ctx, client_fd, "localhost");
+            REQUIRE(handshake(server, client));
+
+            // both ways, whichever direction the kernel took over
+            std::vector<std::uint8_t> const message(50'000, 'm');
+            std::vector<std::uint8_t> received;
+            REQUIRE(send_all(client, client_fd, message));
+            REQUIRE(recv_all(server, server_fd, received, message.size()));
+            REQUIRE(received == message);
+            REQUIRE(send_all(server, server_fd, message));
+            REQUIRE(recv_all(client, client_fd, received, message.size()));
+            REQUIRE(received == message);
+        }
+        ::close(server_fd);
+        ::close(client_fd);
+    }
+
+    SECTION("wrong host name")
+    {
+        int fds[2];
+        REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+        {
+            tls_session server(server_ctx, fds[0]);
+            tls_session client(client_ctx, fds[1], "example.com");
+            REQUIRE_FALSE(handshake(server, client));
+        }
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+}
+
+TEST_CASE("context errors", "[tls]")
+{
+    tls_options options;
+    options.certificate = "/nonexistent.crt";
+    options.private_key = "/nonexistent.key";
+    options.ca_file = "/nonexistent.crt";
+    REQUIRE_THROWS_AS(tls_context(TlsRole::Server, options), std::runtime_error);
+    REQUIRE_THROWS_AS(tls_context(TlsRole::Client, options), std::runtime_error);
+}
+
+} // namespace ws::test
@@ -0,0 +1,105 @@
+#include "util/token_bucket.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <stdexcept>
+
+
+namespace ws::test {
+
+using namespace std::chrono_literals;
+
+TEST_CASE("basic usage", "[token_bucket]")
+{
+    auto const t0 = token_bucket::clock::time_point{} + 1h;
+
+    SECTION("default constructed bucket is unlimited")
+    {
+        token_bucket bucket;
+        REQUIRE_FALSE(bucket.limited());
+        for (int i = 0; i < 1000; ++i) {
+            REQUIRE(bucket.try_consume(1'000'000, t0));
+        }
+    }
+
+    SECTION("a limited bucket needs a positive burst")
+    {
+        REQUIRE_THROWS_AS(token_bucket(/*rate=*/10, /*burst=*/0, t0), std::runtime_error);
+        REQUIRE_THROWS_AS(token_bucket(/*rate=*/10, /*burst=*/-1, t0), std::runtime_error);
+        REQUIRE_NOTHROW(token_bucket(/*rate=*/0, /*burst=*/0, t0));
+    }
+
+    SECTION("starts full and drains")
+    {
+        token_bucket bucket(/*rate=*/10, /*burst=*/5, t0);
+        REQUIRE(bucket.limited());
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(bucket.try_consume(1, t0));
+        }
+        REQUIRE_FALSE(bucket.try_consume(1, t0));
+    }
+
+    SECTION("refills over time")
+    {
+        token_bucket bucket(/*rate=*/10, /*burst=*/5, t0);
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(bucket.try_consume(1, t0));
+        }
+        REQUIRE_FALSE(bucket.try_consume(1, t0 + 50ms));
+        REQUIRE(bucket.try_consume(1, t0 + 100ms));
+        REQUIRE_FALSE(bucket.try_consume(1, t0 + 100ms));
+    }
+
+    SECTION("refill is capped at burst")
+    {
+        token_bucket bucket(/*rate=*/10, /*burst=*/5, t0);
+        REQUIRE(bucket.try_consume(5, t0));
+        REQUIRE(bucket.try_consume(1, t0 + 1h));
+        REQUIRE(bucket.tokens() <= 4);
+        REQUIRE(bucket.tokens() > 3.99);
+    }
+
+    SECTION("oversized request allowed only when full")
+    {
+        token_bucket bucket(/*rate=*/100, /*burst=*/10, t0);
+        REQUIRE(bucket.try_consume(50, t0));
+        REQUIRE(bucket.tokens() < 0);
+        REQUIRE_FALSE(bucket.try_consume(1, t0 + 100ms));
+        REQUIRE(bucket.try_consume(1, t0 + 500ms));
+    }
+
+    SECTION("can_consume does not take tokens")
+    {
+        token_bucket bucket(/*rate=*/10, /*burst=*/1, t0);
+        REQUIRE(bucket.can_consume(1, t0));
+        REQUIRE(bucket.can_consume(1, t0));
+        REQUIRE(bucket.try_consume(1, t0));
+        REQUIRE_FALSE(bucket.can_consume(1, t0));
+    }
+
+    SECTION("wait_time until enough tokens")
+    {
+        // rounded up, so waiting that long always suffices
+        auto const about = [](token_bucket::clock::duration wait, auto expected) {
+            return wait >= expected && wait < expected + 1us;
+        };
+
+        token_bucket bucket(/*rate=*/10, /*burst=*/5, t0);
+        REQUIRE(bucket.wait_time(5, t0) == 0s);
+        REQUIRE(bucket.try_consume(5, t0));
+        REQUIRE(about(bucket.wait_time(1, t0), 100ms));
+        REQUIRE(about(bucket.wait_time(50, t0), 500ms)); // only needs a full bucket
+        REQUIRE(about(bucket.wait_time(2, t0 + 50ms), 150ms));
+        auto const wait = bucket.wait_time(3, t0 + 100ms);
+        REQUIRE_FALSE(bucket.can_consume(3, t0 + 100ms + wait - 1us));
+        REQUIRE(bucket.try_consume(3, t0 + 100ms + wait));
+    }
+
+    SECTION("time going backwards does not refill")
+    {
+        token_bucket bucket(/*rate=*/10, /*burst=*/1, t0);
+        REQUIRE(bucket.try_consume(1, t0));
+        REQUIRE_FALSE(bucket.try_consume(1, t0 - 1s));
+    }
+}
+
+} // namespace ws::test
@@ -0,0 +1,92 @@
+#include "util/work_stealing_deque.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+namespace ws::test {
+
+TEST_CASE("owner", "[work_stealing_deque]")
+{
+    SECTION("pop is lifo, steal is fifo")
+    {
+        work_stealing_deque<int> deque(4);
+        REQUIRE(deque.empty());
+        REQUIRE_FALSE(deque.pop());
+        REQUIRE_FALSE(deque.steal());
+
+        for (int i = 0; i < 3; ++i) {
+            deque.push(i);
+        }
+        REQUIRE(deque.pop() == 2);
+        REQUIRE(deque.steal() == 0);
+        REQUIRE(deque.pop() == 1);
+        REQUIRE(deque.empty());
+        REQUIRE_FALSE(deque.pop());
+    }
+
+    SECTION("grows")
+    {
+        work_stealing_deque<int> deque(2);
+        for (int i = 0; i < 1000; ++i) {
+            deque.push(i);
+        }
+        REQUIRE(deque.steal() == 0);
+        for (int i = 999; i > 0; --i) {
+            REQUIRE(deque.pop() == i);
+        }
+        REQUIRE(deque.empty());
+    }
+}
+
+TEST_CASE("stealers", "[work_stealing_deque]")
+{
+    static constexpr int Items = 200'000;
+    static constexpr int Thieves = 3;
+
+    // the owner pushes and pops while thieves steal; every item must be
+    // taken exactly once
+    work_stealing_deque<int> deque(16);
+    std::vector<std::atomic<int>> taken(Items);
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < Thieves; ++t) {
+        thieves.emplace_back([&] {
+            while (!done.load()) {
+                if (auto const item = deque.steal()) {
+                    ++taken[static_cast<std::size_t>(*item)];
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < Items; ++i) {
+        deque.push(i);
+        if (i % 3 == 0) {
+            if (auto const item = deque.pop()) {
+                ++taken[static_cast<std::size_t>(*item)];
+            }
+        }
+    }
+    while (auto const item = deque.pop()) {
+        ++taken[static_cast<std::size_t>(*item)];
+    }
+    while (!deque.empty()) {
+        std::this_thread::yield(); // a thief is finishing its steal
+    }
+    done = true;
+    for (auto& t : thieves) {
+        t.join();
+    }
+
+    int wrong = 0;
+    for (auto const& count : taken) {
+        wrong += count.load() == 1 ? 0 : 1;
+    }
+    REQUIRE(wrong == 0);
+}
+
+} // namespace ws::test
@@ -0,0 +1,177 @@
+#include "util/serial_executor.hpp"
+#include "util/worker_pool.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    /// Counts its runs
+    class counting_task final : public worker_pool::task
+    {
+    public:
+        std::atomic<int> runs{0};
+
+        void
+        run() noexcept override
+        {
+            ++runs;
+        }
+    };
+
+    /// Wait up to a few seconds for \c done to return true
+    template <typename Fn>
+    bool
+    eventually(Fn&& done)
+    {
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!done()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+} // namespace
+
+TEST_CASE("worker_pool", "[worker_pool]")
+{
+    SECTION("needs a thread")
+    {
+        REQUIRE_THROWS_AS(worker_pool(0), std::invalid_argument);
+    }
+
+    SECTION("runs every task scheduled from outside")
+    {
+        worker_pool pool(3);
+        REQUIRE(pool.size() == 3);
+
+        std::vector<counting_task> tasks(1000);
+        for (auto& t : tasks) {
+            pool.schedule(t);
+        }
+        REQUIRE(eventually([&] {
+            for (auto const& t : tasks) {
+                if (t.runs.load() != 1) {
+                    return false;
+                }
+            }
+            return true;
+        }));
+    }
+
+    SECTION("wakes up after sleeping")
+    {
+        worker_pool pool(2);
+        counting_task t;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pool.schedule(t);
+        REQUIRE(eventually([&] { return t.runs.load() == 1; }));
+    }
+}
+
+TEST_CASE("serial_executor", "[worker_pool]")
+{
+    static constexpr std::uint64_t Executors = 8;
+    static constexpr std::uint64_t Jobs = 20'000;
+
+    // every executor checks its jobs arrive in order and never overlap
+    struct state
+    {
+        std::uint64_t next = 0;
+        std::atomic<int> inside{0};
+        bool in_order = true;
+        bool overlapped = false;
+    };
+    std::vector<state> states(Executors);
+
+    worker_pool pool(4);
+    std::vector<std::unique_ptr<serial_executor<std::uint64_t>>> executors;
+    for (std::uint64_t e = 0; e < Executors; ++e) {
+        executors.push_back(std::make_unique<serial_executor<std::uint64_t>>(
+                pool, 64, [&s = states[e]](std::uint64_t& job) {
+                    s.overlapped = s.overlapped || s.inside.fetch_add(1) != 0;
+                    s.in_order = s.in_order && job == s.next;
+                    ++s.next;
+                    s.inside.fetch_sub(1);
+                }));
+    }
+
+    // interleaved across the executors, as a reactor would
+    for (std::uint64_t i = 0; i < Jobs; ++i) {
+        for (auto& executor : executors) {
+            std::uint64_t job = i;
+            while (!executor->submit(std::move(job))) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    REQUIRE(eventually([&] {
+        for (auto const& executor : executors) {
+            if (!executor->idle()) {
+                return false;
+            }
+        }
+        return true;
+    }));
+    for (auto const& s : states) {
+        REQUIRE(s.next == Jobs);
+        REQUIRE(s.in_order);
+        REQUIRE_FALSE(s.overlapped);
+    }
+}
+
+TEST_CASE("serial_executor with several producers", "[worker_pool]")
+{
+    static constexpr std::uint64_t Producers = 4;
+    static constexpr std::uint64_t Jobs = 20'000;
+
+    // jobs are producer << 32 | sequence: each producer's jobs run in its
+    // order, and the executor is never idle while one is still queued
+    std::vector<std::uint64_t> next(Producers, 0);
+    std::atomic<int> inside{0};
+    bool in_order = true;
+    bool overlapped = false;
+    std::uint64_t ran = 0;
+
+    worker_pool pool(2);
+    serial_executor<std::uint64_t> executor(pool, 16, [&](std::uint64_t& job) {
+        overlapped = overlapped || inside.fetch_add(1) != 0;
+        std::uint64_t const producer = job >> 32;
+        in_order = in_order && (job & 0xffff'ffff) == next[producer];
+        ++next[producer];
+        ++ran;
+        inside.fetch_sub(1);
+    });
+
+    std::vector<std::thread> producers;
+    for (std::uint64_t p = 0; p < Producers; ++p) {
+        producers.emplace_back([&executor, p] {
+            for (std::uint64_t i = 0; i < Jobs; ++i) {
+                std::uint64_t job = p << 32 | i;
+                while (!executor.submit(std::move(job))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    REQUIRE(eventually([&] { return executor.idle(); }));
+    REQUIRE(ran == Producers * Jobs);
+    REQUIRE(in_order);
+    REQUIRE_FALSE(overlapped);
+}
+
+} // namespace ws::test
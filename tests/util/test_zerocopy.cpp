@@ -0,0 +1,70 @@
+#include "util/zerocopy.hpp"
+#include "tcp_pair.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+
+namespace ws::test {
+
+TEST_CASE("completions", "[zerocopy]")
+{
+    auto const [client, server] = tcp_pair();
+
+    SECTION("empty error queue")
+    {
+        REQUIRE(enable_zerocopy(server));
+
+        zerocopy_completions completions;
+        REQUIRE(read_zerocopy_completions(server, completions));
+        REQUIRE(completions.released == 0);
+        REQUIRE(completions.copied == 0);
+    }
+
+    SECTION("every send is released")
+    {
+        REQUIRE(enable_zerocopy(server));
+
+        static constexpr std::uint32_t Sends = 4;
+        std::vector<std::uint8_t> const payload(64 * 1024, 'z');
+        for (std::uint32_t i = 0; i < Sends; ++i) {
+            REQUIRE(::send(server, payload.data(), payload.size(), MSG_ZEROCOPY)
+                    == static_cast<ssize_t>(payload.size()));
+        }
+
+        // drain the receiver so everything is acked
+        std::vector<std::uint8_t> buf(payload.size());
+        std::size_t received = 0;
+        while (received < Sends * payload.size()) {
+            ssize_t const nbytes = ::recv(client, buf.data(), buf.size(), 0);
+            REQUIRE(nbytes > 0);
+            received += static_cast<std::size_t>(nbytes);
+        }
+
+        zerocopy_completions completions;
+        for (int attempt = 0; attempt < 100 && completions.released < Sends; ++attempt) {
+            pollfd pfd{server, 0, 0};
+            ::poll(&pfd, 1, 10); // errors are always reported
+            REQUIRE(read_zerocopy_completions(server, completions));
+        }
+        REQUIRE(completions.released == Sends);
+        REQUIRE(completions.copied <= completions.released);
+    }
+
+    SECTION("without SO_ZEROCOPY the flag is ignored")
+    {
+        char const c = 'x';
+        REQUIRE(::send(server, &c, 1, MSG_ZEROCOPY) == 1);
+
+        zerocopy_completions completions;
+        REQUIRE(read_zerocopy_completions(server, completions));
+        REQUIRE(completions.released == 0);
+    }
+
+    ::close(client);
+    ::close(server);
+}
+
+} // namespace ws::test
@@ -0,0 +1,120 @@
+#include "util/loop_arena.hpp"
+#include "ws/batch.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    std::vector<std::uint8_t>
+    bytes(std::string const& s)
+    {
+        return {s.begin(), s.end()};
+    }
+
+    /// Every message of \c batch; \c false if it is malformed
+    bool
+    unpack(std::span<std::uint8_t const> batch, std::vector<std::vector<std::uint8_t>>& out)
+    {
+        out.clear();
+        batch_reader reader(batch);
+        for (std::span<std::uint8_t const> message; reader.next(message);) {
+            out.emplace_back(message.begin(), message.end());
+        }
+        return !reader.error();
+    }
+} // namespace
+
+
+TEST_CASE("encode_batch_prefix", "[batch]")
+{
+    std::uint8_t out[MaxBatchPrefixSize] = {};
+    REQUIRE(encode_batch_prefix(out, 0) == 1);
+    REQUIRE(out[0] == 0x00);
+    REQUIRE(encode_batch_prefix(out, 127) == 1);
+    REQUIRE(out[0] == 0x7f);
+    REQUIRE(encode_batch_prefix(out, 128) == 2);
+    REQUIRE(out[0] == 0x80);
+    REQUIRE(out[1] == 0x01);
+    REQUIRE(encode_batch_prefix(out, 300) == 2);
+    REQUIRE(out[0] == 0xac);
+    REQUIRE(out[1] == 0x02);
+    REQUIRE(encode_batch_prefix(out, 0xffff'ffff) == MaxBatchPrefixSize);
+    REQUIRE(out[4] == 0x0f);
+}
+
+TEST_CASE("batch round trip", "[batch]")
+{
+    std::vector<std::vector<std::uint8_t>> const messages{
+            bytes("hello"), {}, std::vector<std::uint8_t>(127, 'a'),
+            std::vector<std::uint8_t>(128, 'b'), std::vector<std::uint8_t>(70'000, 'c')};
+
+    batch_writer writer;
+    REQUIRE(writer.empty());
+    for (auto const& message : messages) {
+        writer.add(message);
+    }
+    REQUIRE(writer.size() == messages.size());
+    REQUIRE(writer.data().size() == 1 + 5 + 1 + 1 + 127 + 2 + 128 + 3 + 70'000);
+
+    std::vector<std::vector<std::uint8_t>> unpacked;
+    REQUIRE(unpack(writer.data(), unpacked));
+    REQUIRE(unpacked == messages);
+
+    SECTION("messages point into the batch")
+    {
+        batch_reader reader(writer.data());
+        std::span<std::uint8_t const> message;
+        REQUIRE(reader.next(message));
+        REQUIRE(message.data() == writer.data().data() + 1);
+    }
+
+    SECTION("clear starts over")
+    {
+        writer.clear();
+        REQUIRE(writer.empty());
+        writer.add(std::string_view("x"));
+        REQUIRE(unpack(writer.data(), unpacked));
+        REQUIRE(unpacked == std::vector<std::vector<std::uint8_t>>{bytes("x")});
+    }
+
+    SECTION("from an arena")
+    {
+        loop_arena arena;
+        batch_writer arena_writer(&arena);
+        arena_writer.add(messages[0]);
+        REQUIRE(unpack(arena_writer.data(), unpacked));
+        REQUIRE(unpacked.size() == 1);
+        REQUIRE(unpacked[0] == messages[0]);
+    }
+}
+
+TEST_CASE("malformed batches", "[batch]")
+{
+    std::vector<std::vector<std::uint8_t>> unpacked;
+
+    // an empty batch holds no messages
+    REQUIRE(unpack({}, unpacked));
+    REQUIRE(unpacked.empty());
+
+    // a message running past the end
+    std::vector<std::uint8_t> const short_message{0x05, 'a', 'b'};
+    REQUIRE_FALSE(unpack(short_message, unpacked));
+
+    // a prefix cut off, or longer than 5 bytes
+    std::vector<std::uint8_t> const cut_prefix{0x01, 'a', 0x80};
+    REQUIRE_FALSE(unpack(cut_prefix, unpacked));
+    REQUIRE(unpacked.size() == 1);
+    std::vector<std::uint8_t> const long_prefix{0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    REQUIRE_FALSE(unpack(long_prefix, unpacked));
+
+    // over 2^32 - 1 bytes
+    std::vector<std::uint8_t> const too_long{0xff, 0xff, 0xff, 0xff, 0x1f};
+    REQUIRE_FALSE(unpack(too_long, unpacked));
+}
+
+} // namespace ws::test
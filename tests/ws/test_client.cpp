@@ -0,0 +1,472 @@
+#include "ws/client.hpp"
+#include "ws/frame.hpp"
+#include "ws/frame_header.hpp"
+#include "ws/handshake.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator> // std::size
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace ws::test {
+
+namespace {
+    using namespace std::chrono_literals;
+
+    static constexpr auto Deadline = 2s; ///< how long a test waits for anything
+
+    /// What the client reported through its callbacks
+    struct client_events
+    {
+        std::vector<std::uint64_t> opened;
+        std::vector<std::pair<OpCode, std::string>> messages;
+        std::vector<std::pair<std::uint64_t, std::uint16_t>> closed;
+    };
+
+    client_config
+    make_config(client_events& events)
+    {
+        client_config config;
+        config.reconnect = false;
+        config.on_open = [&events](std::uint64_t id) { events.opened.push_back(id); };
+        config.on_message
+                = [&events](std::uint64_t, OpCode op_code, std::span<std::uint8_t const> payload) {
+                      events.messages.emplace_back(
+                              op_code, std::string(payload.begin(), payload.end()));
+                  };
+        config.on_close = [&events](std::uint64_t id, std::uint16_t code) {
+            events.closed.emplace_back(id, code);
+        };
+        return config;
+    }
+
+    /// poll() \c c until \c done, or fail the test after Deadline
+    void
+    poll_until(client& c, std::function<bool()> const& done)
+    {
+        auto const until = std::chrono::steady_clock::now() + Deadline;
+        while (!done()) {
+            REQUIRE(std::chrono::steady_clock::now() < until);
+            REQUIRE(c.poll(1ms));
+        }
+    }
+
+    /// poll() \c c for a while, for it to take in whatever was sent
+    void
+    poll_for(client& c, std::chrono::milliseconds duration)
+    {
+        auto const until = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < until) {
+            REQUIRE(c.poll(1ms));
+        }
+    }
+
+    /// Close code carried by a close frame
+    std::uint16_t
+    close_code(frame const& f)
+    {
+        auto const payload = f.get_payload_data();
+        REQUIRE(payload.size() >= 2);
+        return static_cast<std::uint16_t>((payload[0] << 8) | payload[1]);
+    }
+
+    /*! \class  scripted_server
+     *  \brief  Loopback listener standing in for a websocket server: the
+     *          test decides every byte it sends and reads back what the
+     *          client sent, polling the client meanwhile.
+     */
+    class scripted_server
+    {
+    public:
+        scripted_server()
+        {
+            listener_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t len = sizeof(addr);
+            REQUIRE(::bind(listener_, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == 0);
+            REQUIRE(::listen(listener_, 4) == 0);
+            REQUIRE(::getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+            port_ = ntohs(addr.sin_port);
+        }
+
+        ~scripted_server()
+        {
+            drop();
+            ::close(listener_);
+        }
+
+        scripted_server(scripted_server const&) = delete;
+        scripted_server& operator=(scripted_server const&) = delete;
+
+        std::string
+        address() const
+        {
+            return "127.0.0.1:" + std::to_string(port_);
+        }
+
+        /// Accept the client's next connection attempt
+        void
+        accept(client& c)
+        {
+            drop();
+            poll_until(c, [this] {
+                fd_ = ::accept(listener_, nullptr, nullptr);
+                return fd_ != -1;
+            });
+        }
+
+        /// Read the upgrade request
+        /// \return its Sec-WebSocket-Key
+        std::string
+        read_request(client& c)
+        {
+            static constexpr std::string_view KeyField = "\r\nSec-WebSocket-Key: ";
+
+            std::size_t end = std::string_view::npos;
+            poll_until(c, [&] {
+                receive();
+                end = as_string().find("\r\n\r\n");
+                return end != std::string_view::npos;
+            });
+            std::string_view const request = as_string().substr(0, end + 2);
+            std::size_t const field = request.find(KeyField);
+            REQUIRE(field != std::string_view::npos);
+            std::size_t const key = field + KeyField.size();
+            std::string result(request.substr(key, request.find("\r\n", key) - key));
+            in_.erase(in_.begin(), in_.begin() + static_cast<std::ptrdiff_t>(end + 4));
+            return result;
+        }
+
+        /// Accept the next attempt and answer its upgrade request
+        void
+        upgrade(client& c)
+        {
+            accept(c);
+            send(response(websocket_accept_key(read_request(c))));
+        }
+
+        static std::string
+        response(std::string_view accept)
+        {
+            return std::string("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n")
+                    + "Connection: Upgrade\r\nSec-WebSocket-Accept: " + std::string(accept)
+                    + "\r\n\r\n";
+        }
+
+        /// Send raw bytes
+        void
+        send(std::string_view bytes)
+        {
+            REQUIRE(::send(fd_, bytes.data(), bytes.size(), MSG_NOSIGNAL)
+                    == static_cast<ssize_t>(bytes.size()));
+        }
+
+        /// Send an unmasked frame
+        void
+        send_frame(OpCode op_code, std::string_view payload, bool fin = true)
+        {
+            send(make_frame(op_code, payload, fin));
+        }
+
+        static std::string
+        make_frame(OpCode op_code, std::string_view payload, bool fin = true)
+        {
+            std::string bytes(frame_header_size(payload.size()), '\0');
+            encode_frame_header(
+                    reinterpret_cast<std::uint8_t*>(bytes.data()), op_code, payload.size(), fin);
+            return bytes.append(payload);
+        }
+
+        /// Read the next frame the client sent, unmasked
+        frame
+        read_frame(client& c)
+        {
+            frame f;
+            poll_until(c, [&] {
+                receive();
+                return f.parse_from_buffer(in_.data(), in_.size()) == ParseResult::Success;
+            });
+            REQUIRE(f.masked());
+            in_.erase(in_.begin(), in_.begin() + static_cast<std::ptrdiff_t>(f.total_size()));
+            return f;
+        }
+
+        /// \return \c true once the client has closed its end
+        bool
+        client_gone()
+        {
+            receive();
+            return eof_;
+        }
+
+        /// Drop the connection without a close frame
+        void
+        drop()
+        {
+            if (fd_ != -1) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+            in_.clear();
+            eof_ = false;
+        }
+
+    private:
+        void
+        receive()
+        {
+            std::uint8_t buf[4096];
+            for (;;) {
+                ssize_t const nbytes = ::recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+                if (nbytes <= 0) {
+                    eof_ = eof_ || nbytes == 0;
+                    return;
+                }
+                in_.insert(in_.end(), buf, buf + nbytes);
+            }
+        }
+
+        std::string_view
+        as_string() const noexcept
+        {
+            return std::string_view(reinterpret_cast<char const*>(in_.data()), in_.size());
+        }
+
+        int listener_ = -1;
+        int fd_ = -1;
+        std::uint16_t port_ = 0;
+        std::vector<std::uint8_t> in_;
+        bool eof_ = false;
+    };
+} // namespace
+
+
+TEST_CASE("client handshake split across reads", "[client]")
+{
+    client_events events;
+    client c(make_config(events));
+    scripted_server server;
+
+    std::uint64_t const id = c.connect(server.address());
+    server.accept(c);
+    std::string const response
+            = scripted_server::response(websocket_accept_key(server.read_request(c)));
+
+    // the end of the header straddles reads too; a frame comes right behind it
+    std::size_t const cuts[] = {0, 10, response.size() - 3, response.size() - 1};
+    for (std::size_t i = 0; i + 1 < std::size(cuts); ++i) {
+        server.send(std::string_view(response).substr(cuts[i], cuts[i + 1] - cuts[i]));
+        poll_for(c, 10ms);
+        REQUIRE(events.opened.empty());
+        REQUIRE_FALSE(c.is_open(id));
+    }
+    server.send(response.substr(cuts[std::size(cuts) - 1])
+            + scripted_server::make_frame(OpCode::Text, "first"));
+
+    poll_until(c, [&] { return !events.messages.empty(); });
+    REQUIRE(events.opened == std::vector<std::uint64_t>{id});
+    REQUIRE(c.is_open(id));
+    REQUIRE(events.messages.front() == std::pair<OpCode, std::string>(OpCode::Text, "first"));
+    REQUIRE(c.stats().connections_opened == 1);
+    REQUIRE(c.stats().handshake_failures == 0);
+}
+
+TEST_CASE("client rejects a bad Sec-WebSocket-Accept", "[client]")
+{
+    client_events events;
+    client c(make_config(events));
+    scripted_server server;
+
+    std::uint64_t const id = c.connect(server.address());
+    server.accept(c);
+    std::string const key = server.read_request(c);
+    server.send(scripted_server::response(websocket_accept_key(key + "x")));
+
+    poll_until(c, [&] { return server.client_gone(); });
+    REQUIRE(events.opened.empty());
+    REQUIRE(events.closed.empty()); // never open, nobody to tell
+    REQUIRE_FALSE(c.is_open(id));
+    REQUIRE(c.size() == 0);
+    REQUIRE(c.stats().handshake_failures == 1);
+    REQUIRE(c.stats().connect_failures == 1);
+    REQUIRE(c.stats().connections_opened == 0);
+}
+
+TEST_CASE("client reassembles fragmented messages", "[client]")
+{
+    client_events events;
+    client c(make_config(events));
+    scripted_server server;
+
+    std::uint64_t const id = c.connect(server.address());
+    server.upgrade(c);
+    poll_until(c, [&] { return c.is_open(id); });
+
+    // a ping between the fragments is answered at once
+    server.send_frame(OpCode::Text, "hel", /*fin=*/false);
+    server.send_frame(OpCode::Ping, "ping");
+    server.send_frame(OpCode::Continuation, "lo ", /*fin=*/false);
+    server.send_frame(OpCode::Continuation, "world");
+    server.send_frame(OpCode::Binary, "", /*fin=*/false);
+    server.send_frame(OpCode::Continuation, "bin");
+
+    frame const pong = server.read_frame(c);
+    REQUIRE(pong.op_code() == OpCode::Pong);
+    REQUIRE(std::string(pong.get_payload_data().begin(), pong.get_payload_data().end()) == "ping");
+
+    poll_until(c, [&] { return events.messages.size() == 2; });
+    REQUIRE(events.messages[0] == std::pair<OpCode, std::string>(OpCode::Text, "hello world"));
+    REQUIRE(events.messages[1] == std::pair<OpCode, std::string>(OpCode::Binary, "bin"));
+    REQUIRE(c.stats().messages_received == 2);
+    REQUIRE(c.is_open(id));
+}
+
+TEST_CASE("client closes with 1002 on protocol errors", "[client]")
+{
+    client_events events;
+    client c(make_config(events));
+    scripted_server server;
+
+    std::uint64_t const id = c.connect(server.address());
+    server.upgrade(c);
+    poll_until(c, [&] { return c.is_open(id); });
+
+    SECTION("masked frame")
+    {
+        // mask bit, a zero key
+        server.send(std::string("\x81\x81\0\0\0\0x", 7));
+    }
+    SECTION("reserved bit")
+    {
+        std::string bytes = scripted_server::make_frame(OpCode::Text, "x");
+        bytes[0] = static_cast<char>(bytes[0] | 0x40);
+        server.send(bytes);
+    }
+    SECTION("reserved opcode")
+    {
+        server.send(std::string("\x83\x00", 2));
+    }
+    SECTION("fragmented control frame")
+    {
+        server.send_frame(OpCode::Ping, "", /*fin=*/false);
+    }
+    SECTION("oversized control frame")
+    {
+        server.send_frame(OpCode::Ping, std::string(MaxControlPayloadSize + 1, 'p'));
+    }
+    SECTION("continuation without a message")
+    {
+        server.send_frame(OpCode::Continuation, "x");
+    }
+    SECTION("new message before the last one ended")
+    {
+        server.send_frame(OpCode::Text, "a", /*fin=*/false);
+        server.send_frame(OpCode::Text, "b");
+    }
+    SECTION("one byte close payload")
+    {
+        server.send_frame(OpCode::Close, "x");
+    }
+
+    frame const close = server.read_frame(c);
+    REQUIRE(close.op_code() == OpCode::Close);
+    REQUIRE(close_code(close) == 1002);
+    poll_until(c, [&] { return !events.closed.empty(); });
+    REQUIRE(events.closed.front() == std::pair<std::uint64_t, std::uint16_t>(id, 1002));
+    REQUIRE(events.messages.empty());
+    REQUIRE_FALSE(c.is_open(id));
+    REQUIRE(c.size() == 0);
+}
+
+TEST_CASE("client closes with 1009 on messages over max_message_size", "[client]")
+{
+    client_events events;
+    client_config config = make_config(events);
+    config.max_message_size = 16;
+    client c(config);
+    scripted_server server;
+
+    std::uint64_t const id = c.connect(server.address());
+    server.upgrade(c);
+    poll_until(c, [&] { return c.is_open(id); });
+
+    server.send_frame(OpCode::Binary, std::string(16, 'a'));
+    SECTION("one frame")
+    {
+        server.send_frame(OpCode::Binary, std::string(17, 'b'));
+    }
+    SECTION("fragments")
+    {
+        server.send_frame(OpCode::Binary, std::string(10, 'b'), /*fin=*/false);
+        server.send_frame(OpCode::Continuation, std::string(7, 'b'));
+    }
+    SECTION("header only")
+    {
+        // rejected before the payload arrives
+        server.send(scripted_server::make_frame(OpCode::Binary, std::string(70'000, 'b'))
+                            .substr(0, 10));
+    }
+
+    frame const close = server.read_frame(c);
+    REQUIRE(close.op_code() == OpCode::Close);
+    REQUIRE(close_code(close) == 1009);
+    poll_until(c, [&] { return !events.closed.empty(); });
+    REQUIRE(events.closed.front() == std::pair<std::uint64_t, std::uint16_t>(id, 1009));
+    REQUIRE(events.messages.size() == 1); // the one that fit
+}
+
+TEST_CASE("client reconnects after a drop", "[client]")
+{
+    client_events events;
+    client_config config = make_config(events);
+    config.reconnect = true;
+    config.backoff_min = 10ms;
+    config.backoff_max = 20ms;
+    client c(config);
+    scripted_server server;
+
+    std::uint64_t const id = c.connect(server.address());
+    server.upgrade(c);
+    poll_until(c, [&] { return c.is_open(id); });
+
+    // gone without a close frame: 1006, then the same id comes back
+    server.drop();
+    poll_until(c, [&] { return !events.closed.empty(); });
+    REQUIRE(events.closed.front() == std::pair<std::uint64_t, std::uint16_t>(id, 1006));
+    REQUIRE_FALSE(c.is_open(id));
+    REQUIRE(c.size() == 1);
+
+    server.upgrade(c);
+    poll_until(c, [&] { return events.opened.size() == 2; });
+    REQUIRE(events.opened == std::vector<std::uint64_t>{id, id});
+    REQUIRE(c.is_open(id));
+    REQUIRE(c.stats().connect_attempts == 2);
+    REQUIRE(c.stats().connections_opened == 2);
+
+    // and works
+    REQUIRE(c.send_text(id, "again"));
+    frame const message = server.read_frame(c);
+    REQUIRE(message.get_text_payload() == "again");
+
+    // closed for good: no more attempts
+    c.close(id);
+    frame const close = server.read_frame(c);
+    REQUIRE(close.op_code() == OpCode::Close);
+    REQUIRE(close_code(close) == 1000);
+    server.send(std::string("\x88\x02\x03\xe8", 4));
+    poll_until(c, [&] { return c.size() == 0; });
+    REQUIRE(events.closed.size() == 2);
+    REQUIRE(c.stats().connect_attempts == 2);
+}
+
+} // namespace ws::test
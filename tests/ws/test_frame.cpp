@@ -1,5 +1,8 @@
+#include "util/loop_arena.hpp"
 #include "ws/frame.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <memory_resource>
+#include <vector>
 
 namespace ws::test {
 
@@ -54,6 +57,59 @@ TEST_CASE("frame", "[frame]")
         REQUIRE(frame.get_raw_payload_data().empty());
         REQUIRE_FALSE(frame.get_text_payload());
     }
+
+    SECTION("take payload")
+    {
+        // masked binary frame, payload "abc" with an all-zero mask
+        std::uint8_t const data[] = {0x82, 0x83, 0, 0, 0, 0, 'a', 'b', 'c'};
+
+        ws::frame frame;
+        REQUIRE(frame.parse_from_buffer(data, sizeof(data)) == ws::ParseResult::Success);
+        std::uint8_t const* const payload = frame.get_payload_data().data();
+
+        std::pmr::vector<std::uint8_t> const taken = frame.take_payload_data();
+        REQUIRE(taken == std::pmr::vector<std::uint8_t>{'a', 'b', 'c'});
+        REQUIRE(taken.data() == payload); // moved, not copied
+        REQUIRE(frame.get_payload_data().empty());
+        REQUIRE(frame.payload_len() == 3);
+    }
+
+    SECTION("payload from an arena")
+    {
+        // masked text frame, payload "abc" with an all-zero mask
+        std::uint8_t const data[] = {0x81, 0x83, 0, 0, 0, 0, 'a', 'b', 'c'};
+
+        ws::loop_arena arena;
+        ws::frame frame(&arena);
+        REQUIRE(frame.parse_from_buffer(data, sizeof(data)) == ws::ParseResult::Success);
+        REQUIRE(frame.get_text_view() == "abc");
+        REQUIRE(frame.get_text_payload() == "abc");
+        REQUIRE(arena.heap_allocations() == 1);
+        REQUIRE(frame.take_payload_data().get_allocator().resource() == &arena);
+    }
+
+    SECTION("header only")
+    {
+        // unmasked binary frame with a 16-bit length of 300, payload not there yet
+        std::uint8_t const data[] = {0x82, 126, 0x01, 0x2c, 'a'};
+
+        ws::frame frame;
+        REQUIRE(frame.parse_header(data, 3) == ws::ParseResult::NeedMoreData);
+        REQUIRE(frame.parse_header(data, sizeof(data)) == ws::ParseResult::Success);
+        REQUIRE(frame.header_size() == 4);
+        REQUIRE(frame.payload_len() == 300);
+        REQUIRE(frame.get_payload_data().empty());
+        REQUIRE(frame.parse_from_buffer(data, sizeof(data)) == ws::ParseResult::NeedMoreData);
+
+        // rejected without waiting for the payload
+        std::uint8_t const long_ping[] = {0x89, 126, 0x01, 0x2c};
+        REQUIRE(frame.parse_header(long_ping, sizeof(long_ping)) == ws::ParseResult::InvalidFrame);
+        REQUIRE(frame.parse_from_buffer(long_ping, sizeof(long_ping))
+                == ws::ParseResult::InvalidFrame);
+        std::uint8_t const reserved_bit[] = {0xc2, 126, 0x01, 0x2c};
+        REQUIRE(frame.parse_header(reserved_bit, sizeof(reserved_bit))
+                == ws::ParseResult::InvalidFrame);
+    }
 }
 
 } // namespace ws::test
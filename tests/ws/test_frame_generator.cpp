@@ -1,8 +1,10 @@
 #include "ws/frame.hpp"
 #include "ws/frame_generator.hpp"
 #include <catch2/catch_test_macros.hpp>
-#include <bit>  // std::byteswap
-#include <span> // std::byteswap
+#include <algorithm> // std::ranges::equal
+#include <bit>       // std::byteswap
+#include <span>      // std::byteswap
+#include <vector>
 
 
 namespace ws::test {
@@ -895,6 +897,46 @@ TEST_CASE("frame_generator", "[frame_generator]")
             REQUIRE(parsed_frame3.op_code() == OpCode::Continuation);
         }
     }
+
+    SECTION("masking")
+    {
+        SECTION("masked payload of every length round-trips")
+        {
+            std::vector<std::uint8_t> payload;
+            for (std::size_t len = 0; len <= 40; ++len) {
+                auto out_frame = ws::frame_generator{}.binary(payload, /*fin=*/true, /*mask=*/true);
+
+                ws::frame frame;
+                REQUIRE(frame.parse_from_buffer(out_frame.data().data(), out_frame.size())
+                        == ParseResult::Success);
+                REQUIRE(frame.masked());
+                REQUIRE(std::ranges::equal(frame.get_payload_data(), payload));
+
+                payload.push_back(static_cast<std::uint8_t>(len * 37));
+            }
+        }
+
+        SECTION("consecutive frames use different masks")
+        {
+            auto frame1 = ws::frame_generator{}.text("hi", /*fin=*/true, /*mask=*/true);
+            auto frame2 = ws::frame_generator{}.text("hi", /*fin=*/true, /*mask=*/true);
+
+            ws::frame parsed1, parsed2;
+            REQUIRE(parsed1.parse_from_buffer(frame1.data().data(), frame1.size())
+                    == ParseResult::Success);
+            REQUIRE(parsed2.parse_from_buffer(frame2.data().data(), frame2.size())
+                    == ParseResult::Success);
+            REQUIRE_FALSE(std::ranges::equal(parsed1.masking_key(), parsed2.masking_key()));
+        }
+    }
+
+    SECTION("websocket key")
+    {
+        std::string const key1 = ws::frame_generator::generate_websocket_key();
+        std::string const key2 = ws::frame_generator::generate_websocket_key();
+        REQUIRE(key1.size() == 24); // base64 of 16 bytes
+        REQUIRE(key1 != key2);
+    }
 }
 
 } // namespace ws::test
@@ -0,0 +1,142 @@
+#include "ws/frame.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/frame_header.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm> // std::equal
+#include <array>
+#include <vector>
+
+
+namespace ws::test {
+
+// everything below is usable at compile time
+static_assert(CloseNormalFrame == std::array<std::uint8_t, 4>{0x88, 0x02, 0x03, 0xe8});
+static_assert(CloseGoingAwayFrame == std::array<std::uint8_t, 4>{0x88, 0x02, 0x03, 0xe9});
+static_assert(EmptyPingFrame == std::array<std::uint8_t, 2>{0x89, 0x00});
+static_assert(EmptyPongFrame == std::array<std::uint8_t, 2>{0x8a, 0x00});
+static_assert(frame_header_size(0) == 2);
+static_assert(frame_header_size(125) == 2);
+static_assert(frame_header_size(126) == 4);
+static_assert(frame_header_size(65535) == 4);
+static_assert(frame_header_size(65536) == 10);
+static_assert(frame_header_size(65536, /*masked=*/true) == MaxFrameHeaderSize);
+static_assert(control_frame_buffer(OpCode::Pong).size() == 2);
+
+
+TEST_CASE("encode_frame_header", "[frame_header]")
+{
+    SECTION("matches frame_generator")
+    {
+        for (std::size_t const len : {0UL, 1UL, 125UL, 126UL, 127UL, 65535UL, 65536UL, 70000UL}) {
+            std::vector<std::uint8_t> const payload(len, 'x');
+            for (OpCode const op : {OpCode::Text, OpCode::Binary, OpCode::Continuation}) {
+                for (bool const fin : {true, false}) {
+                    frame_generator gen;
+                    if (op == OpCode::Text) {
+                        gen.text(std::string_view(
+                                         reinterpret_cast<char const*>(payload.data()), len),
+                                fin);
+                    } else if (op == OpCode::Binary) {
+                        gen.binary(payload, fin);
+                    } else {
+                        gen.continuation(payload, fin);
+                    }
+
+                    std::uint8_t header[MaxFrameHeaderSize] = {};
+                    std::size_t const size = encode_frame_header(header, op, len, fin);
+                    REQUIRE(size == frame_header_size(len));
+                    REQUIRE(size + len == gen.size());
+                    REQUIRE(std::equal(header, header + size, gen.data().begin()));
+                }
+            }
+        }
+    }
+
+    SECTION("masked")
+    {
+        std::uint8_t const key[4] = {0x11, 0x22, 0x33, 0x44};
+        std::array<std::uint8_t, MaxFrameHeaderSize + 3> buf{};
+        std::size_t const size = encode_frame_header(buf.data(), OpCode::Text, 3, true, key);
+        REQUIRE(size == 6);
+        for (std::size_t i = 0; i < 3; ++i) {
+            buf[size + i] = static_cast<std::uint8_t>('a' + i) ^ key[i % 4];
+        }
+
+        frame f;
+        REQUIRE(f.parse_from_buffer(buf.data(), size + 3) == ParseResult::Success);
+        REQUIRE(f.masked());
+        REQUIRE(f.op_code() == OpCode::Text);
+        REQUIRE(f.get_text_payload() == "abc");
+    }
+}
+
+TEST_CASE("copy_masked", "[frame_header]")
+{
+    std::array<std::uint8_t, 4> const key = {0xa1, 0x5b, 0x07, 0xfe};
+    for (std::size_t const len : {0UL, 1UL, 7UL, 8UL, 9UL, 63UL, 64UL, 1000UL}) {
+        std::vector<std::uint8_t> payload(len);
+        for (std::size_t i = 0; i < len; ++i) {
+            payload[i] = static_cast<std::uint8_t>(i * 31);
+        }
+
+        std::vector<std::uint8_t> copied(len);
+        copy_masked(copied.data(), payload, key);
+
+        std::vector<std::uint8_t> masked = payload;
+        apply_mask(masked, key);
+        REQUIRE(copied == masked);
+
+        // masking twice gives the original back
+        apply_mask(copied, key);
+        REQUIRE(copied == payload);
+    }
+}
+
+TEST_CASE("control frames", "[frame_header]")
+{
+    SECTION("prebuilt close frames parse")
+    {
+        frame f;
+        REQUIRE(f.parse_from_buffer(CloseGoingAwayFrame.data(), CloseGoingAwayFrame.size())
+                == ParseResult::Success);
+        REQUIRE(f.op_code() == OpCode::Close);
+        REQUIRE(f.fin());
+        auto const payload = f.get_payload_data();
+        REQUIRE(payload.size() == 2);
+        REQUIRE(((payload[0] << 8) | payload[1]) == 1001);
+
+        auto const gen = frame_generator{}.close(1000);
+        REQUIRE(std::equal(CloseNormalFrame.begin(), CloseNormalFrame.end(), gen.data().begin(),
+                gen.data().end()));
+    }
+
+    SECTION("pong with payload")
+    {
+        std::array<std::uint8_t, 5> const payload = {'h', 'e', 'l', 'l', 'o'};
+        control_frame_buffer const pong(OpCode::Pong, payload);
+
+        auto const gen = frame_generator{}.pong(payload);
+        REQUIRE(std::equal(pong.data().begin(), pong.data().end(), gen.data().begin(),
+                gen.data().end()));
+    }
+
+    SECTION("max payload")
+    {
+        std::array<std::uint8_t, MaxControlPayloadSize> const payload{};
+        control_frame_buffer const pong(OpCode::Pong, payload);
+        REQUIRE(pong.size() == MinFrameHeaderSize + MaxControlPayloadSize);
+
+        frame f;
+        REQUIRE(f.parse_from_buffer(pong.data().data(), pong.size()) == ParseResult::Success);
+        REQUIRE(f.payload_len() == MaxControlPayloadSize);
+    }
+
+    SECTION("oversized payload is truncated")
+    {
+        std::array<std::uint8_t, MaxControlPayloadSize + 10> const payload{};
+        control_frame_buffer const pong(OpCode::Pong, payload);
+        REQUIRE(pong.size() == MinFrameHeaderSize + MaxControlPayloadSize);
+    }
+}
+
+} // namespace ws::test
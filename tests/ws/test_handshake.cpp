@@ -0,0 +1,143 @@
+#include "util/loop_arena.hpp"
+#include "ws/frame_generator.hpp"
+#include "ws/handshake.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <memory_resource>
+#include <string>
+
+
+namespace ws::test {
+
+namespace {
+    // rfc 6455 1.3
+    static constexpr char SampleKey[] = "dGhlIHNhbXBsZSBub25jZQ==";
+    static constexpr char SampleAccept[] = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+    std::string
+    response_with(std::string const& fields)
+    {
+        return "HTTP/1.1 101 Switching Protocols\r\n" + fields + "\r\n";
+    }
+} // namespace
+
+
+TEST_CASE("websocket_accept_key", "[handshake]")
+{
+    REQUIRE(websocket_accept_key(SampleKey) == SampleAccept);
+
+    std::string const key = frame_generator::generate_websocket_key();
+    REQUIRE(websocket_accept_key(key).size() == 28);
+    REQUIRE(websocket_accept_key(key) == websocket_accept_key(key));
+
+    loop_arena arena;
+    std::pmr::string const accept = websocket_accept_key(SampleKey, &arena);
+    REQUIRE(accept == SampleAccept);
+    REQUIRE(accept.get_allocator().resource() == &arena);
+}
+
+TEST_CASE("make_upgrade_request", "[handshake]")
+{
+    std::string const request = make_upgrade_request("example.com:9000", "/feed?x=1", SampleKey);
+    REQUIRE(request.starts_with("GET /feed?x=1 HTTP/1.1\r\n"));
+    REQUIRE(request.contains("\r\nHost: example.com:9000\r\n"));
+    REQUIRE(request.contains("\r\nUpgrade: websocket\r\n"));
+    REQUIRE(request.contains("\r\nConnection: Upgrade\r\n"));
+    REQUIRE(request.contains(std::string("\r\nSec-WebSocket-Key: ") + SampleKey + "\r\n"));
+    REQUIRE(request.contains("\r\nSec-WebSocket-Version: 13\r\n"));
+    REQUIRE(request.ends_with("\r\n\r\n"));
+    REQUIRE_FALSE(request.contains("Sec-WebSocket-Protocol"));
+
+    std::string const offer = make_upgrade_request("example.com", "/", SampleKey, "batch.v1");
+    REQUIRE(offer.contains("\r\nSec-WebSocket-Protocol: batch.v1\r\n"));
+    REQUIRE(offer.ends_with("\r\n\r\n"));
+}
+
+TEST_CASE("validate_upgrade_response", "[handshake]")
+{
+    std::string const accept = std::string("Sec-WebSocket-Accept: ") + SampleAccept + "\r\n";
+
+    SECTION("accepted")
+    {
+        REQUIRE(validate_upgrade_response(
+                response_with("Upgrade: websocket\r\nConnection: Upgrade\r\n" + accept),
+                SampleAccept));
+    }
+
+    SECTION("field names and tokens are case-insensitive")
+    {
+        REQUIRE(validate_upgrade_response(
+                response_with("UPGRADE: WebSocket\r\nconnection: keep-alive, upgrade\r\n"
+                              "sec-websocket-accept:"
+                        + std::string(SampleAccept) + "  \r\n"),
+                SampleAccept));
+    }
+
+    SECTION("wrong status")
+    {
+        REQUIRE_FALSE(validate_upgrade_response(
+                "HTTP/1.1 200 OK\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n" + accept
+                        + "\r\n",
+                SampleAccept));
+        REQUIRE_FALSE(validate_upgrade_response(
+                "HTTP/1.1 1010 Nope\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n" + accept
+                        + "\r\n",
+                SampleAccept));
+    }
+
+    SECTION("wrong or missing accept")
+    {
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                              "Sec-WebSocket-Accept: AAAAAAAAAAAAAAAAAAAAAAAAAAA=\r\n"),
+                SampleAccept));
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Upgrade: websocket\r\nConnection: Upgrade\r\n"), SampleAccept));
+    }
+
+    SECTION("missing upgrade or connection")
+    {
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Connection: Upgrade\r\n" + accept), SampleAccept));
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Upgrade: websocket\r\nConnection: close\r\n" + accept),
+                SampleAccept));
+    }
+
+    SECTION("extension or subprotocol we didn't ask for")
+    {
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Upgrade: websocket\r\nConnection: Upgrade\r\n" + accept
+                        + "Sec-WebSocket-Extensions: permessage-deflate\r\n"),
+                SampleAccept));
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Upgrade: websocket\r\nConnection: Upgrade\r\n" + accept
+                        + "Sec-WebSocket-Protocol: chat\r\n"),
+                SampleAccept));
+    }
+
+    SECTION("subprotocol we offered")
+    {
+        std::string const fields = "Upgrade: websocket\r\nConnection: Upgrade\r\n" + accept;
+        REQUIRE(validate_upgrade_response(
+                response_with(fields + "Sec-WebSocket-Protocol: batch.v1\r\n"), SampleAccept,
+                "batch.v1"));
+
+        // declined, or answered with another one
+        REQUIRE_FALSE(validate_upgrade_response(response_with(fields), SampleAccept, "batch.v1"));
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with(fields + "Sec-WebSocket-Protocol: chat\r\n"), SampleAccept,
+                "batch.v1"));
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with(fields + "Sec-WebSocket-Protocol: BATCH.V1\r\n"), SampleAccept,
+                "batch.v1"));
+    }
+
+    SECTION("malformed")
+    {
+        REQUIRE_FALSE(validate_upgrade_response("", SampleAccept));
+        REQUIRE_FALSE(validate_upgrade_response(
+                response_with("Upgrade websocket\r\n" + accept), SampleAccept));
+    }
+}
+
+} // namespace ws::test